@@ -4,6 +4,7 @@
 
 #include "base/bitset.h"
 
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 #include <string>
@@ -103,7 +104,7 @@ static int num_bits_set(uint64_t value) {
 }
 
 // Position pos is w.r.t the entire bitset, starts at 0.
-// Index    idx is the block number i.e. the index in the vector, starts at 0.
+// Index    idx is the block number in the dense encoding, starts at 0.
 // Offset   offset is w.r.t a given 64 bit block, starts at 0.
 static inline size_t block_index(size_t pos) {
     return pos / 64;
@@ -117,75 +118,413 @@ static inline size_t bit_position(size_t idx, size_t offset) {
     return (idx * 64 + offset);
 }
 
+//
+// Header for a run of blocks in the sparse encoding.  The upper 32 bits
+// hold the index of the first block and the lower 32 bits the number of
+// blocks in the run.
+//
+static inline uint64_t run_header(size_t idx, size_t len) {
+    return (static_cast<uint64_t>(idx) << 32) | len;
+}
+
+static inline size_t run_start(uint64_t header) {
+    return header >> 32;
+}
+
+static inline size_t run_length(uint64_t header) {
+    return header & 0xFFFFFFFFULL;
+}
+
+//
+// Build the sparse encoding from a sequence of blocks in increasing order
+// of index.  Blocks that are 0 are skipped.
+//
+class BlockBuilder {
+public:
+    BlockBuilder() : header_(BitSet::npos), last_(BitSet::npos) {
+    }
+
+    void Append(size_t idx, uint64_t value) {
+        if (value == 0)
+            return;
+        if (header_ != BitSet::npos && idx == last_ + 1) {
+            runs_[header_]++;
+        } else {
+            header_ = runs_.size();
+            runs_.push_back(run_header(idx, 1));
+        }
+        runs_.push_back(value);
+        last_ = idx;
+    }
+
+    const vector<uint64_t> &runs() const { return runs_; }
+    size_t block_count() const {
+        return last_ == BitSet::npos ? 0 : last_ + 1;
+    }
+
+private:
+    vector<uint64_t> runs_;
+    size_t header_;
+    size_t last_;
+};
+
+//
+// Iterate through the stored blocks in increasing order of index.  All the
+// blocks are visited for the dense encoding, including ones that are 0.
+//
+class BitSet::Cursor {
+public:
+    explicit Cursor(const BitSet &bitset)
+        : ptr_(bitset.words()), end_(bitset.words() + bitset.size_),
+          sparse_(bitset.sparse_), idx_(0), left_(0) {
+        if (sparse_)
+            ReadHeader();
+    }
+
+    bool valid() const { return ptr_ < end_; }
+    size_t index() const { return idx_; }
+    uint64_t value() const { return *ptr_; }
+
+    void Next() {
+        ptr_++;
+        idx_++;
+        if (sparse_ && --left_ == 0)
+            ReadHeader();
+    }
+
+    //
+    // Move to the first stored block with an index that's at least idx.
+    //
+    void Seek(size_t idx) {
+        while (valid() && idx_ < idx) {
+            if (!sparse_) {
+                size_t skip = std::min(idx - idx_,
+                                       static_cast<size_t>(end_ - ptr_));
+                ptr_ += skip;
+                idx_ += skip;
+            } else if (idx_ + left_ <= idx) {
+                ptr_ += left_;
+                ReadHeader();
+            } else {
+                ptr_ += idx - idx_;
+                left_ -= idx - idx_;
+                idx_ = idx;
+            }
+        }
+    }
+
+private:
+    void ReadHeader() {
+        if (ptr_ >= end_)
+            return;
+        idx_ = run_start(*ptr_);
+        left_ = run_length(*ptr_);
+        ptr_++;
+    }
+
+    const uint64_t *ptr_;
+    const uint64_t *end_;
+    bool sparse_;
+    size_t idx_;
+    size_t left_;
+};
+
 const size_t BitSet::npos;
 
+BitSet::BitSet() : inline_(0), size_(0), capacity_(0), sparse_(0) {
+}
+
+BitSet::BitSet(const BitSet &rhs)
+    : inline_(0), size_(0), capacity_(0), sparse_(0) {
+    assign(rhs.words(), rhs.size_, rhs.sparse_);
+}
+
+BitSet::~BitSet() {
+    if (capacity_)
+        delete [] heap_;
+}
+
+BitSet &BitSet::operator=(const BitSet &rhs) {
+    if (this != &rhs)
+        assign(rhs.words(), rhs.size_, rhs.sparse_);
+    return *this;
+}
+
+//
+// Exchange the contents of two bitsets without copying the heap storage.
+//
+void BitSet::swap(BitSet &rhs) {
+    std::swap(inline_, rhs.inline_);
+    std::swap(size_, rhs.size_);
+    uint32_t capacity = capacity_;
+    capacity_ = rhs.capacity_;
+    rhs.capacity_ = capacity;
+    uint32_t sparse = sparse_;
+    sparse_ = rhs.sparse_;
+    rhs.sparse_ = sparse;
+}
+
+//
+// Make sure that there's room for count words, preserving the contents.
+//
+void BitSet::reserve(size_t count) {
+    if (count <= (capacity_ ? capacity_ : 1))
+        return;
+    uint64_t *heap = new uint64_t[count];
+    memcpy(heap, words(), size_ * sizeof(uint64_t));
+    if (capacity_)
+        delete [] heap_;
+    heap_ = heap;
+    capacity_ = count;
+}
+
+//
+// Grow or shrink the dense encoding to count blocks.  New blocks are 0.
+// Move back to inline storage when possible to give up the heap memory.
+//
+void BitSet::resize(size_t count) {
+    if (count > size_) {
+        reserve(count);
+        memset(words() + size_, 0, (count - size_) * sizeof(uint64_t));
+    } else if (capacity_ && count <= 1) {
+        uint64_t value = count ? heap_[0] : 0;
+        delete [] heap_;
+        capacity_ = 0;
+        inline_ = value;
+    }
+    size_ = count;
+}
+
+//
+// Give up all the storage.
+//
+void BitSet::release() {
+    if (capacity_)
+        delete [] heap_;
+    inline_ = 0;
+    size_ = 0;
+    capacity_ = 0;
+    sparse_ = 0;
+}
+
+//
+// Replace the contents with the given encoding.
+//
+void BitSet::assign(const uint64_t *src, size_t count, bool sparse) {
+    if (capacity_ && count <= 1)
+        release();
+    size_ = 0;
+    reserve(count);
+    memcpy(words(), src, count * sizeof(uint64_t));
+    size_ = count;
+    sparse_ = sparse;
+}
+
+//
+// Replace the contents with the blocks in the given sparse encoding. Use
+// the dense encoding instead if it's no bigger.
+//
+void BitSet::assign_runs(const vector<uint64_t> &runs, size_t block_count) {
+    if (runs.size() < block_count) {
+        assign(&runs[0], runs.size(), true);
+        return;
+    }
+
+    if (capacity_ && block_count <= 1)
+        release();
+    size_ = 0;
+    sparse_ = 0;
+    resize(block_count);
+    uint64_t *blocks = words();
+    for (size_t pos = 0; pos < runs.size(); ) {
+        size_t idx = run_start(runs[pos]);
+        size_t len = run_length(runs[pos]);
+        memcpy(blocks + idx, &runs[pos + 1], len * sizeof(uint64_t));
+        pos += len + 1;
+    }
+}
+
+//
+// Return the number of blocks in the dense encoding.
+//
+size_t BitSet::block_count() const {
+    if (!sparse_)
+        return size_;
+    const uint64_t *ptr = words();
+    size_t idx = 0;
+    for (size_t pos = 0; pos < size_; pos += run_length(ptr[pos]) + 1) {
+        idx = run_start(ptr[pos]) + run_length(ptr[pos]);
+    }
+    return idx;
+}
+
+//
+// Return the block at the given index, 0 if it's not stored.
+//
+uint64_t BitSet::block(size_t idx) const {
+    if (!sparse_)
+        return (idx < size_ ? words()[idx] : 0);
+    Cursor cursor(*this);
+    cursor.Seek(idx);
+    if (cursor.valid() && cursor.index() == idx)
+        return cursor.value();
+    return 0;
+}
+
+//
+// Return a pointer to the stored block at the given index, if any.
+//
+uint64_t *BitSet::find_block(size_t idx) {
+    if (!sparse_)
+        return (idx < size_ ? &words()[idx] : NULL);
+    uint64_t *ptr = words();
+    for (size_t pos = 0; pos < size_; pos += run_length(ptr[pos]) + 1) {
+        size_t start = run_start(ptr[pos]);
+        if (idx < start)
+            return NULL;
+        if (idx < start + run_length(ptr[pos]))
+            return &ptr[pos + 1 + idx - start];
+    }
+    return NULL;
+}
+
+//
+// Set or reset the bits in value for the block at the given index, with
+// the blocks being re-encoded as needed.
+//
+void BitSet::merge_block(size_t idx, uint64_t value, bool set) {
+    BlockBuilder builder;
+    bool done = false;
+    for (Cursor cursor(*this); cursor.valid(); cursor.Next()) {
+        if (!done && cursor.index() > idx) {
+            if (set)
+                builder.Append(idx, value);
+            done = true;
+        }
+        uint64_t current = cursor.value();
+        if (cursor.index() == idx) {
+            current = set ? (current | value) : (current & ~value);
+            done = true;
+        }
+        builder.Append(cursor.index(), current);
+    }
+    if (!done && set)
+        builder.Append(idx, value);
+    assign_runs(builder.runs(), builder.block_count());
+}
+
+//
+// Replace the contents with the result of the given operation on lhs and
+// rhs.  Either of them may be *this, so the result is built on the side.
+//
+void BitSet::merge(const BitSet &lhs, const BitSet &rhs, MergeOp op) {
+    BlockBuilder builder;
+    Cursor lcursor(lhs), rcursor(rhs);
+    while (lcursor.valid() || rcursor.valid()) {
+        size_t lidx = lcursor.valid() ? lcursor.index() : npos;
+        size_t ridx = rcursor.valid() ? rcursor.index() : npos;
+        size_t idx = std::min(lidx, ridx);
+        uint64_t lvalue = (lidx == idx) ? lcursor.value() : 0;
+        uint64_t rvalue = (ridx == idx) ? rcursor.value() : 0;
+        switch (op) {
+        case MERGE_AND:
+            builder.Append(idx, lvalue & rvalue);
+            break;
+        case MERGE_OR:
+            builder.Append(idx, lvalue | rvalue);
+            break;
+        case MERGE_AND_NOT:
+            builder.Append(idx, lvalue & ~rvalue);
+            break;
+        }
+        if (lidx == idx)
+            lcursor.Next();
+        if (ridx == idx)
+            rcursor.Next();
+    }
+    assign_runs(builder.runs(), builder.block_count());
+}
+
+//
+// Set bit at given position, growing the storage if needed.
 //
-// Set bit at given position, growing the vector if needed.
+// Appending a block to the dense encoding keeps it dense.  If there's a
+// gap, let merge_block figure out whether the sparse encoding is better.
 //
 BitSet &BitSet::set(size_t pos) {
     size_t idx = block_index(pos);
-    if (idx >= blocks_.size())
-        blocks_.resize(idx + 1);
-    blocks_[idx] |= 1LL << block_offset(pos);
+    uint64_t value = 1ULL << block_offset(pos);
+    uint64_t *ptr = find_block(idx);
+    if (ptr) {
+        *ptr |= value;
+    } else if (!sparse_ && idx == size_) {
+        resize(idx + 1);
+        words()[idx] = value;
+    } else {
+        merge_block(idx, value, true);
+    }
     return *this;
 }
 
 //
-// Reset bit at given position, shrinking the vector if possible.
+// Reset bit at given position, shrinking the storage if possible.
 //
 BitSet &BitSet::reset(size_t pos) {
     size_t idx = block_index(pos);
-    if (idx < blocks_.size()) {
-        blocks_[idx] &= ~(1LL << block_offset(pos));
+    uint64_t value = 1ULL << block_offset(pos);
+    uint64_t *ptr = find_block(idx);
+    if (!ptr || (*ptr & value) == 0)
+        return *this;
+    if (*ptr != value) {
+        *ptr &= ~value;
+    } else if (!sparse_) {
+        *ptr = 0;
         compact();
+    } else {
+        merge_block(idx, value, false);
     }
     return *this;
 }
 
 // Test bit at given position.
 bool BitSet::test(size_t pos) const {
-    size_t idx = block_index(pos);
-    if (idx < blocks_.size()) {
-        return ((blocks_[idx] & (1LL << block_offset(pos))) != 0);
-    } else {
-        return false;
-    }
+    return ((block(block_index(pos)) & (1ULL << block_offset(pos))) != 0);
 }
 
 //
 // Shortcut to reset all bits in the bitset.
 //
 void BitSet::clear() {
-    blocks_.resize(0);
+    release();
 }
 
 //
 // Return true if there are no bits in the bitset.
 //
 bool BitSet::empty() const {
-    return (blocks_.size() == 0);
+    return (size_ == 0);
 }
 
 //
 // Return true if no bits are set.
 //
 bool BitSet::none() const {
-    return (blocks_.size() == 0);
+    return (size_ == 0);
 }
 
 //
 // Return true at least one bit is set.
 //
 bool BitSet::any() const {
-    return (blocks_.size() != 0);
+    return (size_ != 0);
 }
 
 //
 // Return the raw number of bits in the bitset. Simply depends on the number
-// of blocks in the vector.
+// of blocks in the dense encoding.
 //
 size_t BitSet::size() const {
-    return blocks_.size() * 64;
+    return block_count() * 64;
 }
 
 //
@@ -193,46 +532,55 @@ size_t BitSet::size() const {
 //
 size_t BitSet::count() const {
     size_t count = 0;
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        count += num_bits_set(blocks_[idx]);
+    for (Cursor cursor(*this); cursor.valid(); cursor.Next()) {
+        count += num_bits_set(cursor.value());
     }
     return count;
 }
 
 //
-// Shrink the underlying vector as much as possible.  All trailing blocks
-// that are 0 can be removed.
-//
-// Note that the for loop does not handle idx 0 since the loop  variable
-// is unsigned.
+// Shrink the dense encoding as much as possible.  All trailing blocks that
+// are 0 can be removed.  Switch to the sparse encoding if the remaining
+// blocks have enough 0 blocks for it to be smaller.
 //
 void BitSet::compact() {
-    if (blocks_.size() == 0)
+    if (sparse_)
         return;
 
-    for (size_t idx = blocks_.size() - 1; idx > 0; idx--) {
-        if (blocks_[idx] != 0) {
-            blocks_.resize(idx + 1);
-            return;
-        }
+    const uint64_t *blocks = words();
+    size_t count = size_;
+    while (count > 0 && blocks[count - 1] == 0)
+        count--;
+
+    size_t sparse_size = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        if (blocks[idx] == 0)
+            continue;
+        if (idx == 0 || blocks[idx - 1] == 0)
+            sparse_size++;
+        sparse_size++;
     }
 
-    if (blocks_[0] != 0) {
-        blocks_.resize(1);
+    if (sparse_size >= count) {
+        resize(count);
         return;
     }
 
-    blocks_.clear();
+    BlockBuilder builder;
+    for (size_t idx = 0; idx < count; idx++) {
+        builder.Append(idx, blocks[idx]);
+    }
+    assign_runs(builder.runs(), builder.block_count());
 }
 
 //
-// Sanity check a bitset.  The last block must never be 0.  Always called
-// after any compaction is done or in cases where no compaction is needed.
+// Sanity check a bitset.  The last stored block must never be 0.  Always
+// called after any compaction is done or in cases where no compaction is
+// needed.
 //
 void BitSet::check_invariants() {
-    size_t mysize = blocks_.size();
-    if (mysize != 0)
-        assert(blocks_[mysize -1] != 0);
+    if (size_ != 0)
+        assert(words()[size_ - 1] != 0);
 }
 
 //
@@ -240,10 +588,10 @@ void BitSet::check_invariants() {
 // return value convention used by find_first_set64.
 //
 size_t BitSet::find_first() const {
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        int bit = find_first_set64(blocks_[idx]);
+    for (Cursor cursor(*this); cursor.valid(); cursor.Next()) {
+        int bit = find_first_set64(cursor.value());
         if (bit > 0)
-            return bit_position(idx, bit - 1);
+            return bit_position(cursor.index(), bit - 1);
     }
     return BitSet::npos;
 }
@@ -254,26 +602,28 @@ size_t BitSet::find_first() const {
 //
 size_t BitSet::find_next(size_t pos) const {
     size_t idx = block_index(pos);
-
-    // If the block index is beyond the vector, we're done.
-    if (idx >= blocks_.size())
-        return BitSet::npos;
+    Cursor cursor(*this);
+    cursor.Seek(idx);
 
     // If the offset is not 63, clear out the bits from 0 through offset
-    // and look for the first set bit.
-    if (block_offset(pos) < 63) {
-        uint64_t temp = blocks_[idx] & ~((1LL << (block_offset(pos) + 1)) - 1);
-        int bit = find_first_set64(temp);
-        if (bit > 0)
-            return bit_position(idx, bit - 1);
+    // in the start block and look for the first set bit.
+    if (cursor.valid() && cursor.index() == idx) {
+        if (block_offset(pos) < 63) {
+            uint64_t temp =
+                cursor.value() & ~((1ULL << (block_offset(pos) + 1)) - 1);
+            int bit = find_first_set64(temp);
+            if (bit > 0)
+                return bit_position(idx, bit - 1);
+        }
+        cursor.Next();
     }
 
     // Go through all blocks after the start block for the pos and see if
     // there's a set bit.
-    for (idx++; idx < blocks_.size(); idx++) {
-        int bit = find_first_set64(blocks_[idx]);
+    for (; cursor.valid(); cursor.Next()) {
+        int bit = find_first_set64(cursor.value());
         if (bit > 0)
-            return bit_position(idx, bit - 1);
+            return bit_position(cursor.index(), bit - 1);
     }
     return BitSet::npos;
 }
@@ -286,64 +636,68 @@ size_t BitSet::find_next(size_t pos) const {
 // at least one bit set.
 //
 size_t BitSet::find_last() const {
-    if (blocks_.size() == 0)
+    if (size_ == 0)
         return BitSet::npos;
 
-    size_t idx = blocks_.size() - 1;
-    int bit = find_last_set64(blocks_[idx]);
+    int bit = find_last_set64(words()[size_ - 1]);
     if (bit > 0)
-        return bit_position(idx, bit - 1);
+        return bit_position(block_count() - 1, bit - 1);
 
     return BitSet::npos;
 }
 
 //
 // Return the position of the first clear bit.  It could be beyond the last
-// block in the vector. This is fine as we automatically grow the vector if
-// needed from set().
+// block.  This is fine as we automatically grow the storage if needed from
+// set().
 //
 // Need to compensate for return value convention used by find_first_clear64.
 //
 size_t BitSet::find_first_clear() const {
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        int bit = find_first_clear64(blocks_[idx]);
-        if (bit > 0) {
-            return bit_position(idx, bit - 1);
-        }
-    }
-    return size();
+    return find_next_clear(npos);
 }
 
 //
 // Return the position of the next clear bit.  It could be beyond the last
-// block in the vector. This is fine as we automatically grow the vector if
-// needed from set().
+// block.  This is fine as we automatically grow the storage if needed from
+// set().
+//
+// Blocks that are not stored in the sparse encoding are 0, so the first bit
+// in such a block is clear.
 //
 // Need to compensate for return value convention used by find_first_clear64.
+// Note that a pos of npos is used by find_first_clear to start at bit 0.
 //
 size_t BitSet::find_next_clear(size_t pos) const {
-    size_t idx = block_index(pos);
+    size_t idx = (pos == npos) ? 0 : block_index(pos);
+    size_t count = block_count();
 
-    // If the block index is beyond the vector, we're done.
-    if (idx >= blocks_.size())
-        return pos + 1;
+    // If the block index is beyond the last block, we're done.
+    if (idx >= count)
+        return (pos == npos) ? 0 : pos + 1;
 
     // If the offset is not 63, set all the bits from 0 through offset and
     // look for the first clear bit.
-    if (block_offset(pos) < 63) {
-        uint64_t temp = blocks_[idx] | ((1LL << (block_offset(pos) + 1)) - 1);
-        int bit = find_first_clear64(temp);
-        if (bit > 0)
-            return bit_position(idx, bit - 1);
+    Cursor cursor(*this);
+    if (pos != npos) {
+        if (block_offset(pos) < 63) {
+            uint64_t temp =
+                block(idx) | ((1ULL << (block_offset(pos) + 1)) - 1);
+            int bit = find_first_clear64(temp);
+            if (bit > 0)
+                return bit_position(idx, bit - 1);
+        }
+        idx++;
     }
 
     // Go through all blocks after the start block for the pos and see if
     // there's a clear bit.
-    for (idx++; idx < blocks_.size(); idx++) {
-        int bit = find_first_clear64(blocks_[idx]);
-        if (bit > 0) {
+    for (cursor.Seek(idx); idx < count; idx++, cursor.Next()) {
+        if (!cursor.valid() || cursor.index() != idx)
+            return bit_position(idx, 0);
+        int bit = find_first_clear64(cursor.value());
+        if (bit > 0)
             return bit_position(idx, bit - 1);
-        }
     }
     return size();
 }
@@ -352,10 +706,18 @@ size_t BitSet::find_next_clear(size_t pos) const {
 // Return (*this & rhs != 0).
 //
 bool BitSet::intersects(const BitSet &rhs) const {
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    for (size_t idx = 0; idx < minsize; idx++) {
-        if (blocks_[idx] & rhs.blocks_[idx])
-            return true;
+    Cursor lcursor(*this), rcursor(rhs);
+    while (lcursor.valid() && rcursor.valid()) {
+        if (lcursor.index() < rcursor.index()) {
+            lcursor.Seek(rcursor.index());
+        } else if (rcursor.index() < lcursor.index()) {
+            rcursor.Seek(lcursor.index());
+        } else {
+            if (lcursor.value() & rcursor.value())
+                return true;
+            lcursor.Next();
+            rcursor.Next();
+        }
     }
     return false;
 }
@@ -363,17 +725,13 @@ bool BitSet::intersects(const BitSet &rhs) const {
 //
 // Return (*this == rhs).
 //
-// Note that it's fine to first compare the number of blocks in the vectors
-// since we always shrink the vectors whenever possible.
+// Note that it's fine to compare the encodings since a given set of bits
+// always has the same encoding.
 //
 bool BitSet::operator==(const BitSet &rhs) const {
-    if (blocks_.size() != rhs.blocks_.size())
+    if (size_ != rhs.size_ || sparse_ != rhs.sparse_)
         return false;
-    for (size_t idx = 0; idx < blocks_.size(); idx++) {
-        if (blocks_[idx] != rhs.blocks_[idx])
-            return false;
-    }
-    return true;
+    return (memcmp(words(), rhs.words(), size_ * sizeof(uint64_t)) == 0);
 }
 
 //
@@ -397,60 +755,39 @@ BitSet BitSet::operator&(const BitSet &rhs) const {
 // Return (*this | rhs).
 //
 BitSet BitSet::operator|(const BitSet &rhs) const {
-    BitSet temp;
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    size_t maxsize = std::max(blocks_.size(), rhs.blocks_.size());
-    temp.blocks_.resize(maxsize);
-
-    // Process common blocks.
-    for (size_t idx = 0; idx < minsize; idx++) {
-        temp.blocks_[idx] = blocks_[idx] | rhs.blocks_[idx];
-    }
-
-    // Process blocks that exist in LHS only. It's a noop if RHS is bigger.
-    for (size_t idx = minsize; idx < blocks_.size(); idx++) {
-        temp.blocks_[idx] = blocks_[idx];
-    }
-
-    // Process blocks that exist in RHS only. It's a noop if LHS is bigger.
-    for (size_t idx = minsize; idx < rhs.blocks_.size(); idx++) {
-        temp.blocks_[idx] = rhs.blocks_[idx];
-    }
-
-    temp.check_invariants();
+    BitSet temp(*this);
+    temp |= rhs;
     return temp;
 }
 
 //
 // Implement (*this &= rhs).
 //
-// Note that we can't simply resize the vector to minsize since we may be
-// able to shrink it even more depending on the values in the blocks.
-//
 BitSet &BitSet::operator&=(const BitSet &rhs) {
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    for (size_t idx = 0; idx < minsize; idx++) {
-        blocks_[idx] &= rhs.blocks_[idx];
-    }
-    for (size_t idx = minsize; idx < blocks_.size(); idx++) {
-        blocks_[idx] = 0;
-    }
-    compact();
-    check_invariants();
+    BuildIntersection(*this, rhs);
     return *this;
 }
 
 //
 // Implement (*this |= rhs).
 //
-// Note that we grow the vector only once instead of doing it multiple
-// times.
+// For the common case where both are dense, we grow the storage only once
+// instead of doing it multiple times.  Adding blocks never makes the sparse
+// encoding smaller than the dense one, so there's no need to compact.
 //
 BitSet &BitSet::operator|=(const BitSet &rhs) {
-    if (blocks_.size() < rhs.blocks_.size())
-        blocks_.resize(rhs.blocks_.size());
-    for (size_t idx = 0; idx < rhs.blocks_.size(); idx++) {
-        blocks_[idx] |= rhs.blocks_[idx];
+    if (sparse_ || rhs.sparse_) {
+        merge(*this, rhs, MERGE_OR);
+        check_invariants();
+        return *this;
+    }
+
+    if (size_ < rhs.size_)
+        resize(rhs.size_);
+    uint64_t *blocks = words();
+    const uint64_t *rhs_blocks = rhs.words();
+    for (size_t idx = 0; idx < rhs.size_; idx++) {
+        blocks[idx] |= rhs_blocks[idx];
     }
     check_invariants();
     return *this;
@@ -468,9 +805,17 @@ void BitSet::Set(const BitSet &rhs) {
 // Implement (*this &= ~rhs).
 //
 void BitSet::Reset(const BitSet &rhs) {
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
+    if (sparse_ || rhs.sparse_) {
+        merge(*this, rhs, MERGE_AND_NOT);
+        check_invariants();
+        return;
+    }
+
+    uint64_t *blocks = words();
+    const uint64_t *rhs_blocks = rhs.words();
+    size_t minsize = std::min(size_, rhs.size_);
     for (size_t idx = 0; idx < minsize; idx++) {
-        blocks_[idx] &= ~rhs.blocks_[idx];
+        blocks[idx] &= ~rhs_blocks[idx];
     }
     compact();
     check_invariants();
@@ -479,54 +824,42 @@ void BitSet::Reset(const BitSet &rhs) {
 //
 // Implement (*this = lhs & ~rhs).
 //
-// Note that we won't enter the second for loop at all if lhs is not bigger
-// than rhs.  Need to compact only for this case, but it is cheap enough to
-// try (and do nothing) when lhs is bigger than rhs.
-//
 void BitSet::BuildComplement(const BitSet &lhs, const BitSet &rhs) {
-    blocks_.clear();
-    blocks_.resize(lhs.blocks_.size());
-    size_t minsize = std::min(blocks_.size(), rhs.blocks_.size());
-    for (size_t idx = 0; idx < minsize; idx++) {
-        blocks_[idx] = lhs.blocks_[idx] & ~rhs.blocks_[idx];
+    if (this == &lhs) {
+        Reset(rhs);
+        return;
     }
-    for (size_t idx = minsize; idx < lhs.blocks_.size(); idx++) {
-        blocks_[idx] = lhs.blocks_[idx];
+    if (this == &rhs || lhs.sparse_ || rhs.sparse_) {
+        merge(lhs, rhs, MERGE_AND_NOT);
+        check_invariants();
+        return;
     }
-    compact();
-    check_invariants();
+
+    assign(lhs.words(), lhs.size_, false);
+    Reset(rhs);
 }
 
 //
 // Implement (*this = lhs & rhs).
 //
-// We avoid the need to compact or to resize multiple times by building
-// the blocks in reverse order.
-//
-// Note that the for loop does not handle idx 0 since the loop  variable
-// is unsigned.
-//
 void BitSet::BuildIntersection(const BitSet &lhs, const BitSet &rhs) {
-    blocks_.clear();
-    size_t minsize = std::min(lhs.blocks_.size(), rhs.blocks_.size());
-
-    if (minsize == 0)
+    if (this == &lhs || this == &rhs || lhs.sparse_ || rhs.sparse_) {
+        merge(lhs, rhs, MERGE_AND);
+        check_invariants();
         return;
-
-    for (size_t idx = minsize - 1; idx > 0; idx--) {
-        if (lhs.blocks_[idx] & rhs.blocks_[idx]) {
-            if (blocks_.size() == 0)
-                blocks_.resize(idx + 1);
-            blocks_[idx] = lhs.blocks_[idx] & rhs.blocks_[idx];
-        }
     }
 
-    if (lhs.blocks_[0] & rhs.blocks_[0]) {
-        if (blocks_.size() == 0)
-            blocks_.resize(1);
-        blocks_[0] = lhs.blocks_[0] & rhs.blocks_[0];
+    size_t minsize = std::min(lhs.size_, rhs.size_);
+    size_ = 0;
+    sparse_ = 0;
+    resize(minsize);
+    uint64_t *blocks = words();
+    const uint64_t *lhs_blocks = lhs.words();
+    const uint64_t *rhs_blocks = rhs.words();
+    for (size_t idx = 0; idx < minsize; idx++) {
+        blocks[idx] = lhs_blocks[idx] & rhs_blocks[idx];
     }
-
+    compact();
     check_invariants();
 }
 
@@ -534,10 +867,13 @@ void BitSet::BuildIntersection(const BitSet &lhs, const BitSet &rhs) {
 // Return true if *this contains rhs.  Implemented as (rhs & ~*this != 0).
 //
 bool BitSet::Contains(const BitSet &rhs) const {
-    if (blocks_.size() < rhs.blocks_.size())
-        return false;
-    for (size_t idx = 0; idx < rhs.blocks_.size(); idx++) {
-        if (rhs.blocks_[idx] & ~blocks_[idx])
+    Cursor cursor(*this);
+    for (Cursor rcursor(rhs); rcursor.valid(); rcursor.Next()) {
+        cursor.Seek(rcursor.index());
+        uint64_t value = 0;
+        if (cursor.valid() && cursor.index() == rcursor.index())
+            value = cursor.value();
+        if (rcursor.value() & ~value)
             return false;
     }
     return true;
@@ -562,26 +898,21 @@ string BitSet::ToString() const {
 
 //
 // Initialize the bitset from the provided string representation. The string
-// must use the same format as described in ToString above. We traverse the
-// string in reverse order to ensure that we do not have to resize multiple
-// times.
-//
-// Note that the for loop does not handle str_idx 0 since the loop variable
-// is unsigned.
+// must use the same format as described in ToString above. We build all the
+// blocks first to ensure that we do not have to re-encode multiple times.
 //
 void BitSet::FromString(string str) {
-    blocks_.clear();
-
-    if (str.length() == 0)
-        return;
-
-    for (size_t str_idx = str.length() - 1; str_idx > 0; str_idx--) {
+    BlockBuilder builder;
+    uint64_t value = 0;
+    for (size_t str_idx = 0; str_idx < str.length(); str_idx++) {
         if (str[str_idx] == '1')
-            set(str_idx);
+            value |= 1ULL << block_offset(str_idx);
+        if (block_offset(str_idx) == 63 || str_idx + 1 == str.length()) {
+            builder.Append(block_index(str_idx), value);
+            value = 0;
+        }
     }
-
-    if (str[0] == '1')
-        set(0);
+    assign_runs(builder.runs(), builder.block_count());
 }
 
 //
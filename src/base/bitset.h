@@ -12,12 +12,32 @@
 //
 // BitSet automatically resizes the bit set when needed and allows for
 // logical operations between bitsets of different sizes.  Implemented
-// using a vector of uint64_t as the underlying storage.
+// using an array of uint64_t blocks as the underlying storage.
+//
+// The blocks are encoded in one of two ways.  The dense encoding simply
+// stores all the blocks up to and including the last one that's non-zero.
+// The sparse encoding stores runs of consecutive non-zero blocks, each of
+// them preceded by a header with the index of the first block in the run
+// and the number of blocks in the run.  The sparse encoding is used only
+// when it needs fewer words than the dense encoding, which is the case for
+// bitsets with a few bits set at high positions.  Since the encoding of a
+// given set of bits is unique, bitsets can be compared word by word.
+//
+// Encodings with a single word are stored inline in the BitSet itself and
+// longer ones are allocated on the heap.  This means that the bitsets for
+// sets of peers that fit in 64 bits, which are by far the most common, do
+// not need any memory beyond the BitSet.
 //
 class BitSet {
 public:
     static const size_t npos = static_cast<size_t>(-1);
 
+    BitSet();
+    BitSet(const BitSet &rhs);
+    ~BitSet();
+    BitSet &operator=(const BitSet &rhs);
+    void swap(BitSet &rhs);
+
     BitSet &set(size_t pos);
     BitSet &reset(size_t pos);
     bool test(size_t pos) const;
@@ -52,11 +72,35 @@ public:
 
 private:
     friend class BitSetTest;
+    class Cursor;
+    enum MergeOp {
+        MERGE_AND,
+        MERGE_OR,
+        MERGE_AND_NOT
+    };
 
+    uint64_t *words() { return capacity_ ? heap_ : &inline_; }
+    const uint64_t *words() const { return capacity_ ? heap_ : &inline_; }
+    void reserve(size_t count);
+    void resize(size_t count);
+    void release();
+    void assign(const uint64_t *src, size_t count, bool sparse);
+    void assign_runs(const std::vector<uint64_t> &runs, size_t block_count);
+    size_t block_count() const;
+    uint64_t block(size_t idx) const;
+    uint64_t *find_block(size_t idx);
+    void merge_block(size_t idx, uint64_t value, bool set);
+    void merge(const BitSet &lhs, const BitSet &rhs, MergeOp op);
     void compact();
     void check_invariants();
 
-    std::vector<uint64_t> blocks_;
+    union {
+        uint64_t inline_;
+        uint64_t *heap_;
+    };
+    uint32_t size_;
+    uint32_t capacity_ : 31;
+    uint32_t sparse_ : 1;
 };
 
 #endif
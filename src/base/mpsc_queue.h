@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef ctrlplane_mpsc_queue_h
+#define ctrlplane_mpsc_queue_h
+
+#include <cstddef>
+#include <tbb/atomic.h>
+
+#include "base/util.h"
+
+//
+// Intrusive, unbounded, lock-free multi-producer/single-consumer queue.
+//
+// Producers only execute a single atomic exchange on the head pointer, so
+// enqueue never blocks behind other producers or the consumer. Elements are
+// linked through an MpscQueueNode embedded in the element, which avoids an
+// extra allocation per enqueue.
+//
+// Dequeue must only be invoked from one thread at a time. It may transiently
+// return NULL while a producer is between the exchange on the head and the
+// link of the previous element. Producers count the element as pending
+// before the exchange, so empty() reports false in that window and a
+// consumer that retries while !empty() observes every element.
+//
+class MpscQueueNode {
+public:
+    MpscQueueNode() {
+        mpsc_next_ = NULL;
+    }
+
+private:
+    template <typename T> friend class MpscQueue;
+    tbb::atomic<MpscQueueNode *> mpsc_next_;
+};
+
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() {
+        head_ = &stub_;
+        tail_ = &stub_;
+        pending_ = 0;
+    }
+
+    // Multiple producers.
+    void Enqueue(T *entry) {
+        pending_.fetch_and_increment();
+        Push(static_cast<MpscQueueNode *>(entry));
+    }
+
+    // Multiple producers. The entries are linked to each other before they
+    // are published with a single exchange on the head pointer, so they
+    // show up in the queue in order and without interleaving.
+    void EnqueueBatch(T **entries, size_t count) {
+        if (count == 0)
+            return;
+        for (size_t idx = 0; idx + 1 < count; ++idx) {
+            static_cast<MpscQueueNode *>(entries[idx])->mpsc_next_ =
+                static_cast<MpscQueueNode *>(entries[idx + 1]);
+        }
+        MpscQueueNode *first = static_cast<MpscQueueNode *>(entries[0]);
+        MpscQueueNode *last = static_cast<MpscQueueNode *>(entries[count - 1]);
+        last->mpsc_next_ = NULL;
+        pending_.fetch_and_add(count);
+        MpscQueueNode *prev = head_.fetch_and_store(last);
+        prev->mpsc_next_ = first;
+    }
+
+    // Single consumer. Returns NULL if there is no linked element.
+    T *Dequeue() {
+        MpscQueueNode *tail = tail_;
+        MpscQueueNode *next = tail->mpsc_next_;
+        if (tail == &stub_) {
+            if (next == NULL)
+                return NULL;
+            tail_ = next;
+            tail = next;
+            next = next->mpsc_next_;
+        }
+        if (next != NULL) {
+            tail_ = next;
+            pending_.fetch_and_decrement();
+            return static_cast<T *>(tail);
+        }
+
+        // The tail is the last linked element. If a producer has already
+        // swung the head past it, wait for the link to be published.
+        MpscQueueNode *head = head_;
+        if (tail != head)
+            return NULL;
+
+        Push(&stub_);
+        next = tail->mpsc_next_;
+        if (next != NULL) {
+            tail_ = next;
+            pending_.fetch_and_decrement();
+            return static_cast<T *>(tail);
+        }
+        return NULL;
+    }
+
+    // Single consumer. Dequeue up to max_count elements into the vector
+    // pointed to by entries. Returns the number of elements dequeued.
+    size_t DequeueBatch(T **entries, size_t max_count) {
+        size_t count = 0;
+        while (count < max_count) {
+            T *entry = Dequeue();
+            if (entry == NULL)
+                break;
+            entries[count++] = entry;
+        }
+        return count;
+    }
+
+    // True when every element enqueued so far has been dequeued, including
+    // the ones a producer has started but not finished linking.
+    bool empty() const {
+        return (pending_ == 0);
+    }
+
+private:
+    void Push(MpscQueueNode *node) {
+        node->mpsc_next_ = NULL;
+        MpscQueueNode *prev = head_.fetch_and_store(node);
+        prev->mpsc_next_ = node;
+    }
+
+    tbb::atomic<MpscQueueNode *> head_;
+    char pad_[64 - sizeof(MpscQueueNode *)];
+    MpscQueueNode *tail_;
+    MpscQueueNode stub_;
+    tbb::atomic<size_t> pending_;
+
+    DISALLOW_COPY_AND_ASSIGN(MpscQueue);
+};
+
+#endif
@@ -12,6 +12,7 @@
 #include "tbb/enumerable_thread_specific.h"
 #include "base/logging.h"
 #include "base/task.h"
+#include "base/time_util.h"
 
 #include <sandesh/sandesh_types.h>
 #include <sandesh/sandesh.h>
@@ -50,6 +51,7 @@ public:
 
 private:
     tbb::task *execute();
+    virtual void note_affinity(affinity_id id);
 
     Task    *parent_;
 
@@ -169,6 +171,7 @@ public:
     void DeleteFromDeferQ(TaskEntry &entry);
     TaskGroup *ActiveGroupInPolicy();
     bool DeferOnPolicyFail(TaskEntry *entry, Task *t);
+    bool DeferOnStalledTasks(TaskEntry *entry, Task *t);
     bool IsWaitQEmpty();
     int  TaskRunCount() const {return run_count_;};
     void RunDeferQ();
@@ -178,6 +181,7 @@ public:
     TaskStats *GetTaskGroupStats();
     TaskStats *GetTaskStats();
     TaskStats *GetTaskStats(int task_instance);
+    tbb::task::affinity_id affinity() const { return affinity_; }
     void ClearTaskGroupStats();
     void ClearTaskStats();
     void ClearTaskStats(int instance_id);
@@ -219,6 +223,7 @@ private:
     TaskDeferList           deferq_;    // Tasks deferred till run_count_ is 0
     TaskEntry               *task_entry_;// Task entry for instance(-1)
     TaskEntryList           task_entry_db_;  // task-entries in this group
+    tbb::task::affinity_id  affinity_;  // Worker that last stole a task
 
     TaskStats               stats_;
     DISALLOW_COPY_AND_ASSIGN(TaskGroup);
@@ -235,7 +240,9 @@ tbb::task *TaskImpl::execute() {
     TaskInfo::reference running = task_running.local();
     running = parent_;
     try {
+        parent_->start_time_ = ClockMonotonicUsec();
         bool is_complete = parent_->Run();
+        parent_->run_time_ = ClockMonotonicUsec() - parent_->start_time_;
         running = NULL;
         if (is_complete == true) {
             parent_->SetTaskComplete();
@@ -260,6 +267,13 @@ tbb::task *TaskImpl::execute() {
     return NULL;
 }
 
+// Invoked by tbb before execute() when the task runs on a worker other than
+// the one that spawned it (i.e. it was stolen) or other than its affinity.
+// Remember the worker so that OnTaskExit can update the group affinity.
+void TaskImpl::note_affinity(affinity_id id) {
+    parent_->affinity_ = id;
+}
+
 // Destructor called when a task execution is compeleted. Invoked
 // implicitly by tbb::task. 
 // Invokes OnTaskExit to schedule tasks pending tasks
@@ -303,8 +317,8 @@ int TaskScheduler::GetThreadCount(int thread_count) {
 // part of tbb. So, initialize TBB with one thread more than its default
 TaskScheduler::TaskScheduler(int task_count) : 
     task_scheduler_(GetThreadCount(task_count) + 1),
-    running_(true), seqno_(0), id_max_(0), enqueue_count_(0), done_count_(0),
-    cancel_count_(0) {
+    running_(true), seqno_(0), id_max_(0), group_affinity_(false),
+    work_stealing_(false), enqueue_count_(0), done_count_(0), cancel_count_(0) {
     hw_thread_count_ = GetThreadCount(task_count);
     task_group_db_.resize(TaskScheduler::kVectorGrowSize);
     stop_entry_ = new TaskEntry(-1);
@@ -430,6 +444,7 @@ void TaskScheduler::EnqueueUnLocked(Task *t) {
     assert(t->GetSeqno() == 0);
     enqueue_count_++;
     t->SetSeqNo(++seqno_);
+    t->enqueue_time_ = ClockMonotonicUsec();
     TaskGroup *group = GetTaskGroup(t->GetTaskId());
 
     TaskEntry *entry = GetTaskEntry(t->GetTaskId(), t->GetTaskInstance());
@@ -455,6 +470,11 @@ void TaskScheduler::EnqueueUnLocked(Task *t) {
         return;
     }
 
+    // In work stealing mode, tasks stalled on this group run before it.
+    if (work_stealing_ && group->DeferOnStalledTasks(entry, t)) {
+        return;
+    }
+
     // Check Task Entry policy. On policy violation, DeferOnPolicyFail() 
     // adds the Task to the TaskEntry's waitq_ and the TaskEntry will be
     // added to deferq_ of the matching TaskEntry.
@@ -543,6 +563,7 @@ void TaskScheduler::OnTaskExit(Task *t) {
 
     // Task is being recycled, reset the state, seq_no and TBB task handle
     t->task_impl_ = NULL;
+    t->affinity_ = 0;
     t->SetSeqNo(0);
     t->state_ = Task::INIT;
     EnqueueUnLocked(t);
@@ -806,7 +827,7 @@ void TaskScheduler::SetThreadAmpFactor(int n) {
 ////////////////////////////////////////////////////////////////////////////
 
 TaskGroup::TaskGroup(int task_id) : task_id_(task_id), policy_set_(false), 
-    run_count_(0) {
+    run_count_(0), affinity_(0) {
     task_entry_db_.resize(TaskGroup::kVectorGrowSize);
     task_entry_ = new TaskEntry(task_id);
     memset(&stats_, 0, sizeof(stats_));
@@ -888,6 +909,22 @@ bool TaskGroup::DeferOnPolicyFail(TaskEntry *entry, Task *task) {
     return false;
 }
 
+// Defer the task behind the tasks already waiting in deferq_ for this group
+// to stop running. deferq_ is only populated while the group has running
+// tasks and is drained in seqno order when run_count_ goes to 0, so the
+// stalled tasks get to run first and the task is started (or deferred
+// again on policy) after them.
+bool TaskGroup::DeferOnStalledTasks(TaskEntry *entry, Task *task) {
+    if (deferq_.empty()) {
+        return false;
+    }
+    if (0 == entry->WaitQSize()) {
+        entry->AddToWaitQ(task);
+    }
+    AddToDeferQ(entry);
+    return true;
+}
+
 // Add task to deferq_
 // Only one task of a given instance goes into deferq_ for its policies.
 void TaskGroup::AddToDeferQ(TaskEntry *entry) {
@@ -924,9 +961,36 @@ void TaskGroup::RunDeferQ() {
     return;
 }
 
+static int TaskStatsHistogramBucket(uint64_t usecs) {
+    int bucket = 0;
+    while (usecs && bucket < TaskStats::kHistogramBuckets - 1) {
+        usecs >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
 inline void TaskGroup::TaskExited(Task *t) {
     run_count_--;
     stats_.total_tasks_completed_++;
+
+    uint64_t wait_time = 0;
+    if (t->start_time_ > t->enqueue_time_)
+        wait_time = t->start_time_ - t->enqueue_time_;
+    stats_.total_wait_time_usecs_ += wait_time;
+    if (wait_time > stats_.max_wait_time_usecs_)
+        stats_.max_wait_time_usecs_ = wait_time;
+    stats_.wait_time_histogram_[TaskStatsHistogramBucket(wait_time)]++;
+
+    stats_.total_run_time_usecs_ += t->run_time_;
+    if (t->run_time_ > stats_.max_run_time_usecs_)
+        stats_.max_run_time_usecs_ = t->run_time_;
+    stats_.run_time_histogram_[TaskStatsHistogramBucket(t->run_time_)]++;
+
+    if (t->task_recycle_ && !t->task_cancel_)
+        stats_.reschedule_count_++;
+    if (t->affinity_)
+        affinity_ = t->affinity_;
 }
 
 // Returns true, if the waiq_ of all the tasks in the group are empty.
@@ -1092,7 +1156,7 @@ void TaskEntry::RunTask (Task *t) {
     TaskGroup *group = scheduler->QueryTaskGroup(t->GetTaskId());
     group->TaskStarted();
 
-    t->StartTask();
+    t->StartTask(scheduler->group_affinity() ? group->affinity() : 0);
 }
 
 void TaskEntry::RunWaitQ() {
@@ -1245,19 +1309,24 @@ int TaskEntry::GetTaskDeferEntrySeqno() const {
 ////////////////////////////////////////////////////////////////////////////
 Task::Task(int task_id, int task_instance) : task_id_(task_id),
     task_instance_(task_instance), task_impl_(NULL), state_(INIT), seqno_(0),
+    enqueue_time_(0), start_time_(0), run_time_(0), affinity_(0),
     task_recycle_(false), task_cancel_(false) {
 }
 
 Task::Task(int task_id) : task_id_(task_id),
     task_instance_(-1), task_impl_(NULL), state_(INIT), seqno_(0),
+    enqueue_time_(0), start_time_(0), run_time_(0), affinity_(0),
     task_recycle_(false), task_cancel_(false) {
 }
 
 // Start execution of task
-void Task::StartTask() {
+// A non-zero affinity is a hint for the tbb worker to run the task on.
+void Task::StartTask(tbb::task::affinity_id affinity) {
     assert(task_impl_ == NULL);
     state_ = RUN;
     task_impl_ = new (task::allocate_root())TaskImpl(this);
+    if (affinity)
+        task_impl_->set_affinity(affinity);
     task::spawn(*task_impl_);
 }
 
@@ -1314,6 +1383,21 @@ void TaskGroup::GetSandeshData(SandeshTaskGroup *resp) const {
         policy_list.push_back(policy_entry);
     }
     resp->set_task_policy_list(policy_list);
+
+    SandeshTaskGroupStats group_stats;
+    group_stats.set_tasks_completed(stats_.total_tasks_completed_);
+    group_stats.set_reschedules(stats_.reschedule_count_);
+    group_stats.set_total_wait_time_usecs(stats_.total_wait_time_usecs_);
+    group_stats.set_max_wait_time_usecs(stats_.max_wait_time_usecs_);
+    group_stats.set_total_run_time_usecs(stats_.total_run_time_usecs_);
+    group_stats.set_max_run_time_usecs(stats_.max_run_time_usecs_);
+    std::vector<uint64_t> wait_histogram(stats_.wait_time_histogram_,
+        stats_.wait_time_histogram_ + TaskStats::kHistogramBuckets);
+    group_stats.set_wait_time_histogram(wait_histogram);
+    std::vector<uint64_t> run_histogram(stats_.run_time_histogram_,
+        stats_.run_time_histogram_ + TaskStats::kHistogramBuckets);
+    group_stats.set_run_time_histogram(run_histogram);
+    resp->set_stats(group_stats);
 }
 
 void TaskScheduler::GetSandeshData(SandeshTaskScheduler *resp) {
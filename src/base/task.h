@@ -46,11 +46,22 @@ class TaskEntry;
 class SandeshTaskScheduler;
 
 struct TaskStats {
+    // Log2 histogram of times in usecs. Bucket 0 counts samples below 1 usec,
+    // bucket n counts samples in [2^(n-1), 2^n) and the last one is open.
+    static const int kHistogramBuckets = 24;
+
     int     wait_count_;                // #Entries in waitq
     int     run_count_;                 // #Entries currently running
     int     defer_count_;               // #Entries in deferq
     uint64_t enqueue_count_;            // #Tasks enqueued
     uint64_t total_tasks_completed_;    // #Total tasks ran
+    uint64_t reschedule_count_;         // #Runs that returned false
+    uint64_t total_wait_time_usecs_;    // Time from enqueue to start of Run
+    uint64_t max_wait_time_usecs_;
+    uint64_t total_run_time_usecs_;     // Time spent in Run
+    uint64_t max_run_time_usecs_;
+    uint64_t wait_time_histogram_[kHistogramBuckets];
+    uint64_t run_time_histogram_[kHistogramBuckets];
 };
 
 struct TaskExclusion {
@@ -100,19 +111,24 @@ public:
 
 private:
     friend class TaskEntry;
+    friend class TaskGroup;
     friend class TaskScheduler;
     friend class TaskImpl;
     void SetSeqNo(uint64_t seqno) {seqno_ = seqno;};
     void SetState(State s) { state_ = s; };
     void SetTaskRecycle() { task_recycle_ = true; };
     void SetTaskComplete() { task_recycle_ = false; };
-    void StartTask();
+    void StartTask(tbb::task::affinity_id affinity);
 
     int                 task_id_;       // The code path executed by the task.
     int                 task_instance_; // The dataset id within a code path.
     tbb::task           *task_impl_;
     State               state_;
     uint64_t            seqno_;
+    uint64_t            enqueue_time_;  // Time of the last (re)enqueue
+    uint64_t            start_time_;    // Time the last Run started
+    uint64_t            run_time_;      // Duration of the last Run
+    tbb::task::affinity_id affinity_;   // Worker that stole the last Run
     bool                task_recycle_;
     bool                task_cancel_;
     // Hook in intrusive list for TaskEntry::waitq_
@@ -194,6 +210,25 @@ public:
     // TBB
     static void SetThreadAmpFactor(int n);
 
+    // Tasks are handed to tbb with spawn and are load balanced across the
+    // tbb worker threads by work stealing. When group affinity is enabled,
+    // new tasks carry an affinity hint for the worker that last stole a
+    // task of the same group, so that a group keeps running on a warm cache
+    // while idle workers are still free to steal it. Affinity only affects
+    // placement; exclusion policies are enforced before a task is spawned.
+    void SetGroupAffinity(bool enable) { group_affinity_ = enable; }
+    bool group_affinity() const { return group_affinity_; }
+
+    // Tasks stalled by an exclusion policy wait in the deferq_ of the group
+    // they conflict with until no task of that group is running. A steady
+    // stream of tasks of the running group can keep them stalled forever.
+    // When work stealing is enabled, a stalled task steals the next turn:
+    // a new task of a group with stalled tasks in its deferq_ is deferred
+    // behind them instead of extending the exclusion. The policy rules are
+    // still enforced when the deferred tasks are started.
+    void SetWorkStealing(bool enable) { work_stealing_ = enable; }
+    bool work_stealing() const { return work_stealing_; }
+
 private:
     friend class ConcurrencyScope;
     typedef std::vector<TaskGroup *> TaskGroupDb;
@@ -225,6 +260,8 @@ private:
     int                     id_max_;
 
     int                     hw_thread_count_;
+    bool                    group_affinity_;
+    bool                    work_stealing_;
 
     uint64_t                enqueue_count_;
     uint64_t                done_count_;
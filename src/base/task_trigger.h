@@ -15,6 +15,8 @@ public:
     ~TaskTrigger();
     void Set();
     void Reset();
+    // True from Set() until the function has run to completion.
+    bool IsSet() const { return trigger_; }
     // For Test only
     void set_disable() {
         bool current = disabled_.fetch_and_store(true);
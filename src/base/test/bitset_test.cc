@@ -3,6 +3,9 @@
  */
 
 #include "base/bitset.h"
+
+#include <stdlib.h>
+
 #include "base/logging.h"
 #include "testing/gunit.h"
 
@@ -10,8 +13,35 @@ using namespace std;
 
 class BitSetTest : public ::testing::Test {
 protected:
-    vector<uint64_t> &get_blocks(BitSet &bitset) {
-        return bitset.blocks_;
+    //
+    // View of the blocks of a bitset in the dense encoding, irrespective of
+    // how they are actually stored.
+    //
+    class BlockView {
+    public:
+        explicit BlockView(const BitSet *bitset) : bitset_(bitset) { }
+        size_t size() const { return BitSetTest::block_count(*bitset_); }
+        uint64_t operator[](size_t idx) const {
+            return BitSetTest::block(*bitset_, idx);
+        }
+
+    private:
+        const BitSet *bitset_;
+    };
+
+    BlockView get_blocks(BitSet &bitset) {
+        return BlockView(&bitset);
+    }
+
+    static size_t block_count(const BitSet &bitset) {
+        return bitset.block_count();
+    }
+    static uint64_t block(const BitSet &bitset, size_t idx) {
+        return bitset.block(idx);
+    }
+    static bool is_sparse(const BitSet &bitset) { return bitset.sparse_; }
+    static size_t heap_bytes(const BitSet &bitset) {
+        return bitset.capacity_ * sizeof(uint64_t);
     }
 };
 
@@ -26,7 +56,7 @@ static int num_bits_set(uint64_t value) {
 
 TEST_F(BitSetTest, Basic) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockView blocks = get_blocks(bitset);
     EXPECT_EQ(bitset.size(), 0);
     EXPECT_EQ(blocks.size(), 0);
 }
@@ -35,7 +65,7 @@ TEST_F(BitSetTest, Basic) {
 TEST_F(BitSetTest, set1) {
     for (int pos = 0; pos <= 63; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockView blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 1);
         EXPECT_EQ(blocks[0],  1LL << pos);
@@ -47,7 +77,7 @@ TEST_F(BitSetTest, set1) {
 TEST_F(BitSetTest, set2) {
     for (int pos = 128; pos <= 191; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockView blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 3);
         EXPECT_EQ(blocks[0], 0 );
@@ -61,7 +91,7 @@ TEST_F(BitSetTest, set2) {
 TEST_F(BitSetTest, set3)  {
     for (int pos = 0; pos <= 1023; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockView blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), pos / 64 + 1);
         EXPECT_EQ(blocks[pos / 64], 1LL << (pos % 64));
@@ -72,7 +102,7 @@ TEST_F(BitSetTest, set3)  {
 // Set all bits within block idx 1 and verify.
 TEST_F(BitSetTest, set4) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockView blocks = get_blocks(bitset);
     for (int pos = 64; pos <= 127; pos++) {
         bitset.set(pos);
     }
@@ -85,7 +115,7 @@ TEST_F(BitSetTest, set4) {
 TEST_F(BitSetTest, reset1) {
     for (int pos = 0; pos <= 63; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockView blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 1);
         bitset.reset(pos);
@@ -97,7 +127,7 @@ TEST_F(BitSetTest, reset1) {
 TEST_F(BitSetTest, reset2) {
     for (int pos = 64; pos <= 127; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockView blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 2);
         bitset.reset(pos);
@@ -109,7 +139,7 @@ TEST_F(BitSetTest, reset2) {
 TEST_F(BitSetTest, reset3) {
     for (int pos = 0; pos <= 1023; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockView blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), pos / 64 + 1);
         bitset.reset(pos);
@@ -121,7 +151,7 @@ TEST_F(BitSetTest, reset3) {
 TEST_F(BitSetTest, reset4)  {
     for (int pos = 64; pos <= 127; pos++) {
         BitSet bitset;
-        vector<uint64_t> &blocks = get_blocks(bitset);
+        BlockView blocks = get_blocks(bitset);
         bitset.set(pos);
         EXPECT_EQ(blocks.size(), 2);
         bitset.reset(128);
@@ -133,7 +163,7 @@ TEST_F(BitSetTest, reset4)  {
 //  Set bits 0-127 and reset 0-63.
 TEST_F(BitSetTest, reset5) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockView blocks = get_blocks(bitset);
     for (int pos = 0; pos <= 127; pos++) {
         bitset.set(pos);
     }
@@ -150,7 +180,7 @@ TEST_F(BitSetTest, reset5) {
 //  Set bits 0-127 and reset 64-127.
 TEST_F(BitSetTest, reset6) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockView blocks = get_blocks(bitset);
     for (int pos = 0; pos <= 127; pos++) {
         bitset.set(pos);
     }
@@ -169,7 +199,7 @@ TEST_F(BitSetTest, reset6) {
 // Clear an empty BitSet.
 TEST_F(BitSetTest, clear1) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockView blocks = get_blocks(bitset);
     bitset.clear();
     EXPECT_EQ(blocks.size(), 0);
 }
@@ -178,7 +208,7 @@ TEST_F(BitSetTest, clear1) {
 // Clear BitSet with first/last bit set in each idx.
 TEST_F(BitSetTest, clear2) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockView blocks = get_blocks(bitset);
 
     for (int idx = 0; idx < 32; idx++) {
         bitset.set(idx * 64);
@@ -198,7 +228,7 @@ TEST_F(BitSetTest, clear2) {
 // Clear BitSet with all bits set in idx 0 thru 15.
 TEST_F(BitSetTest, clear3) {
     BitSet bitset;
-    vector<uint64_t> &blocks = get_blocks(bitset);
+    BlockView blocks = get_blocks(bitset);
     for (int pos = 0; pos < 64 * 16 ; pos++) {
         bitset.set(pos);
     }
@@ -1913,6 +1943,141 @@ TEST_F(BitSetTest, NumberedString2) {
     EXPECT_EQ("1,3-5,7-9", bitset.ToNumberedString());
 }
 
+// Bits at high positions with nothing below use the sparse encoding.
+TEST_F(BitSetTest, Sparse1) {
+    BitSet bitset;
+    BlockView blocks = get_blocks(bitset);
+    bitset.set(5000);
+    EXPECT_TRUE(is_sparse(bitset));
+    EXPECT_EQ(blocks.size(), 5000 / 64 + 1);
+    EXPECT_EQ(blocks[5000 / 64], 1LL << (5000 % 64));
+    EXPECT_EQ(blocks[0], 0);
+    EXPECT_TRUE(bitset.test(5000));
+    EXPECT_FALSE(bitset.test(4999));
+    EXPECT_EQ(bitset.size(), (5000 / 64 + 1) * 64);
+    EXPECT_EQ(bitset.find_first(), 5000);
+    EXPECT_EQ(bitset.find_last(), 5000);
+    EXPECT_EQ(bitset.find_next(5000), BitSet::npos);
+    EXPECT_EQ(bitset.find_first_clear(), 0);
+    EXPECT_EQ(bitset.find_next_clear(4999), 5001);
+
+    bitset.reset(5000);
+    EXPECT_FALSE(is_sparse(bitset));
+    EXPECT_TRUE(bitset.empty());
+    EXPECT_EQ(blocks.size(), 0);
+}
+
+// Filling in the low blocks switches back to the dense encoding.
+TEST_F(BitSetTest, Sparse2) {
+    BitSet bitset;
+    bitset.set(1000);
+    bitset.set(0);
+    EXPECT_TRUE(is_sparse(bitset));
+    EXPECT_EQ("0,1000", bitset.ToNumberedString());
+    for (int pos = 0; pos < 1000; pos += 64) {
+        bitset.set(pos);
+    }
+    EXPECT_FALSE(is_sparse(bitset));
+    EXPECT_EQ(bitset.count(), 1000 / 64 + 2);
+    for (int pos = 64; pos < 1000; pos += 64) {
+        bitset.reset(pos);
+    }
+    EXPECT_TRUE(is_sparse(bitset));
+    EXPECT_EQ("0,1000", bitset.ToNumberedString());
+}
+
+// Logical operations between sparse and dense bitsets.
+TEST_F(BitSetTest, Sparse3) {
+    BitSet lhs, rhs;
+    lhs.FromString("111");
+    lhs.set(3000);
+    lhs.set(3001);
+    rhs.set(1);
+    rhs.set(3001);
+    rhs.set(7000);
+
+    EXPECT_TRUE(lhs.intersects(rhs));
+    EXPECT_EQ("1,3001", (lhs & rhs).ToNumberedString());
+    EXPECT_EQ("0-2,3000-3001,7000", (lhs | rhs).ToNumberedString());
+    BitSet temp;
+    temp.BuildComplement(lhs, rhs);
+    EXPECT_EQ("0,2,3000", temp.ToNumberedString());
+    EXPECT_TRUE(lhs.Contains(temp));
+    EXPECT_FALSE(temp.Contains(lhs));
+
+    temp = lhs;
+    temp.Reset(rhs);
+    temp.Set(rhs);
+    EXPECT_TRUE(temp == (lhs | rhs));
+    temp &= lhs;
+    EXPECT_TRUE(temp == lhs);
+    temp.Reset(lhs);
+    EXPECT_TRUE(temp.empty());
+}
+
+// Bitsets with up to 64 bits don't need any heap storage.
+TEST_F(BitSetTest, Inline) {
+    BitSet bitset;
+    bitset.FromString("1011");
+    EXPECT_EQ(heap_bytes(bitset), 0);
+    bitset.set(64);
+    EXPECT_NE(heap_bytes(bitset), 0);
+    bitset.reset(64);
+    EXPECT_EQ(heap_bytes(bitset), 0);
+    BitSet copy(bitset);
+    EXPECT_EQ(heap_bytes(copy), 0);
+    EXPECT_TRUE(copy == bitset);
+}
+
+//
+// Memory needed for the bitsets in the advertisement state of a million
+// routes, each with a single AdvertiseInfo, extrapolated from a small number
+// of routes.  Set the BITSET_TEST_ROUTES environment variable to measure
+// with a larger number of routes, e.g. 1000000.  Memory for the previous
+// std::vector based implementation is shown for comparison.  Allocator
+// overhead is not included in either case.
+//
+TEST_F(BitSetTest, MemoryPerMillionRoutes) {
+    size_t route_count = 1000;
+    char *str = getenv("BITSET_TEST_ROUTES");
+    if (str)
+        route_count = strtoul(str, NULL, 0);
+
+    struct {
+        const char *name;
+        size_t first;
+        size_t last;
+        size_t step;
+    } peer_sets[] = {
+        { "4 peers", 0, 3, 1 },
+        { "64 peers", 0, 63, 1 },
+        { "1 peer at 3000", 3000, 3000, 1 },
+        { "4 peers at 0, 1000, 2000, 3000", 0, 3000, 1000 },
+        { "4000 peers", 0, 3999, 1 },
+    };
+
+    for (size_t idx = 0; idx < sizeof(peer_sets) / sizeof(peer_sets[0]);
+         ++idx) {
+        BitSet bitset;
+        for (size_t pos = peer_sets[idx].first; pos <= peer_sets[idx].last;
+             pos += peer_sets[idx].step) {
+            bitset.set(pos);
+        }
+
+        vector<BitSet> bitsets(route_count, bitset);
+        size_t bytes = 0;
+        for (size_t rt_idx = 0; rt_idx < bitsets.size(); ++rt_idx) {
+            bytes += sizeof(BitSet) + heap_bytes(bitsets[rt_idx]);
+        }
+        size_t vector_bytes = route_count *
+            (sizeof(vector<uint64_t>) + bitset.size() / 8);
+        LOG(DEBUG, peer_sets[idx].name << ": " <<
+            bytes * 1000000 / route_count << " bytes per million routes, " <<
+            vector_bytes * 1000000 / route_count << " with std::vector");
+        EXPECT_LE(bytes, vector_bytes);
+    }
+}
+
 int main(int argc, char **argv) {
     LoggingInit();
     ::testing::InitGoogleTest(&argc, argv);
@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <fstream>
+#include "tbb/atomic.h"
 #include "tbb/task.h"
 #include "base/task.h"
 #include "base/logging.h"
@@ -1357,6 +1358,110 @@ TEST_F(TestUT, test9_1)
     EXPECT_TRUE(scheduler->IsEmpty());
 }
 
+class RescheduleTask : public Task {
+public:
+    RescheduleTask(int id, int num_runs) : Task(id, 0), num_runs_(num_runs) {
+    }
+    bool Run() {
+        return (--num_runs_ == 0);
+    }
+
+private:
+    int num_runs_;
+};
+
+/* Run a task recycled for n number of times with group affinity enabled and
+ * verify the reschedule count and the run/wait time histograms of the group */
+TEST_F(TestUT, test9_2)
+{
+    const int kNumRuns = 10;
+    scheduler->ClearTaskGroupStats(93);
+    scheduler->SetGroupAffinity(true);
+    scheduler->Enqueue(new RescheduleTask(93, kNumRuns));
+    for (int i = 0; i < 10000 && !scheduler->IsEmpty(); i++) {
+        usleep(1000);
+    }
+    EXPECT_TRUE(scheduler->IsEmpty());
+    scheduler->SetGroupAffinity(false);
+
+    TaskStats *stats = scheduler->GetTaskGroupStats(93);
+    EXPECT_EQ(10UL, stats->total_tasks_completed_);
+    EXPECT_EQ(9UL, stats->reschedule_count_);
+    uint64_t wait_samples = 0, run_samples = 0;
+    for (int i = 0; i < TaskStats::kHistogramBuckets; i++) {
+        wait_samples += stats->wait_time_histogram_[i];
+        run_samples += stats->run_time_histogram_[i];
+    }
+    EXPECT_EQ(10UL, wait_samples);
+    EXPECT_EQ(10UL, run_samples);
+    EXPECT_GE(stats->total_run_time_usecs_, stats->max_run_time_usecs_);
+}
+
+static tbb::atomic<int> test9_3_running;
+static tbb::atomic<int> test9_3_runs;
+static tbb::atomic<int> test9_3_stalled_runs_seen;
+
+class StallTask : public Task {
+public:
+    StallTask(int id, int inst, int num_runs)
+        : Task(id, inst), num_runs_(num_runs) {
+    }
+    // Keep recycling until the stalled task has run or num_runs is reached
+    bool Run() {
+        test9_3_running++;
+        test9_3_runs++;
+        usleep(1000);
+        test9_3_running--;
+        return (--num_runs_ == 0 || test9_3_stalled_runs_seen >= 0);
+    }
+
+private:
+    int num_runs_;
+};
+
+class StalledTask : public Task {
+public:
+    StalledTask(int id) : Task(id) {
+    }
+    bool Run() {
+        EXPECT_EQ(0, test9_3_running);
+        test9_3_stalled_runs_seen = test9_3_runs;
+        return true;
+    }
+};
+
+/* Two instances of group 94 recycle back to back while a task of group 95,
+ * which is excluded by 94, is stalled. With work stealing enabled the
+ * stalled task must run before group 94 reaches its run limit and never
+ * concurrently with it */
+TEST_F(TestUT, test9_3)
+{
+    const int kNumRuns = 1000;
+    TaskExclusion rule[] = { TaskExclusion(95) };
+    TaskPolicy policy;
+    InitPolicy(rule, sizeof(rule) / sizeof(TaskExclusion), &policy);
+    scheduler->SetPolicy(94, policy);
+    scheduler->SetWorkStealing(true);
+    test9_3_running = 0;
+    test9_3_runs = 0;
+    test9_3_stalled_runs_seen = -1;
+
+    scheduler->Enqueue(new StallTask(94, 0, kNumRuns));
+    scheduler->Enqueue(new StallTask(94, 1, kNumRuns));
+    for (int i = 0; i < 10000 && test9_3_runs == 0; i++) {
+        usleep(100);
+    }
+    scheduler->Enqueue(new StalledTask(95));
+    for (int i = 0; i < 10000 && !scheduler->IsEmpty(); i++) {
+        usleep(1000);
+    }
+    EXPECT_TRUE(scheduler->IsEmpty());
+    scheduler->SetWorkStealing(false);
+
+    EXPECT_GE(test9_3_stalled_runs_seen, 1);
+    EXPECT_LT(test9_3_stalled_runs_seen, 2 * kNumRuns);
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -72,7 +72,7 @@ struct AsPathSpec : public BgpAttribute {
     std::vector<PathSegment *> path_segments;
 };
 
-class AsPath {
+class AsPath : public BgpPathAttributeHash {
 public:
     explicit AsPath(AsPathDB *aspath_db) : aspath_db_(aspath_db) {
         refcount_ = 0;
@@ -126,6 +126,8 @@ public:
     }
 
 private:
+    template <class, class, class, class>
+    friend class BgpPathAttributeDB;
     friend int intrusive_ptr_add_ref(const AsPath *cpath);
     friend int intrusive_ptr_del_ref(const AsPath *cpath);
     friend void intrusive_ptr_release(const AsPath *cpath);
@@ -148,21 +150,13 @@ inline void intrusive_ptr_release(const AsPath *cpath) {
     if (prev == 1) {
         AsPath *path = const_cast<AsPath *>(cpath);
         path->Remove();
-        assert(path->refcount_ == 0);
-        delete path;
     }
 }
 
 typedef boost::intrusive_ptr<const AsPath> AsPathPtr;
 
-struct AsPathCompare {
-    bool operator()(const AsPath *lhs, const AsPath *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class AsPathDB : public BgpPathAttributeDB<AsPath, AsPathPtr, AsPathSpec,
-                                           AsPathCompare, AsPathDB> {
+                                           AsPathDB> {
 public:
     explicit AsPathDB(BgpServer *server);
 
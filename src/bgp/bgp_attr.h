@@ -227,7 +227,7 @@ struct PmsiTunnelSpec : public BgpAttribute {
     std::vector<uint8_t> identifier;
 };
 
-class PmsiTunnel {
+class PmsiTunnel : public BgpPathAttributeHash {
 public:
     PmsiTunnel(PmsiTunnelDB *pmsi_tunnel_db, const PmsiTunnelSpec &pmsi_spec);
     virtual ~PmsiTunnel() { }
@@ -252,6 +252,8 @@ public:
     Ip4Address identifier;
 
 private:
+    template <class, class, class, class>
+    friend class BgpPathAttributeDB;
     friend int intrusive_ptr_add_ref(const PmsiTunnel *cpmsi_tunnel);
     friend int intrusive_ptr_del_ref(const PmsiTunnel *cpmsi_tunnel);
     friend void intrusive_ptr_release(const PmsiTunnel *cpmsi_tunnel);
@@ -275,22 +277,13 @@ inline void intrusive_ptr_release(const PmsiTunnel *cpmsi_tunnel) {
     if (prev == 1) {
         PmsiTunnel *pmsi_tunnel = const_cast<PmsiTunnel *>(cpmsi_tunnel);
         pmsi_tunnel->Remove();
-        assert(pmsi_tunnel->refcount_ == 0);
-        delete pmsi_tunnel;
     }
 }
 
 typedef boost::intrusive_ptr<PmsiTunnel> PmsiTunnelPtr;
 
-struct PmsiTunnelCompare {
-    bool operator()(const PmsiTunnel *lhs, const PmsiTunnel *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class PmsiTunnelDB : public BgpPathAttributeDB<PmsiTunnel, PmsiTunnelPtr,
                                                PmsiTunnelSpec,
-                                               PmsiTunnelCompare,
                                                PmsiTunnelDB> {
 public:
     explicit PmsiTunnelDB(BgpServer *server);
@@ -322,7 +315,7 @@ struct EdgeDiscoverySpec : public BgpAttribute {
     EdgeList edge_list;
 };
 
-class EdgeDiscovery {
+class EdgeDiscovery : public BgpPathAttributeHash {
 public:
     EdgeDiscovery(EdgeDiscoveryDB *edge_discovery_db,
         const EdgeDiscoverySpec &edspec);
@@ -356,6 +349,8 @@ public:
     EdgeList edge_list;
 
 private:
+    template <class, class, class, class>
+    friend class BgpPathAttributeDB;
     friend int intrusive_ptr_add_ref(const EdgeDiscovery *ediscovery);
     friend int intrusive_ptr_del_ref(const EdgeDiscovery *ediscovery);
     friend void intrusive_ptr_release(const EdgeDiscovery *ediscovery);
@@ -378,23 +373,14 @@ inline void intrusive_ptr_release(const EdgeDiscovery *cediscovery) {
     if (prev == 1) {
         EdgeDiscovery *ediscovery = const_cast<EdgeDiscovery *>(cediscovery);
         ediscovery->Remove();
-        assert(ediscovery->refcount_ == 0);
-        delete ediscovery;
     }
 }
 
 typedef boost::intrusive_ptr<EdgeDiscovery> EdgeDiscoveryPtr;
 
-struct EdgeDiscoveryCompare {
-    bool operator()(const EdgeDiscovery *lhs, const EdgeDiscovery *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class EdgeDiscoveryDB : public BgpPathAttributeDB<EdgeDiscovery,
                                                   EdgeDiscoveryPtr,
                                                   EdgeDiscoverySpec,
-                                                  EdgeDiscoveryCompare,
                                                   EdgeDiscoveryDB> {
 public:
     explicit EdgeDiscoveryDB(BgpServer *server);
@@ -428,7 +414,7 @@ struct EdgeForwardingSpec : public BgpAttribute {
     EdgeList edge_list;
 };
 
-class EdgeForwarding {
+class EdgeForwarding : public BgpPathAttributeHash {
 public:
     EdgeForwarding(EdgeForwardingDB *edge_forwarding_db,
         const EdgeForwardingSpec &efspec);
@@ -462,6 +448,8 @@ public:
     EdgeList edge_list;
 
 private:
+    template <class, class, class, class>
+    friend class BgpPathAttributeDB;
     friend int intrusive_ptr_add_ref(const EdgeForwarding *ceforwarding);
     friend int intrusive_ptr_del_ref(const EdgeForwarding *ceforwarding);
     friend void intrusive_ptr_release(const EdgeForwarding *ceforwarding);
@@ -485,23 +473,14 @@ inline void intrusive_ptr_release(const EdgeForwarding *ceforwarding) {
         EdgeForwarding *eforwarding =
             const_cast<EdgeForwarding *>(ceforwarding);
         eforwarding->Remove();
-        assert(eforwarding->refcount_ == 0);
-        delete eforwarding;
     }
 }
 
 typedef boost::intrusive_ptr<EdgeForwarding> EdgeForwardingPtr;
 
-struct EdgeForwardingCompare {
-    bool operator()(const EdgeForwarding *lhs, const EdgeForwarding *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class EdgeForwardingDB : public BgpPathAttributeDB<EdgeForwarding,
                                                    EdgeForwardingPtr,
                                                    EdgeForwardingSpec,
-                                                   EdgeForwardingCompare,
                                                    EdgeForwardingDB> {
 public:
     explicit EdgeForwardingDB(BgpServer *server);
@@ -555,7 +534,7 @@ struct BgpOListSpec : public BgpAttribute {
     Elements elements;
 };
 
-class BgpOList {
+class BgpOList : public BgpPathAttributeHash {
 public:
     BgpOList(BgpOListDB *olist_db, const BgpOListSpec &olist_spec);
     virtual ~BgpOList();
@@ -574,6 +553,8 @@ public:
     Elements elements;
 
 private:
+    template <class, class, class, class>
+    friend class BgpPathAttributeDB;
     friend int intrusive_ptr_add_ref(const BgpOList *colist);
     friend int intrusive_ptr_del_ref(const BgpOList *colist);
     friend void intrusive_ptr_release(const BgpOList *colist);
@@ -596,23 +577,14 @@ inline void intrusive_ptr_release(const BgpOList *colist) {
     if (prev == 1) {
         BgpOList *olist = const_cast<BgpOList *>(colist);
         olist->Remove();
-        assert(olist->refcount_ == 0);
-        delete olist;
     }
 }
 
 typedef boost::intrusive_ptr<BgpOList> BgpOListPtr;
 
-struct BgpOListCompare {
-    bool operator()(const BgpOList *lhs, const BgpOList *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class BgpOListDB : public BgpPathAttributeDB<BgpOList,
                                              BgpOListPtr,
                                              BgpOListSpec,
-                                             BgpOListCompare,
                                              BgpOListDB> {
 public:
     explicit BgpOListDB(BgpServer *server);
@@ -668,7 +640,7 @@ struct BgpAttrParams : public BgpAttribute {
 typedef std::vector<BgpAttribute *> BgpAttrSpec;
 
 // Canonicalized BGP attribute
-class BgpAttr {
+class BgpAttr : public BgpPathAttributeHash {
 public:
     BgpAttr();
     explicit BgpAttr(BgpAttrDB *attr_db);
@@ -743,6 +715,8 @@ public:
 
 private:
     friend class BgpAttrDB;
+    template <class, class, class, class>
+    friend class BgpPathAttributeDB;
     friend int intrusive_ptr_add_ref(const BgpAttr *cattrp);
     friend int intrusive_ptr_del_ref(const BgpAttr *cattrp);
     friend void intrusive_ptr_release(const BgpAttr *cattrp);
@@ -785,21 +759,13 @@ inline void intrusive_ptr_release(const BgpAttr *cattrp) {
     if (prev == 1) {
         BgpAttr *attrp = const_cast<BgpAttr *>(cattrp);
         attrp->Remove();
-        assert(attrp->refcount_ == 0);
-        delete attrp;
     }
 }
 
 typedef boost::intrusive_ptr<const BgpAttr> BgpAttrPtr;
 
-struct BgpAttrCompare {
-    bool operator()(const BgpAttr *lhs, const BgpAttr *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class BgpAttrDB : public BgpPathAttributeDB<BgpAttr, BgpAttrPtr, BgpAttrSpec,
-                                            BgpAttrCompare, BgpAttrDB> {
+                                            BgpAttrDB> {
 public:
     explicit BgpAttrDB(BgpServer *server);
     BgpAttrPtr ReplaceCommunityAndLocate(const BgpAttr *attr,
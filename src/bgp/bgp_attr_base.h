@@ -7,15 +7,17 @@
 
 #include <boost/functional/hash.hpp>
 #include <boost/scoped_array.hpp>
+#include <tbb/atomic.h>
 #include <tbb/mutex.h>
 
-#include <set>
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/parse_object.h"
 #include "base/task.h"
+#include "base/util.h"
 
 class BgpAttr;
 
@@ -104,41 +106,105 @@ struct BgpProtoPrefix : public ParseObject {
     uint8_t type;
 };
 
+//
+// Base class for attributes that are interned in a BgpPathAttributeDB. The
+// database caches the hash of the attribute contents here when the attribute
+// is located, so that Delete doesn't need to hash the contents again.
+//
+// The hash is not copied along with the attribute since a copy is normally
+// modified before it gets located.
+//
+class BgpPathAttributeHash {
+public:
+    BgpPathAttributeHash() : attr_hash_(0) { }
+    BgpPathAttributeHash(const BgpPathAttributeHash &rhs) : attr_hash_(0) { }
+    BgpPathAttributeHash &operator=(const BgpPathAttributeHash &rhs) {
+        return *this;
+    }
+
+    size_t attr_hash() const { return attr_hash_; }
+
+private:
+    template <class Type, class TypePtr, class TypeSpec, class TypeDB>
+    friend class BgpPathAttributeDB;
+    size_t attr_hash_;
+};
+
 //
 // Base class to manage BGP Path Attributes database. This class provides
 // thread safe access to the data base.
 //
-// Lock contention can be tuned by varying the hash table size passed to the
-// constructor.
+// The database is split into shards based on the hash of the attribute
+// contents. Each shard is an open addressing hash table of attribute
+// pointers along with the hash of the attribute.
+//
+// Lookups that find a live attribute don't take any lock. Inserts, deletes
+// and resizes of a shard are serialized by the shard mutex. Attributes and
+// tables that are unlinked from a shard are freed only after all lookups that
+// could have seen them are done. This is tracked using an epoch and a pair of
+// reader counts per shard: a lookup registers itself in the reader count of
+// the current epoch, and the epoch is advanced only after the reader count of
+// the previous epoch drains.
+//
+// Write contention can be tuned by varying the number of shards passed to
+// the constructor. The default can be overridden with the
+// BGP_PATH_ATTRIBUTE_DB_SHARD_COUNT environment variable.
 //
 // Attribute contents must be hashable via hash_value() and hashed using
-// boost::hash_combine() to partition the attribute database.
+// boost::hash_combine(). Type must derive from BgpPathAttributeHash.
 //
-template <class Type, class TypePtr, class TypeSpec, typename TypeCompare,
-          class TypeDB>
+template <class Type, class TypePtr, class TypeSpec, class TypeDB>
 class BgpPathAttributeDB {
 public:
-    explicit BgpPathAttributeDB(int hash_size = GetHashSize())
-        : hash_size_(hash_size),
-          set_(new Set[hash_size]),
-          mutex_(new tbb::mutex[hash_size]) {
+    explicit BgpPathAttributeDB(int shard_count = GetShardCount())
+        : shard_count_(std::max(shard_count, 1)),
+          shards_(new Shard[shard_count_]) {
+    }
+
+    ~BgpPathAttributeDB() {
+        for (size_t i = 0; i < shard_count_; i++) {
+            Shard *shard = &shards_[i];
+            delete shard->table;
+            for (int j = 0; j < 2; j++) {
+                STLDeleteValues(&shard->retired[j]);
+                STLDeleteValues(&shard->retired_tables[j]);
+            }
+        }
     }
 
     size_t Size() {
         size_t size = 0;
 
-        for (size_t i = 0; i < hash_size_; i++) {
-            tbb::mutex::scoped_lock lock(mutex_[i]);
-            size += set_[i].size();
+        for (size_t i = 0; i < shard_count_; i++) {
+            tbb::mutex::scoped_lock lock(shards_[i].mutex);
+            size += shards_[i].size;
         }
         return size;
     }
 
+    // Remove the attribute from the database and take ownership of it. The
+    // attribute is freed once no concurrent lookup can be referencing it.
     void Delete(Type *attr) {
-        size_t hash = HashCompute(attr);
+        size_t hash = attr->attr_hash_;
+        Shard *shard = &shards_[hash % shard_count_];
+        std::vector<Type *> free_list;
+        std::vector<Table *> free_tables;
+        bool found;
+
+        {
+            tbb::mutex::scoped_lock lock(shard->mutex);
+            found = Unlink(shard, hash, attr);
+            if (found)
+                shard->retired[shard->epoch & 1].push_back(attr);
+            Reclaim(shard, &free_list, &free_tables);
+        }
 
-        tbb::mutex::scoped_lock lock(mutex_[hash]);
-        set_[hash].erase(attr);
+        // An attribute that never made it into the database can't be seen
+        // by a lookup, so free it right away.
+        if (!found)
+            delete attr;
+        STLDeleteValues(&free_list);
+        STLDeleteValues(&free_tables);
     }
 
     // Locate passed in attribute in the data base based on the attr ptr.
@@ -153,89 +219,277 @@ public:
     }
 
 private:
-    const size_t HashCompute(Type *attr) const {
-        if (hash_size_ <= 1) return 0;
+    static const int kDefaultShardCount = 64;
+    static const size_t kInitialSlots = 16;
 
+    struct Slot {
+        Slot() {
+            hash = 0;
+            entry = NULL;
+        }
+        tbb::atomic<size_t> hash;
+        tbb::atomic<Type *> entry;
+    };
+
+    struct Table {
+        explicit Table(size_t slot_count)
+            : mask(slot_count - 1), slots(new Slot[slot_count]) {
+        }
+        size_t mask;
+        boost::scoped_array<Slot> slots;
+    };
+
+    struct Shard {
+        Shard() : size(0), used(0) {
+            table = new Table(kInitialSlots);
+            epoch = 0;
+            readers[0] = 0;
+            readers[1] = 0;
+        }
+
+        // Accessed by lookups.
+        tbb::atomic<Table *> table;
+        tbb::atomic<uint32_t> epoch;
+        tbb::atomic<int> readers[2];
+
+        // Protected by the mutex.
+        tbb::mutex mutex;
+        size_t size;
+        size_t used;
+        std::vector<Type *> retired[2];
+        std::vector<Table *> retired_tables[2];
+        char pad[64];
+    };
+
+    // Marks a slot whose attribute has been deleted. Never dereferenced.
+    static Type *Tombstone() {
+        return reinterpret_cast<Type *>(static_cast<uintptr_t>(1));
+    }
+
+    static size_t HashCompute(const Type *attr) {
         size_t hash = 0;
         boost::hash_combine(hash, *attr);
-        return hash % hash_size_;
-    }
 
-    static size_t GetHashSize() {
-        char *str = getenv("BGP_PATH_ATTRIBUTE_DB_HASH_SIZE");
+        // The shard and the slot are picked from different bits of the hash,
+        // so mix it to spread attribute hashes that only vary in a few bits.
+        uint64_t value = hash;
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        return static_cast<size_t>(value);
+    }
 
-        // Use just one bucket for now.
-        if (!str) return 1;
+    static int GetShardCount() {
+        char *str = getenv("BGP_PATH_ATTRIBUTE_DB_SHARD_COUNT");
+        if (!str) return kDefaultShardCount;
         return strtoul(str, NULL, 0);
     }
 
+    size_t SlotIndex(const Table *table, size_t hash) const {
+        return (hash / shard_count_) & table->mask;
+    }
+
+    // Register a lookup in the reader count of the current epoch. Returns
+    // the index of the reader count to be released via ExitShard.
+    static int EnterShard(Shard *shard) {
+        while (true) {
+            uint32_t epoch = shard->epoch;
+            int index = epoch & 1;
+            shard->readers[index].fetch_and_increment();
+            if (shard->epoch == epoch)
+                return index;
+            shard->readers[index].fetch_and_decrement();
+        }
+    }
+
+    static void ExitShard(Shard *shard, int index) {
+        shard->readers[index].fetch_and_decrement();
+    }
+
+    // Advance the epoch of the shard if there are no lookups left from the
+    // previous epoch. Anything retired in the previous epoch can't be seen
+    // by any lookup at that point and is moved to the free lists.
+    //
+    // Called with the shard mutex held. Tries twice so that entries retired
+    // in the current epoch get freed right away if there are no lookups.
+    static void Reclaim(Shard *shard, std::vector<Type *> *free_list,
+                        std::vector<Table *> *free_tables) {
+        for (int i = 0; i < 2; i++) {
+            int prev = (shard->epoch + 1) & 1;
+            if (shard->retired[prev].empty() &&
+                shard->retired_tables[prev].empty() &&
+                shard->retired[prev ^ 1].empty() &&
+                shard->retired_tables[prev ^ 1].empty()) {
+                return;
+            }
+            if (shard->readers[prev] != 0)
+                return;
+            free_list->insert(free_list->end(),
+                shard->retired[prev].begin(), shard->retired[prev].end());
+            free_tables->insert(free_tables->end(),
+                shard->retired_tables[prev].begin(),
+                shard->retired_tables[prev].end());
+            shard->retired[prev].clear();
+            shard->retired_tables[prev].clear();
+            shard->epoch.fetch_and_increment();
+        }
+    }
+
+    // Take a reference on the attribute unless its refcount already dropped
+    // to 0. Such an attribute is being released and must not be revived.
+    static bool AddRefIfLive(Type *entry) {
+        int count = entry->refcount_;
+        while (count > 0) {
+            int prev = entry->refcount_.compare_and_swap(count + 1, count);
+            if (prev == count)
+                return true;
+            count = prev;
+        }
+        return false;
+    }
+
+    // Find a live attribute with the same contents as attr. A reference is
+    // taken on the attribute that is returned.
+    //
+    // An attribute whose refcount already dropped to 0 is about to be
+    // deleted and is skipped. The dying flag is set if such an attribute
+    // is found.
+    Type *Find(const Table *table, size_t hash, const Type *attr,
+               bool *dying) const {
+        for (size_t idx = SlotIndex(table, hash); ;
+             idx = (idx + 1) & table->mask) {
+            const Slot &slot = table->slots[idx];
+            Type *entry = slot.entry;
+            if (entry == NULL)
+                return NULL;
+            if (entry == Tombstone() || slot.hash != hash)
+                continue;
+            if (entry->CompareTo(*attr) != 0)
+                continue;
+            if (AddRefIfLive(entry))
+                return entry;
+            if (dying)
+                *dying = true;
+        }
+    }
+
+    // Called with the shard mutex held.
+    bool Unlink(Shard *shard, size_t hash, const Type *attr) {
+        Table *table = shard->table;
+        for (size_t idx = SlotIndex(table, hash); ;
+             idx = (idx + 1) & table->mask) {
+            Slot &slot = table->slots[idx];
+            Type *entry = slot.entry;
+            if (entry == NULL)
+                return false;
+            if (entry == attr) {
+                slot.entry = Tombstone();
+                shard->size--;
+                return true;
+            }
+        }
+    }
+
+    // Called with the shard mutex held. Keeps the load factor including
+    // tombstones at or below 3/4 so that every probe sequence terminates.
+    void Insert(Shard *shard, size_t hash, Type *attr) {
+        Table *table = shard->table;
+        if ((shard->used + 1) * 4 > (table->mask + 1) * 3)
+            table = Resize(shard);
+
+        for (size_t idx = SlotIndex(table, hash); ;
+             idx = (idx + 1) & table->mask) {
+            Slot &slot = table->slots[idx];
+            Type *entry = slot.entry;
+            if (entry == NULL || entry == Tombstone()) {
+                if (entry == NULL)
+                    shard->used++;
+                slot.hash = hash;
+                slot.entry = attr;
+                shard->size++;
+                return;
+            }
+        }
+    }
+
+    // Called with the shard mutex held. Rehashes the live attributes into a
+    // table that is at most half full and drops all tombstones.
+    Table *Resize(Shard *shard) {
+        Table *old_table = shard->table;
+        size_t slot_count = kInitialSlots;
+        while (slot_count < (shard->size + 1) * 2)
+            slot_count *= 2;
+
+        Table *table = new Table(slot_count);
+        for (size_t i = 0; i <= old_table->mask; i++) {
+            const Slot &old_slot = old_table->slots[i];
+            Type *entry = old_slot.entry;
+            if (entry == NULL || entry == Tombstone())
+                continue;
+            size_t idx = SlotIndex(table, old_slot.hash);
+            while (table->slots[idx].entry != NULL)
+                idx = (idx + 1) & table->mask;
+            table->slots[idx].hash = old_slot.hash;
+            table->slots[idx].entry = entry;
+        }
+
+        shard->used = shard->size;
+        shard->table = table;
+        shard->retired_tables[shard->epoch & 1].push_back(old_table);
+        return table;
+    }
+
     // This template safely retrieves an attribute entry from its data base.
     // If the entry is not found, it is inserted into the database.
     //
     // If the entry is already present, then passed in entry is freed and
     // existing entry is returned.
     TypePtr LocateInternal(Type *attr) {
-        // Hash attribute contents to to avoid potential mutex contention.
         size_t hash = HashCompute(attr);
-        while (true) {
-            // Grab mutex to keep db access thread safe.
-            tbb::mutex::scoped_lock lock(mutex_[hash]);
-            std::pair<typename Set::iterator, bool> ret;
-
-            // Try to insert the passed entry into the database.
-            ret = set_[hash].insert(attr);
-
-            // Take a reference to prevent this entry from getting deleted.
-            // Counter is automatically incremented, hence we get thread safety
-            // here.
-            int prev = intrusive_ptr_add_ref(*ret.first);
-
-            // Check if passed in entry did get into the data base.
-            if (ret.second) {
-                // Take intrusive pointer, thereby incrementing the refcount.
-                TypePtr ptr = TypePtr(*ret.first);
-
-                // Release redundant refcount taken above to protect this entry
-                // from getting deleted, as we have now bumped up refcount above
-                intrusive_ptr_del_ref(*ret.first);
-                return ptr;
-            }
+        attr->attr_hash_ = hash;
+        Shard *shard = &shards_[hash % shard_count_];
 
-            // Make sure that this entry, though in the database is not
-            // undergoing deletion. This can happen because attribute intrusive
-            // pointer is released without taking the mutex.
-            //
-            // If the previous refcount is 0, it implies that this entry is
-            // about to get deleted (after we release the mutex). In such
-            // cases, we retry inserting the passed attribute pointer into the
-            // data base.
-            if (prev > 0) {
-                // Free passed in attribute, as it is already in the database.
-                delete attr;
-
-                // Take intrusive pointer, thereby incrementing the refcount.
-                TypePtr ptr = TypePtr(*ret.first);
-
-                // Release redundant refcount taken above to protect this entry
-                // from getting deleted, as we have now bumped up refcount above
-                intrusive_ptr_del_ref(*ret.first);
-                return ptr;
+        // Look for a live entry without taking the shard mutex.
+        int index = EnterShard(shard);
+        Type *entry = Find(shard->table, hash, attr, NULL);
+        ExitShard(shard, index);
+        if (entry)
+            return TakeReference(attr, entry);
+
+        while (true) {
+            bool dying = false;
+            {
+                tbb::mutex::scoped_lock lock(shard->mutex);
+                entry = Find(shard->table, hash, attr, &dying);
+                if (!entry && !dying) {
+                    Insert(shard, hash, attr);
+                    return TypePtr(attr);
+                }
             }
+            if (entry)
+                return TakeReference(attr, entry);
 
-            // Decrement the counter bumped up above as we can't use this entry
-            // which is above to be deleted. Instead, retry inserting the passed
-            // entry again, into the database.
-            intrusive_ptr_del_ref(*ret.first);
+            // An entry with the same contents is about to be deleted, as
+            // attribute intrusive pointers are released without taking the
+            // mutex. Retry once it's gone from the database.
         }
 
         assert(false);
         return NULL;
     }
 
-    typedef std::set<Type *, TypeCompare> Set;
-    size_t hash_size_;
-    boost::scoped_array<Set> set_;
-    boost::scoped_array<tbb::mutex> mutex_;
+    // Free passed in attribute, as an entry with the same contents is
+    // already in the database. Take an intrusive pointer on the entry and
+    // release the reference taken by Find.
+    TypePtr TakeReference(Type *attr, Type *entry) {
+        delete attr;
+        TypePtr ptr = TypePtr(entry);
+        intrusive_ptr_del_ref(entry);
+        return ptr;
+    }
+
+    size_t shard_count_;
+    boost::scoped_array<Shard> shards_;
 };
 
 #endif  // SRC_BGP_BGP_ATTR_BASE_H_
@@ -310,9 +310,9 @@ bool BgpConditionListener::StartWalk() {
     DBTableWalker::WalkCompleteFn walk_complete
         = boost::bind(&BgpConditionListener::WalkDone, this, _1);
 
-    DBTableWalker::WalkFn walker
-        = boost::bind(&BgpConditionListener::BgpRouteNotify, this, server(),
-                      _1, _2);
+    DBTableWalker::WalkBatchFn walker
+        = boost::bind(&BgpConditionListener::BgpRouteBatchNotify, this,
+                      server(), _1, _2);
 
     for (WalkRequestMap::iterator it = walk_map_.begin();
          it != walk_map_.end(); ++it) {
@@ -321,7 +321,8 @@ bool BgpConditionListener::StartWalk() {
         }
         DB *db = server()->database();
         DBTableWalker::WalkId id =
-            db->GetWalker()->WalkTable(it->first, NULL, walker, walk_complete);
+            db->GetWalker()->WalkTableBatch(it->first, NULL, walker,
+                                            walk_complete);
         it->second->WalkStarted(id);
     }
     return true;
@@ -354,6 +355,19 @@ bool BgpConditionListener::BgpRouteNotify(BgpServer *server,
     return true;
 }
 
+// Table walker
+// The match functions add and delete routes through the table partition,
+// which only marks a route deleted while the table has listeners, so the
+// routes of the batch are never removed under the walk.
+bool BgpConditionListener::BgpRouteBatchNotify(BgpServer *server,
+    DBTablePartBase *root, const DBTableWalker::EntryBatch &batch) {
+    for (DBTableWalker::EntryBatch::const_iterator it = batch.begin();
+         it != batch.end(); ++it) {
+        BgpRouteNotify(server, root, *it);
+    }
+    return true;
+}
+
 //
 // WalkComplete function
 // At the end of the walk reset the WalkId.
@@ -15,6 +15,7 @@
 #include "bgp/bgp_table.h"
 #include "bgp/bgp_route.h"
 #include "db/db_table_partition.h"
+#include "db/db_table_walker.h"
 
 //
 // ConditionMatch
@@ -202,6 +203,9 @@ private:
     // Table listener
     bool BgpRouteNotify(BgpServer *server, DBTablePartBase *root,
                         DBEntryBase *entry);
+    // Table walker
+    bool BgpRouteBatchNotify(BgpServer *server, DBTablePartBase *root,
+                             const DBTableWalker::EntryBatch &batch);
 
     void TableWalk(BgpTable *table, ConditionMatch *obj, RequestDoneCb cb);
 
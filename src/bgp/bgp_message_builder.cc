@@ -4,6 +4,7 @@
 
 #include "bgp/bgp_message_builder.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "base/parse_object.h"
@@ -13,13 +14,23 @@
 
 using std::auto_ptr;
 
-BgpMessage::BgpMessage(const BgpTable *table) : table_(table), datalen_(0) {
+BgpMessage::BgpMessage(const BgpTable *table)
+    : table_(table),
+      msg_length_offset_(-1),
+      attr_length_offset_(-1),
+      nlri_length_offset_(-1),
+      datalen_(0) {
 }
 
 BgpMessage::~BgpMessage() {
 }
 
-bool BgpMessage::StartReach(const RibOutAttr *roattr, const BgpRoute *route) {
+//
+// Encode the BGP header, path attributes and the MP_REACH_NLRI attribute for
+// the given RibOutAttr. The MP_REACH_NLRI doesn't contain any prefixes yet.
+//
+bool BgpMessage::EncodeReachAttributes(const RibOutAttr *roattr,
+                                       const BgpRoute *route) {
     BgpProto::Update update;
     const BgpAttr *attr = roattr->attr();
 
@@ -121,13 +132,31 @@ bool BgpMessage::StartReach(const RibOutAttr *roattr, const BgpRoute *route) {
         BgpAttribute::MPReachNlri, route->Afi(), route->Safi(), nh);
     update.path_attributes.push_back(nlri);
 
-    BgpProtoPrefix *prefix = new BgpProtoPrefix;
-    route->BuildProtoPrefix(prefix, attr, roattr->label());
-    nlri->nlri.push_back(prefix);
-
+    EncodeOffsets encode_offsets;
     int result =
-        BgpProto::Encode(&update, data_, sizeof(data_), &encode_offsets_);
-    if (result <= 0) {
+        BgpProto::Encode(&update, data_, sizeof(data_), &encode_offsets);
+    if (result <= 0 || !SaveOffsets(&encode_offsets))
+        return false;
+
+    datalen_ = result;
+    return true;
+}
+
+//
+// Use the encoded attributes from the table's cache if possible and add the
+// first prefix to the message.
+//
+bool BgpMessage::StartReach(const RibOutAttr *roattr, const BgpRoute *route) {
+    BgpMessageAttrCache *cache =
+        table_ ? table_->message_attr_cache() : NULL;
+    bool success = true;
+    if (!cache || !cache->Lookup(roattr->attr(), this)) {
+        success = EncodeReachAttributes(roattr, route);
+        if (success && cache)
+            cache->Insert(roattr->attr(), this);
+    }
+
+    if (!success || !AddRoute(route, roattr)) {
         BGP_LOG_STR(BgpMessage, SandeshLevel::SYS_WARN, BGP_LOG_FLAG_ALL,
             "Error encoding reach message for route " << route->ToString() <<
             " in table " << (table_ ? table_->name() : "unknown"));
@@ -135,8 +164,6 @@ bool BgpMessage::StartReach(const RibOutAttr *roattr, const BgpRoute *route) {
         return false;
     }
 
-    num_reach_route_++;
-    datalen_ = result;
     return true;
 }
 
@@ -151,9 +178,10 @@ bool BgpMessage::StartUnreach(const BgpRoute *route) {
     route->BuildProtoPrefix(prefix);
     nlri->nlri.push_back(prefix);
 
+    EncodeOffsets encode_offsets;
     int result =
-        BgpProto::Encode(&update, data_, sizeof(data_), &encode_offsets_);
-    if (result <= 0) {
+        BgpProto::Encode(&update, data_, sizeof(data_), &encode_offsets);
+    if (result <= 0 || !SaveOffsets(&encode_offsets)) {
         BGP_LOG_STR(BgpMessage, SandeshLevel::SYS_WARN, BGP_LOG_FLAG_ALL,
             "Error encoding unreach message for route " << route->ToString() <<
             " in table " << (table_ ? table_->name() : "unknown"));
@@ -174,15 +202,22 @@ bool BgpMessage::Start(const RibOutAttr *roattr, const BgpRoute *route) {
     }
 }
 
-bool BgpMessage::UpdateLength(const char *tag, int size, int delta) {
-    int offset = encode_offsets_.FindOffset(tag);
-    if (offset < 0) {
-        return false;
-    }
+//
+// Look up the offsets of the length fields that need to be updated as
+// prefixes get added to the message.
+//
+bool BgpMessage::SaveOffsets(EncodeOffsets *encode_offsets) {
+    msg_length_offset_ = encode_offsets->FindOffset("BgpMsgLength");
+    attr_length_offset_ = encode_offsets->FindOffset("BgpPathAttribute");
+    nlri_length_offset_ = encode_offsets->FindOffset("MpReachUnreachNlri");
+    return (msg_length_offset_ >= 0 && attr_length_offset_ >= 0 &&
+            nlri_length_offset_ >= 0);
+}
+
+void BgpMessage::UpdateLength(int offset, int size, int delta) {
     int value = get_value(&data_[offset], size);
     value += delta;
     put_value(&data_[offset], size, value);
-    return true;
 }
 
 bool BgpMessage::AddRoute(const BgpRoute *route, const RibOutAttr *roattr) {
@@ -212,21 +247,9 @@ bool BgpMessage::AddRoute(const BgpRoute *route, const RibOutAttr *roattr) {
         num_unreach_route_++;
     }
 
-    if (!UpdateLength("BgpMsgLength", 2, result)) {
-        assert(false);
-        return false;
-    }
-
-    if (!UpdateLength("BgpPathAttribute", 2, result)) {
-        assert(false);
-        return false;
-    }
-
-    if (!UpdateLength("MpReachUnreachNlri", 2, result)) {
-        assert(false);
-        return false;
-    }
-
+    UpdateLength(msg_length_offset_, 2, result);
+    UpdateLength(attr_length_offset_, 2, result);
+    UpdateLength(nlri_length_offset_, 2, result);
     return true;
 }
 
@@ -250,3 +273,67 @@ Message *BgpMessageBuilder::Create(const BgpTable *table,
 
 BgpMessageBuilder::BgpMessageBuilder() {
 }
+
+BgpMessageAttrCache::BgpMessageAttrCache(size_t max_entries)
+    : max_entries_(max_entries), hit_count_(0), miss_count_(0) {
+}
+
+BgpMessageAttrCache::~BgpMessageAttrCache() {
+}
+
+//
+// Copy the cached encoding for the attribute into the message.
+//
+bool BgpMessageAttrCache::Lookup(const BgpAttr *attr, BgpMessage *msg) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    EntryMap::iterator loc = entry_map_.find(attr);
+    if (loc == entry_map_.end()) {
+        miss_count_++;
+        return false;
+    }
+
+    hit_count_++;
+    EntryList::iterator it = loc->second;
+    lru_list_.splice(lru_list_.begin(), lru_list_, it);
+    std::copy(it->data.begin(), it->data.end(), msg->data_);
+    msg->datalen_ = it->data.size();
+    msg->msg_length_offset_ = it->msg_length_offset;
+    msg->attr_length_offset_ = it->attr_length_offset;
+    msg->nlri_length_offset_ = it->nlri_length_offset;
+    return true;
+}
+
+//
+// Save the encoding of the message for the attribute. The message must not
+// contain any prefixes yet.
+//
+void BgpMessageAttrCache::Insert(const BgpAttr *attr, const BgpMessage *msg) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    if (entry_map_.find(attr) != entry_map_.end())
+        return;
+
+    if (entry_map_.size() >= max_entries_) {
+        entry_map_.erase(lru_list_.back().attr.get());
+        lru_list_.pop_back();
+    }
+
+    lru_list_.push_front(Entry());
+    Entry &entry = lru_list_.front();
+    entry.attr = attr;
+    entry.data.assign(msg->data_, msg->data_ + msg->datalen_);
+    entry.msg_length_offset = msg->msg_length_offset_;
+    entry.attr_length_offset = msg->attr_length_offset_;
+    entry.nlri_length_offset = msg->nlri_length_offset_;
+    entry_map_.insert(std::make_pair(attr, lru_list_.begin()));
+}
+
+void BgpMessageAttrCache::Clear() {
+    tbb::mutex::scoped_lock lock(mutex_);
+    entry_map_.clear();
+    lru_list_.clear();
+}
+
+size_t BgpMessageAttrCache::size() const {
+    tbb::mutex::scoped_lock lock(mutex_);
+    return entry_map_.size();
+}
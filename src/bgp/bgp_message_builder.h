@@ -5,6 +5,12 @@
 #ifndef SRC_BGP_BGP_MESSAGE_BUILDER_H_
 #define SRC_BGP_BGP_MESSAGE_BUILDER_H_
 
+#include <tbb/mutex.h>
+
+#include <list>
+#include <map>
+#include <vector>
+
 #include "bgp/bgp_proto.h"
 #include "bgp/message_builder.h"
 
@@ -18,18 +24,79 @@ public:
     virtual const uint8_t *GetData(IPeerUpdate *ipeer_update, size_t *lenp);
 
 private:
+    friend class BgpMessageAttrCache;
+
     bool StartReach(const RibOutAttr *roattr, const BgpRoute *route);
     bool StartUnreach(const BgpRoute *route);
-    bool UpdateLength(const char *tag, int size, int delta);
+    bool EncodeReachAttributes(const RibOutAttr *roattr,
+                               const BgpRoute *route);
+    bool SaveOffsets(EncodeOffsets *encode_offsets);
+    void UpdateLength(int offset, int size, int delta);
 
     const BgpTable *table_;
-    EncodeOffsets encode_offsets_;
+    int msg_length_offset_;
+    int attr_length_offset_;
+    int nlri_length_offset_;
     uint8_t data_[BgpProto::kMaxMessageSize];
     size_t datalen_;
 
     DISALLOW_COPY_AND_ASSIGN(BgpMessage);
 };
 
+//
+// Cache of encoded update messages without any NLRI, keyed on the BgpAttr.
+// An entry holds the BGP header, the path attributes and the MP_REACH_NLRI
+// attribute header for the attribute, so that a BgpMessage for a route only
+// needs to copy the entry and append the prefixes.
+//
+// The encoding only depends on the attribute and the address family, so a
+// single cache is kept per BgpTable and shared by all its RibOuts. This
+// avoids encoding the same attribute again for each RibOut when it gets
+// advertised to many peers with different export policies.
+//
+// Entries hold a reference to the attribute so that the key can't get
+// reused by a different attribute. The least recently used entry is
+// evicted when the cache is full.
+//
+// Concurrency: accessed from bgp::SendTask instances for different
+// scheduling groups, so all access is serialized by the mutex.
+//
+class BgpMessageAttrCache {
+public:
+    static const size_t kMaxEntries = 1024;
+
+    explicit BgpMessageAttrCache(size_t max_entries = kMaxEntries);
+    ~BgpMessageAttrCache();
+
+    bool Lookup(const BgpAttr *attr, BgpMessage *msg);
+    void Insert(const BgpAttr *attr, const BgpMessage *msg);
+    void Clear();
+
+    size_t size() const;
+    uint64_t hit_count() const { return hit_count_; }
+    uint64_t miss_count() const { return miss_count_; }
+
+private:
+    struct Entry {
+        BgpAttrPtr attr;
+        std::vector<uint8_t> data;
+        int msg_length_offset;
+        int attr_length_offset;
+        int nlri_length_offset;
+    };
+    typedef std::list<Entry> EntryList;
+    typedef std::map<const BgpAttr *, EntryList::iterator> EntryMap;
+
+    mutable tbb::mutex mutex_;
+    size_t max_entries_;
+    EntryList lru_list_;
+    EntryMap entry_map_;
+    uint64_t hit_count_;
+    uint64_t miss_count_;
+
+    DISALLOW_COPY_AND_ASSIGN(BgpMessageAttrCache);
+};
+
 class BgpMessageBuilder : public MessageBuilder {
 public:
     BgpMessageBuilder();
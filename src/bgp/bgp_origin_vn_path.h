@@ -33,7 +33,7 @@ struct OriginVnPathSpec : public BgpAttribute {
     virtual size_t EncodeLength() const;
 };
 
-class OriginVnPath {
+class OriginVnPath : public BgpPathAttributeHash {
 public:
     typedef boost::array<uint8_t, 8> OriginVnValue;
     typedef std::vector<OriginVnValue> OriginVnList;
@@ -68,6 +68,8 @@ public:
     }
 
 private:
+    template <class, class, class, class>
+    friend class BgpPathAttributeDB;
     friend int intrusive_ptr_add_ref(const OriginVnPath *covnpath);
     friend int intrusive_ptr_del_ref(const OriginVnPath *covnpath);
     friend void intrusive_ptr_release(const OriginVnPath *covnpath);
@@ -90,22 +92,13 @@ inline void intrusive_ptr_release(const OriginVnPath *covnpath) {
     if (prev == 1) {
         OriginVnPath *ovnpath = const_cast<OriginVnPath *>(covnpath);
         ovnpath->Remove();
-        assert(ovnpath->refcount_ == 0);
-        delete ovnpath;
     }
 }
 
 typedef boost::intrusive_ptr<const OriginVnPath> OriginVnPathPtr;
 
-struct OriginVnPathCompare {
-    bool operator()(const OriginVnPath *lhs, const OriginVnPath *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class OriginVnPathDB : public BgpPathAttributeDB<OriginVnPath, OriginVnPathPtr,
                                                  OriginVnPathSpec,
-                                                 OriginVnPathCompare,
                                                  OriginVnPathDB> {
 public:
     explicit OriginVnPathDB(BgpServer *server);
@@ -3,6 +3,10 @@
  */
 
 #include "bgp/bgp_path.h"
+
+#include <algorithm>
+#include <limits>
+
 #include "bgp/bgp_server.h"
 
 std::string BgpPath::PathIdString(uint32_t path_id) {
@@ -32,82 +36,102 @@ BgpPath::BgpPath(const IPeer *peer, uint32_t path_id, PathSource src,
                  const BgpAttrPtr ptr, uint32_t flags, uint32_t label)
     : peer_(peer), path_id_(path_id), source_(src), attr_(ptr),
       flags_(flags), label_(label) {
+    InitPathKey();
 }
 
 BgpPath::BgpPath(const IPeer *peer, PathSource src, const BgpAttrPtr ptr,
         uint32_t flags, uint32_t label)
     : peer_(peer), path_id_(0), source_(src), attr_(ptr),
       flags_(flags), label_(label) {
+    InitPathKey();
 }
 
 BgpPath::BgpPath(uint32_t path_id, PathSource src, const BgpAttrPtr ptr,
         uint32_t flags, uint32_t label)
     : peer_(NULL), path_id_(path_id), source_(src), attr_(ptr),
       flags_(flags), label_(label) {
+    InitPathKey();
 }
 
 BgpPath::BgpPath(PathSource src, const BgpAttrPtr ptr,
         uint32_t flags, uint32_t label)
     : peer_(NULL), path_id_(0), source_(src), attr_(ptr),
       flags_(flags), label_(label) {
+    InitPathKey();
 }
 
-// True is better
-#define BOOL_COMPARE(CondA, CondB)   \
-    do {                                \
-        if (CondA) {                    \
-            if (!(CondB)) return -1;    \
-        } else {                        \
-            if (CondB) return 1;        \
-        }                               \
-    } while (0)
-
-int BgpPath::PathCompare(const BgpPath &rhs, bool allow_ecmp) const {
-    const BgpAttr *rattr = rhs.GetAttr();
+//
+// Pack the path selection criteria into the path key. The attributes and the
+// path flags that determine feasibility don't change after the path has been
+// created. The peer's bgp identifier is sampled when the path is created.
+// A path without attributes is worse than any other path.
+//
+void BgpPath::InitPathKey() {
+    if (!attr_) {
+        key_.preference = std::numeric_limits<uint64_t>::max();
+        key_.sequence = std::numeric_limits<uint32_t>::max();
+        key_.as_path = std::numeric_limits<uint32_t>::max();
+        key_.neighbor_as = std::numeric_limits<uint32_t>::max();
+        key_.med = std::numeric_limits<uint32_t>::max();
+        key_.source = std::numeric_limits<uint64_t>::max();
+        key_.peer = std::numeric_limits<uint64_t>::max();
+        return;
+    }
 
-    // Feasible Path first
-    KEY_COMPARE(rhs.IsFeasible(), IsFeasible());
+    key_.preference = (static_cast<uint64_t>(!IsFeasible()) << 32) |
+        static_cast<uint32_t>(~attr_->local_pref());
+    key_.sequence = ~attr_->sequence_number();
+    uint32_t as_path_count = std::min(attr_->as_path_count(), 0xFFFFFF);
+    key_.as_path = (as_path_count << 8) | attr_->origin();
+    key_.neighbor_as = attr_->neighbor_as();
+    key_.med = attr_->med();
+    key_.source = (static_cast<uint64_t>(peer_ != NULL) << 48) |
+        (static_cast<uint64_t>(0xFF - source_) << 40) | path_id_;
+    if (peer_ == NULL)
+        return;
+    key_.source |= static_cast<uint64_t>(!peer_->IsXmppPeer()) << 32;
+    key_.peer = (static_cast<uint64_t>(peer_->PeerType() == BgpProto::IBGP)
+                 << 32) | peer_->bgp_identifier();
+}
 
-    // Compare local_pref in reverse order as larger is better.
-    KEY_COMPARE(rattr->local_pref(), attr_->local_pref());
+int BgpPath::PathKey::CompareTo(const PathKey &rhs, bool allow_ecmp) const {
+    // Feasible path first and then larger local_pref.
+    KEY_COMPARE(preference, rhs.preference);
 
-    // Compare sequence_number in reverse order as larger is better.
-    KEY_COMPARE(rattr->sequence_number(), attr_->sequence_number());
+    // Larger sequence_number.
+    KEY_COMPARE(sequence, rhs.sequence);
 
     // For ECMP paths, above checks should suffice
     if (allow_ecmp)
         return 0;
 
-    KEY_COMPARE(attr_->as_path_count(), rattr->as_path_count());
-
-    KEY_COMPARE(attr_->origin(), rattr->origin());
+    // Shorter as path and then lower origin.
+    KEY_COMPARE(as_path, rhs.as_path);
 
-    if (attr_->neighbor_as() == rattr->neighbor_as()) {
-        KEY_COMPARE(attr_->med(), rattr->med());
+    if (neighbor_as == rhs.neighbor_as) {
+        KEY_COMPARE(med, rhs.med);
     }
 
-    // Prefer locally generated routes over bgp and xmpp routes.
-    BOOL_COMPARE(peer_ == NULL, rhs.peer_ == NULL);
+    // Prefer locally generated routes over bgp and xmpp routes, then larger
+    // source, then xmpp routes over bgp routes and then lower path id.
+    KEY_COMPARE(source, rhs.source);
 
-    // Compare the source and the path id.
-    KEY_COMPARE(rhs.GetSource(), GetSource());
+    // Path received from EBGP is better than the one received from IBGP,
+    // then lower bgp identifier.
+    KEY_COMPARE(peer, rhs.peer);
 
-    // Bail if both paths are local since all subsequent checks are
-    // based on IPeer properties.
-    if (peer_ == NULL && rhs.peer_ == NULL) {
-        KEY_COMPARE(path_id_, rhs.path_id_);
-        return 0;
-    }
-
-    // Prefer xmpp routes over bgp routes.
-    BOOL_COMPARE(peer_->IsXmppPeer(), rhs.peer_->IsXmppPeer());
+    return 0;
+}
 
-    KEY_COMPARE(path_id_, rhs.path_id_);
+int BgpPath::PathCompare(const BgpPath &rhs, bool allow_ecmp) const {
+    int result = key_.CompareTo(rhs.key_, allow_ecmp);
+    if (result || allow_ecmp)
+        return result;
 
-    // Path received from EBGP is better than the one received from IBGP
-    KEY_COMPARE(peer_->PeerType() == BgpProto::IBGP,
-                rhs.peer_->PeerType() == BgpProto::IBGP);
-    KEY_COMPARE(peer_->bgp_identifier(), rhs.peer_->bgp_identifier());
+    // Bail if either path is local since all subsequent checks are
+    // based on BgpPeer properties.
+    if (peer_ == NULL || rhs.peer_ == NULL)
+        return 0;
 
     const BgpPeer *lpeer = dynamic_cast<const BgpPeer *>(peer_);
     const BgpPeer *rpeer = dynamic_cast<const BgpPeer *>(rhs.peer_);
@@ -122,12 +122,42 @@ public:
     int PathCompare(const BgpPath &rhs, bool allow_ecmp) const;
 
 private:
+    //
+    // Path selection criteria packed into integers when the path is created,
+    // so that PathCompare doesn't need to look at the attributes or at the
+    // peer. Smaller is better for all fields.
+    //
+    struct PathKey {
+        PathKey()
+            : preference(0), sequence(0), as_path(0), neighbor_as(0), med(0),
+              source(0), peer(0) {
+        }
+        int CompareTo(const PathKey &rhs, bool allow_ecmp) const;
+
+        // Infeasible bit and complement of local preference.
+        uint64_t preference;
+        // Complement of sequence number.
+        uint32_t sequence;
+        // AS path count and origin.
+        uint32_t as_path;
+        // MED is only compared if the neighbor AS is the same.
+        uint32_t neighbor_as;
+        uint32_t med;
+        // Remote bit, complement of path source, non-xmpp bit and path id.
+        uint64_t source;
+        // IBGP bit and bgp identifier of the peer.
+        uint64_t peer;
+    };
+
+    void InitPathKey();
+
     const IPeer *peer_;
     const uint32_t path_id_;
     const PathSource source_;
     const BgpAttrPtr attr_;
     uint32_t flags_;
     uint32_t label_;
+    PathKey key_;
 };
 
 class BgpSecondaryPath : public BgpPath {
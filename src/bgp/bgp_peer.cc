@@ -1063,85 +1063,300 @@ bool BgpPeer::MpNlriAllowed(uint16_t afi, uint8_t safi) {
     return false;
 }
 
-void BgpPeer::ProcessUpdate(const BgpProto::Update *msg, size_t msgsize) {
-    BgpAttrPtr attr = server_->attr_db()->Locate(msg->path_attributes);
-    // Check as path loop and neighbor-as 
-    const BgpAttr *path_attr = attr.get(); 
-    uint32_t flags = 0;
+namespace {
 
-    if (path_attr->as_path() != NULL) {
-        // Check whether neighbor has appended its AS to the AS_PATH
-        if ((PeerType() == BgpProto::EBGP) && 
-            (!path_attr->as_path()->path().AsLeftMostMatch(peer_as()))) {
-            flags |= BgpPath::NoNeighborAs;
+//
+// Adapts the BgpProto::Update built by the generic decoder to the interface
+// of the BgpUpdateDecoder, so that both can go through ProcessUpdateInternal.
+//
+class ProtoUpdateView {
+public:
+    class PrefixReader {
+    public:
+        explicit PrefixReader(const vector<BgpProtoPrefix *> &prefixes)
+            : it_(prefixes.begin()), end_(prefixes.end()) {
         }
-
-        // Check for AS_PATH loop
-        if (path_attr->as_path()->path().AsPathLoop(local_as_)) {
-            flags |= BgpPath::AsPathLooped;
+        const BgpProtoPrefix *Next() {
+            return (it_ == end_) ? NULL : *it_++;
         }
+
+    private:
+        vector<BgpProtoPrefix *>::const_iterator it_;
+        vector<BgpProtoPrefix *>::const_iterator end_;
+    };
+
+    explicit ProtoUpdateView(const BgpProto::Update *msg) : msg_(msg) {
     }
 
-    // Check for OriginatorId loop in case we are an RR client.
-    if (peer_type_ == BgpProto::IBGP &&
-        path_attr->originator_id().to_ulong() == ntohl(local_bgp_id_)) {
-        flags |= BgpPath::OriginatorIdLooped;
+    const BgpAttrSpec &path_attributes() const {
+        return msg_->path_attributes;
+    }
+    size_t withdrawn_count() const { return msg_->withdrawn_routes.size(); }
+    PrefixReader withdrawn_routes() const {
+        return PrefixReader(msg_->withdrawn_routes);
+    }
+    size_t nlri_count() const { return msg_->nlri.size(); }
+    PrefixReader nlri() const { return PrefixReader(msg_->nlri); }
+    size_t mp_nlri_count(const BgpMpNlri *mp_nlri) const {
+        return mp_nlri->nlri.size();
+    }
+    PrefixReader mp_nlri(const BgpMpNlri *mp_nlri) const {
+        return PrefixReader(mp_nlri->nlri);
     }
 
-    uint32_t reach_count = 0, unreach_count = 0;
-    RoutingInstance *instance = GetRoutingInstance();
-    if (msg->nlri.size() || msg->withdrawn_routes.size()) {
+private:
+    const BgpProto::Update *msg_;
+};
+
+}  // namespace
+
+//
+// Enqueue a request to the table for the family for every prefix handed out
+// by the reader. The nlri_type names the source of the prefixes in parse
+// error logs, e.g. "Withdrawn route" or "MP NLRI".
+//
+template <typename PrefixReader>
+static void EnqueueNlri(BgpPeer *peer, Address::Family family,
+                        DBRequest::DBOperation oper, const BgpAttrPtr &attr,
+                        uint32_t flags, PrefixReader reader,
+                        const char *nlri_type) {
+    RoutingInstance *instance = peer->GetRoutingInstance();
+    const BgpProtoPrefix *proto;
+
+    switch (family) {
+    case Address::INET: {
         InetTable *table =
-            static_cast<InetTable *>(instance->GetTable(Address::INET));
-        if (!table) {
-            BGP_LOG_PEER(Message, this, SandeshLevel::SYS_CRIT, BGP_LOG_FLAG_ALL,
-                         BGP_PEER_DIR_IN, "Cannot find inet table");
-            return;
-        }
+            static_cast<InetTable *>(instance->GetTable(family));
+        assert(table);
 
-        unreach_count += msg->withdrawn_routes.size();
-        for (vector<BgpProtoPrefix *>::const_iterator it =
-             msg->withdrawn_routes.begin(); it != msg->withdrawn_routes.end();
-             ++it) {
+        while ((proto = reader.Next()) != NULL) {
             Ip4Prefix prefix;
-            int result = Ip4Prefix::FromProtoPrefix((**it), &prefix);
+            int result = Ip4Prefix::FromProtoPrefix(*proto, &prefix);
             if (result) {
-                BGP_LOG_PEER(Message, this, SandeshLevel::SYS_WARN,
+                BGP_LOG_PEER(Message, peer, SandeshLevel::SYS_WARN,
                     BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                    "Withdrawn route parse error for inet route");
+                    nlri_type << " parse error for inet route");
                 continue;
             }
 
             DBRequest req;
-            req.oper = DBRequest::DB_ENTRY_DELETE;
-            req.data.reset(NULL);
-            req.key.reset(new InetTable::RequestKey(prefix, this));
+            req.oper = oper;
+            if (oper == DBRequest::DB_ENTRY_ADD_CHANGE)
+                req.data.reset(new InetTable::RequestData(attr, flags, 0));
+            req.key.reset(new InetTable::RequestKey(prefix, peer));
             table->Enqueue(&req);
         }
+        break;
+    }
 
-        reach_count += msg->nlri.size();
-        for (vector<BgpProtoPrefix *>::const_iterator it = msg->nlri.begin();
-             it != msg->nlri.end(); ++it) {
-            Ip4Prefix prefix;
-            int result = Ip4Prefix::FromProtoPrefix((**it), &prefix);
+    case Address::INETVPN: {
+        InetVpnTable *table =
+            static_cast<InetVpnTable *>(instance->GetTable(family));
+        assert(table);
+
+        while ((proto = reader.Next()) != NULL) {
+            InetVpnPrefix prefix;
+            uint32_t label = 0;
+            int result =
+                InetVpnPrefix::FromProtoPrefix(*proto, &prefix, &label);
             if (result) {
-                BGP_LOG_PEER(Message, this, SandeshLevel::SYS_WARN,
+                BGP_LOG_PEER(Message, peer, SandeshLevel::SYS_WARN,
                     BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                    "NLRI parse error for inet route");
+                    nlri_type << " parse error for inet-vpn route");
                 continue;
             }
 
             DBRequest req;
-            req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
-            req.data.reset(new InetTable::RequestData(attr, flags, 0));
-            req.key.reset(new InetTable::RequestKey(prefix, this));
+            req.oper = oper;
+            if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
+                req.data.reset(
+                    new InetVpnTable::RequestData(attr, flags, label));
+            }
+            req.key.reset(new InetVpnTable::RequestKey(prefix, peer));
             table->Enqueue(&req);
         }
+        break;
     }
 
-    for (std::vector<BgpAttribute *>::const_iterator ait =
-            msg->path_attributes.begin();
-            ait != msg->path_attributes.end(); ++ait) {
+    case Address::INET6VPN: {
+        Inet6VpnTable *table =
+            static_cast<Inet6VpnTable *>(instance->GetTable(family));
+        assert(table);
+
+        while ((proto = reader.Next()) != NULL) {
+            Inet6VpnPrefix prefix;
+            uint32_t label = 0;
+            int result =
+                Inet6VpnPrefix::FromProtoPrefix(*proto, &prefix, &label);
+            if (result) {
+                BGP_LOG_PEER(Message, peer, SandeshLevel::SYS_WARN,
+                    BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
+                    nlri_type << " parse error for inet6-vpn route");
+                continue;
+            }
+
+            DBRequest req;
+            req.oper = oper;
+            if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
+                req.data.reset(
+                    new Inet6VpnTable::RequestData(attr, flags, label));
+            }
+            req.key.reset(new Inet6VpnTable::RequestKey(prefix, peer));
+            table->Enqueue(&req);
+        }
+        break;
+    }
+
+    case Address::EVPN: {
+        EvpnTable *table =
+            static_cast<EvpnTable *>(instance->GetTable(family));
+        assert(table);
+
+        while ((proto = reader.Next()) != NULL) {
+            EvpnPrefix prefix;
+            BgpAttrPtr new_attr;
+            uint32_t label = 0;
+            int result = EvpnPrefix::FromProtoPrefix(peer->server(), *proto,
+                (oper == DBRequest::DB_ENTRY_ADD_CHANGE) ? attr.get() : NULL,
+                &prefix, &new_attr, &label);
+            if (result) {
+                BGP_LOG_PEER(Message, peer, SandeshLevel::SYS_WARN,
+                    BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
+                    nlri_type << " parse error for e-vpn route type " <<
+                    proto->type);
+                continue;
+            }
+
+            DBRequest req;
+            req.oper = oper;
+            if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
+                req.data.reset(
+                    new EvpnTable::RequestData(new_attr, flags, label));
+            }
+            req.key.reset(new EvpnTable::RequestKey(prefix, peer));
+            table->Enqueue(&req);
+        }
+        break;
+    }
+
+    case Address::ERMVPN: {
+        ErmVpnTable *table;
+        table = static_cast<ErmVpnTable *>(instance->GetTable(family));
+        assert(table);
+
+        while ((proto = reader.Next()) != NULL) {
+            if (!ErmVpnPrefix::IsValidForBgp(proto->type)) {
+                BGP_LOG_PEER(Message, peer, SandeshLevel::SYS_WARN,
+                    BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
+                    "ERMVPN: Unsupported route type " << proto->type);
+                continue;
+            }
+
+            ErmVpnPrefix prefix;
+            int result = ErmVpnPrefix::FromProtoPrefix(*proto, &prefix);
+            if (result) {
+                BGP_LOG_PEER(Message, peer, SandeshLevel::SYS_WARN,
+                    BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
+                    nlri_type << " parse error for erm-vpn route type " <<
+                    proto->type);
+                continue;
+            }
+
+            DBRequest req;
+            req.oper = oper;
+            if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
+                req.data.reset(
+                    new ErmVpnTable::RequestData(attr, flags, 0));
+            }
+            req.key.reset(new ErmVpnTable::RequestKey(prefix, peer));
+            table->Enqueue(&req);
+        }
+        break;
+    }
+
+    case Address::RTARGET: {
+        RTargetTable *table =
+            static_cast<RTargetTable *>(instance->GetTable(family));
+        assert(table);
+
+        while ((proto = reader.Next()) != NULL) {
+            RTargetPrefix prefix;
+            int result = RTargetPrefix::FromProtoPrefix(*proto, &prefix);
+            if (result) {
+                BGP_LOG_PEER(Message, peer, SandeshLevel::SYS_WARN,
+                    BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
+                    nlri_type << " parse error for rtarget route");
+                continue;
+            }
+
+            DBRequest req;
+            req.oper = oper;
+            if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
+                req.data.reset(
+                    new RTargetTable::RequestData(attr, flags, 0));
+            }
+            req.key.reset(new RTargetTable::RequestKey(prefix, peer));
+            table->Enqueue(&req);
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+//
+// Common handling for UPDATEs from the generic decoder and the
+// BgpUpdateDecoder. The UpdateView provides the path attributes and
+// readers for the prefixes.
+//
+template <typename UpdateView>
+void BgpPeer::ProcessUpdateInternal(const UpdateView &update,
+                                    size_t msgsize) {
+    BgpAttrPtr attr = server_->attr_db()->Locate(update.path_attributes());
+    // Check as path loop and neighbor-as
+    const BgpAttr *path_attr = attr.get();
+    uint32_t flags = 0;
+
+    if (path_attr->as_path() != NULL) {
+        // Check whether neighbor has appended its AS to the AS_PATH
+        if ((PeerType() == BgpProto::EBGP) &&
+            (!path_attr->as_path()->path().AsLeftMostMatch(peer_as()))) {
+            flags |= BgpPath::NoNeighborAs;
+        }
+
+        // Check for AS_PATH loop
+        if (path_attr->as_path()->path().AsPathLoop(local_as_)) {
+            flags |= BgpPath::AsPathLooped;
+        }
+    }
+
+    // Check for OriginatorId loop in case we are an RR client.
+    if (peer_type_ == BgpProto::IBGP &&
+        path_attr->originator_id().to_ulong() == ntohl(local_bgp_id_)) {
+        flags |= BgpPath::OriginatorIdLooped;
+    }
+
+    uint32_t reach_count = 0, unreach_count = 0;
+    RoutingInstance *instance = GetRoutingInstance();
+    if (update.nlri_count() || update.withdrawn_count()) {
+        if (!instance->GetTable(Address::INET)) {
+            BGP_LOG_PEER(Message, this, SandeshLevel::SYS_CRIT, BGP_LOG_FLAG_ALL,
+                         BGP_PEER_DIR_IN, "Cannot find inet table");
+            return;
+        }
+
+        unreach_count += update.withdrawn_count();
+        EnqueueNlri(this, Address::INET, DBRequest::DB_ENTRY_DELETE, attr,
+                    flags, update.withdrawn_routes(), "Withdrawn route");
+        reach_count += update.nlri_count();
+        EnqueueNlri(this, Address::INET, DBRequest::DB_ENTRY_ADD_CHANGE, attr,
+                    flags, update.nlri(), "NLRI");
+    }
+
+    for (BgpAttrSpec::const_iterator ait = update.path_attributes().begin();
+         ait != update.path_attributes().end(); ++ait) {
         DBRequest::DBOperation oper;
         if ((*ait)->code == BgpAttribute::MPReachNlri) {
             oper = DBRequest::DB_ENTRY_ADD_CHANGE;
@@ -1153,10 +1368,11 @@ void BgpPeer::ProcessUpdate(const BgpProto::Update *msg, size_t msgsize) {
 
         BgpMpNlri *nlri = static_cast<BgpMpNlri *>(*ait);
         assert(nlri);
+        size_t nlri_count = update.mp_nlri_count(nlri);
         if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
-            reach_count += nlri->nlri.size();
+            reach_count += nlri_count;
         } else {
-            unreach_count += nlri->nlri.size();
+            unreach_count += nlri_count;
         }
 
         Address::Family family = BgpAf::AfiSafiToFamily(nlri->afi, nlri->safi);
@@ -1169,7 +1385,7 @@ void BgpPeer::ProcessUpdate(const BgpProto::Update *msg, size_t msgsize) {
         }
 
         // Handle EndOfRib marker.
-        if (oper == DBRequest::DB_ENTRY_DELETE && nlri->nlri.empty()) {
+        if (oper == DBRequest::DB_ENTRY_DELETE && nlri_count == 0) {
             ReceiveEndOfRIB(family, msgsize);
             return;
         }
@@ -1177,192 +1393,8 @@ void BgpPeer::ProcessUpdate(const BgpProto::Update *msg, size_t msgsize) {
         if ((*ait)->code == BgpAttribute::MPReachNlri)
             attr = GetMpNlriNexthop(nlri, attr);
 
-        switch (family) {
-        case Address::INET: {
-            InetTable *table =
-                static_cast<InetTable *>(instance->GetTable(family));
-            assert(table);
-
-            vector<BgpProtoPrefix *>::const_iterator it;
-            for (it = nlri->nlri.begin(); it < nlri->nlri.end(); ++it) {
-                Ip4Prefix prefix;
-                int result = Ip4Prefix::FromProtoPrefix((**it), &prefix);
-                if (result) {
-                    BGP_LOG_PEER(Message, this, SandeshLevel::SYS_WARN,
-                        BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                        "MP NLRI parse error for inet route");
-                    continue;
-                }
-
-                DBRequest req;
-                req.oper = oper;
-                if (oper == DBRequest::DB_ENTRY_ADD_CHANGE)
-                    req.data.reset(new InetTable::RequestData(attr, flags, 0));
-                req.key.reset(new InetTable::RequestKey(prefix, this));
-                table->Enqueue(&req);
-            }
-            break;
-        }
-
-        case Address::INETVPN: {
-            InetVpnTable *table = 
-              static_cast<InetVpnTable *>(instance->GetTable(family));
-            assert(table);
-
-            vector<BgpProtoPrefix *>::const_iterator it;
-            for (it = nlri->nlri.begin(); it < nlri->nlri.end(); ++it) {
-                InetVpnPrefix prefix;
-                uint32_t label = 0;
-                int result =
-                    InetVpnPrefix::FromProtoPrefix((**it), &prefix, &label);
-                if (result) {
-                    BGP_LOG_PEER(Message, this, SandeshLevel::SYS_WARN,
-                        BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                        "MP NLRI parse error for inet-vpn route");
-                    continue;
-                }
-
-                DBRequest req;
-                req.oper = oper;
-                if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
-                    req.data.reset(
-                        new InetVpnTable::RequestData(attr, flags, label));
-                }
-                req.key.reset(new InetVpnTable::RequestKey(prefix, this));
-                table->Enqueue(&req);
-            }
-            break;
-        }
-
-        case Address::INET6VPN: {
-            Inet6VpnTable *table = 
-                static_cast<Inet6VpnTable *>(instance->GetTable(family));
-            assert(table);
-
-            vector<BgpProtoPrefix *>::const_iterator it;
-            for (it = nlri->nlri.begin(); it < nlri->nlri.end(); ++it) {
-                Inet6VpnPrefix prefix;
-                uint32_t label = 0;
-                int result =
-                    Inet6VpnPrefix::FromProtoPrefix((**it), &prefix, &label);
-                if (result) {
-                    BGP_LOG_PEER(Message, this, SandeshLevel::SYS_WARN,
-                        BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                        "MP NLRI parse error for inet6-vpn route");
-                    continue;
-                }
-
-                DBRequest req;
-                req.oper = oper;
-                if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
-                    req.data.reset(
-                        new Inet6VpnTable::RequestData(attr, flags, label));
-                }
-                req.key.reset(new Inet6VpnTable::RequestKey(prefix, this));
-                table->Enqueue(&req);
-            }
-            break;
-        }
-
-
-        case Address::EVPN: {
-            EvpnTable *table =
-                static_cast<EvpnTable *>(instance->GetTable(family));
-            assert(table);
-
-            vector<BgpProtoPrefix *>::const_iterator it;
-            for (it = nlri->nlri.begin(); it < nlri->nlri.end(); ++it) {
-                EvpnPrefix prefix;
-                BgpAttrPtr new_attr;
-                uint32_t label = 0;
-                int result = EvpnPrefix::FromProtoPrefix(server_, (**it),
-                    (oper == DBRequest::DB_ENTRY_ADD_CHANGE) ? attr.get() : NULL,
-                    &prefix, &new_attr, &label);
-                if (result) {
-                    BGP_LOG_PEER(Message, this, SandeshLevel::SYS_WARN,
-                        BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                        "MP NLRI parse error for e-vpn route type " << (*it)->type);
-                    continue;
-                }
-
-                DBRequest req;
-                req.oper = oper;
-                if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
-                    req.data.reset(
-                        new EvpnTable::RequestData(new_attr, flags, label));
-                }
-                req.key.reset(new EvpnTable::RequestKey(prefix, this));
-                table->Enqueue(&req);
-            }
-            break;
-        }
-
-        case Address::ERMVPN: {
-            ErmVpnTable *table;
-            table = static_cast<ErmVpnTable *>(instance->GetTable(family));
-            assert(table);
-
-            vector<BgpProtoPrefix *>::const_iterator it;
-            for (it = nlri->nlri.begin(); it < nlri->nlri.end(); ++it) {
-                if (!ErmVpnPrefix::IsValidForBgp((*it)->type)) {
-                    BGP_LOG_PEER(Message, this, SandeshLevel::SYS_WARN,
-                        BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                        "ERMVPN: Unsupported route type " << (*it)->type);
-                    continue;
-                }
-
-                ErmVpnPrefix prefix;
-                int result = ErmVpnPrefix::FromProtoPrefix((**it), &prefix);
-                if (result) {
-                    BGP_LOG_PEER(Message, this, SandeshLevel::SYS_WARN,
-                        BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                        "MP NLRI parse error for erm-vpn route type " << (*it)->type);
-                    continue;
-                }
-
-                DBRequest req;
-                req.oper = oper;
-                if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
-                    req.data.reset(
-                        new ErmVpnTable::RequestData(attr, flags, 0));
-                }
-                req.key.reset(new ErmVpnTable::RequestKey(prefix, this));
-                table->Enqueue(&req);
-            }
-            break;
-        }
-
-        case Address::RTARGET: {
-            RTargetTable *table =
-                static_cast<RTargetTable *>(instance->GetTable(family));
-            assert(table);
-
-            vector<BgpProtoPrefix *>::const_iterator it;
-            for (it = nlri->nlri.begin(); it < nlri->nlri.end(); ++it) {
-                RTargetPrefix prefix;
-                int result = RTargetPrefix::FromProtoPrefix((**it), &prefix);
-                if (result) {
-                    BGP_LOG_PEER(Message, this, SandeshLevel::SYS_WARN,
-                        BGP_LOG_FLAG_ALL, BGP_PEER_DIR_IN,
-                        "MP NLRI parse error for rtarget route");
-                    continue;
-                }
-
-                DBRequest req;
-                req.oper = oper;
-                if (oper == DBRequest::DB_ENTRY_ADD_CHANGE) {
-                    req.data.reset(
-                        new RTargetTable::RequestData(attr, flags, 0));
-                }
-                req.key.reset(new RTargetTable::RequestKey(prefix, this));
-                table->Enqueue(&req);
-            }
-            break;
-        }
-
-        default:
-            continue;
-        }
+        EnqueueNlri(this, family, oper, attr, flags, update.mp_nlri(nlri),
+                    "MP NLRI");
     }
 
     inc_rx_route_reach(reach_count);
@@ -1375,6 +1407,14 @@ void BgpPeer::ProcessUpdate(const BgpProto::Update *msg, size_t msgsize) {
     }
 }
 
+void BgpPeer::ProcessUpdate(const BgpProto::Update *msg, size_t msgsize) {
+    ProcessUpdateInternal(ProtoUpdateView(msg), msgsize);
+}
+
+void BgpPeer::ProcessUpdate(const BgpUpdateDecoder *update) {
+    ProcessUpdateInternal(*update, update->size());
+}
+
 void BgpPeer::EndOfRibTimerErrorHandler(string error_name,
                                         string error_message) {
     BGP_LOG_PEER(Timer, this, SandeshLevel::SYS_CRIT, BGP_LOG_FLAG_ALL,
@@ -1518,6 +1558,17 @@ string BgpPeer::BytesToHexString(const u_int8_t *msg, size_t size) {
 
 bool BgpPeer::ReceiveMsg(BgpSession *session, const u_int8_t *msg,
                          size_t size) {
+    // Most messages are UPDATEs that the BgpUpdateDecoder can handle. Any
+    // other messages, and UPDATEs that it can't, go to the generic decoder.
+    if (BgpUpdateDecoder::IsUpdate(msg, size)) {
+        BgpUpdateDecoderPtr update = update_decoder_pool_.Allocate();
+        if (update->Decode(msg, size)) {
+            BGP_TRACE_PEER_PACKET(this, msg, size, Sandesh::LoggingUtLevel());
+            state_machine_->OnMessage(session, update);
+            return true;
+        }
+    }
+
     ParseErrorContext ec;
     BgpProto::BgpMessage *minfo = BgpProto::Decode(msg, size, &ec);
 
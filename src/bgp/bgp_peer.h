@@ -20,6 +20,7 @@
 #include "bgp/bgp_peer_key.h"
 #include "bgp/bgp_proto.h"
 #include "bgp/bgp_ribout.h"
+#include "bgp/bgp_update_decoder.h"
 #include "bgp/ipeer.h"
 #include "bgp/bgp_peer_close.h"
 #include "bgp/state_machine.h"
@@ -82,6 +83,7 @@ public:
 
     // thread: io::ReaderTask
     void ProcessUpdate(const BgpProto::Update *msg, size_t msgsize = 0);
+    void ProcessUpdate(const BgpUpdateDecoder *update);
 
     // thread: io::ReaderTask
     virtual bool ReceiveMsg(BgpSession *session, const u_int8_t *msg,
@@ -273,6 +275,8 @@ private:
 
     virtual bool MpNlriAllowed(uint16_t afi, uint8_t safi);
     BgpAttrPtr GetMpNlriNexthop(BgpMpNlri *nlri, BgpAttrPtr attr);
+    template <typename UpdateView>
+    void ProcessUpdateInternal(const UpdateView &update, size_t msgsize);
 
     bool GetBestAuthKey(AuthenticationKey *auth_key, KeyType *key_type) const;
     void ProcessAuthKeyChainConfig(const BgpNeighborConfig *config);
@@ -323,6 +327,9 @@ private:
     bool send_ready_;
     bool admin_down_;
 
+    // Must outlive the state machine since queued UPDATE events hold on to
+    // decoders from the pool.
+    BgpUpdateDecoderPool update_decoder_pool_;
     boost::scoped_ptr<StateMachine> state_machine_;
     uint64_t membership_req_pending_;
     bool defer_close_;
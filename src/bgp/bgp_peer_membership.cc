@@ -11,6 +11,7 @@
 #include <boost/bind.hpp>
 #include <tbb/mutex.h>
 
+#include "base/task.h"
 #include "base/task_annotations.h"
 #include "bgp/bgp_export.h"
 #include "bgp/bgp_log.h"
@@ -468,7 +469,8 @@ void PeerRibMembershipManager::JoinDone(DBTableBase *db,
 //
 // Kick off the process to unregister the IPeer from the BgpTable. We first
 // need to do a table walk and clean up state for all routes from the IPeer.
-// We can actually unregister only after the state has been cleaned up.
+// We can actually unregister only after the state has been cleaned up. The
+// walk is skipped if none of the requests delete the RibOut, see RibInLeave.
 //
 // In the meantime, we deactivate the IPeer in the RibOut to ensure that it
 // does not export any more routes.
@@ -476,6 +478,7 @@ void PeerRibMembershipManager::JoinDone(DBTableBase *db,
 void PeerRibMembershipManager::Leave(BgpTable *table,
                               MembershipRequestList *request_list) {
     DB *db = table->database();
+    bool ribout_delete = false;
 
     for (MembershipRequestList::iterator iter = request_list->begin();
              iter != request_list->end(); iter++) {
@@ -484,6 +487,7 @@ void PeerRibMembershipManager::Leave(BgpTable *table,
         if (!(request->action_mask & MembershipRequest::RIBOUT_DELETE)) {
             continue;
         }
+        ribout_delete = true;
 
         IPeerRib *peer_rib = IPeerRibFind(request->ipeer, table);
 
@@ -493,6 +497,14 @@ void PeerRibMembershipManager::Leave(BgpTable *table,
         }
     }
 
+    // Every route in the table needs to be visited to take the peers out
+    // of the RibOuts. Staling, sweeping or deleting the RibIn only needs to
+    // visit the routes that have paths from the peers.
+    if (!ribout_delete) {
+        RibInLeave(table, request_list);
+        return;
+    }
+
     DBTableWalker *walker = db->GetWalker();
     walker->WalkTable(table, NULL,
         // _1: DBTablePartBase, _2: DBEntry
@@ -527,6 +539,134 @@ bool PeerRibMembershipManager::RouteLeave(DBTablePartBase *root,
     return true;
 }
 
+//
+// Leave the RibIn of a table for a set of peers without walking the table.
+//
+// There's a RibInWorker for each partition of the table that goes over the
+// routes with paths from each of the peers using the route index that's kept
+// by the BgpTable. The request list is handed to LeaveDone once the last of
+// the workers is done, same as when the table walk for Leave is complete.
+//
+// The walker count of the table is held until then so that the table does
+// not get deleted underneath the workers.
+//
+class PeerRibMembershipManager::RibInWalker {
+public:
+    RibInWalker(PeerRibMembershipManager *manager, BgpTable *table,
+                MembershipRequestList *request_list)
+        : manager_(manager), table_(table), request_list_(request_list) {
+        pending_ = 0;
+    }
+
+    void Start();
+
+    //
+    // Concurrency: Runs in the context of the DB partition task.
+    //
+    void WorkerDone() {
+        if (--pending_ != 0)
+            return;
+
+        manager_->LeaveDone(table_, request_list_);
+        if (table_->decr_walker_count() == 0)
+            table_->RetryDelete();
+        delete this;
+    }
+
+    PeerRibMembershipManager *manager() { return manager_; }
+    BgpTable *table() { return table_; }
+    MembershipRequestList *request_list() { return request_list_; }
+
+private:
+    PeerRibMembershipManager *manager_;
+    BgpTable *table_;
+    MembershipRequestList *request_list_;
+    tbb::atomic<int> pending_;
+
+    DISALLOW_COPY_AND_ASSIGN(RibInWalker);
+};
+
+//
+// Concurrency: Runs in the context of the DB partition task.
+//
+// Process the RibIn of each peer in the request list for the routes in the
+// partition, kRibInWorkerBatchSize routes at a time. The worker yields after
+// each batch and resumes after the key of the last route that it processed.
+// The key is kept in a route allocated from the table, since the last route
+// may be deleted before the worker runs again.
+//
+class PeerRibMembershipManager::RibInWorker : public Task {
+public:
+    RibInWorker(RibInWalker *walker, int task_id, int part_id)
+        : Task(task_id, part_id), walker_(walker), part_id_(part_id),
+          request_idx_(0) {
+    }
+
+    virtual bool Run() {
+        BgpTable *table = walker_->table();
+        DBTablePartBase *root = table->GetTablePartition(part_id_);
+        MembershipRequestList *request_list = walker_->request_list();
+
+        while (request_idx_ < request_list->size()) {
+            MembershipRequest *request = &request_list->at(request_idx_);
+            IPeerRib *peer_rib =
+                walker_->manager()->IPeerRibFind(request->ipeer, table);
+
+            routes_.clear();
+            if (peer_rib) {
+                table->GetPeerRoutes(part_id_, request->ipeer,
+                                     static_cast<BgpRoute *>(last_.get()),
+                                     kRibInWorkerBatchSize, &routes_);
+            }
+            for (std::vector<BgpRoute *>::iterator it = routes_.begin();
+                 it != routes_.end(); ++it) {
+                peer_rib->RibInLeave(root, *it, table, request->action_mask);
+            }
+
+            if (routes_.size() == kRibInWorkerBatchSize) {
+                last_ = table->AllocEntry(
+                    routes_.back()->GetDBRequestKey().get());
+                return false;
+            }
+            request_idx_++;
+            last_.reset();
+        }
+
+        walker_->WorkerDone();
+        return true;
+    }
+
+private:
+    RibInWalker *walker_;
+    int part_id_;
+    size_t request_idx_;
+    std::auto_ptr<DBEntry> last_;
+    std::vector<BgpRoute *> routes_;
+
+    DISALLOW_COPY_AND_ASSIGN(RibInWorker);
+};
+
+void PeerRibMembershipManager::RibInWalker::Start() {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    int task_id = scheduler->GetTaskId("db::DBTable");
+    int count = table_->PartitionCount();
+
+    table_->incr_walker_count();
+    pending_ = count;
+    for (int part_id = 0; part_id < count; ++part_id) {
+        scheduler->Enqueue(new RibInWorker(this, task_id, part_id));
+    }
+}
+
+//
+// Concurrency: Runs in the context of the BGP peer membership task.
+//
+void PeerRibMembershipManager::RibInLeave(BgpTable *table,
+                                          MembershipRequestList *request_list) {
+    RibInWalker *walker = new RibInWalker(this, table, request_list);
+    walker->Start();
+}
+
 void PeerRibMembershipManager::MembershipRequestListDebug(
     const char *function, int line, BgpTable *table,
     MembershipRequestList *request_list) {
@@ -249,6 +249,12 @@ private:
     typedef std::multimap<const BgpTable *, IPeer *> RibPeerMap;
     typedef std::multimap<const IPeer *, IPeerRib *> PeerRibMap;
 
+    class RibInWalker;
+    class RibInWorker;
+
+    // Number of routes a RibInWorker processes before it yields.
+    static const size_t kRibInWorkerBatchSize = 1024;
+
     void NotifyPeerRegistration(IPeer *ipeer, BgpTable *table, bool unregister);
 
     void Join(BgpTable *table, MembershipRequestList *request_list);
@@ -260,6 +266,7 @@ private:
     bool RouteLeave(DBTablePartBase *root, DBEntryBase *db_entry,
                     BgpTable *table, MembershipRequestList *request_list);
     void LeaveDone(DBTableBase *db, MembershipRequestList *request_list);
+    void RibInLeave(BgpTable *table, MembershipRequestList *request_list);
 
     IPeerRibEvent *ProcessRequest(IPeerRibEvent::EventType event_type,
                                   BgpTable *table,
@@ -4,6 +4,8 @@
 
 #include "bgp/bgp_ribout_updates.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/task_annotations.h"
 #include "bgp/bgp_log.h"
@@ -16,6 +18,8 @@
 
 using std::auto_ptr;
 
+int64_t RibOutUpdates::queue_bytes_threshold_ = -1;
+
 //
 // Create a new RibOutUpdates.  Also create the necessary UpdateQueue and
 // add them to the vector.
@@ -27,6 +31,8 @@ RibOutUpdates::RibOutUpdates(RibOut *ribout) : ribout_(ribout) {
     }
     monitor_.reset(new RibUpdateMonitor(ribout, &queue_vec_));
     builder_ = MessageBuilder::GetInstance(ribout->ExportPolicy().encoding);
+    over_threshold_ = false;
+    over_threshold_count_ = 0;
 }
 
 //
@@ -56,6 +62,36 @@ void RibOutUpdates::Enqueue(DBEntryBase *db_entry, RouteUpdate *rt_update) {
         assert(group != NULL);
         group->RibOutActive(ribout_, rt_update->queue_id());
     }
+    CheckQueueBytesThreshold();
+}
+
+//
+// Concurrency: Called in the context of the routing table partition task.
+//
+// Check the memory used by the UpdateQueues against the monitoring threshold.
+// The over threshold count is bumped and a message is logged only when the
+// threshold is first exceeded, not for every subsequent enqueue.  Since the
+// check is made from multiple partitions, use compare and swap on the flag.
+//
+void RibOutUpdates::CheckQueueBytesThreshold() {
+    size_t threshold = queue_bytes_threshold();
+    if (threshold == 0)
+        return;
+
+    size_t bytes = queue_bytes();
+    if (bytes <= threshold) {
+        if (over_threshold_)
+            over_threshold_ = false;
+        return;
+    }
+    if (over_threshold_.compare_and_swap(true, false))
+        return;
+
+    over_threshold_count_++;
+    BGP_LOG_STR(BgpMessage, SandeshLevel::SYS_WARN, BGP_LOG_FLAG_ALL,
+        "RibOut " << ribout_->ToString() << " update queues use " << bytes <<
+        " bytes, exceeding the monitoring threshold of " << threshold <<
+        " bytes");
 }
 
 //
@@ -565,6 +601,51 @@ bool RibOutUpdates::Empty() const {
     return true;
 }
 
+//
+// Return the memory used by all the UpdateQueues.
+//
+size_t RibOutUpdates::queue_bytes() const {
+    size_t bytes = 0;
+    for (int i = 0; i < RibOutUpdates::QCOUNT; ++i) {
+        bytes += queue_vec_[i]->bytes();
+    }
+    return bytes;
+}
+
+//
+// Return the sum of the peak memory used by each of the UpdateQueues.
+//
+size_t RibOutUpdates::peak_queue_bytes() const {
+    size_t bytes = 0;
+    for (int i = 0; i < RibOutUpdates::QCOUNT; ++i) {
+        bytes += queue_vec_[i]->peak_bytes();
+    }
+    return bytes;
+}
+
+//
+// Monitoring threshold for the memory used by the UpdateQueues of each
+// RibOut. Defaults to 0, which means that there's no threshold, and can be
+// overridden with the BGP_RIBOUT_QUEUE_BYTES_THRESHOLD environment variable.
+//
+size_t RibOutUpdates::queue_bytes_threshold() {
+    if (queue_bytes_threshold_ == -1) {
+        int64_t threshold = 0;
+        char *str = getenv("BGP_RIBOUT_QUEUE_BYTES_THRESHOLD");
+        if (str)
+            threshold = strtoll(str, NULL, 0);
+        queue_bytes_threshold_ = std::max(threshold, static_cast<int64_t>(0));
+    }
+    return queue_bytes_threshold_;
+}
+
+//
+// For unit testing.
+//
+void RibOutUpdates::set_queue_bytes_threshold(size_t threshold) {
+    queue_bytes_threshold_ = threshold;
+}
+
 bool RibOutUpdates::QueueJoin(int queue_id, int bit) {
     UpdateQueue *queue = queue_vec_[queue_id];
     return queue->Join(bit);
@@ -5,6 +5,8 @@
 #ifndef SRC_BGP_BGP_RIBOUT_UPDATES_H_
 #define SRC_BGP_BGP_RIBOUT_UPDATES_H_
 
+#include <tbb/atomic.h>
+
 #include <vector>
 
 #include "bgp/bgp_ribout.h"
@@ -32,6 +34,13 @@ struct UpdateMarker;
 // all the concurrency constraints.  There's an exception for UpdateMarker
 // which are accessed directly through the UpdateQueue.
 //
+// A RibOutUpdates also checks the memory used by its UpdateQueues against
+// a monitoring threshold, which is shared by all RibOuts, whenever a
+// RouteUpdate is enqueued.  Going over the threshold doesn't change how
+// updates are queued.  The number of times that the threshold has been
+// exceeded is kept track of so that RibOuts with slow peers can be spotted
+// easily.
+//
 class RibOutUpdates {
 public:
     typedef std::vector<UpdateQueue *> QueueVec;
@@ -58,6 +67,14 @@ public:
 
     bool Empty() const;
 
+    size_t queue_bytes() const;
+    size_t peak_queue_bytes() const;
+    bool over_threshold() const { return over_threshold_; }
+    uint64_t over_threshold_count() const { return over_threshold_count_; }
+
+    static size_t queue_bytes_threshold();
+    static void set_queue_bytes_threshold(size_t threshold);
+
     RibUpdateMonitor *monitor() { return monitor_.get(); }
 
     UpdateQueue *queue(int queue_id) {
@@ -96,10 +113,16 @@ private:
     bool UpdateMarkersOnBlocked(UpdateMarker *marker, RouteUpdate *rt_update,
                                 const RibPeerSet *blocked);
 
+    void CheckQueueBytesThreshold();
+
+    static int64_t queue_bytes_threshold_;
+
     RibOut *ribout_;
     MessageBuilder *builder_;
     QueueVec queue_vec_;
     boost::scoped_ptr<RibUpdateMonitor> monitor_;
+    tbb::atomic<bool> over_threshold_;
+    tbb::atomic<uint64_t> over_threshold_count_;
     DISALLOW_COPY_AND_ASSIGN(RibOutUpdates);
 };
 
@@ -44,32 +44,52 @@ const BgpPath *BgpRoute::BestPath() const {
 //
 // Insert given path and redo path selection.
 //
+// The path list is kept sorted, so the new path goes in front of the first
+// path that it's better than. Paths that compare equal stay in the order in
+// which they were inserted.
+//
 void BgpRoute::InsertPath(BgpPath *path) {
     assert(!IsDeleted());
-    const Path *prev_front = front();
-
-    insert(path);
+    const BgpPath *prev_best = BestPath();
 
-    Sort(&BgpTable::PathSelection, prev_front);
+    const Path *next = NULL;
+    for (Route::PathList::const_iterator it = GetPathList().begin();
+         it != GetPathList().end(); ++it) {
+        const BgpPath *current = static_cast<const BgpPath *>(it.operator->());
+        if (path->PathCompare(*current, false) < 0) {
+            next = current;
+            break;
+        }
+    }
+    insert(path, next);
+    if (prev_best != BestPath())
+        set_last_change_at_to_now();
 
     // Update counters.
     BgpTable *table = static_cast<BgpTable *>(get_table());
-    if (table) table->UpdatePathCount(path, +1);
+    if (table) {
+        table->UpdatePathCount(path, +1);
+        table->UpdatePeerRouteIndex(this, path, +1);
+    }
     path->UpdatePeerRefCount(+1);
 }
 
 //
 // Delete given path and redo path selection.
 //
+// Removing a path leaves the rest of the path list sorted.
+//
 void BgpRoute::DeletePath(BgpPath *path) {
-    const Path *prev_front = front();
-
+    if (path == BestPath())
+        set_last_change_at_to_now();
     remove(path);
-    Sort(&BgpTable::PathSelection, prev_front);
 
     // Update counters.
     BgpTable *table = static_cast<BgpTable *>(get_table());
-    if (table) table->UpdatePathCount(path, -1);
+    if (table) {
+        table->UpdatePathCount(path, -1);
+        table->UpdatePeerRouteIndex(this, path, -1);
+    }
     path->UpdatePeerRefCount(-1);
 
     delete path;
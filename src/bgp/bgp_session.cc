@@ -47,6 +47,8 @@ BgpSession::BgpSession(BgpSessionManager *session_mgr, Socket *socket)
       index_(-1),
       reader_(new BgpMessageReader(this,
               boost::bind(&BgpSession::ReceiveMsg, this, _1, _2))) {
+    // Let reads grow for peers that send large bursts of updates.
+    SetAdaptiveBufferSize(kDefaultBufferSize, kMaxBufferSize);
 }
 
 BgpSession::~BgpSession() {
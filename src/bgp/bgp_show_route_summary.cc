@@ -3,6 +3,7 @@
  */
 
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 #include <sandesh/sandesh.h>
 #include <sandesh/request_pipeline.h>
 
@@ -96,8 +97,19 @@ void ShowRouteSummaryHandler::FillRouteTableSummaryInfo(
     size_t markers = 0;
     srts->set_pending_updates(table->GetPendingRiboutsCount(&markers));
     srts->set_markers(markers);
+    vector<ShowRibOutStatistics> ribouts;
+    table->FillRibOutStatistics(&ribouts);
+    size_t queue_bytes = 0;
+    BOOST_FOREACH(const ShowRibOutStatistics &sros, ribouts) {
+        queue_bytes += sros.get_queue_bytes();
+    }
+    srts->set_queue_bytes(queue_bytes);
+    srts->set_ribouts(ribouts);
     srts->set_listeners(table->GetListenerCount());
     srts->set_walkers(table->walker_count());
+    vector<ShowTablePartition> partitions;
+    table->FillPartitions(&partitions);
+    srts->set_partitions(partitions);
 }
 
 //
@@ -101,6 +101,7 @@ void ShowRoutingInstanceCommonHandler<
     size_t markers = 0;
     srit->set_pending_updates(table->GetPendingRiboutsCount(&markers));
     srit->set_markers(markers);
+    srit->set_queue_bytes(table->GetRiboutsQueueBytes());
     srit->set_listeners(table->GetListenerCount());
     srit->set_walkers(table->walker_count());
     srit->prefixes = table->Size();
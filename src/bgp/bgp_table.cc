@@ -9,8 +9,10 @@
 #include <sandesh/sandesh.h>
 
 #include "base/task_annotations.h"
+#include "db/db.h"
 #include "db/db_table_partition.h"
 #include "bgp/bgp_log.h"
+#include "bgp/bgp_message_builder.h"
 #include "bgp/bgp_path.h"
 #include "bgp/bgp_peer_types.h"
 #include "bgp/bgp_peer_membership.h"
@@ -28,6 +30,7 @@ using std::map;
 using std::make_pair;
 using std::ostringstream;
 using std::string;
+using std::vector;
 
 class BgpTable::DeleteActor : public LifetimeActor {
   public:
@@ -59,7 +62,9 @@ class BgpTable::DeleteActor : public LifetimeActor {
 BgpTable::BgpTable(DB *db, const string &name)
         : RouteTable(db, name),
           rtinstance_(NULL),
-          instance_delete_ref_(this, NULL) {
+          message_attr_cache_(new BgpMessageAttrCache),
+          instance_delete_ref_(this, NULL),
+          peer_route_index_(PartitionCount()) {
     primary_path_count_ = 0;
     secondary_path_count_ = 0;
     infeasible_path_count_ = 0;
@@ -122,6 +127,11 @@ void BgpTable::RibOutDelete(const RibExportPolicy &policy) {
     assert(loc != ribout_map_.end());
     delete loc->second;
     ribout_map_.erase(loc);
+
+    // Release the references to attributes held by the cache once the last
+    // RibOut is gone.
+    if (ribout_map_.empty())
+        message_attr_cache_->Clear();
 }
 
 UpdateInfo *BgpTable::GetUpdateInfo(RibOut *ribout, BgpRoute *route,
@@ -241,18 +251,6 @@ UpdateInfo *BgpTable::GetUpdateInfo(RibOut *ribout, BgpRoute *route,
     return uinfo;
 }
 
-// Bgp Path selection..
-// Based Attribute weight
-bool BgpTable::PathSelection(const Path &path1, const Path &path2) {
-    const BgpPath &l_path = dynamic_cast<const BgpPath &> (path1);
-    const BgpPath &r_path = dynamic_cast<const BgpPath &> (path2);
-
-    // Check the weight of Path
-    bool res = l_path.PathCompare(r_path, false) < 0;
-
-    return res;
-}
-
 void BgpTable::InputCommon(DBTablePartBase *root, BgpRoute *rt, BgpPath *path,
                            const IPeer *peer, DBRequest *req,
                            DBRequest::DBOperation oper, BgpAttrPtr attrs,
@@ -480,6 +478,48 @@ size_t BgpTable::GetPendingRiboutsCount(size_t *markers) const {
     return count;
 }
 
+size_t BgpTable::GetRiboutsQueueBytes() const {
+    CHECK_CONCURRENCY("bgp::ShowCommand", "bgp::Config");
+    size_t bytes = 0;
+
+    BOOST_FOREACH(const RibOutMap::value_type &i, ribout_map_) {
+        const RibOut *ribout = i.second;
+        if (ribout->updates())
+            bytes += ribout->updates()->queue_bytes();
+    }
+
+    return bytes;
+}
+
+void BgpTable::FillRibOutStatistics(
+    vector<ShowRibOutStatistics> *sros_list) const {
+    CHECK_CONCURRENCY("bgp::ShowCommand", "bgp::Config");
+
+    BOOST_FOREACH(const RibOutMap::value_type &i, ribout_map_) {
+        const RibOut *ribout = i.second;
+        const RibOutUpdates *updates = ribout->updates();
+        if (!updates)
+            continue;
+
+        ShowRibOutStatistics sros;
+        sros.set_name(ribout->ToString());
+        sros.set_encoding(ribout->IsEncodingXmpp() ? "XMPP" : "BGP");
+        sros.set_peers(ribout->PeerSet().count());
+        size_t pending_updates = 0;
+        size_t markers = 0;
+        BOOST_FOREACH(const UpdateQueue *queue, updates->queue_vec()) {
+            pending_updates += queue->size();
+            markers += queue->marker_count();
+        }
+        sros.set_pending_updates(pending_updates);
+        sros.set_markers(markers);
+        sros.set_queue_bytes(updates->queue_bytes());
+        sros.set_peak_queue_bytes(updates->peak_queue_bytes());
+        sros.set_over_threshold_count(updates->over_threshold_count());
+        sros_list->push_back(sros);
+    }
+}
+
 LifetimeActor *BgpTable::deleter() {
     return deleter_.get();
 }
@@ -499,3 +539,85 @@ void BgpTable::UpdatePathCount(const BgpPath *path, int count) {
         infeasible_path_count_ += count;
     }
 }
+
+bool BgpTable::PeerRouteCompare::operator()(const BgpRoute *lhs,
+                                            const BgpRoute *rhs) const {
+    return lhs->IsLess(*rhs);
+}
+
+//
+// Concurrency: called from the task of the route's partition.
+//
+// Account for a primary path from a peer being added to or removed from
+// the route. The route is removed from the index when the last path from
+// the peer goes away.
+//
+void BgpTable::UpdatePeerRouteIndex(BgpRoute *route, const BgpPath *path,
+                                    int count) {
+    const IPeer *peer = path->GetPeer();
+    if (!peer || path->IsReplicated())
+        return;
+
+    DBTablePartBase *tpart = route->get_table_partition();
+    assert(tpart);
+    PeerRouteIndex &index = peer_route_index_[tpart->index()];
+    if (count > 0) {
+        index[peer][route] += count;
+        return;
+    }
+
+    PeerRouteIndex::iterator peer_it = index.find(peer);
+    assert(peer_it != index.end());
+    PeerRouteMap::iterator route_it = peer_it->second.find(route);
+    assert(route_it != peer_it->second.end());
+    assert(route_it->second >= static_cast<uint32_t>(-count));
+    route_it->second += count;
+    if (route_it->second == 0) {
+        peer_it->second.erase(route_it);
+        if (peer_it->second.empty())
+            index.erase(peer_it);
+    }
+}
+
+//
+// Concurrency: called from the task of the given partition.
+//
+// Get up to max_count routes in the partition that have primary paths from
+// the peer, starting after the given route or from the beginning if it's
+// NULL. The routes are ordered by key, so a caller that yields between
+// batches can resume from a copy of the key of the last route it processed
+// even if that route has since been deleted. The start route is only used
+// as a key and need not be in the table.
+//
+void BgpTable::GetPeerRoutes(int part_id, const IPeer *peer,
+                             const BgpRoute *start,
+                             size_t max_count,
+                             std::vector<BgpRoute *> *routes) const {
+    const PeerRouteIndex &index = peer_route_index_[part_id];
+    PeerRouteIndex::const_iterator peer_it = index.find(peer);
+    if (peer_it == index.end())
+        return;
+    const PeerRouteMap &route_map = peer_it->second;
+    PeerRouteMap::const_iterator it = start ?
+        route_map.upper_bound(const_cast<BgpRoute *>(start)) :
+        route_map.begin();
+    for (; it != route_map.end() && routes->size() < max_count; ++it) {
+        routes->push_back(it->first);
+    }
+}
+
+//
+// Number of routes with primary paths from the peer across all partitions.
+// Only meant for tests and introspect since the partitions may be updated
+// concurrently.
+//
+size_t BgpTable::GetPeerRouteCount(const IPeer *peer) const {
+    size_t count = 0;
+    for (std::vector<PeerRouteIndex>::const_iterator it =
+         peer_route_index_.begin(); it != peer_route_index_.end(); ++it) {
+        PeerRouteIndex::const_iterator peer_it = it->find(peer);
+        if (peer_it != it->end())
+            count += peer_it->second.size();
+    }
+    return count;
+}
@@ -18,6 +18,7 @@
 #include "db/db_table_walker.h"
 #include "route/table.h"
 
+class BgpMessageAttrCache;
 class BgpServer;
 class BgpRoute;
 class BgpPath;
@@ -25,6 +26,7 @@ class Path;
 class Route;
 class RoutingInstance;
 class SchedulingGroupManager;
+class ShowRibOutStatistics;
 struct UpdateInfo;
 
 class BgpTable : public RouteTable {
@@ -76,6 +78,9 @@ public:
     RibOut *RibOutLocate(SchedulingGroupManager *mgr,
                          const RibExportPolicy &policy);
     void RibOutDelete(const RibExportPolicy &policy);
+    BgpMessageAttrCache *message_attr_cache() const {
+        return message_attr_cache_.get();
+    }
 
     virtual bool Export(RibOut *ribout, Route *route,
                         const RibPeerSet &peerset,
@@ -90,7 +95,6 @@ public:
                                      BgpRoute *src, const BgpPath *path,
                                      ExtCommunityPtr community) = 0;
 
-    static bool PathSelection(const Path &path1, const Path &path2);
     UpdateInfo *GetUpdateInfo(RibOut *ribout, BgpRoute *route,
                               const RibPeerSet &peerset);
 
@@ -116,6 +120,8 @@ public:
     LifetimeActor *deleter();
     const LifetimeActor *deleter() const;
     size_t GetPendingRiboutsCount(size_t *markers) const;
+    size_t GetRiboutsQueueBytes() const;
+    void FillRibOutStatistics(std::vector<ShowRibOutStatistics> *sros) const;
 
     void UpdatePathCount(const BgpPath *path, int count);
     const uint64_t GetPrimaryPathCount() const { return primary_path_count_; }
@@ -126,19 +132,41 @@ public:
         return infeasible_path_count_;
     }
 
+    // Index of the routes that have primary paths from a given peer. It's
+    // kept per partition and is only accessed from the partition's task,
+    // so close and graceful restart processing for a peer can visit just
+    // the routes of the peer instead of walking the whole table.
+    void UpdatePeerRouteIndex(BgpRoute *route, const BgpPath *path,
+                              int count);
+    void GetPeerRoutes(int part_id, const IPeer *peer, const BgpRoute *start,
+                       size_t max_count, std::vector<BgpRoute *> *routes) const;
+    size_t GetPeerRouteCount(const IPeer *peer) const;
+
 private:
     class DeleteActor;
     friend class BgpTableTest;
+
+    // Orders the routes by key, the same way as the table partition.
+    struct PeerRouteCompare {
+        bool operator()(const BgpRoute *lhs, const BgpRoute *rhs) const;
+    };
+
+    // Number of paths from the peer for each route.
+    typedef std::map<BgpRoute *, uint32_t, PeerRouteCompare> PeerRouteMap;
+    typedef std::map<const IPeer *, PeerRouteMap> PeerRouteIndex;
+
     virtual BgpRoute *TableFind(DBTablePartition *rtp,
             const DBRequestKey *prefix) = 0;
     RoutingInstance *rtinstance_;
     RibOutMap ribout_map_;
+    boost::scoped_ptr<BgpMessageAttrCache> message_attr_cache_;
 
     boost::scoped_ptr<DeleteActor> deleter_;
     LifetimeRef<BgpTable> instance_delete_ref_;
     tbb::atomic<uint64_t> primary_path_count_;
     tbb::atomic<uint64_t> secondary_path_count_;
     tbb::atomic<uint64_t> infeasible_path_count_;
+    std::vector<PeerRouteIndex> peer_route_index_;
 
     DISALLOW_COPY_AND_ASSIGN(BgpTable);
 };
@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_update_decoder.h"
+
+#include "base/parse_object.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_peer.h"
+#include "bgp/bgp_proto.h"
+#include "bgp/bgp_server.h"
+#include "net/bgp_af.h"
+
+using std::string;
+
+static const size_t kMarkerSize = 16;
+static const size_t kHeaderSize = BgpProto::kMinMessageSize;
+
+//
+// Returns true if NLRI for the given afi and safi is understood by BgpProto.
+// Sets typed to true if the prefixes are encoded with a route type.
+//
+static bool MpNlriFamily(uint16_t afi, uint8_t safi, bool *typed) {
+    *typed = false;
+    if (afi == BgpAf::IPv4) {
+        if (safi == BgpAf::Unicast || safi == BgpAf::Vpn ||
+            safi == BgpAf::RTarget) {
+            return true;
+        }
+        if (safi == BgpAf::ErmVpn) {
+            *typed = true;
+            return true;
+        }
+    } else if (afi == BgpAf::IPv6) {
+        return (safi == BgpAf::Vpn);
+    } else if (afi == BgpAf::L2Vpn) {
+        if (safi == BgpAf::EVpn) {
+            *typed = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+const BgpProtoPrefix *BgpUpdateDecoder::PrefixReader::Next() {
+    if (data_ >= end_)
+        return NULL;
+
+    size_t bytes;
+    if (typed_) {
+        prefix_->type = data_[0];
+        bytes = data_[1];
+        prefix_->prefixlen = bytes * 8;
+        data_ += 2;
+    } else {
+        prefix_->type = 0;
+        prefix_->prefixlen = data_[0];
+        bytes = (prefix_->prefixlen + 7) / 8;
+        data_ += 1;
+    }
+    prefix_->prefix.assign(data_, data_ + bytes);
+    data_ += bytes;
+    return prefix_;
+}
+
+BgpUpdateDecoder::BgpUpdateDecoder()
+    : attr_mask_(0),
+      mp_reach_(BgpAttribute::MPReachNlri),
+      mp_unreach_(BgpAttribute::MPUnreachNlri),
+      pool_(NULL) {
+    refcount_ = 0;
+    for (int code = 0; code <= kMaxAttributeCode; ++code) {
+        attributes_[code] = NULL;
+    }
+    attributes_[BgpAttribute::Origin] = &origin_;
+    attributes_[BgpAttribute::AsPath] = &as_path_;
+    attributes_[BgpAttribute::NextHop] = &nexthop_;
+    attributes_[BgpAttribute::MultiExitDisc] = &med_;
+    attributes_[BgpAttribute::LocalPref] = &local_pref_;
+    attributes_[BgpAttribute::AtomicAggregate] = &atomic_aggregate_;
+    attributes_[BgpAttribute::Communities] = &community_;
+    attributes_[BgpAttribute::OriginatorId] = &originator_id_;
+    attributes_[BgpAttribute::MPReachNlri] = &mp_reach_.attr;
+    attributes_[BgpAttribute::MPUnreachNlri] = &mp_unreach_.attr;
+    attributes_[BgpAttribute::ExtendedCommunities] = &ext_community_;
+}
+
+BgpUpdateDecoder::~BgpUpdateDecoder() {
+    as_path_.path_segments.clear();
+    STLDeleteValues(&segments_);
+}
+
+bool BgpUpdateDecoder::IsUpdate(const uint8_t *data, size_t size) {
+    return (size >= kHeaderSize && data[kMarkerSize + 2] == BgpProto::UPDATE);
+}
+
+//
+// Forget about the previous message. Everything that has been allocated is
+// kept around for the next one.
+//
+void BgpUpdateDecoder::Clear() {
+    withdrawn_routes_.clear();
+    nlri_.clear();
+    attr_mask_ = 0;
+    path_attributes_.clear();
+
+    as_path_.path_segments.clear();
+    community_.communities.clear();
+    ext_community_.communities.clear();
+    mp_reach_.attr.nexthop.clear();
+    mp_reach_.span.clear();
+    mp_unreach_.span.clear();
+}
+
+bool BgpUpdateDecoder::Decode(const uint8_t *data, size_t size) {
+    Clear();
+    buffer_.clear();
+    if (!IsUpdate(data, size) ||
+        size > static_cast<size_t>(BgpProto::kMaxMessageSize) ||
+        get_value(data + kMarkerSize, 2) != size) {
+        return false;
+    }
+    for (size_t idx = 0; idx < kMarkerSize; ++idx) {
+        if (data[idx] != 0xff)
+            return false;
+    }
+
+    buffer_.assign(data, data + size);
+    const uint8_t *msg = &buffer_[0];
+    size_t offset = kHeaderSize;
+
+    if (size - offset < 2)
+        return false;
+    size_t withdrawn_size = get_value(msg + offset, 2);
+    offset += 2;
+    if (withdrawn_size > size - offset ||
+        !DecodePrefixes(offset, withdrawn_size, false, &withdrawn_routes_)) {
+        return false;
+    }
+    offset += withdrawn_size;
+
+    if (size - offset < 2)
+        return false;
+    size_t attr_size = get_value(msg + offset, 2);
+    offset += 2;
+    if (attr_size > size - offset)
+        return false;
+
+    size_t attr_end = offset + attr_size;
+    while (offset < attr_end) {
+        if (attr_end - offset < 3)
+            return false;
+        uint8_t flags = msg[offset];
+        uint8_t code = msg[offset + 1];
+        offset += 2;
+        size_t length;
+        if (flags & BgpAttribute::ExtendedLength) {
+            if (attr_end - offset < 2)
+                return false;
+            length = get_value(msg + offset, 2);
+            offset += 2;
+        } else {
+            length = msg[offset];
+            offset += 1;
+        }
+        if (length > attr_end - offset)
+            return false;
+        if (!DecodeAttribute(flags, code, offset, length))
+            return false;
+        offset += length;
+    }
+
+    if (!DecodePrefixes(offset, size - offset, false, &nlri_))
+        return false;
+
+    for (int code = 0; code <= kMaxAttributeCode; ++code) {
+        if (attr_mask_ & (1 << code))
+            path_attributes_.push_back(attributes_[code]);
+    }
+    return true;
+}
+
+//
+// Walk the prefixes in the given part of the message to make sure that they
+// are well formed and count them.
+//
+bool BgpUpdateDecoder::DecodePrefixes(size_t offset, size_t size, bool typed,
+                                      PrefixSpan *span) {
+    span->offset = offset;
+    span->size = size;
+    span->count = 0;
+    span->typed = typed;
+
+    const uint8_t *data = &buffer_[0] + offset;
+    const uint8_t *end = data + size;
+    while (data < end) {
+        size_t bytes;
+        if (typed) {
+            if (end - data < 2)
+                return false;
+            bytes = data[1];
+            data += 2;
+        } else {
+            bytes = (data[0] + 7) / 8;
+            data += 1;
+        }
+        if (static_cast<size_t>(end - data) < bytes)
+            return false;
+        data += bytes;
+        span->count++;
+    }
+    return true;
+}
+
+bool BgpUpdateDecoder::DecodeAttribute(uint8_t flags, uint8_t code,
+                                       size_t offset, size_t length) {
+    if (code > kMaxAttributeCode || !attributes_[code])
+        return false;
+    if (attr_mask_ & (1 << code))
+        return false;
+
+    const uint8_t *value = &buffer_[0] + offset;
+    uint8_t attr_flags = flags & BgpAttribute::FLAG_MASK;
+    switch (code) {
+    case BgpAttribute::Origin:
+        if (length != BgpAttrOrigin::kSize ||
+            attr_flags != BgpAttrOrigin::kFlags ||
+            value[0] > BgpAttrOrigin::INCOMPLETE) {
+            return false;
+        }
+        origin_.origin = value[0];
+        break;
+    case BgpAttribute::AsPath:
+        if (attr_flags != AsPathSpec::kFlags ||
+            !DecodeAsPath(offset, length)) {
+            return false;
+        }
+        break;
+    case BgpAttribute::NextHop:
+        if (length != BgpAttrNextHop::kSize ||
+            attr_flags != BgpAttrNextHop::kFlags) {
+            return false;
+        }
+        nexthop_.nexthop = get_value(value, BgpAttrNextHop::kSize);
+        if (nexthop_.nexthop == 0)
+            return false;
+        break;
+    case BgpAttribute::MultiExitDisc:
+        if (length != BgpAttrMultiExitDisc::kSize ||
+            attr_flags != BgpAttrMultiExitDisc::kFlags) {
+            return false;
+        }
+        med_.med = get_value(value, BgpAttrMultiExitDisc::kSize);
+        break;
+    case BgpAttribute::LocalPref:
+        if (length != BgpAttrLocalPref::kSize ||
+            attr_flags != BgpAttrLocalPref::kFlags) {
+            return false;
+        }
+        local_pref_.local_pref = get_value(value, BgpAttrLocalPref::kSize);
+        break;
+    case BgpAttribute::AtomicAggregate:
+        if (length != 0 || flags != BgpAttrAtomicAggregate::kFlags)
+            return false;
+        break;
+    case BgpAttribute::Communities:
+        if (length == 0 || length % sizeof(uint32_t) != 0 ||
+            attr_flags != CommunitySpec::kFlags) {
+            return false;
+        }
+        for (size_t idx = 0; idx < length; idx += sizeof(uint32_t)) {
+            community_.communities.push_back(
+                get_value(value + idx, sizeof(uint32_t)));
+        }
+        break;
+    case BgpAttribute::OriginatorId:
+        if (length != BgpAttrOriginatorId::kSize ||
+            attr_flags != BgpAttrOriginatorId::kFlags) {
+            return false;
+        }
+        originator_id_.originator_id =
+            get_value(value, BgpAttrOriginatorId::kSize);
+        break;
+    case BgpAttribute::MPReachNlri:
+        if (attr_flags != BgpMpNlri::kFlags ||
+            !DecodeMpNlri(&mp_reach_, offset, length)) {
+            return false;
+        }
+        break;
+    case BgpAttribute::MPUnreachNlri:
+        if (attr_flags != BgpMpNlri::kFlags ||
+            !DecodeMpNlri(&mp_unreach_, offset, length)) {
+            return false;
+        }
+        break;
+    case BgpAttribute::ExtendedCommunities:
+        if (length == 0 || length % sizeof(uint64_t) != 0 ||
+            attr_flags != ExtCommunitySpec::kFlags) {
+            return false;
+        }
+        for (size_t idx = 0; idx < length; idx += sizeof(uint64_t)) {
+            ext_community_.communities.push_back(
+                get_value(value + idx, sizeof(uint64_t)));
+        }
+        break;
+    default:
+        return false;
+    }
+
+    attributes_[code]->flags = flags;
+    attr_mask_ |= (1 << code);
+    return true;
+}
+
+bool BgpUpdateDecoder::DecodeAsPath(size_t offset, size_t length) {
+    const uint8_t *data = &buffer_[0] + offset;
+    const uint8_t *end = data + length;
+    while (data < end) {
+        if (end - data < 2)
+            return false;
+        int type = data[0];
+        size_t count = data[1];
+        data += 2;
+        if (static_cast<size_t>(end - data) < count * sizeof(as_t))
+            return false;
+
+        size_t index = as_path_.path_segments.size();
+        if (index == segments_.size())
+            segments_.push_back(new AsPathSpec::PathSegment);
+        AsPathSpec::PathSegment *segment = segments_[index];
+        as_path_.path_segments.push_back(segment);
+        segment->path_segment_type = type;
+        segment->path_segment.clear();
+        for (size_t idx = 0; idx < count; ++idx) {
+            segment->path_segment.push_back(get_value(data, sizeof(as_t)));
+            data += sizeof(as_t);
+        }
+    }
+    return true;
+}
+
+bool BgpUpdateDecoder::DecodeMpNlri(MpNlriEntry *entry, size_t offset,
+                                    size_t length) {
+    BgpMpNlri *attr = &entry->attr;
+    const uint8_t *value = &buffer_[0] + offset;
+    if (length < 3)
+        return false;
+    attr->afi = get_value(value, 2);
+    attr->safi = value[2];
+    bool typed;
+    if (!MpNlriFamily(attr->afi, attr->safi, &typed))
+        return false;
+
+    size_t pos = 3;
+    if (attr->code == BgpAttribute::MPReachNlri) {
+        if (length - pos < 1)
+            return false;
+        size_t nexthop_size = value[pos++];
+        if (length - pos < nexthop_size + 1)
+            return false;
+        attr->nexthop.assign(value + pos, value + pos + nexthop_size);
+        pos += nexthop_size + 1;
+    }
+    return DecodePrefixes(offset + pos, length - pos, typed, &entry->span);
+}
+
+BgpUpdateDecoder::PrefixReader BgpUpdateDecoder::withdrawn_routes() const {
+    return PrefixReader(&buffer_[0], withdrawn_routes_, &prefix_);
+}
+
+BgpUpdateDecoder::PrefixReader BgpUpdateDecoder::nlri() const {
+    return PrefixReader(&buffer_[0], nlri_, &prefix_);
+}
+
+size_t BgpUpdateDecoder::mp_nlri_count(const BgpMpNlri *mp_nlri) const {
+    if (mp_nlri == &mp_reach_.attr)
+        return mp_reach_.span.count;
+    return mp_unreach_.span.count;
+}
+
+BgpUpdateDecoder::PrefixReader BgpUpdateDecoder::mp_nlri(
+    const BgpMpNlri *mp_nlri) const {
+    if (mp_nlri == &mp_reach_.attr)
+        return PrefixReader(&buffer_[0], mp_reach_.span, &prefix_);
+    return PrefixReader(&buffer_[0], mp_unreach_.span, &prefix_);
+}
+
+string BgpUpdateDecoder::PathAttributesString() const {
+    string rxed_attr("Path attributes : ");
+    for (BgpAttrSpec::const_iterator it = path_attributes_.begin();
+         it != path_attributes_.end(); ++it) {
+        rxed_attr += (*it)->ToString() + " ";
+    }
+    return rxed_attr;
+}
+
+//
+// Attributes are never duplicated since Decode rejects such messages. The
+// attribute list is only converted to a string if it's going to be traced.
+//
+int BgpUpdateDecoder::Validate(const BgpPeer *peer, string *data) const {
+    bool ibgp = (peer->PeerType() == BgpProto::IBGP);
+    bool origin = (attr_mask_ & (1 << BgpAttribute::Origin)) != 0;
+    bool nh = (attr_mask_ & (1 << BgpAttribute::NextHop)) != 0;
+    bool as_path = (attr_mask_ & (1 << BgpAttribute::AsPath)) != 0;
+    bool local_pref = (attr_mask_ & (1 << BgpAttribute::LocalPref)) != 0;
+    bool mp_reach_nlri = (attr_mask_ & (1 << BgpAttribute::MPReachNlri)) != 0;
+
+    // Check segments size for ebgp.
+    // IBGP can have empty path for routes that are originated.
+    if (as_path && !ibgp) {
+        if (!as_path_.path_segments.size() ||
+            !as_path_.path_segments[0]->path_segment.size())
+            return BgpProto::Notification::MalformedASPath;
+    }
+
+    if (!LoggingDisabled() && IsSandeshTraceEnabled() &&
+        IsSandeshTraceBufferEnabled(BgpTraceBuf)) {
+        BGP_LOG_PEER(Message, const_cast<BgpPeer *>(peer),
+                     SandeshLevel::SYS_DEBUG, BGP_LOG_FLAG_TRACE,
+                     BGP_PEER_DIR_IN, PathAttributesString());
+    }
+    if (nlri_.count > 0 && !nh) {
+        // next-hop attribute must be present if IPv4 NLRI is present
+        char attrib_type = BgpAttribute::NextHop;
+        *data = string(&attrib_type, 1);
+        return BgpProto::Notification::MissingWellKnownAttrib;
+    }
+    if (nlri_.count > 0 || mp_reach_nlri) {
+        // origin and as_path must be present if any NLRI is present
+        if (!origin) {
+            char attrib_type = BgpAttribute::Origin;
+            *data = string(&attrib_type, 1);
+            return BgpProto::Notification::MissingWellKnownAttrib;
+        }
+        if (!as_path) {
+            char attrib_type = BgpAttribute::AsPath;
+            *data = string(&attrib_type, 1);
+            return BgpProto::Notification::MissingWellKnownAttrib;
+        }
+
+        // If IBGP, local_pref is mandatory
+        if (ibgp && !local_pref) {
+            char attrib_type = BgpAttribute::LocalPref;
+            *data = string(&attrib_type, 1);
+            return BgpProto::Notification::MissingWellKnownAttrib;
+        }
+    }
+    return 0;
+}
+
+BgpUpdateDecoderPool::BgpUpdateDecoderPool(size_t max_count)
+    : max_count_(max_count) {
+}
+
+BgpUpdateDecoderPool::~BgpUpdateDecoderPool() {
+    STLDeleteValues(&free_list_);
+}
+
+BgpUpdateDecoderPtr BgpUpdateDecoderPool::Allocate() {
+    BgpUpdateDecoder *decoder = NULL;
+    {
+        tbb::spin_mutex::scoped_lock lock(mutex_);
+        if (!free_list_.empty()) {
+            decoder = free_list_.back();
+            free_list_.pop_back();
+        }
+    }
+    if (!decoder) {
+        decoder = new BgpUpdateDecoder;
+        decoder->pool_ = this;
+    }
+    return BgpUpdateDecoderPtr(decoder);
+}
+
+void BgpUpdateDecoderPool::Free(BgpUpdateDecoder *decoder) {
+    {
+        tbb::spin_mutex::scoped_lock lock(mutex_);
+        if (free_list_.size() < max_count_) {
+            free_list_.push_back(decoder);
+            return;
+        }
+    }
+    delete decoder;
+}
+
+size_t BgpUpdateDecoderPool::free_count() const {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    return free_list_.size();
+}
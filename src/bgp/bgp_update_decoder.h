@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef SRC_BGP_BGP_UPDATE_DECODER_H_
+#define SRC_BGP_BGP_UPDATE_DECODER_H_
+
+#include <boost/intrusive_ptr.hpp>
+#include <tbb/atomic.h>
+#include <tbb/spin_mutex.h>
+
+#include <string>
+#include <vector>
+
+#include "base/util.h"
+#include "bgp/bgp_aspath.h"
+#include "bgp/bgp_attr.h"
+#include "bgp/community.h"
+
+class BgpPeer;
+class BgpUpdateDecoderPool;
+
+//
+// Single pass decoder for the common case of an UPDATE message.
+//
+// BgpProto::Decode builds a BgpProto::Update through the generic parser,
+// which allocates an object for every path attribute and every prefix in
+// the message. The BgpUpdateDecoder instead decodes the path attributes
+// into attribute specs that are members of the decoder and are reused for
+// every message, so that the resulting BgpAttrSpec can be passed straight
+// to BgpAttrDB::Locate. Prefixes are not decoded up front. The decoder just
+// keeps track of where the withdrawn routes, NLRI and MP NLRI are in its
+// copy of the message and a PrefixReader hands them out one at a time in a
+// BgpProtoPrefix that is also reused.
+//
+// Only the attributes that show up in almost every UPDATE are supported:
+// origin, as path, nexthop, med, local preference, atomic aggregate,
+// originator id, communities, extended communities and mp reach/unreach
+// for the address families that BgpProto knows about. Decode returns false
+// if the message contains anything else or if it's malformed in any way.
+// The caller must then fall back to BgpProto::Decode, which takes care of
+// the less common attributes and of generating the appropriate errors.
+//
+// Once it's warmed up, a decoder doesn't allocate any memory unless the
+// message is larger or has more as path segments than any it has decoded
+// before.
+//
+class BgpUpdateDecoder {
+public:
+    //
+    // Location of a list of prefixes in the message.
+    //
+    struct PrefixSpan {
+        PrefixSpan() : offset(0), size(0), count(0), typed(false) { }
+        void clear() { offset = 0; size = 0; count = 0; typed = false; }
+
+        size_t offset;
+        size_t size;
+        size_t count;
+        // Prefixes are encoded as type, length in bytes and address
+        // rather than length in bits and address.
+        bool typed;
+    };
+
+    //
+    // Iterates over the prefixes in a PrefixSpan. All readers created by
+    // a decoder share the same BgpProtoPrefix, so the prefix returned by
+    // Next is only valid until the next call to Next on any reader.
+    //
+    class PrefixReader {
+    public:
+        PrefixReader(const uint8_t *data, const PrefixSpan &span,
+                     BgpProtoPrefix *prefix)
+            : data_(data + span.offset), end_(data + span.offset + span.size),
+              typed_(span.typed), prefix_(prefix) {
+        }
+
+        // Returns NULL when there are no more prefixes.
+        const BgpProtoPrefix *Next();
+
+    private:
+        const uint8_t *data_;
+        const uint8_t *end_;
+        bool typed_;
+        BgpProtoPrefix *prefix_;
+    };
+
+    BgpUpdateDecoder();
+    ~BgpUpdateDecoder();
+
+    // Decode the message in data, which includes the BGP header. The data
+    // is copied, so the decoder may be used after the buffer is released.
+    // Returns false if the message needs to be handled by BgpProto::Decode.
+    bool Decode(const uint8_t *data, size_t size);
+
+    // Same checks as BgpProto::Update::Validate.
+    int Validate(const BgpPeer *peer, std::string *data) const;
+
+    // Attribute specs in order of attribute code, including mp reach and
+    // unreach. The BgpMpNlri attributes have an empty nlri vector. Their
+    // prefixes are available via mp_nlri.
+    const BgpAttrSpec &path_attributes() const { return path_attributes_; }
+
+    size_t withdrawn_count() const { return withdrawn_routes_.count; }
+    PrefixReader withdrawn_routes() const;
+    size_t nlri_count() const { return nlri_.count; }
+    PrefixReader nlri() const;
+    size_t mp_nlri_count(const BgpMpNlri *mp_nlri) const;
+    PrefixReader mp_nlri(const BgpMpNlri *mp_nlri) const;
+
+    size_t size() const { return buffer_.size(); }
+
+    // Returns true if the header in data is that of an UPDATE message.
+    static bool IsUpdate(const uint8_t *data, size_t size);
+
+private:
+    friend class BgpUpdateDecoderPool;
+    friend void intrusive_ptr_add_ref(BgpUpdateDecoder *decoder);
+    friend void intrusive_ptr_release(BgpUpdateDecoder *decoder);
+
+    static const int kMaxAttributeCode = BgpAttribute::ExtendedCommunities;
+
+    struct MpNlriEntry {
+        explicit MpNlriEntry(BgpAttribute::Code code) : attr(code) { }
+        BgpMpNlri attr;
+        PrefixSpan span;
+    };
+
+    void Clear();
+    bool DecodePrefixes(size_t offset, size_t size, bool typed,
+                        PrefixSpan *span);
+    bool DecodeAttribute(uint8_t flags, uint8_t code, size_t offset,
+                         size_t length);
+    bool DecodeAsPath(size_t offset, size_t length);
+    bool DecodeMpNlri(MpNlriEntry *entry, size_t offset, size_t length);
+    std::string PathAttributesString() const;
+
+    std::vector<uint8_t> buffer_;
+    PrefixSpan withdrawn_routes_;
+    PrefixSpan nlri_;
+    uint32_t attr_mask_;
+    BgpAttrSpec path_attributes_;
+
+    // Spec for each supported attribute code, NULL if unsupported.
+    BgpAttribute *attributes_[kMaxAttributeCode + 1];
+
+    BgpAttrOrigin origin_;
+    AsPathSpec as_path_;
+    BgpAttrNextHop nexthop_;
+    BgpAttrMultiExitDisc med_;
+    BgpAttrLocalPref local_pref_;
+    BgpAttrAtomicAggregate atomic_aggregate_;
+    CommunitySpec community_;
+    BgpAttrOriginatorId originator_id_;
+    MpNlriEntry mp_reach_;
+    MpNlriEntry mp_unreach_;
+    ExtCommunitySpec ext_community_;
+
+    // All path segments allocated so far. as_path_ uses a prefix of them.
+    std::vector<AsPathSpec::PathSegment *> segments_;
+    mutable BgpProtoPrefix prefix_;
+
+    BgpUpdateDecoderPool *pool_;
+    tbb::atomic<int> refcount_;
+
+    DISALLOW_COPY_AND_ASSIGN(BgpUpdateDecoder);
+};
+
+typedef boost::intrusive_ptr<BgpUpdateDecoder> BgpUpdateDecoderPtr;
+
+//
+// Free list of decoders. A BgpPeer allocates a decoder for each received
+// UPDATE in the io thread and the decoder goes back to the pool once the
+// bgp::StateMachine task is done with the message.
+//
+class BgpUpdateDecoderPool {
+public:
+    static const size_t kDefaultMaxCount = 32;
+
+    explicit BgpUpdateDecoderPool(size_t max_count = kDefaultMaxCount);
+    ~BgpUpdateDecoderPool();
+
+    BgpUpdateDecoderPtr Allocate();
+
+    size_t free_count() const;
+
+private:
+    friend void intrusive_ptr_release(BgpUpdateDecoder *decoder);
+
+    void Free(BgpUpdateDecoder *decoder);
+
+    mutable tbb::spin_mutex mutex_;
+    std::vector<BgpUpdateDecoder *> free_list_;
+    size_t max_count_;
+
+    DISALLOW_COPY_AND_ASSIGN(BgpUpdateDecoderPool);
+};
+
+inline void intrusive_ptr_add_ref(BgpUpdateDecoder *decoder) {
+    decoder->refcount_.fetch_and_increment();
+}
+
+inline void intrusive_ptr_release(BgpUpdateDecoder *decoder) {
+    int prev = decoder->refcount_.fetch_and_decrement();
+    if (prev > 1)
+        return;
+    if (decoder->pool_) {
+        decoder->pool_->Free(decoder);
+    } else {
+        delete decoder;
+    }
+}
+
+#endif  // SRC_BGP_BGP_UPDATE_DECODER_H_
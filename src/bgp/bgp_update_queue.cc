@@ -10,7 +10,7 @@
 // Initialize the UpdateQueue and add the tail marker to the FIFO.
 //
 UpdateQueue::UpdateQueue(int queue_id)
-    : queue_id_(queue_id), marker_count_(0) {
+    : queue_id_(queue_id), marker_count_(0), bytes_(0), peak_bytes_(0) {
     queue_.push_back(tail_marker_);
 }
 
@@ -23,6 +23,24 @@ UpdateQueue::~UpdateQueue() {
     assert(attr_set_.empty());
 }
 
+//
+// Memory accounted for an UpdateInfo on the set container.
+//
+size_t UpdateQueue::UpdateInfoBytes(const UpdateInfo &uinfo) {
+    return sizeof(UpdateInfo) +
+        uinfo.roattr.nexthop_list().size() * sizeof(RibOutAttr::NextHop);
+}
+
+//
+// Account for memory added to the UpdateQueue and update the peak.
+// Assumes that the caller holds the mutex.
+//
+void UpdateQueue::AddBytes(size_t bytes) {
+    bytes_ += bytes;
+    if (bytes_ > peak_bytes_)
+        peak_bytes_ = bytes_;
+}
+
 //
 // Enqueue the specified RouteUpdate to the UpdateQueue.  Updates both the
 // FIFO and the set container.
@@ -42,12 +60,15 @@ bool UpdateQueue::Enqueue(RouteUpdate *rt_update) {
     // Go through the UpdateInfo list and insert each element into the set
     // container for the UpdateQueue.  Also set up the back pointer to the
     // RouteUpdate.
+    size_t bytes = sizeof(RouteUpdate);
     UpdateInfoSList &uinfo_slist = rt_update->Updates();
     for (UpdateInfoSList::List::iterator iter = uinfo_slist->begin();
          iter != uinfo_slist->end(); ++iter) {
         iter->update = rt_update;
         attr_set_.insert(*iter);
+        bytes += UpdateInfoBytes(*iter);
     }
+    AddBytes(bytes);
     return need_tail_dequeue;
 }
 
@@ -58,10 +79,12 @@ bool UpdateQueue::Enqueue(RouteUpdate *rt_update) {
 void UpdateQueue::Dequeue(RouteUpdate *rt_update) {
     tbb::mutex::scoped_lock lock(mutex_);
     queue_.erase(queue_.iterator_to(*rt_update));
+    bytes_ -= sizeof(RouteUpdate);
     UpdateInfoSList &uinfo_slist = rt_update->Updates();
     for (UpdateInfoSList::List::iterator iter = uinfo_slist->begin();
          iter != uinfo_slist->end(); ++iter) {
         attr_set_.erase(attr_set_.iterator_to(*iter));
+        bytes_ -= UpdateInfoBytes(*iter);
     }
 }
 
@@ -106,6 +129,7 @@ UpdateEntry *UpdateQueue::NextEntry(UpdateEntry *current_upentry) {
 void UpdateQueue::AttrDequeue(UpdateInfo *current_uinfo) {
     tbb::mutex::scoped_lock lock(mutex_);
     attr_set_.erase(attr_set_.iterator_to(*current_uinfo));
+    bytes_ -= UpdateInfoBytes(*current_uinfo);
 }
 
 //
@@ -138,6 +162,7 @@ void UpdateQueue::AddMarker(UpdateMarker *marker, RouteUpdate *rt_update) {
     assert(!marker->members.empty());
     tbb::mutex::scoped_lock lock(mutex_);
     marker_count_++;
+    AddBytes(sizeof(UpdateMarker));
     queue_.insert(++queue_.iterator_to(*rt_update), *marker);
 
     for (size_t i = marker->members.find_first();
@@ -194,6 +219,7 @@ void UpdateQueue::MarkerSplit(UpdateMarker *marker, const RibPeerSet &msplit) {
     UpdatesByOrder::iterator mpos = queue_.iterator_to(*marker);
     queue_.insert(mpos, *split_marker);
     marker_count_++;
+    AddBytes(sizeof(UpdateMarker));
 
     for (size_t i = msplit.find_first();
          i != BitSet::npos; i = msplit.find_next(i)) {
@@ -231,6 +257,7 @@ void UpdateQueue::MarkerMerge(UpdateMarker *dst_marker,
         assert(src_marker != &tail_marker_);
         delete src_marker;
         marker_count_--;
+        bytes_ -= sizeof(UpdateMarker);
     }
 }
 
@@ -279,6 +306,8 @@ void UpdateQueue::Leave(int bit) {
     if (marker != &tail_marker_  && marker->members.empty()) {
         queue_.erase(queue_.iterator_to(*marker));
         delete marker;
+        marker_count_--;
+        bytes_ -= sizeof(UpdateMarker);
     }
 }
 
@@ -311,3 +340,19 @@ size_t UpdateQueue::marker_count() const {
     tbb::mutex::scoped_lock lock(mutex_);
     return marker_count_;
 }
+
+//
+// Return the memory currently accounted for the UpdateQueue.
+//
+size_t UpdateQueue::bytes() const {
+    tbb::mutex::scoped_lock lock(mutex_);
+    return bytes_;
+}
+
+//
+// Return the most memory that has been accounted for the UpdateQueue.
+//
+size_t UpdateQueue::peak_bytes() const {
+    tbb::mutex::scoped_lock lock(mutex_);
+    return peak_bytes_;
+}
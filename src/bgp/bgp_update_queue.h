@@ -73,6 +73,11 @@ struct UpdateByAttrCmp {
 // it's UpdateMarker. Note that it's possible for multiple peers to point
 // to the same marker.
 //
+// An UpdateQueue keeps track of the memory used by the RouteUpdates and
+// UpdateInfos on it and by its UpdateMarkers, excluding the tail marker.
+// This doesn't include the memory for the RibPeerSets or the attributes,
+// but it's good enough to see which RibOuts are holding on to a backlog.
+//
 // A special UpdateMarker called the tail marker is used as an easy way to
 // keep track of whether the list is empty.  The tail marker is always the
 // last marker in the list.  Another way to think about this is that all
@@ -133,14 +138,21 @@ public:
     bool empty() const;
     size_t size() const;
     size_t marker_count() const;
+    size_t bytes() const;
+    size_t peak_bytes() const;
 
 private:
     friend class BgpExportTest;
     friend class RibOutUpdatesTest;
 
+    static size_t UpdateInfoBytes(const UpdateInfo &uinfo);
+    void AddBytes(size_t bytes);
+
     mutable tbb::mutex mutex_;
     int queue_id_;
     size_t marker_count_;
+    size_t bytes_;
+    size_t peak_bytes_;
     UpdatesByOrder queue_;
     UpdatesByAttr attr_set_;
     MarkerMap markers_;
@@ -63,6 +63,7 @@ using boost::system::error_code;
 using pugi::xml_node;
 using std::auto_ptr;
 using std::make_pair;
+using std::map;
 using std::pair;
 using std::set;
 using std::string;
@@ -839,6 +840,115 @@ bool BgpXmppChannel::VerifyMembership(const string &vrf_name,
     return true;
 }
 
+//
+// Requests built from the items in a single publish message.
+//
+// All items in a message belong to the same routing instance and family, so
+// the membership is verified once for the whole message. Items also tend to
+// share the same path attributes, so the BgpAttr is located once for each
+// distinct set of inputs. The requests are enqueued to the table together
+// after all the items have been parsed.
+//
+class BgpXmppChannel::RouteBatch {
+public:
+    //
+    // Inputs that determine the BgpAttr for an inet, inet6 or enet route.
+    // The source rd is derived from the nexthop and the instance id, and
+    // the instance id is the same for all items in the message.
+    //
+    struct AttrKey {
+        AttrKey(uint32_t local_pref, const IpAddress &nexthop,
+                const ExtCommunitySpec &ext)
+            : local_pref(local_pref), nexthop(nexthop),
+              ext_communities(ext.communities) {
+        }
+
+        bool operator<(const AttrKey &rhs) const {
+            BOOL_KEY_COMPARE(local_pref, rhs.local_pref);
+            BOOL_KEY_COMPARE(nexthop, rhs.nexthop);
+            BOOL_KEY_COMPARE(ext_communities, rhs.ext_communities);
+            return false;
+        }
+
+        uint32_t local_pref;
+        IpAddress nexthop;
+        vector<uint64_t> ext_communities;
+    };
+
+    RouteBatch(BgpXmppChannel *channel, const string &vrf_name,
+               Address::Family family)
+        : channel_(channel), vrf_name_(vrf_name), family_(family),
+          verified_(false), is_member_(false), table_(NULL),
+          instance_id_(-1), subscribe_pending_(false) {
+    }
+
+    ~RouteBatch() {
+        STLDeleteValues(&requests_);
+    }
+
+    bool VerifyMembership(BgpTable **table, int *instance_id,
+                          bool *subscribe_pending) {
+        if (!verified_) {
+            verified_ = true;
+            is_member_ = channel_->VerifyMembership(vrf_name_, family_,
+                &table_, &instance_id_, &subscribe_pending_);
+        }
+        *table = table_;
+        *instance_id = instance_id_;
+        *subscribe_pending = subscribe_pending_;
+        return is_member_;
+    }
+
+    BgpAttrPtr LocateAttr(const BgpAttrSpec &attrs, const AttrKey &key) {
+        AttrMap::const_iterator loc = attr_map_.find(key);
+        if (loc != attr_map_.end())
+            return loc->second;
+        BgpAttrPtr attr = channel_->bgp_server_->attr_db()->Locate(attrs);
+        attr_map_.insert(make_pair(key, attr));
+        return attr;
+    }
+
+    // Takes ownership of the key and data of the request.
+    void Enqueue(DBRequest *req) {
+        DBRequest *request = new DBRequest();
+        request->Swap(req);
+        requests_.push_back(request);
+    }
+
+    void Flush() {
+        if (requests_.empty())
+            return;
+        assert(table_);
+        table_->Enqueue(requests_);
+        STLDeleteValues(&requests_);
+    }
+
+private:
+    typedef map<AttrKey, BgpAttrPtr> AttrMap;
+
+    BgpXmppChannel *channel_;
+    string vrf_name_;
+    Address::Family family_;
+    bool verified_;
+    bool is_member_;
+    BgpTable *table_;
+    int instance_id_;
+    bool subscribe_pending_;
+    AttrMap attr_map_;
+    vector<DBRequest *> requests_;
+
+    DISALLOW_COPY_AND_ASSIGN(RouteBatch);
+};
+
+BgpAttrPtr BgpXmppChannel::LocateAttr(const BgpAttrSpec &attrs,
+    uint32_t local_pref, const IpAddress &nexthop,
+    const ExtCommunitySpec &ext, RouteBatch *batch) {
+    if (!batch)
+        return bgp_server_->attr_db()->Locate(attrs);
+    return batch->LocateAttr(attrs,
+        RouteBatch::AttrKey(local_pref, nexthop, ext));
+}
+
 bool BgpXmppChannel::ProcessMcastItem(string vrf_name,
     const pugi::xml_node &node, bool add_change) {
     McastItemType item;
@@ -1023,8 +1133,8 @@ bool BgpXmppChannel::ProcessMcastItem(string vrf_name,
     return true;
 }
 
-bool BgpXmppChannel::ProcessItem(string vrf_name,
-    const pugi::xml_node &node, bool add_change) {
+bool BgpXmppChannel::ProcessItem(const string &vrf_name,
+    const pugi::xml_node &node, bool add_change, RouteBatch *batch) {
     ItemType item;
     item.Clear();
 
@@ -1056,8 +1166,11 @@ bool BgpXmppChannel::ProcessItem(string vrf_name,
     bool subscribe_pending;
     int instance_id;
     BgpTable *table;
-    if (!VerifyMembership(vrf_name, Address::INET, &table, &instance_id,
-        &subscribe_pending)) {
+    bool is_member = batch ?
+        batch->VerifyMembership(&table, &instance_id, &subscribe_pending) :
+        VerifyMembership(vrf_name, Address::INET, &table, &instance_id,
+            &subscribe_pending);
+    if (!is_member) {
         channel_->Close();
         return false;
     }
@@ -1172,7 +1285,8 @@ bool BgpXmppChannel::ProcessItem(string vrf_name,
         if (!ext.communities.empty())
             attrs.push_back(&ext);
 
-        BgpAttrPtr attr = bgp_server_->attr_db()->Locate(attrs);
+        BgpAttrPtr attr = LocateAttr(attrs, item.entry.local_preference,
+            nh_address, ext, batch);
 
         req.data.reset(new InetTable::RequestData(attr, nexthops));
         stats_[RX].reach++;
@@ -1198,12 +1312,16 @@ bool BgpXmppChannel::ProcessItem(string vrf_name,
         "Inet route " << item.entry.nlri.address <<
         " with next-hop " << nh_address << " and label " << label <<
         " enqueued for " << (add_change ? "add/change" : "delete"));
-    table->Enqueue(&req);
+    if (batch) {
+        batch->Enqueue(&req);
+    } else {
+        table->Enqueue(&req);
+    }
     return true;
 }
 
-bool BgpXmppChannel::ProcessInet6Item(string vrf_name,
-    const pugi::xml_node &node, bool add_change) {
+bool BgpXmppChannel::ProcessInet6Item(const string &vrf_name,
+    const pugi::xml_node &node, bool add_change, RouteBatch *batch) {
     ItemType item;
     item.Clear();
 
@@ -1247,8 +1365,11 @@ bool BgpXmppChannel::ProcessInet6Item(string vrf_name,
     bool subscribe_pending;
     int instance_id;
     BgpTable *table;
-    if (!VerifyMembership(vrf_name, Address::INET6, &table, &instance_id,
-        &subscribe_pending)) {
+    bool is_member = batch ?
+        batch->VerifyMembership(&table, &instance_id, &subscribe_pending) :
+        VerifyMembership(vrf_name, Address::INET6, &table, &instance_id,
+            &subscribe_pending);
+    if (!is_member) {
         channel_->Close();
         return false;
     }
@@ -1367,7 +1488,8 @@ bool BgpXmppChannel::ProcessInet6Item(string vrf_name,
             attrs.push_back(&ext);
         }
 
-        BgpAttrPtr attr = bgp_server_->attr_db()->Locate(attrs);
+        BgpAttrPtr attr = LocateAttr(attrs, item.entry.local_preference,
+            nh_address, ext, batch);
 
         req.data.reset(new Inet6Table::RequestData(attr, nexthops));
         stats_[RX].reach++;
@@ -1393,12 +1515,16 @@ bool BgpXmppChannel::ProcessInet6Item(string vrf_name,
         "Inet6 route " << item.entry.nlri.address <<
         " with next-hop " << nh_address << " and label " << label <<
         " enqueued for " << (add_change ? "add/change" : "delete"));
-    table->Enqueue(&req);
+    if (batch) {
+        batch->Enqueue(&req);
+    } else {
+        table->Enqueue(&req);
+    }
     return true;
 }
 
-bool BgpXmppChannel::ProcessEnetItem(string vrf_name,
-    const pugi::xml_node &node, bool add_change) {
+bool BgpXmppChannel::ProcessEnetItem(const string &vrf_name,
+    const pugi::xml_node &node, bool add_change, RouteBatch *batch) {
     EnetItemType item;
     item.Clear();
 
@@ -1480,8 +1606,11 @@ bool BgpXmppChannel::ProcessEnetItem(string vrf_name,
     bool subscribe_pending;
     int instance_id;
     BgpTable *table;
-    if (!VerifyMembership(vrf_name, Address::EVPN, &table, &instance_id,
-        &subscribe_pending)) {
+    bool is_member = batch ?
+        batch->VerifyMembership(&table, &instance_id, &subscribe_pending) :
+        VerifyMembership(vrf_name, Address::EVPN, &table, &instance_id,
+            &subscribe_pending);
+    if (!is_member) {
         channel_->Close();
         return false;
     }
@@ -1645,7 +1774,10 @@ bool BgpXmppChannel::ProcessEnetItem(string vrf_name,
             attrs.push_back(&pmsi_spec);
         }
 
-        BgpAttrPtr attr = bgp_server_->attr_db()->Locate(attrs);
+        // The pmsi tunnel is not part of the key used by the batch to look
+        // up attributes, so broadcast routes always locate their own.
+        BgpAttrPtr attr = LocateAttr(attrs, item.entry.local_preference,
+            nh_address, ext, mac_addr.IsBroadcast() ? NULL : batch);
 
         req.data.reset(new EvpnTable::RequestData(attr, nexthops));
         stats_[0].reach++;
@@ -1671,7 +1803,11 @@ bool BgpXmppChannel::ProcessEnetItem(string vrf_name,
         "Enet route " << evpn_prefix.ToXmppIdString() <<
         " with next-hop " << nh_address << " and label " << label <<
         " enqueued for " << (add_change ? "add/change" : "delete"));
-    table->Enqueue(&req);
+    if (batch) {
+        batch->Enqueue(&req);
+    } else {
+        table->Enqueue(&req);
+    }
     return true;
 }
 
@@ -2157,35 +2293,65 @@ void BgpXmppChannel::ReceiveUpdate(const XmppStanza::XmppMessage *msg) {
                 XmlBase *impl = msg->dom.get();
                 stats_[RX].rt_updates++;
                 XmlPugi *pugi = reinterpret_cast<XmlPugi *>(impl);
-                for (xml_node item = pugi->FindNode("item"); item;
-                    item = item.next_sibling()) {
-                    if (strcmp(item.name(), "item") != 0) continue;
-
-                        string id(iq->as_node.c_str());
-                        char *str = const_cast<char *>(id.c_str());
-                        char *saveptr;
-                        char *af = strtok_r(str, "/", &saveptr);
-                        char *safi = strtok_r(NULL, "/", &saveptr);
-
-                        if (atoi(af) == BgpAf::IPv4 &&
-                            atoi(safi) == BgpAf::Unicast) {
-                            ProcessItem(iq->node, item, iq->is_as_node);
-                        } else if (atoi(af) == BgpAf::IPv6 &&
-                                   atoi(safi) == BgpAf::Unicast) {
-                            ProcessInet6Item(iq->node, item, iq->is_as_node);
-                        } else if (atoi(af) == BgpAf::IPv4 &&
-                            atoi(safi) == BgpAf::Mcast) {
-                            ProcessMcastItem(iq->node, item, iq->is_as_node);
-                        } else if (atoi(af) == BgpAf::L2Vpn &&
-                                   atoi(safi) == BgpAf::Enet) {
-                            ProcessEnetItem(iq->node, item, iq->is_as_node);
-                        }
-                }
+                ProcessPublish(iq, pugi);
             }
         }
     }
 }
 
+//
+// Process all the items in a publish message. The address family and
+// subsequent address family are the same for all the items, and so is the
+// routing instance. Inet, inet6 and enet items are processed as a batch.
+//
+void BgpXmppChannel::ProcessPublish(const XmppStanza::XmppMessageIq *iq,
+                                    XmlPugi *pugi) {
+    string id(iq->as_node.c_str());
+    char *str = const_cast<char *>(id.c_str());
+    char *saveptr;
+    char *af_str = strtok_r(str, "/", &saveptr);
+    char *safi_str = strtok_r(NULL, "/", &saveptr);
+    int af = af_str ? atoi(af_str) : 0;
+    int safi = safi_str ? atoi(safi_str) : 0;
+
+    Address::Family family;
+    if (af == BgpAf::IPv4 && safi == BgpAf::Unicast) {
+        family = Address::INET;
+    } else if (af == BgpAf::IPv6 && safi == BgpAf::Unicast) {
+        family = Address::INET6;
+    } else if (af == BgpAf::IPv4 && safi == BgpAf::Mcast) {
+        family = Address::ERMVPN;
+    } else if (af == BgpAf::L2Vpn && safi == BgpAf::Enet) {
+        family = Address::EVPN;
+    } else {
+        return;
+    }
+
+    RouteBatch batch(this, iq->node, family);
+    for (xml_node item = pugi->FindNode("item"); item;
+         item = item.next_sibling()) {
+        if (strcmp(item.name(), "item") != 0) continue;
+
+        switch (family) {
+        case Address::INET:
+            ProcessItem(iq->node, item, iq->is_as_node, &batch);
+            break;
+        case Address::INET6:
+            ProcessInet6Item(iq->node, item, iq->is_as_node, &batch);
+            break;
+        case Address::ERMVPN:
+            ProcessMcastItem(iq->node, item, iq->is_as_node);
+            break;
+        case Address::EVPN:
+            ProcessEnetItem(iq->node, item, iq->is_as_node, &batch);
+            break;
+        default:
+            break;
+        }
+    }
+    batch.Flush();
+}
+
 bool BgpXmppChannelManager::DeleteExecutor(BgpXmppChannel *channel) {
     if (channel->deleted()) return true;
     channel->set_deleted(true);
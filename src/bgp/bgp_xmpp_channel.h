@@ -28,6 +28,7 @@ class BgpServer;
 struct DBRequest;
 class IPeer;
 class PeerCloseManager;
+class XmlPugi;
 class XmppServer;
 class BgpXmppChannelMock;
 class BgpXmppChannelManager;
@@ -125,6 +126,7 @@ private:
     class XmppPeer;
     class PeerClose;
     class PeerStats;
+    class RouteBatch;
 
     //
     // State the instance id received in Membership subscription request
@@ -180,14 +182,20 @@ private:
     bool VerifyMembership(const std::string &vrf_name, Address::Family family,
         BgpTable **table, int *instance_id, bool *subscribe_pending);
 
-    bool ProcessItem(std::string vrf_name, const pugi::xml_node &node,
-                     bool add_change);
-    bool ProcessInet6Item(std::string vrf_name, const pugi::xml_node &node,
-                          bool add_change);
+    void ProcessPublish(const XmppStanza::XmppMessageIq *iq, XmlPugi *pugi);
+    BgpAttrPtr LocateAttr(const BgpAttrSpec &attrs, uint32_t local_pref,
+                          const IpAddress &nexthop,
+                          const ExtCommunitySpec &ext, RouteBatch *batch);
+    bool ProcessItem(const std::string &vrf_name, const pugi::xml_node &node,
+                     bool add_change, RouteBatch *batch = NULL);
+    bool ProcessInet6Item(const std::string &vrf_name,
+                          const pugi::xml_node &node, bool add_change,
+                          RouteBatch *batch = NULL);
     bool ProcessMcastItem(std::string vrf_name,
                           const pugi::xml_node &item, bool add_change);
-    bool ProcessEnetItem(std::string vrf_name,
-                         const pugi::xml_node &item, bool add_change);
+    bool ProcessEnetItem(const std::string &vrf_name,
+                         const pugi::xml_node &item, bool add_change,
+                         RouteBatch *batch = NULL);
     void PublishRTargetRoute(RoutingInstance *instance, bool add_change,
                              int index);
     void RTargetRouteOp(BgpTable *rtarget_table, as4_t asn,
@@ -40,7 +40,7 @@ struct CommunitySpec : public BgpAttribute {
     virtual size_t EncodeLength() const;
 };
 
-class Community {
+class Community : public BgpPathAttributeHash {
 public:
     enum WellKnownCommunity {
         NoExport = 0xFFFFFF01,
@@ -69,6 +69,8 @@ public:
     }
 
 private:
+    template <class, class, class, class>
+    friend class BgpPathAttributeDB;
     friend int intrusive_ptr_add_ref(const Community *ccomm);
     friend int intrusive_ptr_del_ref(const Community *ccomm);
     friend void intrusive_ptr_release(const Community *ccomm);
@@ -91,22 +93,13 @@ inline void intrusive_ptr_release(const Community *ccomm) {
     if (prev == 1) {
         Community *comm = const_cast<Community *>(ccomm);
         comm->Remove();
-        assert(comm->refcount_ == 0);
-        delete comm;
     }
 }
 
 typedef boost::intrusive_ptr<const Community> CommunityPtr;
 
-struct CommunityCompare {
-    bool operator()(const Community *lhs, const Community *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class CommunityDB : public BgpPathAttributeDB<Community, CommunityPtr,
-                                              CommunitySpec, CommunityCompare,
-                                              CommunityDB> {
+                                              CommunitySpec, CommunityDB> {
 public:
     explicit CommunityDB(BgpServer *server);
     virtual ~CommunityDB() { }
@@ -127,7 +120,7 @@ public:
     virtual std::string ToString() const;
 };
 
-class ExtCommunity {
+class ExtCommunity : public BgpPathAttributeHash {
 public:
     typedef boost::array<uint8_t, 8> ExtCommunityValue;
     typedef std::vector<ExtCommunityValue> ExtCommunityList;
@@ -246,6 +239,8 @@ public:
     }
 
 private:
+    template <class, class, class, class>
+    friend class BgpPathAttributeDB;
     friend int intrusive_ptr_add_ref(const ExtCommunity *cextcomm);
     friend int intrusive_ptr_del_ref(const ExtCommunity *cextcomm);
     friend void intrusive_ptr_release(const ExtCommunity *cextcomm);
@@ -268,22 +263,13 @@ inline void intrusive_ptr_release(const ExtCommunity *cextcomm) {
     if (prev == 1) {
         ExtCommunity *extcomm = const_cast<ExtCommunity *>(cextcomm);
         extcomm->Remove();
-        assert(extcomm->refcount_ == 0);
-        delete extcomm;
     }
 }
 
 typedef boost::intrusive_ptr<const ExtCommunity> ExtCommunityPtr;
 
-struct ExtCommunityCompare {
-    bool operator()(const ExtCommunity *lhs, const ExtCommunity *rhs) {
-        return lhs->CompareTo(*rhs) < 0;
-    }
-};
-
 class ExtCommunityDB : public BgpPathAttributeDB<ExtCommunity, ExtCommunityPtr,
                                                  ExtCommunitySpec,
-                                                 ExtCommunityCompare,
                                                  ExtCommunityDB> {
 public:
     explicit ExtCommunityDB(BgpServer *server);
@@ -10,6 +10,7 @@
 #include "base/logging.h"
 #include "base/task.h"
 #include "base/test/task_test_util.h"
+#include "base/time_util.h"
 #include "bgp/bgp_attr.h"
 #include "bgp/bgp_config.h"
 #include "bgp/bgp_log.h"
@@ -18,6 +19,7 @@
 #include "bgp/routing-instance/routing_instance.h"
 #include "control-node/control_node.h"
 #include "db/db.h"
+#include "db/db_table_walker.h"
 #include "io/event_manager.h"
 #include "testing/gunit.h"
 
@@ -75,6 +77,70 @@ protected:
         task_util::WaitForIdle();
     }
 
+    void AddRoutes(int count) {
+        BgpAttrSpec attrs;
+        BgpAttrPtr attr = server_.attr_db()->Locate(attrs);
+        for (int idx = 0; idx < count; ++idx) {
+            InetVpnPrefix prefix(RouteDistinguisher(0x01010101, 1),
+                Ip4Address(0x0a000000 + idx), 32);
+            DBRequest addReq;
+            addReq.key.reset(new InetVpnTable::RequestKey(prefix, NULL));
+            addReq.data.reset(new InetVpnTable::RequestData(attr, 0, 20));
+            addReq.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+            rib_->Enqueue(&addReq);
+        }
+    }
+
+    void DeleteRoutes(int count) {
+        for (int idx = 0; idx < count; ++idx) {
+            InetVpnPrefix prefix(RouteDistinguisher(0x01010101, 1),
+                Ip4Address(0x0a000000 + idx), 32);
+            DBRequest delReq;
+            delReq.key.reset(new InetVpnTable::RequestKey(prefix, NULL));
+            delReq.oper = DBRequest::DB_ENTRY_DELETE;
+            rib_->Enqueue(&delReq);
+        }
+    }
+
+    bool WalkEntry(DBTablePartBase *root, DBEntryBase *entry) {
+        walk_count_++;
+        return true;
+    }
+
+    bool WalkBatch(DBTablePartBase *root,
+                   const DBTableWalker::EntryBatch &batch) {
+        walk_count_ += batch.size();
+        return true;
+    }
+
+    void WalkDone(DBTableBase *table) {
+        walk_done_++;
+    }
+
+    // Start the given number of walks of the table together and return the
+    // elapsed time in usecs.
+    uint64_t TimeWalks(int walks, bool batch) {
+        DBTableWalker *walker = server_.database()->GetWalker();
+        walk_count_ = 0;
+        walk_done_ = 0;
+        uint64_t start = ClockMonotonicUsec();
+        for (int idx = 0; idx < walks; ++idx) {
+            if (batch) {
+                walker->WalkTableBatch(rib_, NULL,
+                    boost::bind(&InetVpnTableTest::WalkBatch, this, _1, _2),
+                    boost::bind(&InetVpnTableTest::WalkDone, this, _1));
+            } else {
+                walker->WalkTable(rib_, NULL,
+                    boost::bind(&InetVpnTableTest::WalkEntry, this, _1, _2),
+                    boost::bind(&InetVpnTableTest::WalkDone, this, _1));
+            }
+        }
+        TASK_UTIL_EXPECT_EQ(walks, walk_done_);
+        uint64_t elapsed = ClockMonotonicUsec() - start;
+        EXPECT_EQ(walks * rib_->Size(), walk_count_);
+        return elapsed;
+    }
+
     void VpnTableListener(DBTablePartBase *root, DBEntryBase *entry) {
         bool del_notify = entry->IsDeleted();
         if (del_notify)
@@ -91,6 +157,8 @@ protected:
 
     tbb::atomic<long> adc_notification_;
     tbb::atomic<long> del_notification_;
+    tbb::atomic<uint64_t> walk_count_;
+    tbb::atomic<int> walk_done_;
 };
 
 TEST_F(InetVpnTableTest, AllocEntryStr) {
@@ -292,6 +360,31 @@ TEST_F(InetVpnTableTest, TableNotification) {
     TASK_UTIL_EXPECT_TRUE(static_cast<BgpRoute *>(rib_->Find(&key2)) == NULL);
 }
 
+//
+// Compare the cost of per-entry, batched and coalesced walks of a table.
+// Every walk must visit every route. The times are only logged. Set
+// INETVPN_TABLE_TEST_WALK_ROUTES to 5000000 for the full scale benchmark.
+//
+TEST_F(InetVpnTableTest, WalkBenchmark) {
+    int route_count = 10000;
+    char *str = getenv("INETVPN_TABLE_TEST_WALK_ROUTES");
+    if (str) route_count = strtoul(str, NULL, 0);
+
+    AddRoutes(route_count);
+    TASK_UTIL_EXPECT_EQ(route_count, rib_->Size());
+
+    uint64_t entry_usecs = TimeWalks(1, false);
+    uint64_t batch_usecs = TimeWalks(1, true);
+    uint64_t coalesced_usecs = TimeWalks(8, true);
+    LOG(DEBUG, "Walk of " << route_count << " routes:" <<
+        " per-entry " << entry_usecs << " usecs" <<
+        " batch " << batch_usecs << " usecs" <<
+        " 8 coalesced batch walks " << coalesced_usecs << " usecs");
+
+    DeleteRoutes(route_count);
+    TASK_UTIL_EXPECT_EQ(0, rib_->Size());
+}
+
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
@@ -60,7 +60,8 @@ TableState::TableState(RoutePathReplicator *replicator, BgpTable *table)
       table_(table),
       listener_id_(DBTableBase::kInvalidId),
       deleted_(false),
-      table_delete_ref_(this, table->deleter()) {
+      table_delete_ref_(this, table->deleter()),
+      primary_routes_(table->IsVpnTable() ? 0 : DB::PartitionCount()) {
     assert(table->deleter() != NULL);
     route_count_ = 0;
 }
@@ -92,6 +93,22 @@ const RtGroup *TableState::FindGroup(RtGroup *group) const {
     return (it != list_.end() ? *it : NULL);
 }
 
+void TableState::AddPrimaryRoute(int part_id, BgpRoute *rt) const {
+    primary_routes_[part_id].insert(rt);
+}
+
+void TableState::RemovePrimaryRoute(int part_id, BgpRoute *rt) const {
+    primary_routes_[part_id].erase(rt);
+}
+
+size_t TableState::primary_route_count() const {
+    size_t count = 0;
+    BOOST_FOREACH(const RouteList &list, primary_routes_) {
+        count += list.size();
+    }
+    return count;
+}
+
 RtReplicated::RtReplicated(RoutePathReplicator *replicator)
     : replicator_(replicator) {
 }
@@ -115,6 +132,7 @@ RoutePathReplicator::RoutePathReplicator(BgpServer *server,
       family_(family),
       vpn_table_(NULL),
       vpn_ts_(NULL),
+      route_eval_lists_(DB::PartitionCount()),
       walk_trigger_(new TaskTrigger(
           boost::bind(&RoutePathReplicator::StartWalk, this),
           TaskScheduler::GetInstance()->GetTaskId("bgp::Config"), 0)),
@@ -122,6 +140,12 @@ RoutePathReplicator::RoutePathReplicator(BgpServer *server,
           boost::bind(&RoutePathReplicator::UnregisterTables, this),
           TaskScheduler::GetInstance()->GetTaskId("bgp::Config"), 0)),
       trace_buf_(SandeshTraceBufferCreate("RoutePathReplicator", 500)) {
+    for (int idx = 0; idx < DB::PartitionCount(); ++idx) {
+        route_eval_triggers_.push_back(boost::shared_ptr<TaskTrigger>(
+            new TaskTrigger(boost::bind(
+                &RoutePathReplicator::ProcessRouteEvalList, this, idx),
+            TaskScheduler::GetInstance()->GetTaskId("db::DBTable"), idx)));
+    }
 }
 
 RoutePathReplicator::~RoutePathReplicator() {
@@ -263,8 +287,9 @@ RoutePathReplicator::StartWalk() {
         const TableState *ts = FindTableState(table);
         assert(ts);
         DB *db = server()->database();
-        DBTableWalker::WalkId id = db->GetWalker()->WalkTable(table, NULL,
-            boost::bind(&RoutePathReplicator::RouteListener, this, ts, _1, _2),
+        DBTableWalker::WalkId id = db->GetWalker()->WalkTableBatch(table, NULL,
+            boost::bind(&RoutePathReplicator::RouteBatchListener, this, ts,
+                        _1, _2),
             boost::bind(&RoutePathReplicator::BulkReplicationDone, this, _1));
         it->second->SetWalkerId(id);
         it->second->SetWalkAgain(false);
@@ -272,6 +297,52 @@ RoutePathReplicator::StartWalk() {
     return true;
 }
 
+//
+// Request evaluation of the routes with primary paths in the given VRF table.
+//
+// Fall back to a walk of the table if a walk is already pending or is in
+// progress. The TableState may not have all the routes with primary paths
+// until the walk that's triggered when it's created has finished.
+//
+void RoutePathReplicator::RequestRouteEval(BgpTable *table) {
+    CHECK_CONCURRENCY("bgp::Config");
+    if (bulk_sync_.find(table) != bulk_sync_.end()) {
+        RequestWalk(table);
+        return;
+    }
+    for (int idx = 0; idx < DB::PartitionCount(); ++idx) {
+        route_eval_lists_[idx].insert(table);
+        route_eval_triggers_[idx]->Set();
+    }
+}
+
+//
+// Evaluate the routes with primary paths in the given partition for all the
+// tables on the RouteEvalList for the partition.
+//
+// The RouteListener may remove the current route from the RouteList, so the
+// iterator is advanced before invoking it.
+//
+bool RoutePathReplicator::ProcessRouteEvalList(int part_id) {
+    CHECK_CONCURRENCY("db::DBTable");
+
+    BOOST_FOREACH(BgpTable *table, route_eval_lists_[part_id]) {
+        const TableState *ts = FindTableState(table);
+        if (!ts)
+            continue;
+        DBTablePartBase *root = table->GetTablePartition(part_id);
+        const TableState::RouteList &list = ts->GetPrimaryRoutes(part_id);
+        for (TableState::RouteList::const_iterator it = list.begin(), next = it;
+             it != list.end(); it = next) {
+            ++next;
+            RouteListener(ts, root, *it);
+        }
+    }
+
+    route_eval_lists_[part_id].clear();
+    return true;
+}
+
 bool RoutePathReplicator::UnregisterTables() {
     CHECK_CONCURRENCY("bgp::Config");
     for (UnregTableList::iterator it = unreg_table_list_.begin();
@@ -301,12 +372,51 @@ RoutePathReplicator::BulkReplicationDone(DBTableBase *dbtable) {
     UnregisterTableState(table);
 }
 
+//
+// Add the BgpTable to the import tables for the RtGroup. The bit position for
+// the table is allocated when it's added to the first RtGroup.
+//
+bool RoutePathReplicator::AddImportTable(RtGroup *group, BgpTable *table) {
+    ImportTableInfo &info = import_table_map_[table];
+    if (info.refcount == 0) {
+        info.index = import_table_bitset_.find_first_clear();
+        import_table_bitset_.set(info.index);
+        if (info.index >= import_table_list_.size())
+            import_table_list_.resize(info.index + 1);
+        import_table_list_[info.index] = table;
+    }
+    const BitSet *bitset = group->GetImportTableBitSet(family());
+    if (!bitset || !bitset->test(info.index))
+        info.refcount++;
+    return group->AddImportTable(family(), table, info.index);
+}
+
+//
+// Remove the BgpTable from the import tables for the RtGroup. The bit position
+// for the table is released when it's removed from the last RtGroup.
+//
+void RoutePathReplicator::RemoveImportTable(RtGroup *group, BgpTable *table) {
+    ImportTableMap::iterator loc = import_table_map_.find(table);
+    if (loc == import_table_map_.end())
+        return;
+    ImportTableInfo &info = loc->second;
+    const BitSet *bitset = group->GetImportTableBitSet(family());
+    if (!bitset || !bitset->test(info.index))
+        return;
+    group->RemoveImportTable(family(), table, info.index);
+    if (--info.refcount > 0)
+        return;
+    import_table_bitset_.reset(info.index);
+    import_table_list_[info.index] = NULL;
+    import_table_map_.erase(loc);
+}
+
 void RoutePathReplicator::JoinVpnTable(RtGroup *group) {
     CHECK_CONCURRENCY("bgp::Config");
     if (!vpn_ts_ || vpn_ts_->FindGroup(group))
         return;
     RPR_TRACE(TableJoin, vpn_table_->name(), group->rt().ToString(), true);
-    group->AddImportTable(family(), vpn_table_);
+    AddImportTable(group, vpn_table_);
     RPR_TRACE(TableJoin, vpn_table_->name(), group->rt().ToString(), false);
     group->AddExportTable(family(), vpn_table_);
     AddTableState(vpn_table_, group);
@@ -317,7 +427,7 @@ void RoutePathReplicator::LeaveVpnTable(RtGroup *group) {
     if (!vpn_ts_)
         return;
     RPR_TRACE(TableLeave, vpn_table_->name(), group->rt().ToString(), true);
-    group->RemoveImportTable(family(), vpn_table_);
+    RemoveImportTable(group, vpn_table_);
     RPR_TRACE(TableLeave, vpn_table_->name(), group->rt().ToString(), false);
     group->RemoveExportTable(family(), vpn_table_);
     RemoveTableState(vpn_table_, group);
@@ -338,14 +448,14 @@ void RoutePathReplicator::Join(BgpTable *table, const RouteTarget &rt,
     bool first = false;
     RtGroup *group = server()->rtarget_group_mgr()->LocateRtGroup(rt);
     if (import) {
-        first = group->AddImportTable(family(), table);
+        first = AddImportTable(group, table);
         server()->rtarget_group_mgr()->NotifyRtGroup(rt);
         if (family_ == Address::INETVPN)
             server_->NotifyAllStaticRoutes();
         BOOST_FOREACH(BgpTable *sec_table, group->GetExportTables(family())) {
             if (sec_table->IsVpnTable() || sec_table->empty())
                 continue;
-            RequestWalk(sec_table);
+            RequestRouteEval(sec_table);
         }
         walk_trigger_->Set();
     } else {
@@ -376,14 +486,14 @@ void RoutePathReplicator::Leave(BgpTable *table, const RouteTarget &rt,
     RPR_TRACE(TableLeave, table->name(), rt.ToString(), import);
 
     if (import) {
-        group->RemoveImportTable(family(), table);
+        RemoveImportTable(group, table);
         server()->rtarget_group_mgr()->NotifyRtGroup(rt);
         if (family_ == Address::INETVPN)
             server_->NotifyAllStaticRoutes();
         BOOST_FOREACH(BgpTable *sec_table, group->GetExportTables(family())) {
             if (sec_table->IsVpnTable() || sec_table->empty())
                 continue;
-            RequestWalk(sec_table);
+            RequestRouteEval(sec_table);
         }
         walk_trigger_->Set();
     } else {
@@ -468,6 +578,19 @@ static ExtCommunityPtr UpdateExtCommunity(BgpServer *server,
     return ExtCommunityPtr(ext_community);
 }
 
+//
+// Return true if the route has at least one path that's not a secondary path.
+//
+static bool HasPrimaryPath(BgpRoute *rt) {
+    for (Route::PathList::iterator it = rt->GetPathList().begin();
+         it != rt->GetPathList().end(); ++it) {
+        const BgpPath *path = static_cast<const BgpPath *>(it.operator->());
+        if (!path->IsReplicated())
+            return true;
+    }
+    return false;
+}
+
 //
 // Concurrency: Called in the context of the DB partition task.
 //
@@ -480,6 +603,23 @@ static ExtCommunityPtr UpdateExtCommunity(BgpServer *server,
 // If primary table is a VRF table attach it's export targets to replicated
 // path in the VPN table.
 //
+//
+// Walker function for the bulk replication walk of a table. RouteListener
+// never removes the route it is given from the table: secondary paths are
+// deleted from other tables and the removal of a route whose DBState is
+// cleared is deferred to the DBPartition queue.
+//
+bool RoutePathReplicator::RouteBatchListener(const TableState *ts,
+    DBTablePartBase *root, const DBTableWalker::EntryBatch &batch) {
+    CHECK_CONCURRENCY("db::DBTable");
+
+    for (DBTableWalker::EntryBatch::const_iterator it = batch.begin();
+         it != batch.end(); ++it) {
+        RouteListener(ts, root, *it);
+    }
+    return true;
+}
+
 bool RoutePathReplicator::RouteListener(const TableState *ts,
     DBTablePartBase *root, DBEntryBase *entry) {
     CHECK_CONCURRENCY("db::DBTable");
@@ -498,6 +638,8 @@ bool RoutePathReplicator::RouteListener(const TableState *ts,
 
     // Cleanup if the route is not usable.
     if (!rt->IsUsable()) {
+        if (!table->IsVpnTable())
+            ts->RemovePrimaryRoute(root->index(), rt);
         if (!dbstate) {
             return true;
         }
@@ -505,6 +647,19 @@ bool RoutePathReplicator::RouteListener(const TableState *ts,
         return true;
     }
 
+    // Update the list of routes with primary paths for a VRF table. There's
+    // nothing to do if the route only has secondary paths and has never had
+    // any of its paths replicated.
+    if (!table->IsVpnTable()) {
+        if (HasPrimaryPath(rt)) {
+            ts->AddPrimaryRoute(root->index(), rt);
+        } else {
+            ts->RemovePrimaryRoute(root->index(), rt);
+            if (!dbstate)
+                return true;
+        }
+    }
+
     // Create and set new DBState on the route.  This will get cleaned up via
     // via the call to DBStateSync if we don't need to replicate the route to
     // any tables.
@@ -551,10 +706,10 @@ bool RoutePathReplicator::RouteListener(const TableState *ts,
         // Go through all extended communities.
         //
         // Get the vn_index from the OriginVn extended community.
-        // For each RouteTarget extended community, get the list of tables
-        // to which we need to replicate the path.
+        // For each RouteTarget extended community, add the bit positions of
+        // the tables to which we need to replicate the path.
         int vn_index = 0;
-        RtGroup::RtGroupMemberList secondary_tables;
+        BitSet secondary_tables;
         BOOST_FOREACH(const ExtCommunity::ExtCommunityValue &comm,
                       ext_community->communities()) {
             if (ExtCommunity::is_origin_vn(comm)) {
@@ -565,16 +720,16 @@ bool RoutePathReplicator::RouteListener(const TableState *ts,
                     server()->rtarget_group_mgr()->GetRtGroup(comm);
                 if (!group)
                     continue;
-                RtGroup::RtGroupMemberList import_list =
-                    group->GetImportTables(family());
-                if (import_list.empty())
+                const BitSet *import_tables =
+                    group->GetImportTableBitSet(family());
+                if (!import_tables)
                     continue;
-                secondary_tables.insert(import_list.begin(), import_list.end());
+                secondary_tables |= *import_tables;
             }
         }
 
         // Skip if we don't need to replicate the path to any tables.
-        if (secondary_tables.empty())
+        if (secondary_tables.none())
             continue;
 
         // Add OriginVn when replicating self-originated routes from a VRF.
@@ -587,7 +742,10 @@ bool RoutePathReplicator::RouteListener(const TableState *ts,
         }
 
         // Replicate path to all destination tables.
-        BOOST_FOREACH(BgpTable *dest, secondary_tables) {
+        for (size_t idx = secondary_tables.find_first();
+             idx != BitSet::npos; idx = secondary_tables.find_next(idx)) {
+            BgpTable *dest = import_table_list_[idx];
+
             // Skip if destination is same as source table.
             if (dest == table)
                 continue;
@@ -6,6 +6,7 @@
 #define SRC_BGP_ROUTING_INSTANCE_ROUTEPATH_REPLICATOR_H_
 
 #include <boost/ptr_container/ptr_map.hpp>
+#include <boost/shared_ptr.hpp>
 #include <sandesh/sandesh_trace.h>
 #include <tbb/mutex.h>
 
@@ -13,7 +14,9 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
+#include "base/bitset.h"
 #include "base/util.h"
 #include "bgp/bgp_table.h"
 #include "bgp/community.h"
@@ -46,9 +49,21 @@ class TaskTrigger;
 // is required for VPN table since we do not walk the entire VPN table when
 // doing Leave processing for VRF import targets.
 //
+// The PartitionRouteList keeps track of the routes in a VRF table that have
+// at least one primary path, with a separate RouteList per DB partition.
+// Every primary path in a VRF table carries all the export targets of the
+// VRF, so this is the list of routes that depend on any one of the export
+// targets. It's used to re-evaluate just these routes, instead of walking
+// the entire table, when an import target is added to or removed from some
+// other table. The lists are updated from the db::DBTable task for the
+// partition and are not maintained for the VPN table since the RtGroups
+// already keep track of the VPN routes that depend on each target.
+//
 class TableState {
 public:
     typedef std::set<RtGroup *> GroupList;
+    typedef std::set<BgpRoute *> RouteList;
+    typedef std::vector<RouteList> PartitionRouteList;
 
     TableState(RoutePathReplicator *replicator, BgpTable *table);
     ~TableState();
@@ -62,6 +77,13 @@ public:
     bool empty() const { return list_.empty(); }
     bool deleted() const { return deleted_; }
 
+    void AddPrimaryRoute(int part_id, BgpRoute *rt) const;
+    void RemovePrimaryRoute(int part_id, BgpRoute *rt) const;
+    const RouteList &GetPrimaryRoutes(int part_id) const {
+        return primary_routes_[part_id];
+    }
+    size_t primary_route_count() const;
+
     uint32_t route_count() const { return route_count_; }
     uint32_t increment_route_count() const {
         return route_count_.fetch_and_increment();
@@ -83,6 +105,7 @@ private:
     bool deleted_;
     LifetimeRef<TableState> table_delete_ref_;
     GroupList list_;
+    mutable PartitionRouteList primary_routes_;
 
     DISALLOW_COPY_AND_ASSIGN(TableState);
 };
@@ -210,17 +233,23 @@ private:
 // 1. When an export target is added to or removed from a VRF table, walk all
 //    routes in the VRF table to re-evaluate the new set of secondary paths.
 //    The DBTableWalker provides this functionality.
-// 2. When an import target is added to or removed from a VRF table, walk all
-//    VRF tables that have the target in question as an export target.  The
-//    list of tables that export a target is maintained in the RTargetGroupMgr.
-//    This list is updated by the replicator (by calling RTargetGroupMgr APIs)
-//    based on configuration changes in the routing instance.
+// 2. When an import target is added to or removed from a VRF table, evaluate
+//    the routes with primary paths in all VRF tables that have the target in
+//    question as an export target.  The list of tables that export a target
+//    is maintained in the RTargetGroupMgr. This list is updated by the
+//    replicator (by calling RTargetGroupMgr APIs) based on configuration
+//    changes in the routing instance. The routes with primary paths are kept
+//    in the TableState and are evaluated from the db::DBTable task for each
+//    partition, unless a walk of the table is already pending.
 // 3. When an import target is added to or removed from a VRF tables, walk all
 //    VPN routes with the target in question.  This dependency is maintained
 //    by RTargetGroupMgr.
 // 4. When a route is updated, calculate new set of secondary paths by going
 //    through all VRF tables that import one of the targets for the route in
-//    question.  The list of VRF tables is obtained from the RTargetGroupMgr.
+//    question.  Each table that imports a target is assigned a bit position
+//    by the replicator and each RtGroup has a BitSet of the positions of the
+//    tables that import the target. The set of secondary tables for a path
+//    is the union of the BitSets of the RtGroups for its targets.
 // 5. When a route is updated, remove secondary paths that are not required
 //    anymore.  The list of previous secondary paths for a primary route is
 //    maintained using RtReplicated and reconciled/synchronized with the new
@@ -241,6 +270,10 @@ private:
 // TableState. Requests are enqueued from the db::DBTable task when a table
 // walk finishes and the TableState is empty.
 //
+// The RouteEvalLists keep track of the tables whose routes with primary paths
+// need to be evaluated, one list per DB partition. They are added to from the
+// bgp::Config task and processed from the db::DBTable task for the partition.
+//
 class RoutePathReplicator {
 public:
     RoutePathReplicator(BgpServer *server, Address::Family family);
@@ -263,9 +296,21 @@ private:
     typedef std::map<BgpTable *, TableState *> TableStateList;
     typedef std::map<BgpTable *, BulkSyncState *> BulkSyncOrders;
     typedef std::set<BgpTable *> UnregTableList;
+    typedef std::set<BgpTable *> RouteEvalList;
+
+    // Bit position of an import table and the number of RtGroups for the
+    // targets that it imports.
+    struct ImportTableInfo {
+        ImportTableInfo() : index(0), refcount(0) { }
+        size_t index;
+        uint32_t refcount;
+    };
+    typedef std::map<BgpTable *, ImportTableInfo> ImportTableMap;
 
     bool StartWalk();
     void RequestWalk(BgpTable *table);
+    void RequestRouteEval(BgpTable *table);
+    bool ProcessRouteEvalList(int part_id);
     void BulkReplicationDone(DBTableBase *dbtable);
     bool UnregisterTables();
 
@@ -279,8 +324,13 @@ private:
     void JoinVpnTable(RtGroup *group);
     void LeaveVpnTable(RtGroup *group);
 
+    bool AddImportTable(RtGroup *group, BgpTable *table);
+    void RemoveImportTable(RtGroup *group, BgpTable *table);
+
     bool RouteListener(const TableState *ts, DBTablePartBase *root,
                        DBEntryBase *entry);
+    bool RouteBatchListener(const TableState *ts, DBTablePartBase *root,
+                            const DBTableWalker::EntryBatch &batch);
     void DeleteSecondaryPath(BgpTable  *table, BgpRoute *rt,
                              const RtReplicated::SecondaryRouteInfo &rtinfo);
     void DBStateSync(BgpTable *table, const TableState *ts, BgpRoute *rt,
@@ -305,6 +355,11 @@ private:
     Address::Family family_;
     BgpTable *vpn_table_;
     TableState *vpn_ts_;
+    ImportTableMap import_table_map_;
+    std::vector<BgpTable *> import_table_list_;
+    BitSet import_table_bitset_;
+    std::vector<RouteEvalList> route_eval_lists_;
+    std::vector<boost::shared_ptr<TaskTrigger> > route_eval_triggers_;
     boost::scoped_ptr<TaskTrigger> walk_trigger_;
     boost::scoped_ptr<TaskTrigger> unreg_trigger_;
     SandeshTraceBufferPtr trace_buf_;
@@ -37,9 +37,17 @@ const RtGroup::RtGroupMemberList RtGroup::GetExportTables(
     return loc->second;
 }
 
-bool RtGroup::AddImportTable(Address::Family family, BgpTable *tbl) {
+const BitSet *RtGroup::GetImportTableBitSet(Address::Family family) const {
+    RtGroupMemberBitSets::const_iterator loc = import_bitsets_.find(family);
+    if (loc == import_bitsets_.end()) return NULL;
+    return &loc->second;
+}
+
+bool RtGroup::AddImportTable(Address::Family family, BgpTable *tbl,
+    size_t index) {
     bool first = import_[family].empty();
     import_[family].insert(tbl);
+    import_bitsets_[family].set(index);
     return first;
 }
 
@@ -49,8 +57,10 @@ bool RtGroup::AddExportTable(Address::Family family, BgpTable *tbl) {
     return first;
 }
 
-bool RtGroup::RemoveImportTable(Address::Family family, BgpTable *tbl) {
+bool RtGroup::RemoveImportTable(Address::Family family, BgpTable *tbl,
+    size_t index) {
     import_[family].erase(tbl);
+    import_bitsets_[family].reset(index);
     return import_[family].empty();
 }
 
@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 
+#include "base/bitset.h"
 #include "bgp/bgp_table.h"
 #include "bgp/rtarget/rtarget_address.h"
 
@@ -27,7 +28,11 @@ class RtGroupInterestedPeerSet : public BitSet {
 //
 // 1. The RtGroupMembers map and the RtGroupMemberList set are used to keep
 //    per address family lists of import and export BgpTables. The lists are
-//    updated from the RoutePathReplicator.
+//    updated from the RoutePathReplicator.  The RtGroupMemberBitSets map has
+//    the same import tables as a BitSet for each address family. The bit
+//    positions are assigned by the RoutePathReplicator for the family, so
+//    that it can combine the import tables for multiple RouteTargets without
+//    building sets of BgpTables.
 //
 // 2. The RTargetDepRouteList and the RouteList are used to maintain a per
 //    partition list of dependent BgpRoutes i.e. routes with the RouteTarget
@@ -58,6 +63,7 @@ class RtGroup {
 public:
     typedef std::set<BgpTable *> RtGroupMemberList;
     typedef std::map<Address::Family, RtGroupMemberList> RtGroupMembers;
+    typedef std::map<Address::Family, BitSet> RtGroupMemberBitSets;
     typedef std::set<BgpRoute *> RouteList;
     typedef std::vector<RouteList> RTargetDepRouteList;
     typedef std::set<RTargetRoute *> RTargetRouteList;
@@ -69,10 +75,12 @@ public:
 
     const RtGroupMemberList GetImportTables(Address::Family family) const;
     const RtGroupMemberList GetExportTables(Address::Family family) const;
+    const BitSet *GetImportTableBitSet(Address::Family family) const;
 
-    bool AddImportTable(Address::Family family, BgpTable *tbl);
+    bool AddImportTable(Address::Family family, BgpTable *tbl, size_t index);
     bool AddExportTable(Address::Family family, BgpTable *tbl);
-    bool RemoveImportTable(Address::Family family, BgpTable *tbl);
+    bool RemoveImportTable(Address::Family family, BgpTable *tbl,
+                           size_t index);
     bool RemoveExportTable(Address::Family family, BgpTable *tbl);
     bool HasImportExportTables(Address::Family family) const;
     bool HasImportExportTables() const;
@@ -103,6 +111,7 @@ private:
 
     RouteTarget rt_;
     RtGroupMembers import_;
+    RtGroupMemberBitSets import_bitsets_;
     RtGroupMembers export_;
     RTargetDepRouteList dep_;
     InterestedPeerList peer_list_;
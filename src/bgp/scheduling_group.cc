@@ -28,6 +28,7 @@ using std::swap;
 using std::vector;
 
 int SchedulingGroup::send_task_id_ = -1;
+int SchedulingGroup::max_workers_ = -1;
 
 //
 // This struct represents RibOut specific state for a PeerState.  There's one
@@ -411,8 +412,9 @@ public:
     virtual bool Run() {
         CHECK_CONCURRENCY("bgp::SendTask");
 
+        GroupPeerSet peers;
         while (true) {
-            auto_ptr<WorkBase> wentry = group_->WorkDequeue();
+            auto_ptr<WorkBase> wentry = group_->WorkDequeue(this, &peers);
             if (wentry.get() == NULL) {
                 break;
             }
@@ -441,11 +443,9 @@ private:
 };
 
 SchedulingGroup::SchedulingGroup()
-    : running_(false),
-      disabled_(false),
+    : disabled_(false),
       split_disabled_(false),
-      member_count_(0),
-      worker_task_(NULL) {
+      member_count_(0) {
     if (send_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         send_task_id_ = scheduler->GetTaskId("bgp::SendTask");
@@ -453,10 +453,35 @@ SchedulingGroup::SchedulingGroup()
 }
 
 SchedulingGroup::~SchedulingGroup() {
-    if (worker_task_) {
-        TaskScheduler *scheduler = TaskScheduler::GetInstance();
-        scheduler->Cancel(worker_task_);
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    for (WorkerList::iterator iter = workers_.begin();
+         iter != workers_.end(); ++iter) {
+        scheduler->Cancel(*iter);
+    }
+}
+
+//
+// Maximum number of Workers per SchedulingGroup. Defaults to the number of
+// hardware threads, capped at kMaxWorkers, and can be overridden with the
+// BGP_SCHEDULING_GROUP_MAX_WORKERS environment variable.
+//
+int SchedulingGroup::max_workers() {
+    if (max_workers_ == -1) {
+        int max_workers =
+            TaskScheduler::GetInstance()->HardwareThreadCount();
+        char *str = getenv("BGP_SCHEDULING_GROUP_MAX_WORKERS");
+        if (str)
+            max_workers = strtol(str, NULL, 0);
+        max_workers_ = std::max(1, std::min(max_workers, kMaxWorkers));
     }
+    return max_workers_;
+}
+
+//
+// For unit testing.
+//
+void SchedulingGroup::set_max_workers(int max_workers) {
+    max_workers_ = std::max(1, max_workers);
 }
 
 void SchedulingGroup::clear() {
@@ -652,8 +677,10 @@ void SchedulingGroup::Merge(SchedulingGroup *rhs) {
 
     // Finally transfer the work queue from the old SchedulingGroup to this
     // one and clear the old SchedulingGroup. It's the caller responsibility
-    // to delete the old SchedulingGroup.
+    // to delete the old SchedulingGroup, which also cancels its Workers.
+    tbb::mutex::scoped_lock lock(mutex_);
     work_queue_.transfer(work_queue_.end(), rhs->work_queue_);
+    MaybeStartWorker();
     rhs->clear();
 }
 
@@ -737,6 +764,9 @@ void SchedulingGroup::Split(SchedulingGroup *rhs, const RibOutList &rg1,
             rhs->work_queue_.transfer(rhs->work_queue_.end(), loc, work_queue_);
         }
     }
+
+    tbb::mutex::scoped_lock lock(rhs->mutex_);
+    rhs->MaybeStartWorker();
 }
 
 //
@@ -826,30 +856,93 @@ bool SchedulingGroup::IsSendReady(IPeerUpdate *peer) const {
 // Create a Worker if warranted and enqueue it to the TaskScheduler.
 // Assumes that the caller holds the SchedulingGroup mutex.
 //
+// A new Worker is started if there are more entries in the work queue than
+// Workers, up to the maximum number of Workers. Extra Workers that can't find
+// an entry that's independent of the ones being processed simply exit.
+//
 void SchedulingGroup::MaybeStartWorker() {
-    if (!running_ && !disabled_) {
-        worker_task_ = new Worker(this);
-        TaskScheduler *scheduler = TaskScheduler::GetInstance();
-        scheduler->Enqueue(worker_task_);
-        running_ = true;
+    if (disabled_)
+        return;
+    if (work_queue_.size() <= workers_.size())
+        return;
+    if (workers_.size() >= static_cast<size_t>(max_workers()))
+        return;
+
+    Worker *worker = new Worker(this);
+    workers_.push_back(worker);
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Enqueue(worker);
+}
+
+//
+// Build the GroupPeerSet of IPeers whose state may be accessed when the
+// WorkBase entry is processed. Invalid entries don't touch any IPeers.
+//
+void SchedulingGroup::GetWorkPeerSet(const WorkBase *wentry,
+                                     GroupPeerSet *peers) const {
+    peers->clear();
+    if (!wentry->valid)
+        return;
+
+    switch (wentry->type) {
+    case WorkBase::WRibOut: {
+        const WorkRibOut *workrib = static_cast<const WorkRibOut *>(wentry);
+        RibState *rs = rib_state_imap_.Find(workrib->ribout);
+        if (rs)
+            peers->Set(rs->peer_set());
+        break;
+    }
+    case WorkBase::WPeer: {
+        const WorkPeer *workpeer = static_cast<const WorkPeer *>(wentry);
+        PeerState *ps = peer_state_imap_.Find(workpeer->peer);
+        if (!ps)
+            break;
+        for (PeerState::iterator iter = ps->begin(rib_state_imap_);
+             iter != ps->end(rib_state_imap_); ++iter) {
+            peers->Set(iter.rib_state()->peer_set());
+        }
+        break;
+    }
     }
 }
 
 //
-// Dequeue the first WorkBase item from the work queue and return an
-// auto_ptr to it.  Clear out Worker related state if the work queue
-// is empty.
+// Release the IPeers used by the previous WorkBase item processed by the
+// Worker and dequeue the first WorkBase item that can be processed without
+// touching IPeers that are in use by other Workers or by earlier items on
+// the work queue. Return an auto_ptr to the item and fill in the IPeers it
+// uses.
+//
+// Clear out Worker related state if there's no such item.
 //
-auto_ptr<SchedulingGroup::WorkBase> SchedulingGroup::WorkDequeue() {
+auto_ptr<SchedulingGroup::WorkBase> SchedulingGroup::WorkDequeue(
+        Worker *worker, GroupPeerSet *peers) {
     CHECK_CONCURRENCY("bgp::SendTask");
 
     tbb::mutex::scoped_lock lock(mutex_);
+    busy_peers_.Reset(*peers);
+    peers->clear();
+
     auto_ptr<WorkBase> wentry;
-    if (work_queue_.empty()) {
-        worker_task_ = NULL;
-        running_ = false;
+    GroupPeerSet skipped;
+    size_t count = 0;
+    for (WorkQueue::iterator iter = work_queue_.begin();
+         iter != work_queue_.end() && count < kMaxWorkScan; ++iter, ++count) {
+        GroupPeerSet wpeers;
+        GetWorkPeerSet(iter.operator->(), &wpeers);
+        if (!wpeers.intersects(busy_peers_) && !wpeers.intersects(skipped)) {
+            busy_peers_.Set(wpeers);
+            *peers = wpeers;
+            wentry.reset(work_queue_.release(iter).release());
+            break;
+        }
+        skipped.Set(wpeers);
+    }
+
+    if (wentry.get() == NULL) {
+        workers_.remove(worker);
     } else {
-        wentry.reset(work_queue_.pop_front().release());
+        MaybeStartWorker();
     }
     return wentry;
 }
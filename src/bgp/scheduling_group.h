@@ -50,11 +50,21 @@ class GroupPeerSet : public BitSet {
 // to a peer dequeue.
 //
 // A mutex is used to control access to the WorkQueue between producers that
-// need to enqueue WorkBase entries and the Worker which dequeues the entries
-// and processes them. The producers are the BgpExport class which creates a
+// need to enqueue WorkBase entries and the Workers which dequeue the entries
+// and process them. The producers are the BgpExport class which creates a
 // WorkRibOut entry after adding a RouteUpdate to an empty UpdateQueue, and
 // the IPeer class which create a WorkPeer entry when it becomes unblocked.
 //
+// Since all XMPP peers tend to end up in a single large SchedulingGroup, up
+// to max_workers() Workers can drain the WorkQueue concurrently. Each WorkBase
+// entry touches a known set of IPeers i.e. all the IPeers of the RibOut for a
+// WorkRibOut and all the IPeers of all the RibOuts of the IPeer for WorkPeer.
+// A Worker only picks an entry if none of the IPeers it touches are in use by
+// another Worker or by an earlier entry that is still on the WorkQueue. This
+// preserves the order of updates to any given IPeer and guarantees that the
+// RibState and PeerState for a (RibOut, IPeer) are only accessed by a single
+// Worker at a time.
+//
 class SchedulingGroup {
 public:
     static const uint32_t kSplitThreshold = 8192;
@@ -116,6 +126,9 @@ public:
     // For unit testing.
     void set_disabled(bool disabled);
 
+    static int max_workers();
+    static void set_max_workers(int max_workers);
+
 private:
     friend class RibOutUpdatesTest;
     friend class BgpUpdateTest;
@@ -155,12 +168,19 @@ private:
     class Worker;
     struct PeerRibState;
 
+    // Maximum number of WorkQueue entries examined to find one that can be
+    // processed concurrently with the ones being processed by other Workers.
+    static const size_t kMaxWorkScan = 64;
+    static const int kMaxWorkers = 8;
+
+    typedef std::list<Worker *> WorkerList;
     typedef boost::ptr_list<WorkBase> WorkQueue;
     typedef IndexMap<IPeerUpdate *, PeerState, GroupPeerSet> PeerStateMap;
     typedef IndexMap<RibOut *, RibState> RibStateMap;
 
     void MaybeStartWorker();
-    std::auto_ptr<WorkBase> WorkDequeue();
+    void GetWorkPeerSet(const WorkBase *wentry, GroupPeerSet *peers) const;
+    std::auto_ptr<WorkBase> WorkDequeue(Worker *worker, GroupPeerSet *peers);
     void WorkEnqueue(WorkBase *wentry);
     void WorkPeerEnqueue(IPeerUpdate *peer);
     void WorkRibOutEnqueue(RibOut *ribout, int queue_id);
@@ -193,17 +213,18 @@ private:
 
     // The mutex controls access to WorkQueue and related Worker state.
     tbb::mutex mutex_;
-    bool running_;
     bool disabled_;
     bool split_disabled_;
     uint32_t member_count_;
     WorkQueue work_queue_;
-    Worker *worker_task_;
+    WorkerList workers_;
+    GroupPeerSet busy_peers_;
 
     PeerStateMap peer_state_imap_;
     RibStateMap rib_state_imap_;
 
     static int send_task_id_;
+    static int max_workers_;
 
     DISALLOW_COPY_AND_ASSIGN(SchedulingGroup);
 };
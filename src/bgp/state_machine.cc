@@ -319,16 +319,24 @@ struct EvBgpNotification : sc::event<EvBgpNotification> {
     boost::shared_ptr<const BgpProto::Notification> msg;
 };
 
+//
+// The UPDATE comes either from the generic decoder in msg or from the
+// BgpUpdateDecoder in update.
+//
 struct EvBgpUpdate : sc::event<EvBgpUpdate> {
     EvBgpUpdate(BgpSession *session, const BgpProto::Update *msg,
         size_t msgsize) : session(session), msg(msg), msgsize(msgsize) {
     }
+    EvBgpUpdate(BgpSession *session, const BgpUpdateDecoderPtr &update)
+        : session(session), update(update), msgsize(update->size()) {
+    }
     static const char *Name() {
         return "EvBgpUpdate";
     }
 
     BgpSession *session;
     boost::shared_ptr<const BgpProto::Update> msg;
+    BgpUpdateDecoderPtr update;
     size_t msgsize;
 };
 
@@ -1060,7 +1068,12 @@ struct Established : sc::state<Established, StateMachine> {
     sc::result react(const EvBgpUpdate &event) {
         StateMachine *state_machine = &context<StateMachine>();
         state_machine->StartHoldTimer();
-        state_machine->peer()->ProcessUpdate(event.msg.get(), event.msgsize);
+        if (event.update) {
+            state_machine->peer()->ProcessUpdate(event.update.get());
+        } else {
+            state_machine->peer()->ProcessUpdate(event.msg.get(),
+                event.msgsize);
+        }
         return discard_event();
     }
 };
@@ -1501,6 +1514,27 @@ void StateMachine::OnMessage(BgpSession *session, BgpProto::BgpMessage *msg,
     delete msg;
 }
 
+//
+// Handle incoming UPDATE decoded by the BgpUpdateDecoder.
+//
+void StateMachine::OnMessage(BgpSession *session,
+    const BgpUpdateDecoderPtr &update) {
+    BgpPeer *peer = NULL;
+    if (session)
+        peer = session->peer();
+    if (peer)
+        peer->inc_rx_update();
+
+    std::string data;
+    int subcode;
+    if (peer && (subcode = update->Validate(peer, &data))) {
+        Enqueue(fsm::EvBgpUpdateError(session, subcode, data));
+        peer->inc_update_error();
+    } else {
+        Enqueue(fsm::EvBgpUpdate(session, update));
+    }
+}
+
 //
 // Handle errors in incoming message on the session.
 //
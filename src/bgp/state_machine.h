@@ -13,6 +13,7 @@
 #include "base/queue_task.h"
 #include "base/timer.h"
 #include "bgp/bgp_proto.h"
+#include "bgp/bgp_update_decoder.h"
 #include "io/tcp_session.h"
 #include "sandesh/sandesh.h"
 
@@ -132,6 +133,7 @@ public:
 
     void OnMessage(BgpSession *session, BgpProto::BgpMessage *msg,
         size_t msgsize = 0);
+    void OnMessage(BgpSession *session, const BgpUpdateDecoderPtr &update);
     void OnMessageError(BgpSession *session, const ParseErrorContext *context);
 
     void SendNotificationAndClose(BgpSession *session,
@@ -12,6 +12,7 @@
 #include "base/logging.h"
 #include "base/task.h"
 #include "base/test/task_test_util.h"
+#include "base/time_util.h"
 #include "bgp/bgp_log.h"
 #include "bgp/bgp_server.h"
 #include "bgp/evpn/evpn_route.h"
@@ -2194,6 +2195,86 @@ TEST_F(BgpAttrTest, EdgeForwardingDBConcurrency) {
                     EdgeForwardingSpec>(edge_forwarding_db_);
 }
 
+//
+// Benchmark Locate throughput when a number of threads parse a full table
+// feed concurrently. Each route in the feed carries one of a smaller set of
+// distinct attributes, like a typical internet table, so most lookups find
+// an existing attribute.
+//
+struct LocateBenchmarkArgs {
+    BgpAttrDB *attr_db;
+    int first_route;
+    int attr_count;
+    vector<BgpAttrPtr> attrs;
+};
+
+static void *LocateBenchmarkThreadRun(void *objp) {
+    LocateBenchmarkArgs *args = reinterpret_cast<LocateBenchmarkArgs *>(objp);
+    for (size_t idx = 0; idx < args->attrs.size(); ++idx) {
+        int attr_index = (args->first_route + idx) % args->attr_count;
+        BgpAttrSpec attr_spec;
+        BgpAttrNextHop nexthop(0x0a000001 + attr_index % 64);
+        attr_spec.push_back(&nexthop);
+        BgpAttrLocalPref local_pref(100);
+        attr_spec.push_back(&local_pref);
+        AsPathSpec aspath;
+        AsPathSpec::PathSegment *ps = new AsPathSpec::PathSegment;
+        ps->path_segment_type = AsPathSpec::PathSegment::AS_SEQUENCE;
+        ps->path_segment.push_back(64512);
+        ps->path_segment.push_back(1000 + attr_index);
+        aspath.path_segments.push_back(ps);
+        attr_spec.push_back(&aspath);
+        CommunitySpec community;
+        community.communities.push_back(0xFDE80000 + attr_index % 256);
+        attr_spec.push_back(&community);
+        args->attrs[idx] = args->attr_db->Locate(attr_spec);
+    }
+    return NULL;
+}
+
+TEST_F(BgpAttrTest, LocateBenchmark) {
+    int thread_count = 32;
+    int route_count = 320000;
+    int attr_count = 20000;
+    char *str = getenv("BGP_ATTR_TEST_LOCATE_ROUTES");
+    if (str) route_count = strtoul(str, NULL, 0);
+
+    int thread_routes = route_count / thread_count;
+    route_count = thread_routes * thread_count;
+    vector<LocateBenchmarkArgs> args(thread_count);
+    vector<pthread_t> thread_ids;
+    uint64_t start = ClockMonotonicUsec();
+    for (int i = 0; i < thread_count; i++) {
+        pthread_t tid;
+        args[i].attr_db = attr_db_;
+        args[i].first_route = i * thread_routes;
+        args[i].attr_count = attr_count;
+        args[i].attrs.resize(thread_routes);
+        if (!pthread_create(&tid, NULL, &LocateBenchmarkThreadRun, &args[i]))
+            thread_ids.push_back(tid);
+    }
+    BOOST_FOREACH(pthread_t tid, thread_ids) { pthread_join(tid, NULL); }
+    uint64_t elapsed = ClockMonotonicUsec() - start;
+
+    LOG(DEBUG, "Located " << route_count << " attributes from " <<
+        thread_count << " threads in " << elapsed << " usecs, " <<
+        (uint64_t) route_count * 1000000 / std::max<uint64_t>(elapsed, 1) <<
+        " locates/sec");
+    EXPECT_EQ(std::min(route_count, attr_count), attr_db_->Size());
+    EXPECT_EQ(std::min(route_count, attr_count), aspath_db_->Size());
+    EXPECT_EQ(std::min(route_count, 256), comm_db_->Size());
+
+    // Routes with the same attribute contents must share the attribute,
+    // whichever thread located it. Route N carries the same attribute as
+    // route N % attr_count.
+    for (int route = 0; route < route_count; route++) {
+        int first = route % attr_count;
+        EXPECT_EQ(
+            args[first / thread_routes].attrs[first % thread_routes].get(),
+            args[route / thread_routes].attrs[route % thread_routes].get());
+    }
+}
+
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
@@ -185,6 +185,131 @@ TEST_F(BgpMsgBuilderTest, Build) {
     delete ext_community;
     delete result;
 }
+
+//
+// Messages built via the table's attribute cache must be identical to the
+// ones encoded from scratch, whichever RibOut builds them.
+//
+TEST_F(BgpMsgBuilderTest, AttrCache) {
+    BgpTable *table = static_cast<BgpTable *>(
+        server_.database()->FindTable("bgp.l3vpn.0"));
+    ASSERT_TRUE(table != NULL);
+    BgpMessageAttrCache *cache = table->message_attr_cache();
+    EXPECT_EQ(0, cache->size());
+
+    BgpAttrSpec attr;
+    BgpAttrNextHop nexthop(0xabcdef01);
+    attr.push_back(&nexthop);
+    BgpAttrOrigin origin(BgpAttrOrigin::IGP);
+    attr.push_back(&origin);
+    BgpAttrLocalPref lp(100);
+    attr.push_back(&lp);
+    AsPathSpec path_spec;
+    AsPathSpec::PathSegment *ps = new AsPathSpec::PathSegment;
+    ps->path_segment_type = AsPathSpec::PathSegment::AS_SEQUENCE;
+    ps->path_segment.push_back(64512);
+    ps->path_segment.push_back(64513);
+    path_spec.path_segments.push_back(ps);
+    attr.push_back(&path_spec);
+
+    RibOutAttr rib_out_attr(server_.attr_db()->Locate(attr).get(), 16);
+    InetVpnRoute route1(InetVpnPrefix::FromString("12345:2:1.1.1.0/24"));
+    InetVpnRoute route2(InetVpnPrefix::FromString("12345:2:2.2.2.0/24"));
+
+    BgpMessage reference;
+    EXPECT_TRUE(reference.Start(&rib_out_attr, &route1));
+    EXPECT_TRUE(reference.AddRoute(&route2, &rib_out_attr));
+    size_t reference_length;
+    const uint8_t *reference_data =
+        reference.GetData(NULL, &reference_length);
+    EXPECT_EQ(0, cache->size());
+
+    for (int idx = 0; idx < 3; ++idx) {
+        BgpMessage message(table);
+        EXPECT_TRUE(message.Start(&rib_out_attr, &route1));
+        EXPECT_TRUE(message.AddRoute(&route2, &rib_out_attr));
+        EXPECT_EQ(2, message.num_reach_routes());
+        size_t length;
+        const uint8_t *data = message.GetData(NULL, &length);
+        EXPECT_EQ(reference_length, length);
+        EXPECT_EQ(0, memcmp(reference_data, data, length));
+    }
+    EXPECT_EQ(1, cache->size());
+    EXPECT_EQ(1, cache->miss_count());
+    EXPECT_EQ(2, cache->hit_count());
+
+    // A different attribute gets its own entry.
+    BgpAttrLocalPref lp2(200);
+    attr[2] = &lp2;
+    RibOutAttr rib_out_attr2(server_.attr_db()->Locate(attr).get(), 16);
+    BgpMessage message2(table);
+    EXPECT_TRUE(message2.Start(&rib_out_attr2, &route1));
+    EXPECT_EQ(2, cache->size());
+    EXPECT_EQ(2, cache->miss_count());
+
+    cache->Clear();
+    EXPECT_EQ(0, cache->size());
+}
+
+//
+// The least recently used entry is evicted when the cache is full.
+//
+TEST_F(BgpMsgBuilderTest, AttrCacheEvict) {
+    BgpTable *table = static_cast<BgpTable *>(
+        server_.database()->FindTable("bgp.l3vpn.0"));
+    ASSERT_TRUE(table != NULL);
+    BgpMessageAttrCache *cache = table->message_attr_cache();
+    cache->Clear();
+    InetVpnRoute route(InetVpnPrefix::FromString("12345:2:1.1.1.0/24"));
+
+    size_t max_entries = BgpMessageAttrCache::kMaxEntries;
+    vector<BgpAttrPtr> attrs;
+    for (size_t idx = 0; idx <= max_entries; ++idx) {
+        BgpAttrSpec attr;
+        BgpAttrLocalPref lp(100 + idx);
+        attr.push_back(&lp);
+        attrs.push_back(server_.attr_db()->Locate(attr));
+    }
+
+    // Fill the cache and then make the first entry the most recently used.
+    for (size_t idx = 0; idx < max_entries; ++idx) {
+        BgpMessage message(table);
+        RibOutAttr rib_out_attr(attrs[idx].get(), 16);
+        EXPECT_TRUE(message.Start(&rib_out_attr, &route));
+    }
+    EXPECT_EQ(max_entries, cache->size());
+    uint64_t miss_count = cache->miss_count();
+    uint64_t hit_count = cache->hit_count();
+    {
+        BgpMessage message(table);
+        RibOutAttr rib_out_attr(attrs[0].get(), 16);
+        EXPECT_TRUE(message.Start(&rib_out_attr, &route));
+    }
+    EXPECT_EQ(hit_count + 1, cache->hit_count());
+
+    // Adding one more entry evicts the second one.
+    {
+        BgpMessage message(table);
+        RibOutAttr rib_out_attr(attrs[max_entries].get(), 16);
+        EXPECT_TRUE(message.Start(&rib_out_attr, &route));
+    }
+    EXPECT_EQ(max_entries, cache->size());
+    EXPECT_EQ(miss_count + 1, cache->miss_count());
+    {
+        BgpMessage message(table);
+        RibOutAttr rib_out_attr(attrs[0].get(), 16);
+        EXPECT_TRUE(message.Start(&rib_out_attr, &route));
+    }
+    EXPECT_EQ(hit_count + 2, cache->hit_count());
+    {
+        BgpMessage message(table);
+        RibOutAttr rib_out_attr(attrs[1].get(), 16);
+        EXPECT_TRUE(message.Start(&rib_out_attr, &route));
+    }
+    EXPECT_EQ(miss_count + 2, cache->miss_count());
+
+    cache->Clear();
+}
 }  // namespace
 
 static void SetUp() {
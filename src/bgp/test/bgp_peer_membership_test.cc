@@ -3,9 +3,12 @@
  */
 #include <boost/uuid/random_generator.hpp>
 
+#include "base/logging.h"
 #include "base/task.h"
 #include "base/task_annotations.h"
+#include "base/test/addr_test_util.h"
 #include "base/test/task_test_util.h"
+#include "base/time_util.h"
 #include "control-node/control_node.h"
 #include "bgp/inet/inet_table.h"
 #include "bgp/l3vpn/inetvpn_table.h"
@@ -21,6 +24,7 @@
 #include "bgp/test/bgp_server_test_util.h"
 #include "db/db.h"
 #include "db/db_partition.h"
+#include "db/db_table_partition.h"
 #include "io/test/event_manager_test.h"
 #include "testing/gunit.h"
 
@@ -34,7 +38,7 @@ public:
                 const BgpNeighborConfig *config)
        : BgpPeer(server, instance, config),
          policy_(BgpProto::IBGP, RibExportPolicy::BGP, -1, 0),
-         index_(gbl_index++) {
+         index_(gbl_index++), ready_(false) {
     }
 
     virtual ~BgpTestPeer() { }
@@ -49,7 +53,8 @@ public:
         return true;
     }
 
-    virtual bool IsReady() const { return false; }
+    virtual bool IsReady() const { return ready_; }
+    void set_ready(bool ready) { ready_ = ready; }
 
     BgpProto::BgpPeerType PeerType() const {
         return BgpProto::IBGP;
@@ -63,6 +68,7 @@ public:
 private:
     RibExportPolicy policy_;
     int index_;
+    bool ready_;
 };
 
 class PeerRibMembershipManagerTest : public PeerRibMembershipManager {
@@ -151,6 +157,56 @@ protected:
     BgpServer *server() { return server_.get(); }
     int size() { return server()->membership_mgr()->peer_rib_set_.size(); }
 
+    void AddRoutes(BgpTestPeer *peer, BgpTable *table, int count) {
+        BgpAttrSpec attr_spec;
+        BgpAttrPtr attr = server_->attr_db()->Locate(attr_spec);
+        Ip4Prefix prefix(Ip4Prefix::FromString("10.0.0.0/32"));
+        for (int idx = 0; idx < count; ++idx) {
+            DBRequest req;
+            req.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+            req.key.reset(new InetTable::RequestKey(prefix, peer));
+            req.data.reset(new InetTable::RequestData(attr, 0, 0));
+            table->Enqueue(&req);
+            prefix = task_util::Ip4PrefixIncrement(prefix);
+        }
+    }
+
+    static int GetAction(int action, IPeerRib *peer_rib) { return action; }
+    void UnregisterPeerDone(IPeer *ipeer, BgpTable *table) {
+        unregister_peer_done_ = true;
+    }
+
+    // Apply the action to the RibIns of the peer and return the time that
+    // it took in usecs.
+    uint64_t UnregisterPeer(BgpTestPeer *peer, int action) {
+        unregister_peer_done_ = false;
+        uint64_t start = UTCTimestampUsec();
+        server()->membership_mgr()->UnregisterPeer(peer,
+            boost::bind(&PeerMembershipMgrTest::GetAction, action, _1),
+            boost::bind(&PeerMembershipMgrTest::UnregisterPeerDone, this,
+                        _1, _2));
+        TASK_UTIL_EXPECT_TRUE(unregister_peer_done_);
+        uint64_t elapsed = UTCTimestampUsec() - start;
+        task_util::WaitForIdle();
+        return elapsed;
+    }
+
+    size_t GetStalePathCount(BgpTestPeer *peer, BgpTable *table) {
+        size_t count = 0;
+        for (int idx = 0; idx < table->PartitionCount(); ++idx) {
+            DBTablePartition *tpart = static_cast<DBTablePartition *>(
+                table->GetTablePartition(idx));
+            for (DBEntry *entry = tpart->GetFirst(); entry != NULL;
+                 entry = tpart->GetNext(entry)) {
+                BgpRoute *route = static_cast<BgpRoute *>(entry);
+                BgpPath *path = route->FindPath(BgpPath::BGP_XMPP, peer, 0);
+                if (path && path->IsStale())
+                    count++;
+            }
+        }
+        return count;
+    }
+
     auto_ptr<EventManager> evm_;
     auto_ptr<BgpServerTest> server_;
     vector<BgpTestPeer *> peers_;
@@ -160,6 +216,7 @@ protected:
     BgpTable *vpn_tbl_;
     BgpTable *red_tbl_, *green_tbl_, *blue_tbl_;
     SchedulingGroupManager mgr_;
+    tbb::atomic<bool> unregister_peer_done_;
 };
 
 // Single peer with inet table.
@@ -504,6 +561,80 @@ TEST_F(PeerMembershipMgrTest, PeerDeleteWithDBRequestPending) {
         server_->FindPeer(BgpConfigManager::kMasterInstance, peer_names_[0]));
 }
 
+// Peer flap with graceful restart. The RibIn of the peer is staled when it
+// goes down, the stale paths are swept once the peer has readvertised some
+// of its routes and the rest of the paths are deleted. None of these walk
+// the table, so they should take time proportional to the number of paths
+// from the peer. The default count spans several RibIn worker batches so
+// that the sweep and delete resume after routes of the previous batch have
+// been removed. Set BGP_PEER_FLAP_TEST_ROUTES to measure convergence with
+// a large number of routes, e.g. 1000000.
+TEST_F(PeerMembershipMgrTest, PeerFlapWithRouteStaling) {
+    PeerRibMembershipManager *mgr = server()->membership_mgr();
+    size_t route_count = 5000;
+    char *str = getenv("BGP_PEER_FLAP_TEST_ROUTES");
+    if (str) route_count = strtoul(str, NULL, 0);
+    size_t half_count = route_count / 2;
+
+    peers_[0]->set_ready(true);
+    peers_[1]->set_ready(true);
+    mgr->Register(peers_[0], inet_tbl_, peers_[0]->GetRibExportPolicy(), -1);
+    mgr->Register(peers_[1], inet_tbl_, peers_[1]->GetRibExportPolicy(), -1);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(2, size());
+
+    // Both peers advertise the first half of the routes.
+    AddRoutes(peers_[0], inet_tbl_, route_count);
+    AddRoutes(peers_[1], inet_tbl_, half_count);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(route_count, inet_tbl_->Size());
+    EXPECT_EQ(route_count, inet_tbl_->GetPeerRouteCount(peers_[0]));
+    EXPECT_EQ(half_count, inet_tbl_->GetPeerRouteCount(peers_[1]));
+
+    // Peer goes down.
+    peers_[0]->set_ready(false);
+    uint64_t elapsed = UnregisterPeer(peers_[0],
+                                      MembershipRequest::RIBIN_STALE);
+    LOG(DEBUG, "Staled " << route_count << " routes in " << elapsed <<
+        " usecs");
+    EXPECT_EQ(route_count, GetStalePathCount(peers_[0], inet_tbl_));
+    EXPECT_EQ(route_count, inet_tbl_->GetPeerRouteCount(peers_[0]));
+    EXPECT_EQ(0U, GetStalePathCount(peers_[1], inet_tbl_));
+
+    // Peer comes back up and readvertises the first half of the routes.
+    peers_[0]->set_ready(true);
+    AddRoutes(peers_[0], inet_tbl_, half_count);
+    task_util::WaitForIdle();
+    EXPECT_EQ(route_count - half_count,
+              GetStalePathCount(peers_[0], inet_tbl_));
+
+    // Sweep the routes that were not readvertised.
+    elapsed = UnregisterPeer(peers_[0], MembershipRequest::RIBIN_SWEEP);
+    LOG(DEBUG, "Swept " << route_count - half_count << " routes in " <<
+        elapsed << " usecs");
+    TASK_UTIL_EXPECT_EQ(half_count, inet_tbl_->Size());
+    EXPECT_EQ(0U, GetStalePathCount(peers_[0], inet_tbl_));
+    EXPECT_EQ(half_count, inet_tbl_->GetPeerRouteCount(peers_[0]));
+    EXPECT_EQ(half_count, inet_tbl_->GetPeerRouteCount(peers_[1]));
+
+    // Peer goes down without graceful restart.
+    peers_[0]->set_ready(false);
+    elapsed = UnregisterPeer(peers_[0], MembershipRequest::RIBIN_DELETE);
+    LOG(DEBUG, "Deleted " << half_count << " routes in " << elapsed <<
+        " usecs");
+    EXPECT_EQ(0U, inet_tbl_->GetPeerRouteCount(peers_[0]));
+    EXPECT_EQ(half_count, inet_tbl_->GetPeerRouteCount(peers_[1]));
+    TASK_UTIL_EXPECT_EQ(half_count, inet_tbl_->Size());
+
+    // Unregister both peers, which walks the table to leave the RibOut.
+    mgr->Unregister(peers_[0], inet_tbl_);
+    mgr->Unregister(peers_[1], inet_tbl_);
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(0, size());
+    TASK_UTIL_EXPECT_EQ(0U, inet_tbl_->Size());
+    EXPECT_EQ(0U, inet_tbl_->GetPeerRouteCount(peers_[1]));
+}
+
 static void SetUp() {
     bgp_log_test::init();
     BgpServerTest::GlobalSetUp();
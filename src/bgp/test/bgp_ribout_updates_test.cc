@@ -2417,6 +2417,65 @@ TEST_F(RibOutUpdatesTest, PeerDequeueSplitMerge1) {
     }
 }
 
+// Routes:   Routes x=[0,kRouteCount-1] enqueued to all peers, attr A.
+// Blocking: None.
+// Result:   Memory for the RouteUpdates is accounted while they are on the
+//           queue and released once all peers are in sync. Peak is kept.
+TEST_F(RibOutUpdatesTest, QueueBytes) {
+    EXPECT_EQ(0, updates_->queue_bytes());
+
+    UpdateInfoSList uinfo_slist;
+    PrependUpdateInfo(uinfo_slist, attrA_, 0, kPeerCount-1);
+    for (int idx = 0; idx < kRouteCount; idx++) {
+        UpdateInfoSList temp_uinfo_slist;
+        CloneUpdateInfo(uinfo_slist, temp_uinfo_slist);
+        BuildRouteUpdate(routes_[idx], temp_uinfo_slist);
+    }
+
+    size_t bytes = updates_->queue_bytes();
+    EXPECT_LE(kRouteCount * (sizeof(RouteUpdate) + sizeof(UpdateInfo)), bytes);
+    EXPECT_EQ(bytes, updates_->peak_queue_bytes());
+
+    UpdateRibOut();
+    VerifyPeerInSync(0, kPeerCount-1, true);
+    EXPECT_EQ(0, updates_->queue_bytes());
+    EXPECT_EQ(bytes, updates_->peak_queue_bytes());
+}
+
+// Routes:   Routes x=[0,5] enqueued to all peers, attr A.
+// Blocking: None.
+// Result:   Over threshold count goes up only when the threshold is first
+//           exceeded and again after memory goes back within threshold.
+TEST_F(RibOutUpdatesTest, QueueBytesThreshold) {
+    UpdateInfoSList uinfo_slist;
+    PrependUpdateInfo(uinfo_slist, attrA_, 0, kPeerCount-1);
+    UpdateInfoSList temp_uinfo_slist;
+    CloneUpdateInfo(uinfo_slist, temp_uinfo_slist);
+    BuildRouteUpdate(routes_[0], temp_uinfo_slist);
+    size_t bytes = updates_->queue_bytes();
+    DrainAndDeleteDBState();
+
+    RibOutUpdates::set_queue_bytes_threshold(bytes + bytes / 2);
+    for (int idx = 1; idx <= 3; idx++) {
+        UpdateInfoSList temp_uinfo_slist;
+        CloneUpdateInfo(uinfo_slist, temp_uinfo_slist);
+        BuildRouteUpdate(routes_[idx], temp_uinfo_slist);
+        EXPECT_EQ(idx > 1, updates_->over_threshold());
+    }
+    EXPECT_EQ(1, updates_->over_threshold_count());
+
+    UpdateRibOut();
+    EXPECT_EQ(0, updates_->queue_bytes());
+    for (int idx = 4; idx <= 5; idx++) {
+        UpdateInfoSList temp_uinfo_slist;
+        CloneUpdateInfo(uinfo_slist, temp_uinfo_slist);
+        BuildRouteUpdate(routes_[idx], temp_uinfo_slist);
+        EXPECT_EQ(idx > 4, updates_->over_threshold());
+    }
+    EXPECT_EQ(2, updates_->over_threshold_count());
+    RibOutUpdates::set_queue_bytes_threshold(0);
+}
+
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
@@ -4,8 +4,12 @@
 
 #include "bgp/bgp_route.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "base/util.h"
 #include "base/logging.h"
+#include "base/time_util.h"
 #include "base/test/task_test_util.h"
 #include "bgp/bgp_attr.h"
 #include "bgp/bgp_config.h"
@@ -20,6 +24,9 @@
 
 class BgpPeerMock : public IPeer {
 public:
+    BgpPeerMock(bool is_xmpp = false, uint32_t bgp_identifier = 0)
+        : is_xmpp_(is_xmpp), bgp_identifier_(bgp_identifier) {
+    }
     virtual std::string ToString() const {
         return "test-peer";
     }
@@ -44,7 +51,7 @@ public:
     virtual bool IsReady() const {
         return true;
     }
-    virtual bool IsXmppPeer() const { return false; }
+    virtual bool IsXmppPeer() const { return is_xmpp_; }
     virtual void Close() {
     }
     virtual const std::string GetStateName() const {
@@ -55,7 +62,7 @@ public:
         return BgpProto::IBGP;
     }
     virtual uint32_t bgp_identifier() const {
-        return 0;
+        return bgp_identifier_;
     }
     virtual void UpdateRefCount(int count) const { }
     virtual tbb::atomic<int> GetRefCount() const {
@@ -63,7 +70,10 @@ public:
         count = 0;
         return count;
     }
+
 private:
+    bool is_xmpp_;
+    uint32_t bgp_identifier_;
 };
 
 class BgpRouteTest : public ::testing::Test {
@@ -77,6 +87,42 @@ protected:
         task_util::WaitForIdle();
     }
 
+    BgpAttrPtr BuildAttr(uint32_t local_pref, uint32_t med, int as_count,
+                         BgpAttrOrigin::OriginType origin) {
+        BgpAttrSpec spec;
+        BgpAttrLocalPref local_pref_spec(local_pref);
+        spec.push_back(&local_pref_spec);
+        BgpAttrMultiExitDisc med_spec(med);
+        spec.push_back(&med_spec);
+        BgpAttrOrigin origin_spec(origin);
+        spec.push_back(&origin_spec);
+        AsPathSpec as_path_spec;
+        AsPathSpec::PathSegment *ps = new AsPathSpec::PathSegment;
+        ps->path_segment_type = AsPathSpec::PathSegment::AS_SEQUENCE;
+        for (int idx = 0; idx < as_count; ++idx) {
+            ps->path_segment.push_back(64512 + idx);
+        }
+        as_path_spec.path_segments.push_back(ps);
+        spec.push_back(&as_path_spec);
+        return server_.attr_db()->Locate(spec);
+    }
+
+    // Verify that the path list is sorted and return the number of paths.
+    size_t VerifySorted(const BgpRoute &route) {
+        size_t count = 0;
+        const BgpPath *prev = NULL;
+        for (Route::PathList::const_iterator it =
+             route.GetPathList().begin();
+             it != route.GetPathList().end(); ++it, ++count) {
+            const BgpPath *path = static_cast<const BgpPath *>(it.operator->());
+            if (prev) {
+                EXPECT_LE(prev->PathCompare(*path, false), 0);
+            }
+            prev = path;
+        }
+        return count;
+    }
+
     EventManager evm_;
     BgpServer server_;
 };
@@ -137,6 +183,152 @@ TEST_F(BgpRouteTest, Paths) {
     route.RemovePath(&peer);
 }
 
+//
+// InsertPath and DeletePath keep the best path at the front of the list.
+//
+TEST_F(BgpRouteTest, BestPath) {
+    BgpPeerMock peer1(true), peer2(true), peer3(true), peer4(true);
+    Ip4Prefix prefix;
+    InetRoute route(prefix);
+
+    BgpPath *path1 = new BgpPath(&peer1, BgpPath::BGP_XMPP,
+        BuildAttr(100, 0, 1, BgpAttrOrigin::IGP), 0, 0);
+    route.InsertPath(path1);
+    EXPECT_EQ(path1, route.BestPath());
+
+    // Same local pref, ECMP with the best path.
+    BgpPath *path2 = new BgpPath(&peer2, BgpPath::BGP_XMPP,
+        BuildAttr(100, 0, 1, BgpAttrOrigin::IGP), 0, 0);
+    route.InsertPath(path2);
+    EXPECT_EQ(path1, route.BestPath());
+
+    // Lower local pref, not ECMP with the best path.
+    BgpPath *path3 = new BgpPath(&peer3, BgpPath::BGP_XMPP,
+        BuildAttr(50, 0, 1, BgpAttrOrigin::IGP), 0, 0);
+    route.InsertPath(path3);
+    EXPECT_EQ(path1, route.BestPath());
+
+    // Higher local pref, new best path.
+    BgpPath *path4 = new BgpPath(&peer4, BgpPath::BGP_XMPP,
+        BuildAttr(200, 0, 1, BgpAttrOrigin::IGP), 0, 0);
+    route.InsertPath(path4);
+    EXPECT_EQ(path4, route.BestPath());
+    EXPECT_EQ(4U, VerifySorted(route));
+
+    route.DeletePath(path3);
+    route.DeletePath(path4);
+    EXPECT_EQ(path1, route.BestPath());
+    route.DeletePath(path2);
+    EXPECT_EQ(path1, route.BestPath());
+    route.DeletePath(path1);
+    EXPECT_TRUE(route.BestPath() == NULL);
+}
+
+//
+// A path without attributes is worse than any path with attributes.
+//
+TEST_F(BgpRouteTest, PathWithoutAttributes) {
+    BgpPeerMock peer1(true), peer2(true);
+    Ip4Prefix prefix;
+    InetRoute route(prefix);
+
+    BgpPath *path1 = new BgpPath(&peer1, BgpPath::BGP_XMPP,
+        BgpAttrPtr(), 0, 0);
+    route.InsertPath(path1);
+    EXPECT_EQ(path1, route.BestPath());
+
+    BgpPath *path2 = new BgpPath(&peer2, BgpPath::BGP_XMPP,
+        BuildAttr(0, 0, 1, BgpAttrOrigin::INCOMPLETE),
+        BgpPath::NoNeighborAs, 0);
+    route.InsertPath(path2);
+    EXPECT_EQ(path2, route.BestPath());
+    EXPECT_EQ(2U, VerifySorted(route));
+
+    route.DeletePath(path2);
+    route.DeletePath(path1);
+}
+
+//
+// Insert and delete paths with random attributes in random order and make
+// sure that the path list stays sorted.
+//
+TEST_F(BgpRouteTest, RandomInsertDelete) {
+    const int kPeerCount = 8;
+    const size_t kPathCount = 64;
+    std::vector<BgpPeerMock *> peers;
+    for (int idx = 0; idx < kPeerCount; ++idx) {
+        peers.push_back(new BgpPeerMock(idx % 2 == 0, idx));
+    }
+
+    srand(1);
+    Ip4Prefix prefix;
+    InetRoute route(prefix);
+    std::vector<BgpPath *> paths;
+    for (size_t iter = 0; iter < 4 * kPathCount; ++iter) {
+        if (paths.size() < kPathCount && (paths.empty() || rand() % 3)) {
+            BgpAttrPtr attr = BuildAttr(100 + rand() % 3, rand() % 3,
+                1 + rand() % 2, static_cast<BgpAttrOrigin::OriginType>(
+                    rand() % 2));
+            BgpPath *path = new BgpPath(peers[rand() % kPeerCount],
+                rand() % 4, BgpPath::BGP_XMPP, attr, 0, 0);
+            route.InsertPath(path);
+            paths.push_back(path);
+        } else {
+            size_t idx = rand() % paths.size();
+            route.DeletePath(paths[idx]);
+            paths.erase(paths.begin() + idx);
+        }
+        ASSERT_EQ(paths.size(), VerifySorted(route));
+    }
+
+    while (!paths.empty()) {
+        route.DeletePath(paths.back());
+        paths.pop_back();
+    }
+    STLDeleteValues(&peers);
+}
+
+//
+// Time path selection for a route with many ECMP paths.
+//
+TEST_F(BgpRouteTest, ManyEcmpPaths) {
+    const size_t kPeerCount = 64;
+    const size_t kIterations = 20000;
+    std::vector<BgpPeerMock *> peers;
+    for (size_t idx = 0; idx < kPeerCount; ++idx) {
+        peers.push_back(new BgpPeerMock(true, idx));
+    }
+
+    Ip4Prefix prefix;
+    InetRoute route(prefix);
+    BgpAttrPtr attr = BuildAttr(100, 0, 1, BgpAttrOrigin::IGP);
+    std::vector<BgpPath *> paths;
+    for (size_t idx = 0; idx < kPeerCount; ++idx) {
+        BgpPath *path =
+            new BgpPath(peers[idx], BgpPath::BGP_XMPP, attr, 0, 0);
+        route.InsertPath(path);
+        paths.push_back(path);
+    }
+
+    uint64_t start = UTCTimestampUsec();
+    for (size_t iter = 0; iter < kIterations; ++iter) {
+        size_t idx = iter % kPeerCount;
+        route.DeletePath(paths[idx]);
+        paths[idx] = new BgpPath(peers[idx], BgpPath::BGP_XMPP, attr, 0, 0);
+        route.InsertPath(paths[idx]);
+    }
+    uint64_t elapsed = UTCTimestampUsec() - start;
+    LOG(DEBUG, "Path changes with " << kPeerCount << " ECMP paths: " <<
+        kIterations * 1000000 / std::max(elapsed, static_cast<uint64_t>(1)) <<
+        " per second");
+    EXPECT_EQ(kPeerCount, VerifySorted(route));
+
+    for (size_t idx = 0; idx < kPeerCount; ++idx) {
+        route.DeletePath(paths[idx]);
+    }
+    STLDeleteValues(&peers);
+}
+
 }  // namespace
 
 static void SetUp() {
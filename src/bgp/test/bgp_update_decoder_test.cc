@@ -0,0 +1,443 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/bgp_update_decoder.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include <tbb/atomic.h>
+
+#include "base/logging.h"
+#include "base/time_util.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_proto.h"
+#include "control-node/control_node.h"
+#include "net/bgp_af.h"
+#include "testing/gunit.h"
+#include "bgp_message_test.h"
+
+using std::vector;
+
+//
+// Count all heap allocations made by the test so that the decoders can be
+// compared.
+//
+static tbb::atomic<uint64_t> alloc_count;
+
+void *operator new(size_t size) throw(std::bad_alloc) {
+    alloc_count.fetch_and_increment();
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) throw() {
+    free(ptr);
+}
+
+void *operator new[](size_t size) throw(std::bad_alloc) {
+    return operator new(size);
+}
+
+void operator delete[](void *ptr) throw() {
+    operator delete(ptr);
+}
+
+namespace {
+
+struct BgpAttrCodeLess {
+    bool operator()(const BgpAttribute *lhs, const BgpAttribute *rhs) const {
+        return lhs->code < rhs->code;
+    }
+};
+
+class BgpUpdateDecoderTest : public ::testing::Test {
+protected:
+    static void AddPrefix(vector<BgpProtoPrefix *> *prefixes, int prefixlen,
+                          uint32_t value, uint8_t type = 0) {
+        BgpProtoPrefix *prefix = new BgpProtoPrefix;
+        prefix->type = type;
+        prefix->prefixlen = prefixlen;
+        size_t bytes = type ? prefixlen / 8 : (prefixlen + 7) / 8;
+        for (size_t idx = 0; idx < bytes; ++idx) {
+            prefix->prefix.push_back((value >> ((idx % 4) * 8)) & 0xff);
+        }
+        prefixes->push_back(prefix);
+    }
+
+    // Attributes that a route reflector typically sees from another
+    // control-node or a gateway for inet-vpn routes.
+    static void BuildUpdate(BgpProto::Update *update, uint16_t afi,
+                            uint8_t safi, int count) {
+        update->path_attributes.push_back(
+            new BgpAttrOrigin(BgpAttrOrigin::IGP));
+
+        AsPathSpec *path_spec = new AsPathSpec;
+        AsPathSpec::PathSegment *ps = new AsPathSpec::PathSegment;
+        ps->path_segment_type = AsPathSpec::PathSegment::AS_SEQUENCE;
+        ps->path_segment.push_back(64512);
+        ps->path_segment.push_back(64513);
+        ps->path_segment.push_back(64514);
+        path_spec->path_segments.push_back(ps);
+        update->path_attributes.push_back(path_spec);
+
+        update->path_attributes.push_back(new BgpAttrMultiExitDisc(100));
+        update->path_attributes.push_back(new BgpAttrLocalPref(200));
+
+        CommunitySpec *community = new CommunitySpec;
+        community->communities.push_back(0xfc000001);
+        community->communities.push_back(0xfc000002);
+        update->path_attributes.push_back(community);
+
+        ExtCommunitySpec *ext_community = new ExtCommunitySpec;
+        ext_community->communities.push_back(0x0002fc00007a1200ULL);
+        ext_community->communities.push_back(0x030c000000000002ULL);
+        update->path_attributes.push_back(ext_community);
+
+        if (afi == BgpAf::IPv4 && safi == BgpAf::Unicast) {
+            update->path_attributes.push_back(new BgpAttrNextHop(0x0a010101));
+            for (int idx = 0; idx < count; ++idx) {
+                AddPrefix(&update->nlri, 24, 0x0a000000 + idx);
+            }
+            AddPrefix(&update->withdrawn_routes, 16, 0xc0a80000);
+            return;
+        }
+
+        BgpMpNlri *mp_nlri = new BgpMpNlri(BgpAttribute::MPReachNlri);
+        mp_nlri->afi = afi;
+        mp_nlri->safi = safi;
+        uint8_t nh[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 10, 1, 1, 1 };
+        if (safi == BgpAf::Vpn) {
+            mp_nlri->nexthop.assign(&nh[0], &nh[12]);
+        } else {
+            mp_nlri->nexthop.assign(&nh[8], &nh[12]);
+        }
+        for (int idx = 0; idx < count; ++idx) {
+            if (safi == BgpAf::EVpn) {
+                AddPrefix(&mp_nlri->nlri, 33 * 8, 0x0a000000 + idx, 2);
+            } else {
+                // Label, route distinguisher and address.
+                AddPrefix(&mp_nlri->nlri, 24 + 64 + 32, 0x0a000000 + idx);
+            }
+        }
+        update->path_attributes.push_back(mp_nlri);
+
+        mp_nlri = new BgpMpNlri(BgpAttribute::MPUnreachNlri);
+        mp_nlri->afi = afi;
+        mp_nlri->safi = safi;
+        if (safi == BgpAf::EVpn) {
+            AddPrefix(&mp_nlri->nlri, 33 * 8, 0x0b000000, 2);
+        } else {
+            AddPrefix(&mp_nlri->nlri, 24 + 64 + 32, 0x0b000000);
+        }
+        update->path_attributes.push_back(mp_nlri);
+    }
+
+    static void VerifyPrefixes(const vector<BgpProtoPrefix *> &expected,
+                               BgpUpdateDecoder::PrefixReader reader) {
+        for (size_t idx = 0; idx < expected.size(); ++idx) {
+            const BgpProtoPrefix *prefix = reader.Next();
+            ASSERT_TRUE(prefix != NULL);
+            EXPECT_EQ(expected[idx]->type, prefix->type);
+            EXPECT_EQ(expected[idx]->prefixlen, prefix->prefixlen);
+            EXPECT_TRUE(expected[idx]->prefix == prefix->prefix);
+        }
+        EXPECT_TRUE(reader.Next() == NULL);
+    }
+
+    // Verify that the decoder has the same contents as the Update from the
+    // generic decoder.
+    static void Verify(const BgpProto::Update *msg,
+                       const BgpUpdateDecoder &decoder) {
+        BgpAttrSpec expected = msg->path_attributes;
+        std::stable_sort(expected.begin(), expected.end(), BgpAttrCodeLess());
+        const BgpAttrSpec &attributes = decoder.path_attributes();
+        ASSERT_EQ(expected.size(), attributes.size());
+        for (size_t idx = 0; idx < expected.size(); ++idx) {
+            EXPECT_EQ(expected[idx]->code, attributes[idx]->code);
+            EXPECT_EQ(expected[idx]->flags, attributes[idx]->flags);
+            if (expected[idx]->code != BgpAttribute::MPReachNlri &&
+                expected[idx]->code != BgpAttribute::MPUnreachNlri) {
+                EXPECT_EQ(0, expected[idx]->CompareTo(*attributes[idx]));
+                continue;
+            }
+            const BgpMpNlri *expected_nlri =
+                static_cast<const BgpMpNlri *>(expected[idx]);
+            const BgpMpNlri *nlri =
+                static_cast<const BgpMpNlri *>(attributes[idx]);
+            EXPECT_EQ(expected_nlri->afi, nlri->afi);
+            EXPECT_EQ(expected_nlri->safi, nlri->safi);
+            EXPECT_TRUE(expected_nlri->nexthop == nlri->nexthop);
+            EXPECT_TRUE(nlri->nlri.empty());
+            EXPECT_EQ(expected_nlri->nlri.size(), decoder.mp_nlri_count(nlri));
+            VerifyPrefixes(expected_nlri->nlri, decoder.mp_nlri(nlri));
+        }
+
+        EXPECT_EQ(msg->withdrawn_routes.size(), decoder.withdrawn_count());
+        VerifyPrefixes(msg->withdrawn_routes, decoder.withdrawn_routes());
+        EXPECT_EQ(msg->nlri.size(), decoder.nlri_count());
+        VerifyPrefixes(msg->nlri, decoder.nlri());
+    }
+
+    // Encode the update, decode it with both decoders and compare.
+    void EncodeAndVerify(const BgpProto::Update &update) {
+        uint8_t data[BgpProto::kMaxMessageSize];
+        int size = BgpProto::Encode(&update, data, sizeof(data));
+        ASSERT_LT(0, size);
+
+        BgpUpdateDecoder decoder;
+        EXPECT_TRUE(decoder.Decode(data, size));
+        EXPECT_EQ(static_cast<size_t>(size), decoder.size());
+        BgpProto::Update *msg =
+            static_cast<BgpProto::Update *>(BgpProto::Decode(data, size));
+        ASSERT_TRUE(msg != NULL);
+        Verify(msg, decoder);
+        delete msg;
+    }
+
+    // Decode UPDATEs with BgpProto::Decode and with the BgpUpdateDecoder
+    // and report UPDATEs/sec and allocations per UPDATE for each.
+    void RunBenchmark(const string &name, const BgpProto::Update &update,
+                      int count) {
+        uint8_t data[BgpProto::kMaxMessageSize];
+        int size = BgpProto::Encode(&update, data, sizeof(data));
+        ASSERT_LT(0, size);
+
+        uint64_t allocs = alloc_count;
+        uint64_t start = ClockMonotonicUsec();
+        for (int idx = 0; idx < count; ++idx) {
+            BgpProto::BgpMessage *msg = BgpProto::Decode(data, size);
+            delete msg;
+        }
+        uint64_t proto_usec =
+            std::max<uint64_t>(ClockMonotonicUsec() - start, 1);
+        uint64_t proto_allocs = alloc_count - allocs;
+
+        // Walk all the prefixes since BgpProto::Decode builds them.
+        BgpUpdateDecoderPool pool;
+        EXPECT_TRUE(pool.Allocate()->Decode(data, size));
+        allocs = alloc_count;
+        start = ClockMonotonicUsec();
+        size_t prefix_count = 0;
+        for (int idx = 0; idx < count; ++idx) {
+            BgpUpdateDecoderPtr decoder = pool.Allocate();
+            EXPECT_TRUE(decoder->Decode(data, size));
+            const BgpAttrSpec &attributes = decoder->path_attributes();
+            for (size_t attr_idx = 0; attr_idx < attributes.size();
+                 ++attr_idx) {
+                if (attributes[attr_idx]->code != BgpAttribute::MPReachNlri &&
+                    attributes[attr_idx]->code != BgpAttribute::MPUnreachNlri)
+                    continue;
+                const BgpMpNlri *nlri =
+                    static_cast<const BgpMpNlri *>(attributes[attr_idx]);
+                BgpUpdateDecoder::PrefixReader reader = decoder->mp_nlri(nlri);
+                while (reader.Next() != NULL) {
+                    prefix_count++;
+                }
+            }
+            BgpUpdateDecoder::PrefixReader reader = decoder->nlri();
+            while (reader.Next() != NULL) {
+                prefix_count++;
+            }
+        }
+        uint64_t decoder_usec =
+            std::max<uint64_t>(ClockMonotonicUsec() - start, 1);
+        uint64_t decoder_allocs = alloc_count - allocs;
+
+        EXPECT_LT(0U, prefix_count);
+        EXPECT_GT(proto_allocs, decoder_allocs);
+        LOG(DEBUG, name << ": " << count << " UPDATEs of " << size <<
+            " bytes, BgpProto " << count * 1000000ULL / proto_usec <<
+            " UPDATEs/sec " << static_cast<double>(proto_allocs) / count <<
+            " allocations/UPDATE, BgpUpdateDecoder " <<
+            count * 1000000ULL / decoder_usec << " UPDATEs/sec " <<
+            static_cast<double>(decoder_allocs) / count <<
+            " allocations/UPDATE");
+    }
+
+    static int GetBenchmarkCount() {
+        char *str = getenv("BGP_UPDATE_DECODER_TEST_COUNT");
+        if (!str) return 100000;
+        return strtoul(str, NULL, 0);
+    }
+};
+
+TEST_F(BgpUpdateDecoderTest, Inet) {
+    BgpProto::Update update;
+    BuildUpdate(&update, BgpAf::IPv4, BgpAf::Unicast, 8);
+    EncodeAndVerify(update);
+}
+
+TEST_F(BgpUpdateDecoderTest, InetVpn) {
+    BgpProto::Update update;
+    BuildUpdate(&update, BgpAf::IPv4, BgpAf::Vpn, 8);
+    EncodeAndVerify(update);
+}
+
+TEST_F(BgpUpdateDecoderTest, Inet6Vpn) {
+    BgpProto::Update update;
+    BuildUpdate(&update, BgpAf::IPv6, BgpAf::Vpn, 4);
+    EncodeAndVerify(update);
+}
+
+TEST_F(BgpUpdateDecoderTest, Evpn) {
+    BgpProto::Update update;
+    BuildUpdate(&update, BgpAf::L2Vpn, BgpAf::EVpn, 4);
+    EncodeAndVerify(update);
+}
+
+TEST_F(BgpUpdateDecoderTest, Withdraw) {
+    BgpProto::Update update;
+    BgpMessageTest::GenerateWithdrawMessage(&update);
+    EncodeAndVerify(update);
+}
+
+TEST_F(BgpUpdateDecoderTest, EndOfRib) {
+    BgpProto::Update update;
+    BgpMessageTest::GenerateEmptyUpdateMessage(&update);
+    EncodeAndVerify(update);
+}
+
+//
+// Attributes that the decoder doesn't know about need the generic decoder.
+//
+TEST_F(BgpUpdateDecoderTest, Fallback) {
+    BgpProto::Update update;
+    BgpMessageTest::GenerateUpdateMessage(&update, BgpAf::IPv4, BgpAf::Vpn);
+    uint8_t data[BgpProto::kMaxMessageSize];
+    int size = BgpProto::Encode(&update, data, sizeof(data));
+    ASSERT_LT(0, size);
+
+    BgpUpdateDecoder decoder;
+    EXPECT_FALSE(decoder.Decode(data, size));
+
+    // Other messages aren't UPDATEs.
+    BgpProto::Keepalive keepalive;
+    size = BgpProto::Encode(&keepalive, data, sizeof(data));
+    ASSERT_LT(0, size);
+    EXPECT_FALSE(BgpUpdateDecoder::IsUpdate(data, size));
+    EXPECT_FALSE(decoder.Decode(data, size));
+}
+
+//
+// A decoder can be reused for messages with different contents.
+//
+TEST_F(BgpUpdateDecoderTest, Reuse) {
+    BgpProto::Update update1;
+    BuildUpdate(&update1, BgpAf::IPv4, BgpAf::Vpn, 16);
+    BgpProto::Update update2;
+    BgpMessageTest::GenerateWithdrawMessage(&update2);
+
+    uint8_t data1[BgpProto::kMaxMessageSize];
+    int size1 = BgpProto::Encode(&update1, data1, sizeof(data1));
+    uint8_t data2[BgpProto::kMaxMessageSize];
+    int size2 = BgpProto::Encode(&update2, data2, sizeof(data2));
+
+    BgpUpdateDecoder decoder;
+    for (int idx = 0; idx < 4; ++idx) {
+        const uint8_t *data = (idx % 2) ? data2 : data1;
+        int size = (idx % 2) ? size2 : size1;
+        EXPECT_TRUE(decoder.Decode(data, size));
+        BgpProto::Update *msg =
+            static_cast<BgpProto::Update *>(BgpProto::Decode(data, size));
+        ASSERT_TRUE(msg != NULL);
+        Verify(msg, decoder);
+        delete msg;
+    }
+}
+
+//
+// Whenever the decoder accepts a corrupted message, the generic decoder
+// must accept it as well and produce the same contents. Everything else
+// gets handled by the generic decoder.
+//
+TEST_F(BgpUpdateDecoderTest, RandomCorruption) {
+    BgpProto::Update update;
+    BuildUpdate(&update, BgpAf::IPv4, BgpAf::Vpn, 4);
+    uint8_t data[BgpProto::kMaxMessageSize];
+    int size = BgpProto::Encode(&update, data, sizeof(data));
+    ASSERT_LT(0, size);
+
+    BgpUpdateDecoder decoder;
+    for (int idx = 0; idx < 4096; ++idx) {
+        uint8_t corrupt[BgpProto::kMaxMessageSize];
+        memcpy(corrupt, data, size);
+        int pos = BgpProto::kMinMessageSize + rand() % (size -
+            BgpProto::kMinMessageSize);
+        corrupt[pos] = rand();
+        if (!decoder.Decode(corrupt, size))
+            continue;
+        BgpProto::Update *msg =
+            static_cast<BgpProto::Update *>(BgpProto::Decode(corrupt, size));
+        EXPECT_TRUE(msg != NULL) << "Byte " << pos << " " << int(corrupt[pos]);
+        if (msg)
+            Verify(msg, decoder);
+        delete msg;
+    }
+}
+
+//
+// No memory is allocated once the pool and the decoder are warmed up.
+//
+TEST_F(BgpUpdateDecoderTest, NoAllocation) {
+    BgpProto::Update update;
+    BuildUpdate(&update, BgpAf::IPv4, BgpAf::Vpn, 32);
+    uint8_t data[BgpProto::kMaxMessageSize];
+    int size = BgpProto::Encode(&update, data, sizeof(data));
+    ASSERT_LT(0, size);
+
+    BgpUpdateDecoderPool pool;
+    EXPECT_TRUE(pool.Allocate()->Decode(data, size));
+    EXPECT_EQ(1U, pool.free_count());
+
+    uint64_t allocs = alloc_count;
+    size_t prefix_count = 0;
+    for (int idx = 0; idx < 100; ++idx) {
+        BgpUpdateDecoderPtr decoder = pool.Allocate();
+        if (!decoder->Decode(data, size))
+            continue;
+        const BgpAttrSpec &attributes = decoder->path_attributes();
+        for (size_t attr_idx = 0; attr_idx < attributes.size(); ++attr_idx) {
+            if (attributes[attr_idx]->code == BgpAttribute::MPReachNlri ||
+                attributes[attr_idx]->code == BgpAttribute::MPUnreachNlri) {
+                prefix_count += decoder->mp_nlri_count(
+                    static_cast<const BgpMpNlri *>(attributes[attr_idx]));
+            }
+        }
+    }
+    EXPECT_EQ(0U, alloc_count - allocs);
+    EXPECT_EQ(100U * (32 + 1), prefix_count);
+    EXPECT_EQ(1U, pool.free_count());
+}
+
+TEST_F(BgpUpdateDecoderTest, BenchmarkInet) {
+    BgpProto::Update update;
+    BuildUpdate(&update, BgpAf::IPv4, BgpAf::Unicast, 64);
+    RunBenchmark("inet", update, GetBenchmarkCount());
+}
+
+TEST_F(BgpUpdateDecoderTest, BenchmarkInetVpn) {
+    BgpProto::Update update;
+    BuildUpdate(&update, BgpAf::IPv4, BgpAf::Vpn, 64);
+    RunBenchmark("inet-vpn", update, GetBenchmarkCount());
+}
+
+TEST_F(BgpUpdateDecoderTest, BenchmarkInetVpnSinglePrefix) {
+    BgpProto::Update update;
+    BuildUpdate(&update, BgpAf::IPv4, BgpAf::Vpn, 1);
+    RunBenchmark("inet-vpn single prefix", update, GetBenchmarkCount());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    bgp_log_test::init();
+    ControlNode::SetDefaultSchedulingPolicy();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
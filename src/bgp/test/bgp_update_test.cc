@@ -12,6 +12,7 @@
 #include "base/logging.h"
 #include "base/task.h"
 #include "base/task_annotations.h"
+#include "base/time_util.h"
 #include "base/util.h"
 #include "base/test/task_test_util.h"
 #include "bgp/bgp_attr.h"
@@ -529,6 +530,172 @@ TEST_F(BgpUpdate2RibTest, WithBlock) {
     STLDeleteValues(&routes);
 }
 
+//
+// Benchmark for the time taken to send all updates in a large SchedulingGroup
+// to all peers. Each RibOut has kPeersPerRibOut peers of its own and also has
+// the first peer of the next RibOut, which chains all the RibOuts and peers
+// into a single SchedulingGroup, as is the case for XMPP agents.
+//
+// The convergence time is measured with a single Worker and with the maximum
+// number of Workers, and the number of updates sent to each peer must be the
+// same in both cases.
+//
+class BgpUpdateScaleTest : public ::testing::Test {
+protected:
+    static const int kPeersPerRibOut = 10;
+    static const int kAttrCount = 20;
+
+    BgpUpdateScaleTest()
+        : server_(&evm_),
+          inetvpn_table_(static_cast<InetVpnTable *>(
+              db_.CreateTable("bgp.l3vpn.0"))),
+          peer_count_(1000),
+          route_count_(100000) {
+        char *str = getenv("BGP_UPDATE_TEST_SCALE_PEERS");
+        if (str) peer_count_ = strtoul(str, NULL, 0);
+        str = getenv("BGP_UPDATE_TEST_SCALE_ROUTES");
+        if (str) route_count_ = strtoul(str, NULL, 0);
+    }
+
+    virtual void SetUp() {
+        gbl_index = 0;
+        saved_max_workers_ = SchedulingGroup::max_workers();
+        for (int idx = 0; idx < peer_count_; ++idx) {
+            peers_.push_back(new BgpTestPeer());
+        }
+
+        int ribout_count =
+            (peer_count_ + kPeersPerRibOut - 1) / kPeersPerRibOut;
+        for (int ro_idx = 0; ro_idx < ribout_count; ++ro_idx) {
+            RibOut *ribout =
+                new RibOut(inetvpn_table_, &mgr_, RibExportPolicy());
+            ribout->updates()->SetMessageBuilder(&builder_);
+            ribouts_.push_back(ribout);
+            int first = ro_idx * kPeersPerRibOut;
+            int last = std::min(first + kPeersPerRibOut + 1, peer_count_);
+            for (int idx = first; idx < last; ++idx) {
+                RibOutRegister(ribout, &peers_[idx]);
+            }
+        }
+        EXPECT_EQ(1, mgr_.size());
+
+        for (int idx = 0; idx < kAttrCount; ++idx) {
+            BgpAttr *attr = new BgpAttr(server_.attr_db());
+            attr->set_med(1000 + idx);
+            attr_.push_back(server_.attr_db()->Locate(attr));
+        }
+    }
+
+    virtual void TearDown() {
+        SchedulingGroup::set_max_workers(saved_max_workers_);
+        server_.Shutdown();
+        task_util::WaitForIdle();
+    }
+
+    void RibOutRegister(RibOut *ribout, IPeerUpdate *peer) {
+        ConcurrencyScope scope("bgp::PeerMembership");
+        ribout->Register(peer);
+        int bit = ribout->GetPeerIndex(peer);
+        ribout->updates()->QueueJoin(RibOutUpdates::QUPDATE, bit);
+    }
+
+    bool UpdatesEmpty() {
+        BOOST_FOREACH(RibOut &ribout, ribouts_) {
+            if (!ribout.updates()->Empty())
+                return false;
+        }
+        return true;
+    }
+
+    //
+    // Enqueue updates for all routes with the scheduler stopped and return
+    // the time taken to drain all the update queues. The number of updates
+    // sent to each peer gets filled in counts.
+    //
+    uint64_t Converge(int max_workers, vector<int> *counts) {
+        SchedulingGroup::set_max_workers(max_workers);
+        vector<int> start_counts;
+        BOOST_FOREACH(const BgpTestPeer &peer, peers_) {
+            start_counts.push_back(peer.update_count());
+        }
+
+        InetVpnPrefix prefix(InetVpnPrefix::FromString("0:0:192.168.24.0/24"));
+        vector<vector<InetVpnRoute *> > routes(ribouts_.size());
+        int routes_per_ribout = route_count_ / ribouts_.size();
+        TaskScheduler::GetInstance()->Stop();
+        {
+            ConcurrencyScope scope("db::DBTable");
+            for (size_t ro_idx = 0; ro_idx < ribouts_.size(); ++ro_idx) {
+                RibOut *ribout = &ribouts_[ro_idx];
+                for (int idx = 0; idx < routes_per_ribout; ++idx) {
+                    InetVpnRoute *rt = new InetVpnRoute(prefix);
+                    routes[ro_idx].push_back(rt);
+                    RouteUpdate *update =
+                        BuildUpdate(rt, *ribout, attr_[idx % kAttrCount]);
+                    ribout->updates()->Enqueue(rt, update);
+                }
+            }
+        }
+
+        uint64_t start = ClockMonotonicUsec();
+        TaskScheduler::GetInstance()->Start();
+        task_util::WaitForIdle();
+        TASK_UTIL_EXPECT_TRUE(UpdatesEmpty());
+        uint64_t elapsed = ClockMonotonicUsec() - start;
+
+        counts->clear();
+        for (size_t idx = 0; idx < peers_.size(); ++idx) {
+            counts->push_back(peers_[idx].update_count() - start_counts[idx]);
+        }
+
+        {
+            ConcurrencyScope scope("db::DBTable");
+            for (size_t ro_idx = 0; ro_idx < ribouts_.size(); ++ro_idx) {
+                BOOST_FOREACH(InetVpnRoute *rt, routes[ro_idx]) {
+                    DBState *state = rt->GetState(inetvpn_table_,
+                        ribouts_[ro_idx].listener_id());
+                    rt->ClearState(inetvpn_table_,
+                        ribouts_[ro_idx].listener_id());
+                    delete state;
+                }
+                STLDeleteValues(&routes[ro_idx]);
+            }
+        }
+        return elapsed;
+    }
+
+    EventManager evm_;
+    BgpServer server_;
+    DB db_;
+    InetVpnTable *inetvpn_table_;
+    SchedulingGroupManager mgr_;
+    MsgBuilderMock builder_;
+    boost::ptr_vector<BgpTestPeer> peers_;
+    boost::ptr_vector<RibOut> ribouts_;
+    std::vector<BgpAttrPtr> attr_;
+    int peer_count_;
+    int route_count_;
+    int saved_max_workers_;
+};
+
+TEST_F(BgpUpdateScaleTest, Converge) {
+    vector<int> serial_counts;
+    uint64_t serial_usec = Converge(1, &serial_counts);
+
+    vector<int> parallel_counts;
+    int max_workers = TaskScheduler::GetInstance()->HardwareThreadCount();
+    uint64_t parallel_usec = Converge(max_workers, &parallel_counts);
+
+    EXPECT_TRUE(serial_counts == parallel_counts);
+    BOOST_FOREACH(int count, serial_counts) {
+        EXPECT_NE(0, count);
+    }
+    LOG(DEBUG, "SchedulingGroup convergence for " << peers_.size() <<
+        " peers, " << ribouts_.size() << " ribouts and " << route_count_ <<
+        " routes: 1 worker " << serial_usec / 1000 << " msec, " <<
+        max_workers << " workers " << parallel_usec / 1000 << " msec");
+}
+
 static void SetUp() {
     bgp_log_test::init();
     ControlNode::SetDefaultSchedulingPolicy();
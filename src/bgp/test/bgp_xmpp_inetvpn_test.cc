@@ -7,6 +7,7 @@
 #include <boost/foreach.hpp>
 
 #include "base/task_annotations.h"
+#include "base/time_util.h"
 #include "base/test/task_test_util.h"
 #include "bgp/bgp_factory.h"
 #include "bgp/bgp_session_manager.h"
@@ -722,6 +723,93 @@ TEST_F(BgpXmppInetvpn2ControlNodeTest, MultipleRouteAddDelete2) {
     agent_b_->SessionDown();
 }
 
+//
+// Agent publishes all its routes in messages with many items, like it does
+// after reconnecting. Routes are exchanged correctly after the agent flaps.
+//
+TEST_F(BgpXmppInetvpn2ControlNodeTest, AgentReconnect) {
+    static const int kItemCount = 64;
+
+    Configure();
+    task_util::WaitForIdle();
+
+    // Create XMPP Agent A connected to XMPP server X.
+    agent_a_.reset(
+        new test::NetworkAgentMock(&evm_, "agent-a", xs_x_->GetPort(),
+            "127.0.0.1", "127.0.0.1"));
+    TASK_UTIL_EXPECT_TRUE(agent_a_->IsEstablished());
+
+    // Create XMPP Agent B connected to XMPP server Y.
+    agent_b_.reset(
+        new test::NetworkAgentMock(&evm_, "agent-b", xs_y_->GetPort(),
+            "127.0.0.2", "127.0.0.2"));
+    TASK_UTIL_EXPECT_TRUE(agent_b_->IsEstablished());
+
+    // Register to blue instance
+    agent_a_->Subscribe("blue", 1);
+    agent_b_->Subscribe("blue", 1);
+
+    vector<vector<string> > batches;
+    for (int idx = 0; idx < kRouteCount; idx += kItemCount) {
+        vector<string> prefixes;
+        for (int jdx = idx; jdx < idx + kItemCount && jdx < kRouteCount;
+             ++jdx) {
+            prefixes.push_back(BuildPrefix(jdx));
+        }
+        batches.push_back(prefixes);
+    }
+
+    for (int round = 0; round < 3; ++round) {
+        // Add routes from agent A.
+        uint64_t start = UTCTimestampUsec();
+        BOOST_FOREACH(const vector<string> &prefixes, batches) {
+            agent_a_->AddRoutes("blue", prefixes, "192.168.1.1", 200);
+        }
+        TASK_UTIL_EXPECT_EQ(kRouteCount, agent_b_->RouteCount("blue"));
+        LOG(DEBUG, "Round " << round << ": " << kRouteCount <<
+            " routes in messages of " << kItemCount << " items took " <<
+            (UTCTimestampUsec() - start) / 1000 << " msec");
+
+        // Verify that routes showed up on agents A and B.
+        for (int idx = 0; idx < kRouteCount; ++idx) {
+            VerifyRouteExists(
+                agent_a_, "blue", BuildPrefix(idx), "192.168.1.1", 200);
+            VerifyRouteExists(
+                agent_b_, "blue", BuildPrefix(idx), "192.168.1.1", 200);
+        }
+
+        // Flap agent A and verify that routes are removed from agent B.
+        agent_a_->SessionDown();
+        TASK_UTIL_EXPECT_EQ(0, agent_b_->RouteCount("blue"));
+        agent_a_->SessionUp();
+        TASK_UTIL_EXPECT_TRUE(agent_a_->IsEstablished());
+        agent_a_->Subscribe("blue", 1);
+    }
+
+    // Add routes and delete them, also in messages with many items.
+    BOOST_FOREACH(const vector<string> &prefixes, batches) {
+        agent_a_->AddRoutes("blue", prefixes, "192.168.1.1", 200);
+    }
+    TASK_UTIL_EXPECT_EQ(kRouteCount, agent_b_->RouteCount("blue"));
+    BOOST_FOREACH(const vector<string> &prefixes, batches) {
+        agent_a_->DeleteRoutes("blue", prefixes);
+    }
+
+    // Verify that routes are deleted at agents A and B.
+    for (int idx = 0; idx < kRouteCount; ++idx) {
+        VerifyRouteNoExists(agent_a_, "blue", BuildPrefix(idx));
+        VerifyRouteNoExists(agent_b_, "blue", BuildPrefix(idx));
+    }
+
+    // Unregister to blue instance
+    agent_a_->Unsubscribe("blue");
+    agent_b_->Unsubscribe("blue");
+
+    // Close the sessions.
+    agent_a_->SessionDown();
+    agent_b_->SessionDown();
+}
+
 //
 // Multiple routes are exchanged correctly.
 // Force creation of large update messages.
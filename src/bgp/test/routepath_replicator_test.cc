@@ -465,6 +465,16 @@ protected:
         TASK_UTIL_EXPECT_EQ(count, replicator->VpnTableStateRouteCount());
     }
 
+    size_t PrimaryRouteCount(const string &instance_name) {
+        BgpTable *table = static_cast<BgpTable *>(
+            bgp_server_->database()->FindTable(instance_name + ".inet.0"));
+        EXPECT_TRUE(table != NULL);
+        RoutePathReplicator *replicator =
+            bgp_server_->replicator(Address::INETVPN);
+        const TableState *ts = replicator->FindTableState(table);
+        return (ts ? ts->primary_route_count() : 0);
+    }
+
     EventManager evm_;
     DB config_db_;
     DBGraph config_graph_;
@@ -1934,6 +1944,73 @@ TEST_F(ReplicationTest, UpdateInstanceImportRouteTargets2) {
     TASK_UTIL_EXPECT_TRUE(InetRouteLookup("red", "10.0.1.1/32") == NULL);
 }
 
+//
+// Only routes with primary paths are evaluated when an import target is added
+// to or removed from another instance. Verify that secondary routes are not
+// kept track of as routes with primary paths.
+//
+TEST_F(ReplicationTest, UpdateInstanceImportRouteTargets3) {
+    vector<string> instance_names = list_of("blue")("red");
+    multimap<string, string> connections;
+    NetworkConfig(instance_names, connections);
+    task_util::WaitForIdle();
+
+    boost::system::error_code ec;
+    peers_.push_back(
+        new BgpPeerMock(Ip4Address::from_string("192.168.0.1", ec)));
+
+    // Add routes to blue and red tables.
+    AddInetRoute(peers_[0], "blue", "10.0.1.1/32", 100, "192.168.0.1:1");
+    AddInetRoute(peers_[0], "blue", "10.0.1.2/32", 100, "192.168.0.1:1");
+    AddInetRoute(peers_[0], "red", "10.0.2.1/32", 100, "192.168.0.1:2");
+    task_util::WaitForIdle();
+    VERIFY_EQ(2, RouteCount("blue"));
+    VERIFY_EQ(1, RouteCount("red"));
+    TASK_UTIL_EXPECT_EQ(2, PrimaryRouteCount("blue"));
+    TASK_UTIL_EXPECT_EQ(1, PrimaryRouteCount("red"));
+
+    // Add blue export target to red import target list.
+    AddInstanceImportRouteTarget("red", "target:64496:1");
+    TASK_UTIL_EXPECT_EQ(2, GetInstanceImportRouteTargetList("red").size());
+
+    // Make sure the blue routes are in the red table, but are not counted
+    // as routes with primary paths.
+    VERIFY_EQ(2, RouteCount("blue"));
+    VERIFY_EQ(3, RouteCount("red"));
+    TASK_UTIL_EXPECT_TRUE(InetRouteLookup("red", "10.0.1.1/32") != NULL);
+    TASK_UTIL_EXPECT_TRUE(InetRouteLookup("red", "10.0.1.2/32") != NULL);
+    TASK_UTIL_EXPECT_EQ(2, PrimaryRouteCount("blue"));
+    TASK_UTIL_EXPECT_EQ(1, PrimaryRouteCount("red"));
+
+    // Add a primary path for a route that's also a secondary route.
+    AddInetRoute(peers_[0], "red", "10.0.1.1/32", 100, "192.168.0.1:2");
+    task_util::WaitForIdle();
+    VERIFY_EQ(3, RouteCount("red"));
+    TASK_UTIL_EXPECT_EQ(2, PrimaryRouteCount("red"));
+
+    // Remove blue export target from red import target list.
+    RemoveInstanceRouteTarget("red", "target:64496:1");
+    TASK_UTIL_EXPECT_EQ(1, GetInstanceImportRouteTargetList("red").size());
+
+    // Make sure the secondary routes are gone from the red table.
+    VERIFY_EQ(2, RouteCount("blue"));
+    VERIFY_EQ(2, RouteCount("red"));
+    TASK_UTIL_EXPECT_TRUE(InetRouteLookup("red", "10.0.1.2/32") == NULL);
+    TASK_UTIL_EXPECT_EQ(2, PrimaryRouteCount("blue"));
+    TASK_UTIL_EXPECT_EQ(2, PrimaryRouteCount("red"));
+
+    // Delete routes from blue and red tables.
+    DeleteInetRoute(peers_[0], "blue", "10.0.1.1/32");
+    DeleteInetRoute(peers_[0], "blue", "10.0.1.2/32");
+    DeleteInetRoute(peers_[0], "red", "10.0.1.1/32");
+    DeleteInetRoute(peers_[0], "red", "10.0.2.1/32");
+    task_util::WaitForIdle();
+    VERIFY_EQ(0, RouteCount("blue"));
+    VERIFY_EQ(0, RouteCount("red"));
+    TASK_UTIL_EXPECT_EQ(0, PrimaryRouteCount("blue"));
+    TASK_UTIL_EXPECT_EQ(0, PrimaryRouteCount("red"));
+}
+
 TEST_F(ReplicationTest, UpdateInstanceExportRouteTargets) {
     vector<string> instance_names = list_of("blue")("red");
     multimap<string, string> connections;
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "bgp/xmpp_message_builder.h"
+
+#include <boost/foreach.hpp>
+#include <pugixml/pugixml.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/task_annotations.h"
+#include "base/test/task_test_util.h"
+#include "bgp/bgp_attr.h"
+#include "bgp/bgp_config.h"
+#include "bgp/bgp_log.h"
+#include "bgp/bgp_path.h"
+#include "bgp/bgp_ribout.h"
+#include "bgp/bgp_server.h"
+#include "bgp/bgp_table.h"
+#include "bgp/inet/inet_route.h"
+#include "bgp/routing-instance/routing_instance.h"
+#include "bgp/security_group/security_group.h"
+#include "bgp/tunnel_encap/tunnel_encap.h"
+#include "control-node/control_node.h"
+#include "io/event_manager.h"
+#include "schema/xmpp_unicast_types.h"
+#include "xmpp/xmpp_init.h"
+#include "testing/gunit.h"
+
+using pugi::xml_document;
+using pugi::xml_node;
+using std::auto_ptr;
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+class BgpPeerMock : public IPeer {
+public:
+    explicit BgpPeerMock(const string &name) : name_(name) { }
+    virtual string ToString() const { return name_; }
+    virtual string ToUVEKey() const { return name_; }
+    virtual bool SendUpdate(const uint8_t *msg, size_t msgsize) { return true; }
+    virtual BgpServer *server() { return NULL; }
+    virtual IPeerClose *peer_close() { return NULL; }
+    virtual IPeerDebugStats *peer_stats() { return NULL; }
+    virtual const IPeerDebugStats *peer_stats() const { return NULL; }
+    virtual bool IsReady() const { return true; }
+    virtual bool IsXmppPeer() const { return true; }
+    virtual void Close() { }
+    BgpProto::BgpPeerType PeerType() const { return BgpProto::IBGP; }
+    virtual uint32_t bgp_identifier() const { return 0; }
+    virtual const string GetStateName() const { return "UNKNOWN"; }
+    virtual void UpdateRefCount(int count) const { }
+    virtual tbb::atomic<int> GetRefCount() const {
+        tbb::atomic<int> count;
+        count = 0;
+        return count;
+    }
+
+private:
+    string name_;
+};
+
+class XmppMessageBuilderTest : public ::testing::Test {
+protected:
+    XmppMessageBuilderTest()
+        : server_(&evm_),
+          instance_config_(BgpConfigManager::kMasterInstance),
+          peer1_("agent-a"),
+          peer2_("agent-with-a-much-longer-name&co"),
+          table_(NULL) {
+    }
+
+    virtual void SetUp() {
+        ConcurrencyScope scope("bgp::Config");
+        server_.routing_instance_mgr()->CreateRoutingInstance(
+            &instance_config_);
+        table_ = static_cast<BgpTable *>(
+            server_.database()->FindTable("inet.0"));
+        ASSERT_TRUE(table_ != NULL);
+    }
+
+    virtual void TearDown() {
+        server_.Shutdown();
+        task_util::WaitForIdle();
+    }
+
+    BgpAttrPtr BuildAttr(uint32_t nexthop, const vector<uint32_t> &sgids,
+                         const vector<string> &encaps) {
+        BgpAttrSpec spec;
+        BgpAttrLocalPref local_pref(100);
+        spec.push_back(&local_pref);
+        BgpAttrNextHop attr_nexthop(nexthop);
+        spec.push_back(&attr_nexthop);
+        ExtCommunitySpec ext_community;
+        BOOST_FOREACH(uint32_t sgid, sgids) {
+            SecurityGroup sg(server_.autonomous_system(), sgid);
+            ext_community.communities.push_back(sg.GetExtCommunityValue());
+        }
+        BOOST_FOREACH(const string &encap, encaps) {
+            TunnelEncap tunnel_encap(encap);
+            ext_community.communities.push_back(
+                tunnel_encap.GetExtCommunityValue());
+        }
+        spec.push_back(&ext_community);
+        return server_.attr_db()->Locate(spec);
+    }
+
+    //
+    // Encode the message the way it used to be done i.e. by building a DOM
+    // with the schema generated types and saving the document.
+    //
+    string ReferenceEncode(const IPeerUpdate *peer, const RibOutAttr *roattr,
+                           const vector<const BgpRoute *> &routes) {
+        xml_document xdoc;
+        xml_node message = xdoc.append_child("message");
+        message.append_attribute("from") = XmppInit::kControlNodeJID;
+        string to = peer->ToString() + "/" + XmppInit::kBgpPeer;
+        message.append_attribute("to") = to.c_str();
+        xml_node event = message.append_child("event");
+        event.append_attribute("xmlns") = "http://jabber.org/protocol/pubsub";
+        xml_node items = event.append_child("items");
+        ostringstream node;
+        node << routes[0]->Afi() << "/" << int(routes[0]->XmppSafi()) <<
+            "/" << table_->routing_instance()->name();
+        items.append_attribute("node") = node.str().c_str();
+
+        BOOST_FOREACH(const BgpRoute *route, routes) {
+            if (!roattr->IsReachable()) {
+                xml_node retract = items.append_child("retract");
+                retract.append_attribute("id") =
+                    route->ToXmppIdString().c_str();
+                continue;
+            }
+
+            autogen::ItemType item;
+            item.entry.nlri.af = route->Afi();
+            item.entry.nlri.safi = route->XmppSafi();
+            item.entry.nlri.address = route->ToString();
+            item.entry.version = 1;
+            item.entry.virtual_network = "unresolved";
+            item.entry.local_preference = roattr->attr()->local_pref();
+            item.entry.sequence_number = 0;
+            BOOST_FOREACH(const RibOutAttr::NextHop &nexthop,
+                          roattr->nexthop_list()) {
+                autogen::NextHopType item_nexthop;
+                item_nexthop.af = route->NexthopAfi();
+                item_nexthop.address = nexthop.address().to_v4().to_string();
+                item_nexthop.label = nexthop.label();
+                vector<string> &encap_list =
+                    item_nexthop.tunnel_encapsulation_list.tunnel_encapsulation;
+                if (nexthop.encap().empty()) {
+                    encap_list.push_back(string("gre"));
+                } else {
+                    encap_list = nexthop.encap();
+                }
+                item.entry.next_hops.next_hop.push_back(item_nexthop);
+            }
+            const ExtCommunity *ext_community =
+                roattr->attr()->ext_community();
+            if (ext_community) {
+                BOOST_FOREACH(const ExtCommunity::ExtCommunityValue &comm,
+                              ext_community->communities()) {
+                    if (!ExtCommunity::is_security_group(comm))
+                        continue;
+                    SecurityGroup sg(comm);
+                    item.entry.security_group_list.security_group.push_back(
+                        sg.security_group_id());
+                }
+            }
+
+            xml_node xitem = items.append_child("item");
+            xitem.append_attribute("id") = route->ToXmppIdString().c_str();
+            item.Encode(&xitem);
+        }
+
+        ostringstream oss;
+        xdoc.save(oss);
+        return oss.str();
+    }
+
+    string GetData(Message *message, IPeerUpdate *peer) {
+        size_t length;
+        const uint8_t *data = message->GetData(peer, &length);
+        return string(reinterpret_cast<const char *>(data), length);
+    }
+
+    void VerifyMessage(const RibOutAttr *roattr,
+                       const vector<const BgpRoute *> &routes) {
+        BgpXmppMessageBuilder builder;
+        auto_ptr<Message> message(
+            builder.Create(table_, roattr, routes[0]));
+        for (size_t idx = 1; idx < routes.size(); ++idx) {
+            EXPECT_TRUE(message->AddRoute(routes[idx], roattr));
+        }
+        message->Finish();
+
+        // The 'to' attribute gets replaced for each peer, including when
+        // going back to a peer with a shorter name.
+        EXPECT_EQ(ReferenceEncode(&peer1_, roattr, routes),
+                  GetData(message.get(), &peer1_));
+        EXPECT_EQ(ReferenceEncode(&peer2_, roattr, routes),
+                  GetData(message.get(), &peer2_));
+        EXPECT_EQ(ReferenceEncode(&peer1_, roattr, routes),
+                  GetData(message.get(), &peer1_));
+    }
+
+    EventManager evm_;
+    BgpServer server_;
+    BgpInstanceConfig instance_config_;
+    BgpPeerMock peer1_;
+    BgpPeerMock peer2_;
+    BgpTable *table_;
+};
+
+//
+// Single route with one next-hop and no security groups.
+//
+TEST_F(XmppMessageBuilderTest, Reach1) {
+    InetRoute route(Ip4Prefix::FromString("10.1.1.0/24"));
+    BgpAttrPtr attr = BuildAttr(0x0a000001, vector<uint32_t>(),
+                                vector<string>());
+    RibOutAttr roattr(attr.get(), 16);
+    vector<const BgpRoute *> routes;
+    routes.push_back(&route);
+    VerifyMessage(&roattr, routes);
+}
+
+//
+// Multiple routes with multiple encaps and security groups.
+//
+TEST_F(XmppMessageBuilderTest, Reach2) {
+    vector<uint32_t> sgids;
+    sgids.push_back(8000001);
+    sgids.push_back(8000002);
+    vector<string> encaps;
+    encaps.push_back("gre");
+    encaps.push_back("udp");
+    BgpAttrPtr attr = BuildAttr(0x0a000001, sgids, encaps);
+    RibOutAttr roattr(attr.get(), 1024);
+
+    vector<InetRoute *> inet_routes;
+    vector<const BgpRoute *> routes;
+    for (int idx = 0; idx < 8; ++idx) {
+        Ip4Prefix prefix(Ip4Address(0x0a010000 + (idx << 8)), 24);
+        inet_routes.push_back(new InetRoute(prefix));
+        routes.push_back(inet_routes.back());
+    }
+    VerifyMessage(&roattr, routes);
+    STLDeleteValues(&inet_routes);
+}
+
+//
+// Route with ECMP next-hops.
+//
+TEST_F(XmppMessageBuilderTest, ReachEcmp) {
+    InetRoute route(Ip4Prefix::FromString("10.1.1.0/24"));
+    vector<uint32_t> sgids;
+    sgids.push_back(8000001);
+    BgpAttrPtr attr1 = BuildAttr(0x0a000001, sgids, vector<string>());
+    BgpAttrPtr attr2 = BuildAttr(0x0a000002, sgids, vector<string>());
+    BgpPeerMock peer1("peer1");
+    BgpPeerMock peer2("peer2");
+    route.InsertPath(new BgpPath(&peer1, BgpPath::BGP_XMPP, attr1, 0, 17));
+    route.InsertPath(new BgpPath(&peer2, BgpPath::BGP_XMPP, attr2, 0, 18));
+
+    RibOutAttr roattr(&route, route.BestPath()->GetAttr(), true);
+    EXPECT_EQ(2, roattr.nexthop_list().size());
+    vector<const BgpRoute *> routes;
+    routes.push_back(&route);
+    VerifyMessage(&roattr, routes);
+
+    route.RemovePath(&peer1);
+    route.RemovePath(&peer2);
+}
+
+//
+// Retracts for multiple routes.
+//
+TEST_F(XmppMessageBuilderTest, Unreach) {
+    RibOutAttr roattr;
+    vector<InetRoute *> inet_routes;
+    vector<const BgpRoute *> routes;
+    for (int idx = 0; idx < 16; ++idx) {
+        Ip4Prefix prefix(Ip4Address(0x0a010000 + (idx << 8)), 24);
+        inet_routes.push_back(new InetRoute(prefix));
+        routes.push_back(inet_routes.back());
+    }
+    VerifyMessage(&roattr, routes);
+    STLDeleteValues(&inet_routes);
+}
+
+static void SetUp() {
+    bgp_log_test::init();
+    ControlNode::SetDefaultSchedulingPolicy();
+}
+
+static void TearDown() {
+    task_util::WaitForIdle();
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Terminate();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    SetUp();
+    int result = RUN_ALL_TESTS();
+    TearDown();
+    return result;
+}
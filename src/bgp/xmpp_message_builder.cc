@@ -7,6 +7,8 @@
 #include <boost/foreach.hpp>
 #include <pugixml/pugixml.hpp>
 
+#include <cstdio>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -27,35 +29,156 @@
 #include "schema/xmpp_enet_types.h"
 #include "xmpp/xmpp_init.h"
 
-using pugi::xml_attribute;
 using pugi::xml_document;
 using pugi::xml_node;
-using std::ostringstream;
 using std::string;
 using std::stringstream;
 using std::vector;
 
+namespace {
+
+//
+// Appends XML to a string in the same format as pugixml's default output
+// i.e. one element per line, indented with tabs. This lets items get added
+// to a message without building a DOM and serializing it.
+//
+class XmlWriter {
+public:
+    explicit XmlWriter(string *repr) : repr_(repr) { }
+
+    void StartElement(int depth, const char *name) {
+        repr_->append(depth, '\t');
+        repr_->append("<").append(name).append(">\n");
+    }
+
+    void StartElement(int depth, const char *name, const char *attr,
+                      const string &value) {
+        repr_->append(depth, '\t');
+        repr_->append("<").append(name);
+        AppendAttribute(attr, value);
+        repr_->append(">\n");
+    }
+
+    void EndElement(int depth, const char *name) {
+        repr_->append(depth, '\t');
+        repr_->append("</").append(name).append(">\n");
+    }
+
+    void EmptyElement(int depth, const char *name) {
+        repr_->append(depth, '\t');
+        repr_->append("<").append(name).append(" />\n");
+    }
+
+    void EmptyElement(int depth, const char *name, const char *attr,
+                      const string &value) {
+        repr_->append(depth, '\t');
+        repr_->append("<").append(name);
+        AppendAttribute(attr, value);
+        repr_->append(" />\n");
+    }
+
+    void TextElement(int depth, const char *name, const string &value) {
+        repr_->append(depth, '\t');
+        repr_->append("<").append(name).append(">");
+        AppendEscaped(value, false);
+        repr_->append("</").append(name).append(">\n");
+    }
+
+    // Integer elements are declared as xsd:integer and hence formatted as
+    // an int by the schema generated code.
+    void TextElement(int depth, const char *name, int value) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%d", value);
+        TextElement(depth, name, string(buf));
+    }
+
+    void AppendAttribute(const char *attr, const string &value) {
+        repr_->append(" ").append(attr).append("=\"");
+        AppendEscaped(value, true);
+        repr_->append("\"");
+    }
+
+    // Escapes the characters that pugixml escapes. Quotes only need to be
+    // escaped in attribute values.
+    void AppendEscaped(const string &value, bool attr) {
+        size_t start = 0;
+        for (size_t idx = 0; idx < value.size(); ++idx) {
+            const char *entity;
+            switch (value[idx]) {
+            case '&':
+                entity = "&amp;";
+                break;
+            case '<':
+                entity = "&lt;";
+                break;
+            case '>':
+                entity = "&gt;";
+                break;
+            case '"':
+                if (!attr)
+                    continue;
+                entity = "&quot;";
+                break;
+            default:
+                continue;
+            }
+            repr_->append(value, start, idx - start).append(entity);
+            start = idx + 1;
+        }
+        repr_->append(value, start, string::npos);
+    }
+
+private:
+    string *repr_;
+};
+
+//
+// Adapter to print a pugixml node straight into a string.
+//
+class XmlStringWriter : public pugi::xml_writer {
+public:
+    explicit XmlStringWriter(string *repr) : repr_(repr) { }
+    virtual void write(const void *data, size_t size) {
+        repr_->append(static_cast<const char *>(data), size);
+    }
+
+private:
+    string *repr_;
+};
+
+}  // namespace
+
 class BgpXmppMessage : public Message {
 public:
     BgpXmppMessage(const BgpTable *table, const RibOutAttr *roattr)
         : table_(table),
           is_reachable_(roattr->IsReachable()),
-          sequence_number_(0) {
+          sequence_number_(0),
+          to_offset_(0),
+          to_length_(0),
+          finished_(false) {
     }
     virtual ~BgpXmppMessage() { }
     void Start(const RibOutAttr *roattr, const BgpRoute *route);
     virtual bool AddRoute(const BgpRoute *route, const RibOutAttr *roattr);
-    virtual void Finish() { }
+    virtual void Finish();
     virtual const uint8_t *GetData(IPeerUpdate *peer, size_t *lenp);
 
 private:
     static const uint32_t kMaxReachCount = 32;
     static const uint32_t kMaxUnreachCount = 256;
+    static const size_t kInitialSize = 8192;
 
-    void EncodeNextHop(const BgpRoute *route, RibOutAttr::NextHop nexthop,
-                       autogen::ItemType *item);
+    // Indentation depth of items in the message.
+    static const int kItemDepth = 3;
+
+    void EncodeNextHop(const BgpRoute *route,
+                       const RibOutAttr::NextHop &nexthop, XmlWriter *writer);
+    void EncodeIpEntryTail(const BgpRoute *route, const RibOutAttr *roattr);
     void AddIpReach(const BgpRoute *route, const RibOutAttr *roattr);
     void AddIpUnreach(const BgpRoute *route);
+    void AddRetract(const BgpRoute *route);
+    void AddItemNode(const xml_node &node);
     bool AddInetRoute(const BgpRoute *route, const RibOutAttr *roattr);
 
     bool AddInet6Route(const BgpRoute *route, const RibOutAttr *roattr);
@@ -101,27 +224,37 @@ private:
 
     const BgpTable *table_;
     bool is_reachable_;
-    xml_document xdoc_;
-    xml_node xitems_;
     uint32_t sequence_number_;
     string virtual_network_;
     vector<int> security_group_list_;
+
+    // The encoded message. The value of the 'to' attribute of the message
+    // element starts at to_offset_ and gets replaced for each peer.
     string repr_;
-    string repr_new_;
-    size_t repr_part1_;
-    size_t repr_part2_;
+    size_t to_offset_;
+    size_t to_length_;
+    bool finished_;
+
+    // Encoded next-hops and the remaining elements of an inet entry, which
+    // only depend on the RibOutAttr. All routes that get packed into the
+    // same message normally have the same RibOutAttr.
+    RibOutAttr entry_tail_roattr_;
+    string entry_tail_;
 
     DISALLOW_COPY_AND_ASSIGN(BgpXmppMessage);
 };
 
 void BgpXmppMessage::Start(const RibOutAttr *roattr, const BgpRoute *route) {
-    // Build the DOM tree
-    xml_node message = xdoc_.append_child("message");
-    message.append_attribute("from") = XmppInit::kControlNodeJID;
-
-    xml_node event = message.append_child("event");
-    event.append_attribute("xmlns") = "http://jabber.org/protocol/pubsub";
-    xitems_ = event.append_child("items");
+    repr_.reserve(kInitialSize);
+    repr_ = "<?xml version=\"1.0\"?>\n";
+    XmlWriter writer(&repr_);
+    repr_.append("<message");
+    writer.AppendAttribute("from", XmppInit::kControlNodeJID);
+    repr_.append(" to=\"");
+    to_offset_ = repr_.size();
+    repr_.append("\">\n");
+    writer.StartElement(1, "event", "xmlns",
+                        "http://jabber.org/protocol/pubsub");
 
     if (is_reachable_) {
         const BgpAttr *attr = roattr->attr();
@@ -135,22 +268,43 @@ void BgpXmppMessage::Start(const RibOutAttr *roattr, const BgpRoute *route) {
     stringstream ss;
     ss << route->Afi() << "/" << int(route->XmppSafi()) << "/" <<
           table_->routing_instance()->name();
-    string node(ss.str());
+    writer.StartElement(2, "items", "node", ss.str());
     if (table_->family() == Address::ERMVPN) {
-        xitems_.append_attribute("node") = node.c_str();
         AddMcastRoute(route, roattr);
     } else if (table_->family() == Address::EVPN) {
-        xitems_.append_attribute("node") = node.c_str();
         AddEnetRoute(route, roattr);
     } else if (table_->family() == Address::INET6) {
-        xitems_.append_attribute("node") = node.c_str();
         AddInet6Route(route, roattr);
     } else {
-        xitems_.append_attribute("node") = node.c_str();
         AddInetRoute(route, roattr);
     }
 }
 
+void BgpXmppMessage::Finish() {
+    if (finished_)
+        return;
+    XmlWriter writer(&repr_);
+    writer.EndElement(2, "items");
+    writer.EndElement(1, "event");
+    writer.EndElement(0, "message");
+    finished_ = true;
+}
+
+//
+// Add an item or retract that was built as a DOM node.
+//
+void BgpXmppMessage::AddItemNode(const xml_node &node) {
+    XmlStringWriter writer(&repr_);
+    node.print(writer, "\t", pugi::format_default, pugi::encoding_auto,
+               kItemDepth);
+}
+
+void BgpXmppMessage::AddRetract(const BgpRoute *route) {
+    XmlWriter writer(&repr_);
+    writer.EmptyElement(kItemDepth, "retract", "id",
+                        route->ToXmppIdString());
+}
+
 bool BgpXmppMessage::AddRoute(const BgpRoute *route, const RibOutAttr *roattr) {
     if (is_reachable_ && num_reach_route_ >= kMaxReachCount)
         return false;
@@ -169,60 +323,88 @@ bool BgpXmppMessage::AddRoute(const BgpRoute *route, const RibOutAttr *roattr) {
 }
 
 void BgpXmppMessage::EncodeNextHop(const BgpRoute *route,
-                                   RibOutAttr::NextHop nexthop,
-                                   autogen::ItemType *item) {
-    autogen::NextHopType item_nexthop;
-
-    item_nexthop.af = route->NexthopAfi();
-    item_nexthop.address = nexthop.address().to_v4().to_string();
-    item_nexthop.label = nexthop.label();
+                                   const RibOutAttr::NextHop &nexthop,
+                                   XmlWriter *writer) {
+    int depth = kItemDepth + 3;
+    writer->StartElement(depth, "next-hop");
+    writer->TextElement(depth + 1, "af", route->NexthopAfi());
+    writer->TextElement(depth + 1, "address",
+                        nexthop.address().to_v4().to_string());
+    writer->TextElement(depth + 1, "label", nexthop.label());
 
     // If encap list is empty use mpls over gre as default encap.
-    vector<string> &encap_list =
-        item_nexthop.tunnel_encapsulation_list.tunnel_encapsulation;
+    writer->StartElement(depth + 1, "tunnel-encapsulation-list");
     if (nexthop.encap().empty()) {
-        encap_list.push_back(string("gre"));
+        writer->TextElement(depth + 2, "tunnel-encapsulation", "gre");
     } else {
-        encap_list = nexthop.encap();
+        BOOST_FOREACH(const string &encap, nexthop.encap()) {
+            writer->TextElement(depth + 2, "tunnel-encapsulation", encap);
+        }
     }
-
-    item->entry.next_hops.next_hop.push_back(item_nexthop);
+    writer->EndElement(depth + 1, "tunnel-encapsulation-list");
+    writer->EndElement(depth, "next-hop");
 }
 
-void BgpXmppMessage::AddIpReach(const BgpRoute *route,
-                                const RibOutAttr *roattr) {
-    autogen::ItemType item;
-
-    item.entry.nlri.af = route->Afi();
-    item.entry.nlri.safi = route->XmppSafi();
-    item.entry.nlri.address = route->ToString();
-    item.entry.version = 1;
-    item.entry.virtual_network = GetVirtualNetwork(route);
-    item.entry.local_preference = roattr->attr()->local_pref();
-    item.entry.sequence_number = sequence_number_;
+//
+// Encode the elements of an inet entry that follow the nlri, which don't
+// depend on the route, into entry_tail_.
+//
+void BgpXmppMessage::EncodeIpEntryTail(const BgpRoute *route,
+                                       const RibOutAttr *roattr) {
+    entry_tail_roattr_ = *roattr;
+    entry_tail_.clear();
+    XmlWriter writer(&entry_tail_);
+    int depth = kItemDepth + 2;
 
     assert(!roattr->nexthop_list().empty());
 
     //
     // Encode all next-hops in the list
     //
-    BOOST_FOREACH(RibOutAttr::NextHop nexthop, roattr->nexthop_list()) {
-        EncodeNextHop(route, nexthop, &item);
+    writer.StartElement(depth, "next-hops");
+    BOOST_FOREACH(const RibOutAttr::NextHop &nexthop,
+                  roattr->nexthop_list()) {
+        EncodeNextHop(route, nexthop, &writer);
     }
+    writer.EndElement(depth, "next-hops");
 
-    for (vector<int>::iterator it = security_group_list_.begin();
-         it !=  security_group_list_.end(); ++it) {
-        item.entry.security_group_list.security_group.push_back(*it);
+    writer.TextElement(depth, "version", 1);
+    writer.TextElement(depth, "virtual-network", GetVirtualNetwork(route));
+    writer.TextElement(depth, "sequence-number", sequence_number_);
+    if (security_group_list_.empty()) {
+        writer.EmptyElement(depth, "security-group-list");
+    } else {
+        writer.StartElement(depth, "security-group-list");
+        for (vector<int>::iterator it = security_group_list_.begin();
+             it != security_group_list_.end(); ++it) {
+            writer.TextElement(depth + 1, "security-group", *it);
+        }
+        writer.EndElement(depth, "security-group-list");
     }
+    writer.TextElement(depth, "local-preference",
+                       roattr->attr()->local_pref());
+}
 
-    xml_node node = xitems_.append_child("item");
-    node.append_attribute("id") = route->ToXmppIdString().c_str();
-    item.Encode(&node);
+void BgpXmppMessage::AddIpReach(const BgpRoute *route,
+                                const RibOutAttr *roattr) {
+    if (entry_tail_.empty() || !(entry_tail_roattr_ == *roattr))
+        EncodeIpEntryTail(route, roattr);
+
+    XmlWriter writer(&repr_);
+    writer.StartElement(kItemDepth, "item", "id", route->ToXmppIdString());
+    writer.StartElement(kItemDepth + 1, "entry");
+    writer.StartElement(kItemDepth + 2, "nlri");
+    writer.TextElement(kItemDepth + 3, "af", route->Afi());
+    writer.TextElement(kItemDepth + 3, "safi", route->XmppSafi());
+    writer.TextElement(kItemDepth + 3, "address", route->ToString());
+    writer.EndElement(kItemDepth + 2, "nlri");
+    repr_.append(entry_tail_);
+    writer.EndElement(kItemDepth + 1, "entry");
+    writer.EndElement(kItemDepth, "item");
 }
 
 void BgpXmppMessage::AddIpUnreach(const BgpRoute *route) {
-    xml_node node = xitems_.append_child("retract");
-    node.append_attribute("id") = route->ToXmppIdString().c_str();
+    AddRetract(route);
 }
 
 bool BgpXmppMessage::AddInetRoute(const BgpRoute *route,
@@ -325,14 +507,15 @@ void BgpXmppMessage::AddEnetReach(const BgpRoute *route,
         EncodeEnetNextHop(route, nexthop, &item);
     }
 
-    xml_node node = xitems_.append_child("item");
+    xml_document xdoc;
+    xml_node node = xdoc.append_child("item");
     node.append_attribute("id") = route->ToXmppIdString().c_str();
     item.Encode(&node);
+    AddItemNode(node);
 }
 
 void BgpXmppMessage::AddEnetUnreach(const BgpRoute *route) {
-    xml_node node = xitems_.append_child("retract");
-    node.append_attribute("id") = route->ToXmppIdString().c_str();
+    AddRetract(route);
 }
 
 bool BgpXmppMessage::AddEnetRoute(const BgpRoute *route,
@@ -370,14 +553,15 @@ void BgpXmppMessage::AddMcastReach(const BgpRoute *route,
         item.entry.olist.next_hop.push_back(nh);
     }
 
-    xml_node node = xitems_.append_child("item");
+    xml_document xdoc;
+    xml_node node = xdoc.append_child("item");
     node.append_attribute("id") = route->ToXmppIdString().c_str();
     item.Encode(&node);
+    AddItemNode(node);
 }
 
 void BgpXmppMessage::AddMcastUnreach(const BgpRoute *route) {
-    xml_node node = xitems_.append_child("retract");
-    node.append_attribute("id") = route->ToXmppIdString().c_str();
+    AddRetract(route);
 }
 
 bool BgpXmppMessage::AddMcastRoute(const BgpRoute *route,
@@ -392,35 +576,21 @@ bool BgpXmppMessage::AddMcastRoute(const BgpRoute *route,
     return true;
 }
 
+//
+// Fill in the 'to' attribute for the peer. The rest of the message is
+// shared by all peers.
+//
 const uint8_t *BgpXmppMessage::GetData(IPeerUpdate *peer, size_t *lenp) {
-    string str = peer->ToString() + "/" + XmppInit::kBgpPeer;
-
-    // If the message has already been constructed, just replace the 'to' part.
-    if (!repr_.empty()) {
-        repr_new_ = string(repr_, 0, repr_part1_) + "to=\"" + str + "\">" +
-                    string(repr_, repr_part2_);
-
-        *lenp = repr_new_.size();
-        return reinterpret_cast<const uint8_t *>(repr_new_.c_str());
-    }
-
-    xml_node message =  xdoc_.child("message");
-    xml_attribute attr_to = message.attribute("to");
-    if (!attr_to) {
-        attr_to = message.append_attribute("to");
-    }
-    attr_to.set_value(str.c_str());
-    ostringstream oss;
-    xdoc_.save(oss);
-    repr_ = oss.str();
+    Finish();
 
-    repr_part1_ = repr_.find("to=", 0);
-    assert(repr_part1_ != string::npos);
-    repr_part2_ = repr_.find("\n\t<event xmlns");
-    assert(repr_part2_ != string::npos);
+    string to;
+    XmlWriter writer(&to);
+    writer.AppendEscaped(peer->ToString() + "/" + XmppInit::kBgpPeer, true);
+    repr_.replace(to_offset_, to_length_, to);
+    to_length_ = to.size();
 
     *lenp = repr_.size();
-    return reinterpret_cast<const uint8_t *>(repr_.c_str());
+    return reinterpret_cast<const uint8_t *>(repr_.data());
 }
 
 string BgpXmppMessage::GetVirtualNetwork(const BgpRoute *route) const {
@@ -36,6 +36,7 @@
 #include "ifmap/ifmap_sandesh_context.h"
 #include "ifmap/ifmap_server.h"
 #include "ifmap/ifmap_server_parser.h"
+#include "ifmap/ifmap_snapshot.h"
 #include "ifmap/ifmap_xmpp.h"
 #include "io/event_manager.h"
 #include "sandesh/common/vns_constants.h"
@@ -500,6 +501,10 @@ int main(int argc, char *argv[]) {
     }
 
     TaskScheduler::Initialize();
+    TaskScheduler::GetInstance()->SetGroupAffinity(
+        options.task_group_affinity());
+    TaskScheduler::GetInstance()->SetWorkStealing(
+        options.task_work_stealing());
     ControlNode::SetDefaultSchedulingPolicy();
 
     /* If Sandesh initialization is not being done via discovery we need to
@@ -666,6 +671,18 @@ int main(int argc, char *argv[]) {
 
     IFMapServerParser *ifmap_parser = IFMapServerParser::GetInstance("vnc_cfg");
 
+    // Populate the configuration database from the snapshot taken by the
+    // previous incarnation, before the connection to the IFMAP server is up.
+    std::auto_ptr<IFMapSnapshot> ifmap_snapshot;
+    if (!options.ifmap_snapshot_file().empty()) {
+        ifmap_snapshot.reset(
+            new IFMapSnapshot(ifmap_parser, options.ifmap_snapshot_file()));
+        ifmap_parser->set_snapshot(ifmap_snapshot.get());
+        ifmap_server.set_snapshot(ifmap_snapshot.get());
+        ifmap_snapshot->Load(&config_db);
+        ifmap_snapshot->Start(evm.io_service());
+    }
+
     IFMapManager *ifmapmgr = new IFMapManager(&ifmap_server,
                 options.ifmap_server_url(), options.ifmap_user(),
                 options.ifmap_password(), options.ifmap_certs_store(),
@@ -700,6 +717,13 @@ int main(int argc, char *argv[]) {
      */
     evm.Run();
 
+    if (ifmap_snapshot.get() != NULL) {
+        ifmap_parser->set_snapshot(NULL);
+        ifmap_server.set_snapshot(NULL);
+        ifmap_snapshot->Shutdown();
+        ifmap_snapshot->Write();
+    }
+
     ShutdownServers(&bgp_peer_manager, ds_client, node_info_log_timer.get());
 
     return 0;
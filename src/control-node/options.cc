@@ -116,6 +116,10 @@ void Options::Initialize(EventManager &evm,
              "Enable logging to syslog")
         ("DEFAULT.syslog_facility", opt::value<string>()->default_value("LOG_LOCAL0"),
              "Syslog facility to receive log lines")
+        ("DEFAULT.task_group_affinity", opt::bool_switch(&task_group_affinity_),
+             "Run the tasks of a group on the worker that last ran the group")
+        ("DEFAULT.task_work_stealing", opt::bool_switch(&task_work_stealing_),
+             "Let tasks stalled by an exclusion policy take the next turn")
         ("DEFAULT.test_mode", opt::bool_switch(&test_mode_),
              "Enable control-node to run in test-mode")
 
@@ -146,6 +150,8 @@ void Options::Initialize(EventManager &evm,
         ("IFMAP.server_url",
              opt::value<string>()->default_value(ifmap_server_url_),
              "IFMAP server URL")
+        ("IFMAP.snapshot_file", opt::value<string>(),
+             "File used to persist the IFMAP configuration across restarts")
         ("IFMAP.user", opt::value<string>()->default_value("control-node"),
              "IFMAP server username")
         ;
@@ -271,6 +277,7 @@ bool Options::Process(int argc, char *argv[],
     GetOptValue<string>(var_map, ifmap_server_url_, "IFMAP.server_url");
     GetOptValue<string>(var_map, ifmap_user_, "IFMAP.user");
     GetOptValue<string>(var_map, ifmap_certs_store_, "IFMAP.certs_store");
+    GetOptValue<string>(var_map, ifmap_snapshot_file_, "IFMAP.snapshot_file");
 
     return true;
 }
@@ -36,10 +36,15 @@ public:
     const std::string ifmap_password() const { return ifmap_password_; }
     const std::string ifmap_user() const { return ifmap_user_; }
     const std::string ifmap_certs_store() const { return ifmap_certs_store_; }
+    const std::string ifmap_snapshot_file() const {
+        return ifmap_snapshot_file_;
+    }
     const uint16_t xmpp_port() const { return xmpp_port_; }
     const bool xmpp_auth_enabled() const { return xmpp_auth_enable_; }
     const std::string xmpp_server_cert() const { return xmpp_server_cert_; }
     const std::string xmpp_server_key() const { return xmpp_server_key_; }
+    const bool task_group_affinity() const { return task_group_affinity_; }
+    const bool task_work_stealing() const { return task_work_stealing_; }
     const bool test_mode() const { return test_mode_; }
     const bool collectors_configured() const { return collectors_configured_; }
 
@@ -84,10 +89,13 @@ private:
     std::string ifmap_password_;
     std::string ifmap_user_;
     std::string ifmap_certs_store_;
+    std::string ifmap_snapshot_file_;
     uint16_t xmpp_port_;
     bool xmpp_auth_enable_;
     std::string xmpp_server_cert_;
     std::string xmpp_server_key_;
+    bool task_group_affinity_;
+    bool task_work_stealing_;
     bool test_mode_;
     bool collectors_configured_;
 
@@ -264,6 +264,18 @@ pugi::xml_document *XmppDocumentMock::RouteDeleteXmlDoc(
     return RouteAddDeleteXmlDoc(network, prefix, false);
 }
 
+pugi::xml_document *XmppDocumentMock::RouteAddBatchXmlDoc(
+        const std::string &network, const std::vector<std::string> &prefixes,
+        const NextHops &nexthops, const RouteAttributes &attributes) {
+    return RouteAddDeleteBatchXmlDoc(network, prefixes, true, nexthops,
+                                     attributes);
+}
+
+pugi::xml_document *XmppDocumentMock::RouteDeleteBatchXmlDoc(
+        const std::string &network, const std::vector<std::string> &prefixes) {
+    return RouteAddDeleteBatchXmlDoc(network, prefixes, false);
+}
+
 pugi::xml_document *XmppDocumentMock::Inet6RouteAddXmlDoc(
         const std::string &network, const std::string &prefix,
         const NextHops &nexthops, const RouteAttributes &attributes) {
@@ -345,16 +357,9 @@ pugi::xml_document *XmppDocumentMock::SubUnsubXmlDoc(
     return xdoc_.get();
 }
 
-pugi::xml_document *XmppDocumentMock::RouteAddDeleteXmlDoc(
-        const std::string &network, const std::string &prefix, bool add,
+void XmppDocumentMock::RouteItemAppend(pugi::xml_node *pub,
+        const std::string &prefix, bool add,
         const NextHops &nexthops, const RouteAttributes &attributes) {
-    xdoc_->reset();
-    xml_node pubsub = PubSubHeader(kNetworkServiceJID);
-    xml_node pub = pubsub.append_child("publish");
-    stringstream header;
-    header << BgpAf::IPv4 << "/" <<  BgpAf::Unicast << "/" <<
-              network.c_str() << "/" << prefix.c_str();
-    pub.append_attribute("node") = header.str().c_str();
     autogen::ItemType rt_entry;
     rt_entry.Clear();
     rt_entry.entry.nlri.af = BgpAf::IPv4;
@@ -393,8 +398,50 @@ pugi::xml_document *XmppDocumentMock::RouteAddDeleteXmlDoc(
         }
     }
 
-    xml_node item = pub.append_child("item");
+    xml_node item = pub->append_child("item");
     rt_entry.Encode(&item);
+}
+
+pugi::xml_document *XmppDocumentMock::RouteAddDeleteXmlDoc(
+        const std::string &network, const std::string &prefix, bool add,
+        const NextHops &nexthops, const RouteAttributes &attributes) {
+    xdoc_->reset();
+    xml_node pubsub = PubSubHeader(kNetworkServiceJID);
+    xml_node pub = pubsub.append_child("publish");
+    stringstream header;
+    header << BgpAf::IPv4 << "/" <<  BgpAf::Unicast << "/" <<
+              network.c_str() << "/" << prefix.c_str();
+    pub.append_attribute("node") = header.str().c_str();
+    RouteItemAppend(&pub, prefix, add, nexthops, attributes);
+    pubsub = PubSubHeader(kNetworkServiceJID);
+    xml_node collection = pubsub.append_child("collection");
+    collection.append_attribute("node") = network.c_str();
+    xml_node assoc = collection.append_child(
+            add ? "associate" : "dissociate");
+    assoc.append_attribute("node") = header.str().c_str();
+    return xdoc_.get();
+}
+
+//
+// Build a single publish message with an item for each prefix, the way an
+// agent sends its routes after reconnecting. The collection node refers to
+// the first prefix, since only the family in it is of interest.
+//
+pugi::xml_document *XmppDocumentMock::RouteAddDeleteBatchXmlDoc(
+        const std::string &network, const std::vector<std::string> &prefixes,
+        bool add, const NextHops &nexthops,
+        const RouteAttributes &attributes) {
+    assert(!prefixes.empty());
+    xdoc_->reset();
+    xml_node pubsub = PubSubHeader(kNetworkServiceJID);
+    xml_node pub = pubsub.append_child("publish");
+    stringstream header;
+    header << BgpAf::IPv4 << "/" <<  BgpAf::Unicast << "/" <<
+              network.c_str() << "/" << prefixes.front().c_str();
+    pub.append_attribute("node") = header.str().c_str();
+    BOOST_FOREACH(const std::string &prefix, prefixes) {
+        RouteItemAppend(&pub, prefix, add, nexthops, attributes);
+    }
     pubsub = PubSubHeader(kNetworkServiceJID);
     xml_node collection = pubsub.append_child("collection");
     collection.append_attribute("node") = network.c_str();
@@ -980,6 +1027,29 @@ void NetworkAgentMock::DeleteRoute(const string &network_name,
     peer->SendDocument(xdoc);
 }
 
+void NetworkAgentMock::AddRoutes(const string &network_name,
+                                 const vector<string> &prefixes,
+                                 const string nexthop, int local_pref) {
+    NextHops nexthops;
+    if (!nexthop.empty()) {
+        nexthops.push_back(NextHop(nexthop, 0));
+    }
+    RouteAttributes attributes(local_pref);
+
+    AgentPeer *peer = GetAgent();
+    xml_document *xdoc = impl_->RouteAddBatchXmlDoc(network_name, prefixes,
+                                                    nexthops, attributes);
+    peer->SendDocument(xdoc);
+}
+
+void NetworkAgentMock::DeleteRoutes(const string &network_name,
+                                    const vector<string> &prefixes) {
+    AgentPeer *peer = GetAgent();
+    xml_document *xdoc = impl_->RouteDeleteBatchXmlDoc(network_name,
+                                                       prefixes);
+    peer->SendDocument(xdoc);
+}
+
 void NetworkAgentMock::AddInet6Route(const string &network,
         const string &prefix, const NextHops &nexthops,
         const RouteAttributes &attributes) {
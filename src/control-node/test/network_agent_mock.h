@@ -8,6 +8,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <map>
+#include <vector>
 #include <pugixml/pugixml.hpp>
 #include <tbb/compat/condition_variable>
 #include <tbb/mutex.h>
@@ -154,6 +155,12 @@ public:
         const RouteAttributes &attributes = RouteAttributes());
     pugi::xml_document *RouteDeleteXmlDoc(const std::string &network, 
         const std::string &prefix);
+    pugi::xml_document *RouteAddBatchXmlDoc(const std::string &network,
+        const std::vector<std::string> &prefixes,
+        const NextHops &nexthops = NextHops(),
+        const RouteAttributes &attributes = RouteAttributes());
+    pugi::xml_document *RouteDeleteBatchXmlDoc(const std::string &network,
+        const std::vector<std::string> &prefixes);
 
     pugi::xml_document *Inet6RouteAddXmlDoc(const std::string &network,
         const std::string &prefix, const NextHops &nexthops,
@@ -202,6 +209,14 @@ private:
             const std::string &prefix, bool add,
             const NextHops &nexthop = NextHops(),
             const RouteAttributes &attributes = RouteAttributes());
+    pugi::xml_document *RouteAddDeleteBatchXmlDoc(
+            const std::string &network,
+            const std::vector<std::string> &prefixes, bool add,
+            const NextHops &nexthops = NextHops(),
+            const RouteAttributes &attributes = RouteAttributes());
+    void RouteItemAppend(pugi::xml_node *pub, const std::string &prefix,
+            bool add, const NextHops &nexthops,
+            const RouteAttributes &attributes);
     pugi::xml_document *RouteEnetAddDeleteXmlDoc(const std::string &network,
             const std::string &prefix, bool add,
             const NextHops &nexthops = NextHops(),
@@ -358,6 +373,11 @@ public:
     void AddRoute(const std::string &network, const std::string &prefix,
                   const NextHops &nexthops, const RouteAttributes &attributes);
     void DeleteRoute(const std::string &network, const std::string &prefix);
+    void AddRoutes(const std::string &network,
+                   const std::vector<std::string> &prefixes,
+                   const std::string nexthop = "", int local_pref = 0);
+    void DeleteRoutes(const std::string &network,
+                      const std::vector<std::string> &prefixes);
 
     void AddInet6Route(const std::string &network, const std::string &prefix,
         const NextHops &nexthops = NextHops(),
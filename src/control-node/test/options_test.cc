@@ -75,7 +75,10 @@ TEST_F(OptionsTest, NoArguments) {
     EXPECT_EQ(options_.ifmap_password(), "control-node");
     EXPECT_EQ(options_.ifmap_user(), "control-node");
     EXPECT_EQ(options_.ifmap_certs_store(), "");
+    EXPECT_EQ(options_.ifmap_snapshot_file(), "");
     EXPECT_EQ(options_.xmpp_port(), default_xmpp_port);
+    EXPECT_EQ(options_.task_group_affinity(), false);
+    EXPECT_EQ(options_.task_work_stealing(), false);
     EXPECT_EQ(options_.test_mode(), false);
 }
 
@@ -209,6 +212,8 @@ TEST_F(OptionsTest, CustomConfigFile) {
         "log_file_size=1024\n"
         "log_level=SYS_DEBUG\n"
         "log_local=1\n"
+        "task_group_affinity=1\n"
+        "task_work_stealing=1\n"
         "test_mode=1\n"
         "xmpp_server_port=100\n"
         "\n"
@@ -220,6 +225,7 @@ TEST_F(OptionsTest, CustomConfigFile) {
         "certs_store=test-store\n"
         "password=test-password\n"
         "server_url=https://127.0.0.1:100\n"
+        "snapshot_file=test-snapshot\n"
         "user=test-user\n";
 
     ofstream config_file;
@@ -263,7 +269,10 @@ TEST_F(OptionsTest, CustomConfigFile) {
     EXPECT_EQ(options_.ifmap_password(), "test-password");
     EXPECT_EQ(options_.ifmap_user(), "test-user");
     EXPECT_EQ(options_.ifmap_certs_store(), "test-store");
+    EXPECT_EQ(options_.ifmap_snapshot_file(), "test-snapshot");
     EXPECT_EQ(options_.xmpp_port(), 100);
+    EXPECT_EQ(options_.task_group_affinity(), true);
+    EXPECT_EQ(options_.task_work_stealing(), true);
     EXPECT_EQ(options_.test_mode(), true);
 }
 
@@ -2,6 +2,8 @@
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
 
+#include <cstdlib>
+
 #include "base/task.h"
 #include "db/db.h"
 #include "db/db_partition.h"
@@ -32,11 +34,23 @@ int DB::PartitionCount() {
 
     // Initialize static partition_count_.
     if (!partition_count_) {
-        partition_count_ = TaskScheduler::GetInstance()->HardwareThreadCount();
+        char *count_str = getenv("DB_PARTITION_COUNT");
+        if (count_str) {
+            partition_count_ = strtol(count_str, NULL, 0);
+        }
+        if (partition_count_ <= 0) {
+            partition_count_ =
+                TaskScheduler::GetInstance()->HardwareThreadCount();
+        }
     }
     return partition_count_;
 }
 
+void DB::SetPartitionCount(int count) {
+    assert(count > 0);
+    partition_count_ = count;
+}
+
 DB::DB() : walker_(new DBTableWalker()) {
     for (int i = 0; i < PartitionCount(); i++) {
         partitions_.push_back(new DBPartition(i));
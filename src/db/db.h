@@ -50,7 +50,12 @@ public:
     void SetGraph(const std::string &name, DBGraph *graph);
     void SetQueueDisable(bool disable);
 
+    // The partition count defaults to the number of hardware threads and
+    // can be overridden with the DB_PARTITION_COUNT environment variable.
+    // SetPartitionCount must be called before any DB is created.
     static int PartitionCount();
+    static void SetPartitionCount(int count);
+
     static void RegisterFactory(const std::string &prefix,
                                 CreateFunction create_fn);
     static void ClearFactoryRegistry();
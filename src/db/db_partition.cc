@@ -4,11 +4,14 @@
 
 #include "db/db_partition.h"
 
+#include <cstdlib>
 #include <list>
+#include <vector>
 #include <tbb/atomic.h>
 #include <tbb/concurrent_queue.h>
 #include <tbb/mutex.h>
 
+#include "base/mpsc_queue.h"
 #include "base/task.h"
 #include "db/db_client.h"
 #include "db/db_entry.h"
@@ -17,8 +20,11 @@ using tbb::concurrent_queue;
 using tbb::atomic;
 
 int DBPartition::db_partition_task_id_ = -1;
+DBPartition::RequestQueueType DBPartition::default_request_queue_type_ =
+    getenv("DB_REQUEST_QUEUE_MPSC") != NULL ?
+        DBPartition::MPSC_QUEUE : DBPartition::TBB_CONCURRENT_QUEUE;
 
-struct RequestQueueEntry {
+struct RequestQueueEntry : public MpscQueueNode {
     // Constructor takes ownership of DBRequest key, data.
     RequestQueueEntry(DBTablePartBase *tpart, DBClient *client, DBRequest *req)
         : tpart(tpart), client(client) {
@@ -41,11 +47,13 @@ class DBPartition::WorkQueue {
 public:
     static const int kThreshold = 1024;
     typedef concurrent_queue<RequestQueueEntry *> RequestQueue;
+    typedef MpscQueue<RequestQueueEntry> MpscRequestQueue;
     typedef concurrent_queue<RemoveQueueEntry *> RemoveQueue;
     typedef std::list<DBTablePartBase *> TablePartList;
 
-    explicit WorkQueue(int partition_id) 
-        : db_partition_id_(partition_id), disable_(false), running_(false) {
+    WorkQueue(int partition_id, RequestQueueType queue_type)
+        : queue_type_(queue_type), db_partition_id_(partition_id),
+          disable_(false), running_(false) {
         request_count_ = 0;
         max_request_queue_len_ = 0;
         total_request_count_ = 0;
@@ -58,25 +66,65 @@ public:
             delete req_entry;
         }
         request_queue_.clear();
+        RequestQueueEntry *req_entry;
+        while ((req_entry = mpsc_queue_.Dequeue()) != NULL) {
+            delete req_entry;
+        }
     }
 
     bool EnqueueRequest(RequestQueueEntry *req_entry) {
-        request_queue_.push(req_entry);
+        if (queue_type_ == MPSC_QUEUE) {
+            mpsc_queue_.Enqueue(req_entry);
+        } else {
+            request_queue_.push(req_entry);
+        }
         MaybeStartRunner();
         uint32_t max = request_count_.fetch_and_increment();
         if (max > max_request_queue_len_)
             max_request_queue_len_ = max;
         total_request_count_++;
         return max < (kThreshold - 1);
+    }
 
+    bool EnqueueRequestBatch(RequestQueueEntry **req_entries, size_t count) {
+        if (queue_type_ == MPSC_QUEUE) {
+            mpsc_queue_.EnqueueBatch(req_entries, count);
+        } else {
+            for (size_t idx = 0; idx < count; ++idx) {
+                request_queue_.push(req_entries[idx]);
+            }
+        }
+        MaybeStartRunner();
+        uint32_t max =
+            request_count_.fetch_and_add(static_cast<long>(count)) + count - 1;
+        if (max > max_request_queue_len_)
+            max_request_queue_len_ = max;
+        total_request_count_ += count;
+        return max < (kThreshold - 1);
     }
 
-    bool DequeueRequest(RequestQueueEntry **req_entry) {
-        bool success = request_queue_.try_pop(*req_entry);
-        if (success) {
-            request_count_.fetch_and_decrement();
+    // Dequeue up to max_count requests. Returns the number dequeued.
+    size_t DequeueRequestBatch(RequestQueueEntry **req_entries,
+                               size_t max_count) {
+        size_t count = 0;
+        if (queue_type_ == MPSC_QUEUE) {
+            count = mpsc_queue_.DequeueBatch(req_entries, max_count);
+        } else {
+            while (count < max_count &&
+                   request_queue_.try_pop(req_entries[count])) {
+                count++;
+            }
         }
-        return success;
+        if (count) {
+            request_count_.fetch_and_add(-static_cast<long>(count));
+        }
+        return count;
+    }
+
+    bool IsRequestQueueEmpty() const {
+        if (queue_type_ == MPSC_QUEUE)
+            return mpsc_queue_.empty();
+        return request_queue_.empty();
     }
 
     void EnqueueRemove(RemoveQueueEntry *rm_entry) {
@@ -111,7 +159,7 @@ public:
     }
 
     bool IsDBQueueEmpty() const {
-        return (request_queue_.empty() && change_list_.empty());
+        return (IsRequestQueueEmpty() && change_list_.empty());
     }
 
     bool disable() { return disable_; }
@@ -129,8 +177,12 @@ public:
         return max_request_queue_len_;
     }
 
+    RequestQueueType queue_type() const { return queue_type_; }
+
 private:
+    RequestQueueType queue_type_;
     RequestQueue request_queue_;
+    MpscRequestQueue mpsc_queue_;
     TablePartList change_list_;
     atomic<long> request_count_;
     uint64_t total_request_count_;
@@ -182,15 +234,25 @@ public:
             }
         }
 
-        RequestQueueEntry *req_entry = NULL;
-        while (queue_->DequeueRequest(&req_entry)) {
-            req_entry->tpart->Process(req_entry->client, &req_entry->request);
-            delete req_entry;
-            if (++count == kMaxIterations) {
+        RequestQueueEntry *req_entries[kMaxIterations];
+        while (true) {
+            size_t batch_count =
+                queue_->DequeueRequestBatch(req_entries, kMaxIterations - count);
+            if (batch_count == 0) {
+                break;
+            }
+            for (size_t idx = 0; idx < batch_count; ++idx) {
+                RequestQueueEntry *req_entry = req_entries[idx];
+                req_entry->tpart->Process(req_entry->client,
+                                          &req_entry->request);
+                delete req_entry;
+            }
+            count += batch_count;
+            if (count == kMaxIterations) {
                 return false;
             }
         }
-        
+
         while (true) {
             DBTablePartBase *tpart = queue_->GetActiveTable();
             if (tpart == NULL) {
@@ -225,7 +287,7 @@ void DBPartition::WorkQueue::MaybeStartRunner() {
 
 bool DBPartition::WorkQueue::RunnerDone() {
     tbb::mutex::scoped_lock lock(mutex_);
-    if (request_queue_.empty() && remove_queue_.empty()) {
+    if (IsRequestQueueEmpty() && remove_queue_.empty()) {
         running_ = false;
         return true;
     }
@@ -235,7 +297,7 @@ bool DBPartition::WorkQueue::RunnerDone() {
 }
 
 DBPartition::DBPartition(int partition_id)
-    : work_queue_(new WorkQueue(partition_id)) {
+    : work_queue_(new WorkQueue(partition_id, default_request_queue_type_)) {
     if (db_partition_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
         db_partition_task_id_ = scheduler->GetTaskId("db::DBTable");
@@ -253,6 +315,16 @@ bool DBPartition::EnqueueRequest(DBTablePartBase *tpart, DBClient *client,
     return work_queue_->EnqueueRequest(entry);
 }
 
+bool DBPartition::EnqueueRequestBatch(DBTablePartBase *tpart,
+                                      DBClient *client, DBRequest **reqs,
+                                      size_t count) {
+    std::vector<RequestQueueEntry *> entries(count);
+    for (size_t idx = 0; idx < count; ++idx) {
+        entries[idx] = new RequestQueueEntry(tpart, client, reqs[idx]);
+    }
+    return work_queue_->EnqueueRequestBatch(&entries[0], count);
+}
+
 void DBPartition::EnqueueRemove(DBTablePartBase *tpart, DBEntryBase *db_entry) {
     RemoveQueueEntry *entry = new RemoveQueueEntry(tpart, db_entry);
     db_entry->SetOnRemoveQ();
@@ -275,3 +347,15 @@ uint64_t DBPartition::total_request_count() const {
 uint64_t DBPartition::max_request_queue_len() const {
     return work_queue_->max_request_queue_len();
 }
+
+DBPartition::RequestQueueType DBPartition::request_queue_type() const {
+    return work_queue_->queue_type();
+}
+
+void DBPartition::SetDefaultRequestQueueType(RequestQueueType type) {
+    default_request_queue_type_ = type;
+}
+
+DBPartition::RequestQueueType DBPartition::default_request_queue_type() {
+    return default_request_queue_type_;
+}
@@ -21,6 +21,13 @@ class DBPartition {
 public:
     typedef boost::function<void(void)> Callback;
 
+    // Backend used for the request queue. The MPSC queue is lock-free on
+    // the enqueue side and lets the partition runner dequeue in batches.
+    enum RequestQueueType {
+        TBB_CONCURRENT_QUEUE,
+        MPSC_QUEUE,
+    };
+
     explicit DBPartition(int partition_id);
     ~DBPartition();
 
@@ -29,6 +36,10 @@ public:
     bool EnqueueRequest(DBTablePartBase *tpart, DBClient *client,
                         DBRequest *req);
 
+    // Enqueue count requests for the same table partition at once.
+    bool EnqueueRequestBatch(DBTablePartBase *tpart, DBClient *client,
+                             DBRequest **reqs, size_t count);
+
     void EnqueueRemove(DBTablePartBase *tpart, DBEntryBase *db_entry);
 
     // Enqueue table on change list.
@@ -39,11 +50,18 @@ public:
     long request_queue_len() const;
     uint64_t total_request_count() const;
     uint64_t max_request_queue_len() const;
+    RequestQueueType request_queue_type() const;
+
+    // Select the request queue backend for partitions created afterwards.
+    static void SetDefaultRequestQueueType(RequestQueueType type);
+    static RequestQueueType default_request_queue_type();
+
 private:
     class WorkQueue;
     class QueueRunner;
     std::auto_ptr<WorkQueue> work_queue_;
     static int db_partition_task_id_;
+    static RequestQueueType default_request_queue_type_;
     DISALLOW_COPY_AND_ASSIGN(DBPartition);
 };
 
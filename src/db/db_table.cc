@@ -2,6 +2,7 @@
  * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
  */
 
+#include <algorithm>
 #include <vector>
 #include <tbb/atomic.h>
 #include <tbb/spin_rw_mutex.h>
@@ -188,6 +189,42 @@ bool DBTableBase::Enqueue(DBRequest *req) {
     return partition->EnqueueRequest(tpart, NULL, req);
 }
 
+typedef pair<DBTablePartBase *, DBRequest *> PartRequest;
+
+static bool PartRequestCompare(const PartRequest &lhs,
+                               const PartRequest &rhs) {
+    return lhs.first->index() < rhs.first->index();
+}
+
+bool DBTableBase::Enqueue(const vector<DBRequest *> &reqs) {
+    vector<PartRequest> part_reqs;
+    part_reqs.reserve(reqs.size());
+    for (vector<DBRequest *>::const_iterator it = reqs.begin();
+         it != reqs.end(); ++it) {
+        part_reqs.push_back(
+            make_pair(GetTablePartition((*it)->key.get()), *it));
+    }
+    stable_sort(part_reqs.begin(), part_reqs.end(), PartRequestCompare);
+
+    bool result = true;
+    vector<DBRequest *> batch;
+    for (size_t start = 0, end; start < part_reqs.size(); start = end) {
+        DBTablePartBase *tpart = part_reqs[start].first;
+        batch.clear();
+        for (end = start; end < part_reqs.size() &&
+             part_reqs[end].first == tpart; ++end) {
+            batch.push_back(part_reqs[end].second);
+        }
+        DBPartition *partition = db_->GetPartition(tpart->index());
+        enqueue_count_ += batch.size();
+        if (!partition->EnqueueRequestBatch(tpart, NULL, &batch[0],
+                                            batch.size())) {
+            result = false;
+        }
+    }
+    return result;
+}
+
 void DBTableBase::EnqueueRemove(DBEntryBase *db_entry) {
     DBTablePartBase *tpart = GetTablePartition(db_entry);
     DBPartition *partition = db_->GetPartition(tpart->index());
@@ -319,6 +356,21 @@ size_t DBTable::Size() const {
     return total;
 }
 
+//
+// Concurrency: called from task that's mutually exclusive with db::DBTable.
+//
+void DBTable::FillPartitions(vector<ShowTablePartition> *partitions) const {
+    for (int idx = 0; idx < PartitionCount(); ++idx) {
+        const DBTablePartition *partition = partitions_[idx];
+        ShowTablePartition item;
+        item.index = idx;
+        item.size = partition->size();
+        item.input_count = partition->input_count();
+        item.notify_count = partition->notify_count();
+        partitions->push_back(item);
+    }
+}
+
 void DBTable::Input(DBTablePartition *tbl_partition, DBClient *client,
                     DBRequest *req) {
     DBRequestKey *key = 
@@ -19,6 +19,7 @@ class DBEntry;
 class DBTablePartBase;
 class DBTablePartition;
 class ShowTableListener;
+class ShowTablePartition;
 
 class DBRequestKey {
 public:
@@ -63,6 +64,12 @@ public:
 
     // Enqueue a request to the table. Takes ownership of the data.
     bool Enqueue(DBRequest *req);
+
+    // Enqueue a list of requests to the table. Requests are grouped by
+    // table partition, keeping their relative order, and each group is
+    // added to the partition's queue in one go. Takes ownership of the
+    // data of all the requests.
+    bool Enqueue(const std::vector<DBRequest *> &reqs);
     void EnqueueRemove(DBEntryBase *db_entry);
 
     // Determine the table partition depending on the record key.
@@ -220,6 +227,9 @@ public:
     // Calculate the size across all partitions.
     virtual size_t Size() const;
 
+    // Per-partition size and load counters.
+    void FillPartitions(std::vector<ShowTablePartition> *partitions) const;
+
     // helper functions
 
     // Delete all the state entries of a specific listener.
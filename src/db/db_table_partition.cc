@@ -45,6 +45,7 @@ bool DBTablePartBase::RunNotify() {
 
         parent()->RunNotify(this, entry);
         entry->clear_onlist();
+        notify_count_++;
 
         // If the entry is marked deleted and all DBStates are removed
         // and it's not already on the remove queue, it can be removed
@@ -89,6 +90,7 @@ DBTablePartition::DBTablePartition(DBTable *table, int index)
 void DBTablePartition::Process(DBClient *client, DBRequest *req) {
     DBTable *table = static_cast<DBTable *>(parent());
     table->incr_input_count();
+    incr_input_count();
     table->Input(this, client, req);
 }
 
@@ -190,6 +192,23 @@ DBEntry *DBTablePartition::GetNext(const DBEntryBase *key) {
     return NULL;
 }
 
+//
+// Collect the batch under a single acquisition of the partition lock.
+//
+DBEntry *DBTablePartition::GetBatch(DBEntry *entry, size_t count,
+                                    vector<DBEntryBase *> *batch) {
+    tbb::mutex::scoped_lock lock(mutex_);
+
+    Tree::iterator it = tree_.iterator_to(*entry);
+    for (; it != tree_.end() && count > 0; ++it, --count) {
+        batch->push_back(it.operator->());
+    }
+    if (it != tree_.end()) {
+        return it.operator->();
+    }
+    return NULL;
+}
+
 DBTable *DBTablePartition::table() {
     return static_cast<DBTable *>(parent());
 }
@@ -5,6 +5,7 @@
 #ifndef ctrlplane_db_table_partition_h
 #define ctrlplane_db_table_partition_h
 
+#include <vector>
 #include <boost/intrusive/list.hpp>
 #include <tbb/mutex.h>
 
@@ -25,7 +26,7 @@ public:
 
 
     DBTablePartBase(DBTableBase *tbl_base, int index)
-        : parent_(tbl_base), index_(index) {
+        : parent_(tbl_base), index_(index), input_count_(0), notify_count_(0) {
     }
 
     // Input processing stage for DBRequests. Called from per-partition thread.
@@ -53,11 +54,19 @@ public:
         return dbstate_mutex_;
     }
 
+    // Load counters. Only updated from the DBPartition task that owns the
+    // shard, so no atomics are needed.
+    uint64_t input_count() const { return input_count_; }
+    void incr_input_count() { input_count_++; }
+    uint64_t notify_count() const { return notify_count_; }
+
     virtual ~DBTablePartBase() {};
 private:
     tbb::mutex dbstate_mutex_;
     DBTableBase *parent_;
     int index_;
+    uint64_t input_count_;
+    uint64_t notify_count_;
     ChangeList change_list_;
     DISALLOW_COPY_AND_ASSIGN(DBTablePartBase);
 };
@@ -81,6 +90,11 @@ public:
     // Returns the next route (Doesn't search). Threaded walk
     virtual DBEntry *GetNext(const DBEntryBase *entry);
 
+    // Append up to count entries starting at entry to the batch, in tree
+    // order. Returns the entry following the last one added, if any.
+    DBEntry *GetBatch(DBEntry *entry, size_t count,
+                      std::vector<DBEntryBase *> *batch);
+
     virtual DBEntry *GetFirst();
     
     ///////////////////////////////////////////////////////////
@@ -4,6 +4,7 @@
 
 #include "db/db_table_walker.h"
 
+#include <algorithm>
 #include <tbb/atomic.h>
 
 #include "base/logging.h"
@@ -17,15 +18,55 @@ int DBTableWalker::walker_task_id_ = -1;
 
 class DBTableWalker::Walker {
 public:
-    Walker(WalkId id, DBTableWalker *wkmgr, DBTable *table,
-           const DBRequestKey *key, WalkFn walker, 
-           WalkCompleteFn walk_done);
+    // A walk request. Coalesced requests share the Walker and its workers.
+    struct Request {
+        Request(WalkId id, WalkFn walker_fn, WalkBatchFn batch_fn,
+                WalkCompleteFn done_fn)
+            : id_(id), walker_fn_(walker_fn), batch_fn_(batch_fn),
+              done_fn_(done_fn) {
+            should_stop_ = false;
+        }
 
-    void StopWalk() {
-        should_stop_.fetch_and_store(true);
+        WalkId id_;
+        WalkFn walker_fn_;
+        WalkBatchFn batch_fn_;
+        WalkCompleteFn done_fn_;
+
+        // Will be true if this request is cancelled
+        tbb::atomic<bool> should_stop_;
+    };
+    typedef std::vector<Request *> RequestList;
+
+    Walker(DBTableWalker *wkmgr, DBTable *table, const DBRequestKey *key,
+           bool batch);
+    ~Walker();
+
+    void AddRequest(WalkId id, WalkFn walker_fn, WalkBatchFn batch_fn,
+                    WalkCompleteFn done_fn);
+
+    // Only batch walks are coalesced: their walker functions don't remove
+    // entries, so an entry stays valid for every request sharing the walk.
+    // Concurrency: called with walkers_mutex_ held.
+    bool CanCoalesce(const DBTable *table, const DBRequestKey *key,
+                     bool batch) const {
+        return (batch && batch_ && !started_ && !should_stop_ &&
+                table_ == table && key == NULL && key_start_.get() == NULL);
     }
 
-    WalkId  id_;
+    // Stop the walk once all the coalesced requests are cancelled.
+    void StopWalk(WalkId id) {
+        bool all_stopped = true;
+        for (RequestList::iterator iter = requests_.begin();
+             iter != requests_.end(); ++iter) {
+            Request *request = *iter;
+            if (request->id_ == id)
+                request->should_stop_ = true;
+            if (!request->should_stop_)
+                all_stopped = false;
+        }
+        if (all_stopped)
+            should_stop_.fetch_and_store(true);
+    }
 
     // Parent walker manager
     DBTableWalker *wkmgr_;
@@ -36,10 +77,16 @@ public:
     // Take the ownership of key passed
     std::auto_ptr<DBRequestKey> key_start_;
 
-    WalkFn walker_fn_;
-    WalkCompleteFn done_fn_;
+    // Walk invokes WalkBatchFn instead of WalkFn
+    bool batch_;
+
+    // Requests served by this walk. Not modified once the walk has started.
+    RequestList requests_;
 
-    // Will be true if Table walk is cancelled
+    // Set under walkers_mutex_ by the first worker that starts running.
+    bool started_;
+
+    // Will be true if all the requests are cancelled
     tbb::atomic<bool> should_stop_;
 
     // check whether iteraton is completed on all Table Partition
@@ -50,7 +97,7 @@ class DBTableWalker::Worker : public Task {
 public:
     Worker(Walker *walker, int db_partition_id, const DBRequestKey *key) 
         : Task(walker_task_id_, db_partition_id), walker_(walker), 
-          key_start_(key) {
+          key_start_(key), started_(false) {
         tbl_partition_ = static_cast<DBTablePartition *>(
             walker_->table_->GetTablePartition(db_partition_id));
     }
@@ -58,6 +105,12 @@ public:
     virtual bool Run();
 
 private:
+    void Start();
+    bool WalkEntries(DBEntry *entry);
+    bool WalkBatches(DBEntry *entry);
+    bool InvokeWalkFn(DBEntry *entry);
+    bool InvokeBatchFn(const EntryBatch &batch);
+
     DBTableWalker::Walker *walker_;
 
     // Store the last visited node to continue walk
@@ -68,6 +121,10 @@ private:
 
     // Table partition for which this worker was created
     DBTablePartition *tbl_partition_;
+
+    // Requests whose walker function returned false on this partition
+    std::vector<bool> done_;
+    bool started_;
 };
 
 static void db_walker_wait() {
@@ -86,10 +143,124 @@ static void db_walker_wait() {
     }
 }
 
-bool DBTableWalker::Worker::Run() {
+//
+// Mark the walk as started, so that no more requests are coalesced into it.
+//
+void DBTableWalker::Worker::Start() {
+    tbb::mutex::scoped_lock lock(walker_->wkmgr_->walkers_mutex_);
+    walker_->started_ = true;
+    done_.assign(walker_->requests_.size(), false);
+    started_ = true;
+}
+
+//
+// Invoke the walker functions of all active requests on the entry.
+// Returns false if there are no more active requests on this partition.
+//
+bool DBTableWalker::Worker::InvokeWalkFn(DBEntry *entry) {
+    bool more = false;
+    for (size_t idx = 0; idx < walker_->requests_.size(); ++idx) {
+        Walker::Request *request = walker_->requests_[idx];
+        if (done_[idx] || request->should_stop_)
+            continue;
+        if (!request->walker_fn_(tbl_partition_, entry)) {
+            done_[idx] = true;
+            continue;
+        }
+        more = true;
+    }
+    return more;
+}
+
+bool DBTableWalker::Worker::InvokeBatchFn(const EntryBatch &batch) {
+    bool more = false;
+    for (size_t idx = 0; idx < walker_->requests_.size(); ++idx) {
+        Walker::Request *request = walker_->requests_[idx];
+        if (done_[idx] || request->should_stop_)
+            continue;
+        if (!request->batch_fn_(tbl_partition_, batch)) {
+            done_[idx] = true;
+            continue;
+        }
+        more = true;
+    }
+    return more;
+}
+
+//
+// Walk the partition one entry at a time. Returns false if the walk needs
+// to yield, after storing the context to resume from.
+//
+bool DBTableWalker::Worker::WalkEntries(DBEntry *entry) {
     int count = 0;
+    for (DBEntry *next = NULL; entry; entry = next) {
+        next = tbl_partition_->GetNext(entry);
+        // Check whether Walker was requested to be cancelled
+        if (walker_->should_stop_) {
+            break; 
+        }
+        if (count == GetIterationToYield()) {
+            // store the context
+            walk_ctx_ = entry->GetDBRequestKey();
+            return false;
+        }
+
+        // Invoke walker function
+        bool more = InvokeWalkFn(entry);
+        if (!more) {
+            break;
+        }
+
+        db_walker_wait();
+        count++;
+    }
+    return true;
+}
+
+//
+// Walk the partition in batches. The batch walker functions don't remove
+// entries, so the entry following a batch remains valid until the next
+// batch is collected.
+//
+bool DBTableWalker::Worker::WalkBatches(DBEntry *entry) {
+    int count = 0;
+    EntryBatch batch;
+    batch.reserve(kBatchSize);
+    while (entry) {
+        // Check whether Walker was requested to be cancelled
+        if (walker_->should_stop_) {
+            break;
+        }
+        if (count >= GetIterationToYield()) {
+            // store the context
+            walk_ctx_ = entry->GetDBRequestKey();
+            return false;
+        }
+
+        batch.clear();
+        int batch_size = kBatchSize;
+        batch_size = std::min(batch_size, GetIterationToYield() - count);
+        entry = tbl_partition_->GetBatch(entry, batch_size, &batch);
+
+        // Invoke walker function
+        bool more = InvokeBatchFn(batch);
+        if (!more) {
+            break;
+        }
+
+        db_walker_wait();
+        count += batch.size();
+    }
+    return true;
+}
+
+bool DBTableWalker::Worker::Run() {
     DBRequestKey *key_resume;
 
+    if (!started_) {
+        Start();
+    }
+
     // Check whether Walker was requested to be cancelled
     if (walker_->should_stop_) {
         goto walk_done;
@@ -115,54 +286,43 @@ bool DBTableWalker::Worker::Run() {
         goto walk_done;
     }
 
-    for (DBEntry *next = NULL; entry; entry = next) {
-        next = tbl_partition_->GetNext(entry);
-        // Check whether Walker was requested to be cancelled
-        if (walker_->should_stop_) {
-            break; 
-        }
-        if (count == GetIterationToYield()) {
-            // store the context
-            walk_ctx_ = entry->GetDBRequestKey();
+    if (walker_->batch_) {
+        if (!WalkBatches(entry))
+            return false;
+    } else {
+        if (!WalkEntries(entry))
             return false;
-        }
-
-        // Invoke walker function
-        bool more = walker_->walker_fn_(tbl_partition_, entry);
-        if (!more) {
-            break;
-        }
-
-        db_walker_wait();
-        count++;
     }
 
 walk_done:
     // Check whether all other walks on the table is completed
     long num_walkers_on_tpart = walker_->status_.fetch_and_decrement();
     if (num_walkers_on_tpart == 1) {
-        if (walker_->should_stop_) {
-            walker_->table_->incr_walk_cancel_count();
-        } else {
-            walker_->table_->incr_walk_complete_count();
-            // Invoke Walker_Complete callback
-            if (walker_->done_fn_ != NULL) {
-                walker_->done_fn_(walker_->table_);
+        for (Walker::RequestList::iterator iter = walker_->requests_.begin();
+             iter != walker_->requests_.end(); ++iter) {
+            Walker::Request *request = *iter;
+            if (request->should_stop_) {
+                walker_->table_->incr_walk_cancel_count();
+            } else {
+                walker_->table_->incr_walk_complete_count();
+                // Invoke Walker_Complete callback
+                if (request->done_fn_ != NULL) {
+                    request->done_fn_(walker_->table_);
+                }
             }
         }
 
         // Release the memory for walker and bitmap
-        walker_->wkmgr_->PurgeWalker(walker_->id_);
+        walker_->wkmgr_->PurgeWalker(walker_);
     }
     return true;
 }
 
-DBTableWalker::Walker::Walker(WalkId id, DBTableWalker *wkmgr,
-                              DBTable *table, const DBRequestKey *key,
-                              WalkFn walker, WalkCompleteFn walk_done)
-    : id_(id), wkmgr_(wkmgr), table_(table),
-      key_start_(const_cast<DBRequestKey *>(key)), 
-      walker_fn_(walker), done_fn_(walk_done) {
+DBTableWalker::Walker::Walker(DBTableWalker *wkmgr, DBTable *table,
+                              const DBRequestKey *key, bool batch)
+    : wkmgr_(wkmgr), table_(table),
+      key_start_(const_cast<DBRequestKey *>(key)), batch_(batch),
+      started_(false) {
     int num_worker = table->PartitionCount();
     should_stop_ = false;
     status_ = num_worker;
@@ -173,6 +333,16 @@ DBTableWalker::Walker::Walker(WalkId id, DBTableWalker *wkmgr,
     }
 }
 
+DBTableWalker::Walker::~Walker() {
+    STLDeleteValues(&requests_);
+}
+
+void DBTableWalker::Walker::AddRequest(WalkId id, WalkFn walker_fn,
+                                       WalkBatchFn batch_fn,
+                                       WalkCompleteFn done_fn) {
+    requests_.push_back(new Request(id, walker_fn, batch_fn, done_fn));
+}
+
 DBTableWalker::DBTableWalker() {
     if (walker_task_id_ == -1) {
         TaskScheduler *scheduler = TaskScheduler::GetInstance();
@@ -181,59 +351,97 @@ DBTableWalker::DBTableWalker() {
     }
 }
 
-DBTableWalker::WalkId DBTableWalker::WalkTable(DBTable *table, 
-                                               const DBRequestKey *key_start, 
-                                               WalkFn walkerfn , 
-                                               WalkCompleteFn walk_complete) {
-    table->incr_walk_request_count();
-    tbb::mutex::scoped_lock lock(walkers_mutex_);
+//
+// Concurrency: called with walkers_mutex_ held.
+//
+DBTableWalker::WalkId DBTableWalker::AllocWalkId(Walker *walker) {
     size_t i = walker_map_.find_first();
     if (i == walker_map_.npos) {
         i = walkers_.size();
-        Walker *walker = new Walker(i, this, table, key_start, 
-                                    walkerfn, walk_complete);
         walkers_.push_back(walker);
     } else {
         walker_map_.reset(i);
         if (walker_map_.none()) {
             walker_map_.clear();
         }
-        Walker *walker = new Walker(i, this, table, key_start, 
-                                    walkerfn, walk_complete);
         walkers_[i] = walker;
     }
-    table->incr_walker_count();
     return i;
 }
 
+DBTableWalker::WalkId DBTableWalker::AddWalker(DBTable *table,
+                                               const DBRequestKey *key_start,
+                                               WalkFn walkerfn,
+                                               WalkBatchFn batchfn,
+                                               WalkCompleteFn walk_complete) {
+    table->incr_walk_request_count();
+    bool batch = !batchfn.empty();
+    tbb::mutex::scoped_lock lock(walkers_mutex_);
+
+    // Look for a pending walk on the same table to piggyback on.
+    Walker *walker = NULL;
+    for (WalkerList::const_iterator iter = walkers_.begin();
+         iter != walkers_.end(); ++iter) {
+        if (*iter && (*iter)->CanCoalesce(table, key_start, batch)) {
+            walker = *iter;
+            break;
+        }
+    }
+    if (walker == NULL) {
+        walker = new Walker(this, table, key_start, batch);
+    }
+
+    WalkId id = AllocWalkId(walker);
+    walker->AddRequest(id, walkerfn, batchfn, walk_complete);
+    table->incr_walker_count();
+    return id;
+}
+
+DBTableWalker::WalkId DBTableWalker::WalkTable(DBTable *table, 
+                                               const DBRequestKey *key_start, 
+                                               WalkFn walkerfn , 
+                                               WalkCompleteFn walk_complete) {
+    return AddWalker(table, key_start, walkerfn, NULL, walk_complete);
+}
+
+DBTableWalker::WalkId DBTableWalker::WalkTableBatch(DBTable *table,
+                                                    const DBRequestKey *key_start,
+                                                    WalkBatchFn batchfn,
+                                                    WalkCompleteFn walk_complete) {
+    return AddWalker(table, key_start, NULL, batchfn, walk_complete);
+}
+
 void DBTableWalker::WalkCancel(WalkId id) {
     tbb::mutex::scoped_lock lock(walkers_mutex_);
-    walkers_[id]->StopWalk();
+    walkers_[id]->StopWalk(id);
     // Purge to be called after task has stopped
 }
 
-void DBTableWalker::PurgeWalker(WalkId id) {
+void DBTableWalker::PurgeWalker(Walker *walker) {
     tbb::mutex::scoped_lock lock(walkers_mutex_);
-    Walker *walker = walkers_[id];
     DBTable *table = walker->table_;
-    delete walker;
-    walkers_[id] = NULL;
-    if ((size_t) id == walkers_.size() - 1) {
-        while (!walkers_.empty() && walkers_.back() == NULL) {
-            walkers_.pop_back();
-        }
-        if (walker_map_.size() > walkers_.size()) {
-            walker_map_.resize(walkers_.size());
-        }
-    } else {
+    uint64_t walker_count = 0;
+    for (Walker::RequestList::iterator iter = walker->requests_.begin();
+         iter != walker->requests_.end(); ++iter) {
+        WalkId id = (*iter)->id_;
+        walkers_[id] = NULL;
         if ((size_t) id >= walker_map_.size()) {
             walker_map_.resize(id + 1);
         }
         walker_map_.set(id);
+        walker_count = table->decr_walker_count();
+    }
+    delete walker;
+
+    while (!walkers_.empty() && walkers_.back() == NULL) {
+        walkers_.pop_back();
+    }
+    if (walker_map_.size() > walkers_.size()) {
+        walker_map_.resize(walkers_.size());
     }
 
     // Retry table deletion when the last walker is purged.
-    if (table->decr_walker_count() == 0) {
+    if (walker_count == 0) {
         table->RetryDelete();
     }
 }
@@ -25,6 +25,16 @@ public:
     // returns: true (continue); false (stop).
     typedef boost::function<bool(DBTablePartBase *, DBEntryBase *)> WalkFn;
 
+    // Batch walker function:
+    // Called with a batch of consecutive DBEntries of a partition under the
+    // task that corresponds to the specific partition. The function may
+    // notify entries but must not remove any entry from the table.
+    // arguments: DBTable partition and list of DBEntries.
+    // returns: true (continue); false (stop).
+    typedef std::vector<DBEntryBase *> EntryBatch;
+    typedef boost::function<bool(DBTablePartBase *, const EntryBatch &)>
+        WalkBatchFn;
+
     // Called when all partitions are done iterating.
     typedef boost::function<void(DBTableBase *)> WalkCompleteFn;
 
@@ -40,10 +50,22 @@ public:
     WalkId WalkTable(DBTable *table, const DBRequestKey *key_start,
                      WalkFn walker, WalkCompleteFn walk_complete);
 
+    // Same as WalkTable, except that the walker function is invoked with
+    // batches of up to kBatchSize entries.
+    //
+    // Full table batch walks (null 'key_start') requested on a table that
+    // has a full table batch walk pending are coalesced into a single pass
+    // over the table, as long as the pending walk has not visited any entry
+    // yet. Each request keeps its own id, callbacks and cancellation.
+    WalkId WalkTableBatch(DBTable *table, const DBRequestKey *key_start,
+                          WalkBatchFn walker, WalkCompleteFn walk_complete);
+
     // cancel a walk that may be in progress. This cannot be called from
     // the walker function itself.
     void WalkCancel(WalkId id);
 
+    static const int kBatchSize = 128;
+
 private:
     static int walker_task_id_;
     static const int kIterationToYield = 1024;
@@ -74,8 +96,13 @@ private:
     typedef std::vector<Walker *> WalkerList;
     typedef boost::dynamic_bitset<> WalkerMap;
 
+    WalkId AddWalker(DBTable *table, const DBRequestKey *key_start,
+                     WalkFn walkerfn, WalkBatchFn batchfn,
+                     WalkCompleteFn walk_complete);
+    WalkId AllocWalkId(Walker *walker);
+
     // Purge the walker after the walk is completed/cancelled
-    void PurgeWalker(WalkId id);
+    void PurgeWalker(Walker *walker);
 
     // List of walkers allocated
     tbb::mutex walkers_mutex_;
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <pthread.h>
+#include <algorithm>
+#include <vector>
+
+#include <boost/foreach.hpp>
+#include <boost/scoped_array.hpp>
+#include <tbb/atomic.h>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/time_util.h"
+#include "base/test/task_test_util.h"
+#include "db/db_partition.h"
+#include "db/db_table.h"
+#include "db/db_table_partition.h"
+#include "testing/gunit.h"
+
+using std::vector;
+
+//
+// Microbenchmark for the enqueue side of DBPartition. A number of producer
+// threads push DBRequests into a single partition concurrently and the
+// test reports the number of requests/sec that made it through the queue.
+//
+// The per-producer sequence number is checked in Process to make sure that
+// each backend preserves the FIFO order of requests from a given producer.
+// Producers may also enqueue their requests in batches.
+//
+
+struct BenchReqKey : public DBRequestKey {
+    BenchReqKey(int producer, int seqno) : producer(producer), seqno(seqno) {
+    }
+    int producer;
+    int seqno;
+};
+
+class BenchTablePart : public DBTablePartBase {
+public:
+    explicit BenchTablePart(int producer_count)
+        : DBTablePartBase(NULL, 0), last_seqno_(producer_count, -1),
+          out_of_order_(0) {
+        processed_ = 0;
+    }
+
+    virtual void Process(DBClient *client, DBRequest *req) {
+        const BenchReqKey *key =
+            static_cast<const BenchReqKey *>(req->key.get());
+        if (key->seqno != last_seqno_[key->producer] + 1)
+            out_of_order_++;
+        last_seqno_[key->producer] = key->seqno;
+        processed_++;
+    }
+
+    virtual void Remove(DBEntryBase *entry) { }
+    virtual DBEntryBase *lower_bound(const DBEntryBase *key) { return NULL; }
+    virtual DBEntryBase *GetFirst() { return NULL; }
+    virtual DBEntryBase *GetNext(const DBEntryBase *entry) { return NULL; }
+
+    uint64_t processed() const { return processed_; }
+    int out_of_order() const { return out_of_order_; }
+
+private:
+    tbb::atomic<uint64_t> processed_;
+    vector<int> last_seqno_;
+    int out_of_order_;
+};
+
+class DBPartitionTest :
+    public ::testing::TestWithParam<DBPartition::RequestQueueType> {
+protected:
+    struct ProducerArgs {
+        DBPartitionTest *test;
+        int producer;
+    };
+
+    virtual void SetUp() {
+        saved_queue_type_ = DBPartition::default_request_queue_type();
+        DBPartition::SetDefaultRequestQueueType(GetParam());
+        request_count_ = 200000;
+        batch_size_ = 1;
+        char *str = getenv("DB_PARTITION_TEST_REQUEST_COUNT");
+        if (str) request_count_ = strtoul(str, NULL, 0);
+    }
+
+    virtual void TearDown() {
+        DBPartition::SetDefaultRequestQueueType(saved_queue_type_);
+    }
+
+    static void *ProducerRun(void *objp) {
+        ProducerArgs *args = reinterpret_cast<ProducerArgs *>(objp);
+        args->test->Produce(args->producer);
+        return NULL;
+    }
+
+    void Produce(int producer) {
+        int count = request_count_ / producer_count_;
+        if (batch_size_ > 1) {
+            ProduceBatches(producer, count);
+            return;
+        }
+        for (int seqno = 0; seqno < count; ++seqno) {
+            DBRequest req(DBRequest::DB_ENTRY_ADD_CHANGE);
+            req.key.reset(new BenchReqKey(producer, seqno));
+            partition_->EnqueueRequest(tpart_, NULL, &req);
+        }
+    }
+
+    void ProduceBatches(int producer, int count) {
+        boost::scoped_array<DBRequest> reqs(new DBRequest[batch_size_]);
+        vector<DBRequest *> req_ptrs(batch_size_);
+        for (int seqno = 0; seqno < count; ) {
+            size_t batch_count = 0;
+            for (; batch_count < batch_size_ && seqno < count;
+                 ++batch_count, ++seqno) {
+                reqs[batch_count].oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+                reqs[batch_count].key.reset(new BenchReqKey(producer, seqno));
+                req_ptrs[batch_count] = &reqs[batch_count];
+            }
+            partition_->EnqueueRequestBatch(tpart_, NULL, &req_ptrs[0],
+                                            batch_count);
+        }
+    }
+
+    void RunProducers(int producer_count) {
+        producer_count_ = producer_count;
+        partition_.reset(new DBPartition(0));
+        EXPECT_EQ(GetParam(), partition_->request_queue_type());
+        tpart_ = new BenchTablePart(producer_count);
+        uint64_t expected = (request_count_ / producer_count) * producer_count;
+
+        vector<ProducerArgs> args(producer_count);
+        vector<pthread_t> thread_ids;
+        uint64_t start = ClockMonotonicUsec();
+        for (int i = 0; i < producer_count; i++) {
+            pthread_t tid;
+            args[i].test = this;
+            args[i].producer = i;
+            pthread_create(&tid, NULL, &ProducerRun, &args[i]);
+            thread_ids.push_back(tid);
+        }
+        BOOST_FOREACH(pthread_t tid, thread_ids) { pthread_join(tid, NULL); }
+        uint64_t enqueue_done = ClockMonotonicUsec();
+        TASK_UTIL_EXPECT_EQ(expected, tpart_->processed());
+        uint64_t end = ClockMonotonicUsec();
+
+        EXPECT_EQ(0, tpart_->out_of_order());
+        EXPECT_TRUE(partition_->IsDBQueueEmpty());
+        LOG(DEBUG, "DBPartition queue " <<
+            (GetParam() == DBPartition::MPSC_QUEUE ? "mpsc" : "tbb") <<
+            " producers " << producer_count <<
+            " batch size " << batch_size_ <<
+            " enqueue req/sec " <<
+            expected * 1000000 / std::max<uint64_t>(enqueue_done - start, 1) <<
+            " total req/sec " <<
+            expected * 1000000 / std::max<uint64_t>(end - start, 1));
+
+        task_util::WaitForIdle();
+        partition_.reset();
+        delete tpart_;
+    }
+
+    DBPartition::RequestQueueType saved_queue_type_;
+    std::auto_ptr<DBPartition> partition_;
+    BenchTablePart *tpart_;
+    int producer_count_;
+    int request_count_;
+    size_t batch_size_;
+};
+
+TEST_P(DBPartitionTest, EnqueueThroughput) {
+    for (int producer_count = 1; producer_count <= 64; producer_count *= 2) {
+        RunProducers(producer_count);
+    }
+}
+
+TEST_P(DBPartitionTest, EnqueueBatchThroughput) {
+    batch_size_ = 64;
+    for (int producer_count = 1; producer_count <= 64; producer_count *= 2) {
+        RunProducers(producer_count);
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(RequestQueueType, DBPartitionTest,
+    ::testing::Values(DBPartition::TBB_CONCURRENT_QUEUE,
+                      DBPartition::MPSC_QUEUE));
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -243,6 +243,97 @@ TEST_F(DBTest, SkipDelete) {
     itbl->Unregister(tid_);
 }
 
+class DBWalkCounter {
+public:
+    DBWalkCounter() {
+        entry_count_ = 0;
+        batch_count_ = 0;
+        done_count_ = 0;
+    }
+
+    bool WalkEntry(DBTablePartBase *tpart, DBEntryBase *entry) {
+        entry_count_++;
+        return true;
+    }
+
+    bool WalkBatch(DBTablePartBase *tpart,
+                   const DBTableWalker::EntryBatch &batch) {
+        size_t max_batch = DBTableWalker::kBatchSize;
+        EXPECT_LE(batch.size(), max_batch);
+        entry_count_ += batch.size();
+        batch_count_++;
+        return true;
+    }
+
+    void WalkDone(DBTableBase *table) {
+        done_count_++;
+    }
+
+    tbb::atomic<int> entry_count_;
+    tbb::atomic<int> batch_count_;
+    tbb::atomic<int> done_count_;
+};
+
+// Full table batch walks requested before the walk starts share a single
+// pass. Per-entry walks are never coalesced. Cancelling one walk doesn't
+// affect the others.
+TEST_F(DBTest, WalkerCoalesceAndBatch) {
+    int num_entries = 1000;
+    for (int idx = 0; idx < num_entries; ++idx) {
+        DBRequest addReq;
+        addReq.key.reset(new VlanTableReqKey(idx));
+        addReq.data.reset(new VlanTableReqData("DB Test Vlan"));
+        addReq.oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+        itbl->Enqueue(&addReq);
+    }
+    TASK_UTIL_EXPECT_EQ(num_entries, itbl->Size());
+
+    DBTableWalker *walker = db_.GetWalker();
+    DBWalkCounter counter1, counter2, counter3, counter4;
+
+    TaskScheduler::GetInstance()->Stop();
+    DBTableWalker::WalkId id1 = walker->WalkTable(itbl, NULL,
+        boost::bind(&DBWalkCounter::WalkEntry, &counter1, _1, _2),
+        boost::bind(&DBWalkCounter::WalkDone, &counter1, _1));
+    DBTableWalker::WalkId id2 = walker->WalkTable(itbl, NULL,
+        boost::bind(&DBWalkCounter::WalkEntry, &counter2, _1, _2),
+        boost::bind(&DBWalkCounter::WalkDone, &counter2, _1));
+    walker->WalkTableBatch(itbl, NULL,
+        boost::bind(&DBWalkCounter::WalkBatch, &counter3, _1, _2),
+        boost::bind(&DBWalkCounter::WalkDone, &counter3, _1));
+    walker->WalkTableBatch(itbl, NULL,
+        boost::bind(&DBWalkCounter::WalkBatch, &counter4, _1, _2),
+        boost::bind(&DBWalkCounter::WalkDone, &counter4, _1));
+    EXPECT_NE(id1, id2);
+    walker->WalkCancel(id1);
+
+    TaskScheduler::GetInstance()->Start();
+    task_util::WaitForIdle();
+
+    EXPECT_EQ(0, counter1.entry_count_);
+    EXPECT_EQ(0, counter1.done_count_);
+    EXPECT_EQ(num_entries, counter2.entry_count_);
+    EXPECT_EQ(1, counter2.done_count_);
+    EXPECT_EQ(num_entries, counter3.entry_count_);
+    EXPECT_EQ(1, counter3.done_count_);
+    int max_batch = DBTableWalker::kBatchSize;
+    EXPECT_GE(counter3.batch_count_, num_entries / max_batch);
+    EXPECT_EQ(num_entries, counter4.entry_count_);
+    EXPECT_EQ(counter3.batch_count_, counter4.batch_count_);
+    EXPECT_EQ(4, itbl->walk_request_count());
+    EXPECT_EQ(3, itbl->walk_complete_count());
+    EXPECT_EQ(1, itbl->walk_cancel_count());
+    EXPECT_EQ(0, itbl->walker_count());
+
+    for (int idx = 0; idx < num_entries; ++idx) {
+        DBRequest delReq;
+        delReq.key.reset(new VlanTableReqKey(idx));
+        delReq.oper = DBRequest::DB_ENTRY_DELETE;
+        itbl->Enqueue(&delReq);
+    }
+    TASK_UTIL_EXPECT_EQ(0, itbl->Size());
+}
+
 void RegisterFactory() {
     DB::RegisterFactory("db.test.vlan.0", &VlanTable::CreateTable);
     DB::RegisterFactory("db.test.vlan.1", &VlanTable::CreateTable);
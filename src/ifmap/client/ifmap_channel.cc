@@ -37,6 +37,7 @@
 #include "ifmap/ifmap_sandesh_context.h"
 #include "ifmap/ifmap_server.h"
 #include "ifmap/ifmap_server_show_types.h"
+#include "ifmap/ifmap_snapshot.h"
 #include "ifmap/ifmap_log_types.h"
 
 #include <sandesh/sandesh_types.h>
@@ -276,7 +277,12 @@ void IFMapChannel::DoConnectInMainThr(bool is_ssrc) {
     // likely everything else will go through since ssrc went through the same
     // steps earlier successfully
     if (!is_ssrc) {
-        if (ConnectionStatusIsDown()) {
+        // Objects loaded from a snapshot have to be refreshed by the resync
+        // that follows the first connection, like after a reconnect.
+        IFMapSnapshot *snapshot = manager_->ifmap_server()->snapshot();
+        if (ConnectionStatusIsDown() ||
+            (connection_status_ == NOCONN && snapshot != NULL &&
+             snapshot->load_count() > 0)) {
             sequence_number_++;
             manager_->ifmap_server()->StaleNodesCleanup();
         }
@@ -4,7 +4,6 @@
 
 #include "ifmap/ifmap_encoder.h"
 
-#include <sstream>
 #include "ifmap/ifmap_link.h"
 #include "ifmap/ifmap_object.h"
 #include "ifmap/ifmap_update.h"
@@ -12,94 +11,163 @@
 using namespace pugi;
 using namespace std;
 
-IFMapMessage::IFMapMessage() : op_type_(NONE), node_count_(0),
-    objects_per_message_(kObjectsPerMessage) {
-    // init empty document
-    Open();
+namespace {
+
+// Appends the serialized xml to a string.
+class StringWriter : public xml_writer {
+public:
+    explicit StringWriter(string *str) : str_(str) { }
+    virtual void write(const void *data, size_t size) {
+        str_->append(static_cast<const char *>(data), size);
+    }
+private:
+    string *str_;
+};
+
+void AppendEscaped(const string &value, string *str) {
+    for (string::const_iterator iter = value.begin(); iter != value.end();
+         ++iter) {
+        switch (*iter) {
+        case '&':
+            str->append("&amp;");
+            break;
+        case '<':
+            str->append("&lt;");
+            break;
+        case '>':
+            str->append("&gt;");
+            break;
+        case '"':
+            str->append("&quot;");
+            break;
+        default:
+            str->push_back(*iter);
+            break;
+        }
+    }
 }
 
-void IFMapMessage::Open() {
-    xml_node iq = doc_.append_child("iq");
-    // set iq (type, from, to) attributes
-    iq.append_attribute("type") = "set";
-    iq.append_attribute("from") = "network-control@contrailsystems.com"; 
-    iq.append_attribute("to") = "";
-    config_ = iq.append_child("config");
+const char kMessageHeader[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<iq type=\"set\" from=\"network-control@contrailsystems.com\" to=\"";
+const char kMessageConfig[] = "\"><config>";
+const char kMessageTrailer[] = "</config></iq>\n";
+
+}  // namespace
+
+IFMapMessage::IFMapMessage() : op_type_(NONE), node_count_(0),
+    objects_per_message_(kObjectsPerMessage),
+    bytes_per_message_(kBytesPerMessage),
+    encode_count_(0), encode_cache_hits_(0) {
 }
 
 void IFMapMessage::Close() {
-    ostringstream oss;
-    doc_.save(oss);
-    str_ = oss.str();
+    str_.clear();
+    str_.reserve(sizeof(kMessageHeader) + receiver_.size() +
+                 sizeof(kMessageConfig) + body_.size() + 16 +
+                 sizeof(kMessageTrailer));
+    str_.append(kMessageHeader);
+    AppendEscaped(receiver_, &str_);
+    str_.append(kMessageConfig);
+    str_.append(body_);
+    if (op_type_ == UPDATE) {
+        str_.append("</update>");
+    } else if (op_type_ == DELETE) {
+        str_.append("</delete>");
+    }
+    str_.append(kMessageTrailer);
 }
 
 void IFMapMessage::SetReceiverInMsg(const std::string &cli_identifier) {
-    xml_node iq = doc_.child("iq");
-    assert(iq);
-    xml_attribute iqattr = iq.attribute("to");
-    assert(iqattr);
-    std::string str(cli_identifier);
-    str += "/config";
-    iqattr.set_value(str.c_str());
+    receiver_ = cli_identifier;
+    receiver_ += "/config";
 }
 
 void IFMapMessage::SetObjectsPerMessage(int num) {
     objects_per_message_ = num;
 }
 
-void IFMapMessage::EncodeUpdate(const IFMapUpdate *update) {
+void IFMapMessage::SetBytesPerMessage(size_t num) {
+    bytes_per_message_ = num;
+}
+
+void IFMapMessage::EncodeUpdate(const IFMapUpdate *update, IFMapState *state) {
     // update is either of type UPDATE OR DELETE
-    if (update->IsUpdate()) {
-        if (op_type_ != UPDATE) {
-            op_node_ = config_.append_child("update");
-            op_type_ = UPDATE;
-        }
-        if (update->data().type == IFMapObjectPtr::NODE) {
-            EncodeNode(update);
-        } else if (update->data().type == IFMapObjectPtr::LINK) {
-            EncodeLink(update);
-        } else {
-            assert(0);
+    Op op = update->IsUpdate() ? UPDATE : DELETE;
+    if (op_type_ != op) {
+        if (op_type_ == UPDATE) {
+            body_.append("</update>");
+        } else if (op_type_ == DELETE) {
+            body_.append("</delete>");
         }
+        body_.append(op == UPDATE ? "<update>" : "<delete>");
+        op_type_ = op;
+    }
+
+    // The encoding of a node delete only has the name of the node. Don't
+    // bother caching it since it's sent at most once to every client. Nor
+    // cache objects that no client is interested in anymore, since nothing
+    // would clear the encoding until the object goes away.
+    bool cacheable = (state != NULL) && !state->interest().empty() &&
+        (update->data().type == IFMapObjectPtr::LINK || update->IsUpdate());
+    if (!cacheable) {
+        scratch_.clear();
+        EncodeObject(update, &scratch_);
+        body_.append(scratch_);
     } else {
-        if (op_type_ != DELETE) {
-            op_node_ = config_.append_child("delete");
-            op_type_ = DELETE;
-        }
-        if (update->data().type == IFMapObjectPtr::NODE) {
-            EncodeNode(update);
-        } else if (update->data().type == IFMapObjectPtr::LINK) {
-            EncodeLink(update);
+        if (state->encoding().empty()) {
+            scratch_.clear();
+            EncodeObject(update, &scratch_);
+            state->set_encoding(scratch_);
         } else {
-            assert(0);
+            encode_cache_hits_++;
         }
+        body_.append(state->encoding());
     }
+
     node_count_++;
+    if (update->data().type == IFMapObjectPtr::LINK) {
+        node_count_++;
+    }
 }
 
-void IFMapMessage::EncodeNode(const IFMapUpdate *update) {
+void IFMapMessage::EncodeObject(const IFMapUpdate *update, std::string *str) {
+    xml_document doc;
+    xml_node root = doc;
+    if (update->data().type == IFMapObjectPtr::NODE) {
+        EncodeNode(update, &root);
+    } else if (update->data().type == IFMapObjectPtr::LINK) {
+        EncodeLink(update, &root);
+    } else {
+        assert(0);
+    }
+    StringWriter writer(str);
+    doc.first_child().print(writer, "", format_raw);
+    encode_count_++;
+}
+
+void IFMapMessage::EncodeNode(const IFMapUpdate *update, xml_node *parent) {
     IFMapNode *node = update->data().u.node;
     if (update->IsUpdate()) {
-        node->EncodeNodeDetail(&op_node_);
+        node->EncodeNodeDetail(parent);
     } else {
-        node->EncodeNode(&op_node_);
-    }    
+        node->EncodeNode(parent);
+    }
 }
 
-void IFMapMessage::EncodeLink(const IFMapUpdate *update) {
-    xml_node link_node = op_node_.append_child("link");
+void IFMapMessage::EncodeLink(const IFMapUpdate *update, xml_node *parent) {
+    xml_node link_node = parent->append_child("link");
 
     const IFMapLink *link = update->data().u.link;
 
     IFMapNode::EncodeNode(link->left_id(), &link_node);
     IFMapNode::EncodeNode(link->right_id(), &link_node);
     link->EncodeLinkInfo(&link_node);
-
-    node_count_++;
 }
 
 bool IFMapMessage::IsFull() {
-    return ((node_count_ >= objects_per_message_) ? true : false);
+    return ((node_count_ >= objects_per_message_) ||
+            (body_.size() >= bytes_per_message_));
 }
 
 bool IFMapMessage::IsEmpty() {
@@ -107,10 +175,10 @@ bool IFMapMessage::IsEmpty() {
 }
 
 void IFMapMessage::Reset() {
-    doc_.reset();
+    receiver_.clear();
+    body_.clear();
     node_count_ = 0;
     op_type_ = NONE;
-    Open();
 }
 
 const char * IFMapMessage::c_str() const {
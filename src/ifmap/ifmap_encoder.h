@@ -5,27 +5,44 @@
 #ifndef __ctrlplane__ifmap_encoder__
 #define __ctrlplane__ifmap_encoder__
 
+#include <stdint.h>
+#include <string>
 #include <pugixml/pugixml.hpp>
 
 class IFMapNode;
 class IFMapLink;
+class IFMapState;
 class IFMapUpdate;
 
+// Builds the config messages sent to the clients. The objects are encoded
+// as XML fragments that are concatenated into the message, so the message
+// only has to be assembled again, not encoded again, for every client that
+// it's sent to. The fragments of node updates and links are also cached in
+// their IFMapState and reused until the configuration of the node changes.
 class IFMapMessage {
 public:
     static const int kObjectsPerMessage = 16;
+    static const size_t kBytesPerMessage = 64 * 1024;
     IFMapMessage();
 
     void Close();
     // set the 'to' field in the message
     void SetReceiverInMsg(const std::string &cli_identifier);
     void SetObjectsPerMessage(int num);
-    void EncodeUpdate(const IFMapUpdate *update);
+    void SetBytesPerMessage(size_t num);
+    // state is the IFMapState of the object in the update, if any.
+    void EncodeUpdate(const IFMapUpdate *update, IFMapState *state = NULL);
+    // The message is full once it has either kObjectsPerMessage objects or
+    // kBytesPerMessage bytes of encoded objects, unless overridden.
     bool IsFull();
     bool IsEmpty();
     void Reset();
 
     const char *c_str() const;
+    size_t size() const { return str_.size(); }
+
+    uint64_t encode_count() const { return encode_count_; }
+    uint64_t encode_cache_hits() const { return encode_cache_hits_; }
 
 private:
     enum Op {
@@ -33,17 +50,20 @@ private:
         UPDATE,
         DELETE
     };
-    void Open();
-    void EncodeNode(const IFMapUpdate *update);
-    void EncodeLink(const IFMapUpdate *update);
-
-    pugi::xml_document doc_;
-    pugi::xml_node config_;
-    Op op_type_;             // the current  type of op_node_
-    pugi::xml_node op_node_;
+    void EncodeObject(const IFMapUpdate *update, std::string *str);
+    void EncodeNode(const IFMapUpdate *update, pugi::xml_node *parent);
+    void EncodeLink(const IFMapUpdate *update, pugi::xml_node *parent);
+
+    std::string receiver_;
+    std::string body_;       // encoded objects, without the closing op tag
+    Op op_type_;             // the current type of op in body_
     std::string str_;
+    std::string scratch_;
     int node_count_;
     int objects_per_message_;
+    size_t bytes_per_message_;
+    uint64_t encode_count_;
+    uint64_t encode_cache_hits_;
 };
 
 #endif /* defined(__ctrlplane__ifmap_encoder__) */
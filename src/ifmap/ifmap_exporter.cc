@@ -67,6 +67,9 @@ void IFMapExporter::Initialize(DB *db) {
 }
 
 void IFMapExporter::Shutdown() {
+    if (walker_.get() != NULL) {
+        walker_->Clear();
+    }
     for (size_t index = 0; index < client_config_tracker_.size(); ++index) {
         ConfigSet *set = client_config_tracker_[index];
         if (set) {
@@ -612,6 +615,14 @@ bool IFMapExporter::ConfigChanged(IFMapNode *node) {
         state->SetCrc(node_crc);
     }
 
+    // The cached encoding is of the node's front object, which may come
+    // from a different origin than the one tracked by the config crc.
+    IFMapExporter::crc32type object_crc = node->GetObjectCrc();
+    if (state->encoding_crc() != object_crc) {
+        state->SetEncodingCrc(object_crc);
+        state->clear_encoding();
+    }
+
     return changed;
 }
 
@@ -717,6 +728,9 @@ void IFMapExporter::StateInterestSet(IFMapState *state,
     }
 
     state->SetInterest(interest_bits);
+    if (state->interest().empty()) {
+        state->clear_encoding();
+    }
 }
 
 // Add the node to the config-tracker of all clients that just became interested
@@ -735,6 +749,9 @@ void IFMapExporter::StateInterestReset(IFMapState *state,
     bool add = false;
     UpdateClientConfigTracker(state, interest_bits, add);
     state->InterestReset(interest_bits);
+    if (state->interest().empty()) {
+        state->clear_encoding();
+    }
 }
 
 const IFMapTypenameWhiteList &IFMapExporter::get_traversal_white_list() const {
@@ -63,6 +63,7 @@ public:
 
     DBTable *link_table() { return link_table_; }
     IFMapServer *server() { return server_; }
+    IFMapGraphWalker *walker() { return walker_.get(); }
 
     bool FilterNeighbor(IFMapNode *lnode, IFMapNode *rnode);
 
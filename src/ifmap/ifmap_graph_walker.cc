@@ -21,55 +21,20 @@
 #include "ifmap/ifmap_whitelist.h"
 #include "schema/vnc_cfg_types.h"
 
-class GraphPropagateFilter : public DBGraph::VisitorFilter {
-public:
-    GraphPropagateFilter(IFMapExporter *exporter,
-                         const IFMapTypenameWhiteList *type_filter,
-                         const BitSet &bitset)
-            : exporter_(exporter),
-              type_filter_(type_filter),
-              bset_(bitset) {
-    }
-
-    bool VertexFilter(const DBGraphVertex *vertex) const {
-        return type_filter_->VertexFilter(vertex);
-    }
-
-    bool EdgeFilter(const DBGraphVertex *source, const DBGraphVertex *target,
-                    const DBGraphEdge *edge) const {
-        bool accept = type_filter_->EdgeFilter(source, target, edge);
-        if (!accept) {
-            return false;
-        }
-        const IFMapNode *tgt = static_cast<const IFMapNode *>(target);
-        const IFMapNodeState *state = NodeStateLookup(tgt);
-        if (state != NULL && state->interest().Contains(bset_)) {
-            return false;
-        }
-
-        return true;
-    }
-
-    const IFMapNodeState *NodeStateLookup(const IFMapNode *node) const {
-        const DBTable *table = node->table();
-        const DBState *state =
-                node->GetState(table, exporter_->TableListenerId(table));
-        return static_cast<const IFMapNodeState *>(state);
-    }
-
-private:
-    IFMapExporter *exporter_;
-    const IFMapTypenameWhiteList *type_filter_;
-    const BitSet &bset_;
-};
-
 IFMapGraphWalker::IFMapGraphWalker(DBGraph *graph, IFMapExporter *exporter)
     : graph_(graph),
       exporter_(exporter),
+      link_add_walk_trigger_(new TaskTrigger(
+                        boost::bind(&IFMapGraphWalker::LinkAddWalk, this),
+                        TaskScheduler::GetInstance()->GetTaskId("db::DBTable"), 0)),
       link_delete_walk_trigger_(new TaskTrigger(
                         boost::bind(&IFMapGraphWalker::LinkDeleteWalk, this),
                         TaskScheduler::GetInstance()->GetTaskId("db::DBTable"), 0)),
-      walk_client_index_(BitSet::npos) {
+      walk_client_index_(BitSet::npos),
+      link_add_count_(0),
+      link_add_walk_count_(0),
+      link_delete_walk_count_(0),
+      walk_visit_count_(0) {
     traversal_white_list_.reset(new IFMapTypenameWhiteList());
     AddNodesToWhitelist();
     AddLinksToWhitelist();
@@ -93,13 +58,90 @@ void IFMapGraphWalker::JoinVertex(DBGraphVertex *vertex, const BitSet &bset) {
     }
 }
 
-void IFMapGraphWalker::ProcessLinkAdd(IFMapNode *lnode, IFMapNode *rnode,
-                                      const BitSet &bset) {
-    GraphPropagateFilter filter(exporter_, traversal_white_list_.get(), bset);
-    graph_->Visit(rnode,
-                  boost::bind(&IFMapGraphWalker::JoinVertex, this, _1, bset),
-                  0,
-                  filter);
+// Returns the set of clients that have already reached the node, either
+// before the walk started or from a previous level of the walk.
+const BitSet *IFMapGraphWalker::VisitedSet(WalkType type, IFMapNode *node) {
+    IFMapNodeState *state = exporter_->NodeStateLookup(node);
+    if (state == NULL) {
+        return NULL;
+    }
+    if (type == WALK_LINK_ADD) {
+        return &state->interest();
+    }
+    return &state->nmask();
+}
+
+// Breadth first walk from all the nodes in the frontier at once. Each node
+// carries the set of clients that are propagated through it, so that a
+// single traversal computes the interest of all the clients in the batch.
+// A neighbor is only added to the next level for the clients that haven't
+// reached it yet, which is also what terminates the walk.
+//
+// The whole level is applied before it is expanded. Nodes that are adjacent
+// to each other within the same level are then not queued again and the
+// expansion itself does not modify any state.
+size_t IFMapGraphWalker::Walk(WalkType type, NodeBitMap *frontier) {
+    size_t visited = 0;
+    NodeBitMap next;
+    while (!frontier->empty()) {
+        for (NodeBitMap::iterator iter = frontier->begin();
+             iter != frontier->end(); ++iter) {
+            if (type == WALK_LINK_ADD) {
+                JoinVertex(iter->first, iter->second);
+            } else {
+                RecomputeInterest(iter->first, iter->second);
+            }
+        }
+        visited += frontier->size();
+
+        for (NodeBitMap::iterator iter = frontier->begin();
+             iter != frontier->end(); ++iter) {
+            IFMapNode *node = iter->first;
+            const BitSet &bset = iter->second;
+            for (DBGraphVertex::edge_iterator edge_iter =
+                     node->edge_list_begin(graph_);
+                 edge_iter != node->edge_list_end(graph_); ++edge_iter) {
+                const DBGraphEdge *edge = edge_iter.operator->();
+                IFMapNode *target =
+                    static_cast<IFMapNode *>(edge_iter.target());
+                if (edge->IsDeleted() || target->IsDeleted() ||
+                    !traversal_white_list_->VertexFilter(target) ||
+                    !traversal_white_list_->EdgeFilter(node, target, edge)) {
+                    continue;
+                }
+                BitSet bits;
+                const BitSet *known = VisitedSet(type, target);
+                if (known != NULL) {
+                    bits.BuildComplement(bset, *known);
+                } else {
+                    bits = bset;
+                }
+                if (bits.empty()) {
+                    continue;
+                }
+                NodeBitMap::iterator loc = next.find(target);
+                if (loc == next.end()) {
+                    next.insert(std::make_pair(target, bits));
+                } else {
+                    loc->second |= bits;
+                }
+            }
+        }
+        frontier->swap(next);
+        next.clear();
+    }
+    return visited;
+}
+
+void IFMapGraphWalker::QueueLinkAdd(IFMapNode *node, const BitSet &bset) {
+    link_add_count_++;
+    NodeBitMap::iterator loc = link_add_nodes_.find(node);
+    if (loc == link_add_nodes_.end()) {
+        link_add_nodes_.insert(std::make_pair(node, bset));
+    } else {
+        loc->second |= bset;
+    }
+    link_add_walk_trigger_->Set();
 }
 
 void IFMapGraphWalker::LinkAdd(IFMapNode *lnode, const BitSet &lhs,
@@ -109,16 +151,43 @@ void IFMapGraphWalker::LinkAdd(IFMapNode *lnode, const BitSet &lhs,
     if (!lhs.empty() && !rhs.Contains(lhs) &&
         traversal_white_list_->VertexFilter(rnode) &&
         traversal_white_list_->EdgeFilter(lnode, rnode, NULL)) {
-        ProcessLinkAdd(lnode, rnode, lhs);
+        QueueLinkAdd(rnode, lhs);
     }
     if (!rhs.empty() && !lhs.Contains(rhs) &&
         traversal_white_list_->VertexFilter(lnode) &&
         traversal_white_list_->EdgeFilter(rnode, lnode, NULL)) {
-        ProcessLinkAdd(rnode, lnode, rhs);
+        QueueLinkAdd(lnode, rhs);
+    }
+}
+
+// Walk from all the nodes that had links added since the last run. The
+// interest of the links themselves is fixed up when JoinVertex marks them
+// as modified.
+bool IFMapGraphWalker::LinkAddWalk() {
+    NodeBitMap frontier;
+    frontier.swap(link_add_nodes_);
+    for (NodeBitMap::iterator iter = frontier.begin();
+         iter != frontier.end(); ) {
+        if (!iter->first->IsVertexValid()) {
+            frontier.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+    if (frontier.empty()) {
+        return true;
     }
+    link_add_walk_count_++;
+    walk_visit_count_ += Walk(WALK_LINK_ADD, &frontier);
+    return true;
 }
 
 void IFMapGraphWalker::LinkRemove(const BitSet &bset) {
+    // The nodes queued by LinkAdd may go away once their links are removed.
+    // Finish the pending walks before that can happen.
+    if (!link_add_nodes_.empty()) {
+        LinkAddWalk();
+    }
     OrLinkDeleteClients(bset);          // link_delete_clients_ | bset
     link_delete_walk_trigger_->Set();
 }
@@ -133,14 +202,19 @@ bool IFMapGraphWalker::FilterNeighbor(IFMapNode *lnode, IFMapNode *rnode) {
     return false;
 }
 
-void IFMapGraphWalker::RecomputeInterest(DBGraphVertex *vertex, int bit) {
+void IFMapGraphWalker::RecomputeInterest(DBGraphVertex *vertex,
+                                         const BitSet &bset) {
     IFMapNode *node = static_cast<IFMapNode *>(vertex);
     IFMapNodeState *state = exporter_->NodeStateLocate(node);
-    state->nmask_set(bit);
+    state->nmask_or(bset);
 }
 
+// Recompute the interest of up to kMaxLinkDeleteWalks clients with a single
+// walk that starts at the virtual-router node of each client.
 bool IFMapGraphWalker::LinkDeleteWalk() {
     IFMapServer *server = exporter_->server();
+    IFMapTable *table = IFMapTable::FindTable(server->database(),
+                                              "virtual-router");
 
     size_t i;
     // Get the index of the client we want to start with.
@@ -152,32 +226,32 @@ bool IFMapGraphWalker::LinkDeleteWalk() {
     }
     int count = 0;
     BitSet done_set;
+    NodeBitMap frontier;
     while (i != BitSet::npos) {
         IFMapClient *client = server->GetClient(i);
+        done_set.set(i);
         if (client) {
-            IFMapTable *table = IFMapTable::FindTable(server->database(),
-                                                      "virtual-router");
             IFMapNode *node = table->FindNode(client->identifier());
             if ((node != NULL) && node->IsVertexValid()) {
-                graph_->Visit(node,
-                 boost::bind(&IFMapGraphWalker::RecomputeInterest, this, _1, i),
-                 0, *traversal_white_list_.get());
+                frontier[node].set(i);
             }
-            done_set.set(i);
             if (++count == kMaxLinkDeleteWalks) {
                 // client 'i' has been processed. If 'i' is the last bit set, we
                 // will return true below. Else we will return false and there
                 // is atleast one more bit left to process.
                 break;
             }
-        } else {
-            done_set.set(i);
         }
 
         i = link_delete_clients_.find_next(i);
     }
+    if (!frontier.empty()) {
+        link_delete_walk_count_++;
+        walk_visit_count_ += Walk(WALK_RECOMPUTE, &frontier);
+    }
+
     // Remove the subset of clients that we have finished processing.
-    ResetLinkDeleteClients(done_set);
+    link_delete_clients_.Reset(done_set);
     rm_mask_ |= done_set;
 
     LinkDeleteWalkBatchEnd();
@@ -195,8 +269,26 @@ void IFMapGraphWalker::OrLinkDeleteClients(const BitSet &bset) {
     link_delete_clients_.Set(bset);     // link_delete_clients_ | bset
 }
 
+// Also called when clients are deleted, in which case they should not be
+// propagated by any pending link add walk either.
 void IFMapGraphWalker::ResetLinkDeleteClients(const BitSet &bset) {
     link_delete_clients_.Reset(bset);
+    for (NodeBitMap::iterator iter = link_add_nodes_.begin();
+         iter != link_add_nodes_.end(); ) {
+        iter->second.Reset(bset);
+        if (iter->second.empty()) {
+            link_add_nodes_.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+void IFMapGraphWalker::Clear() {
+    link_add_nodes_.clear();
+    link_delete_clients_.clear();
+    rm_mask_.clear();
+    walk_client_index_ = BitSet::npos;
 }
 
 void IFMapGraphWalker::CleanupInterest(IFMapNode *node, IFMapNodeState *state) {
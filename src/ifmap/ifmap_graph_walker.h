@@ -5,6 +5,8 @@
 #ifndef __ctrlplane__ifmap_graph_walker__
 #define __ctrlplane__ifmap_graph_walker__
 
+#include <map>
+
 #include "base/bitset.h"
 #include "base/queue_task.h"
 
@@ -26,7 +28,9 @@ public:
 
     // When a link is added, for each interest bit, find the corresponding
     // source node and walk the graph constructing the respective interest
-    // list.
+    // list. The walk is deferred to the link add walk task so that all the
+    // links added within the same batch of db updates are handled by a
+    // single traversal.
     void LinkAdd(IFMapNode *lnode, const BitSet &lhs,
                  IFMapNode *rnode, const BitSet &rhs);
     void LinkRemove(const BitSet &bset);
@@ -35,12 +39,34 @@ public:
     const IFMapTypenameWhiteList &get_traversal_white_list() const;
     void ResetLinkDeleteClients(const BitSet &bset);
 
+    // Drop all pending walks. Called when the exporter shuts down.
+    void Clear();
+
+    size_t link_add_pending() const { return link_add_nodes_.size(); }
+    uint64_t link_add_count() const { return link_add_count_; }
+    uint64_t link_add_walk_count() const { return link_add_walk_count_; }
+    uint64_t link_delete_walk_count() const { return link_delete_walk_count_; }
+    uint64_t walk_visit_count() const { return walk_visit_count_; }
+
 private:
-    static const int kMaxLinkDeleteWalks = 1;
+    // Maximum number of clients whose interest is recomputed by a single
+    // link delete walk.
+    static const int kMaxLinkDeleteWalks = 64;
+
+    // Nodes to visit and the set of clients to propagate from each of them.
+    typedef std::map<IFMapNode *, BitSet> NodeBitMap;
+
+    enum WalkType {
+        WALK_LINK_ADD,
+        WALK_RECOMPUTE,
+    };
 
-    void ProcessLinkAdd(IFMapNode *lnode, IFMapNode *rnode, const BitSet &bset);
+    void QueueLinkAdd(IFMapNode *node, const BitSet &bset);
+    bool LinkAddWalk();
+    size_t Walk(WalkType type, NodeBitMap *frontier);
+    const BitSet *VisitedSet(WalkType type, IFMapNode *node);
     void JoinVertex(DBGraphVertex *vertex, const BitSet &bset);
-    void RecomputeInterest(DBGraphVertex *vertex, int bit);
+    void RecomputeInterest(DBGraphVertex *vertex, const BitSet &bset);
     void CleanupInterest(IFMapNode *node, IFMapNodeState *state);
     void AddNodesToWhitelist();
     void AddLinksToWhitelist();
@@ -50,11 +76,17 @@ private:
 
     DBGraph *graph_;
     IFMapExporter *exporter_;
+    boost::scoped_ptr<TaskTrigger> link_add_walk_trigger_;
     boost::scoped_ptr<TaskTrigger> link_delete_walk_trigger_;
     std::auto_ptr<IFMapTypenameWhiteList> traversal_white_list_;
     BitSet rm_mask_;
     BitSet link_delete_clients_;
     size_t walk_client_index_;
+    NodeBitMap link_add_nodes_;
+    uint64_t link_add_count_;
+    uint64_t link_add_walk_count_;
+    uint64_t link_delete_walk_count_;
+    uint64_t walk_visit_count_;
 };
 
 #endif /* defined(__ctrlplane__ifmap_graph_walker__) */
@@ -72,9 +72,8 @@ const IFMapObject *IFMapNode::GetObject() const {
     return &list_.front();
 }
 
-IFMapNode::crc32type IFMapNode::GetConfigCrc() {
+static IFMapNode::crc32type ObjectCrc(const IFMapObject *object) {
     IFMapNode::crc32type crc = 0;
-    IFMapObject *object = Find(IFMapOrigin(IFMapOrigin::MAP_SERVER));
     if (object) {
         crc = object->CalculateCrc();
         if (crc == 0) {
@@ -85,6 +84,16 @@ IFMapNode::crc32type IFMapNode::GetConfigCrc() {
     return crc;
 }
 
+IFMapNode::crc32type IFMapNode::GetConfigCrc() {
+    return ObjectCrc(Find(IFMapOrigin(IFMapOrigin::MAP_SERVER)));
+}
+
+// The crc of the object that EncodeNodeDetail encodes, which need not be the
+// MAP_SERVER object.
+IFMapNode::crc32type IFMapNode::GetObjectCrc() const {
+    return ObjectCrc(GetObject());
+}
+
 void IFMapNode::PrintAllObjects() {
     cout << name_ << ": " << list_.size() << " objects" << endl;
     for (ObjectList::iterator iter = list_.begin(); iter != list_.end();
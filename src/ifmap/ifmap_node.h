@@ -54,6 +54,7 @@ public:
     IFMapObject *GetObject();
     const IFMapObject *GetObject() const;
     crc32type GetConfigCrc();
+    crc32type GetObjectCrc() const;
     void PrintAllObjects();
     int get_object_list_size() { return list_.size(); }
 
@@ -22,6 +22,7 @@
 #include "ifmap/ifmap_node.h"
 #include "ifmap/ifmap_server_table.h"
 #include "ifmap/ifmap_server_show_types.h"
+#include "ifmap/ifmap_snapshot.h"
 #include "ifmap/ifmap_log_types.h"
 #include "ifmap/ifmap_table.h"
 #include "ifmap/ifmap_update_queue.h"
@@ -117,6 +118,10 @@ public:
         IFMAP_DEBUG(IFMapStaleCleanerInfo, curr_seq_num, nodes_deleted,
                     nodes_changed, links_deleted, objects_deleted);
 
+        if (ifmap_server_->snapshot() != NULL) {
+            ifmap_server_->snapshot()->PurgeStale(curr_seq_num);
+        }
+
         return true;
     }
 
@@ -192,7 +197,8 @@ IFMapServer::IFMapServer(DB *db, DBGraph *graph,
           io_service_(io_service),
           stale_cleanup_timer_(TimerManager::CreateTimer(*(io_service_),
                                          "Stale cleanup timer")),
-          ifmap_manager_(NULL), ifmap_channel_manager_(NULL) {
+          ifmap_manager_(NULL), ifmap_channel_manager_(NULL),
+          snapshot_(NULL) {
 }
 
 IFMapServer::~IFMapServer() {
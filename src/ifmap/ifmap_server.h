@@ -25,6 +25,7 @@ class IFMapChannelManager;
 class IFMapClient;
 class IFMapExporter;
 class IFMapNode;
+class IFMapSnapshot;
 class IFMapUpdateQueue;
 class IFMapUpdateSender;
 class IFMapVmUuidMapper;
@@ -81,6 +82,8 @@ public:
     IFMapChannelManager *get_ifmap_channel_manager() {
         return ifmap_channel_manager_;
     }
+    void set_snapshot(IFMapSnapshot *snapshot) { snapshot_ = snapshot; }
+    IFMapSnapshot *snapshot() { return snapshot_; }
 
     void ProcessVmSubscribe(std::string vr_name, std::string vm_uuid,
                             bool subscribe, bool has_vms);
@@ -141,6 +144,7 @@ private:
     Timer *stale_cleanup_timer_;
     IFMapManager *ifmap_manager_;
     IFMapChannelManager *ifmap_channel_manager_;
+    IFMapSnapshot *snapshot_;
 };
 
 #endif /* defined(__ctrlplane__ifmap_server__) */
@@ -8,6 +8,7 @@
 #include <pugixml/pugixml.hpp>
 #include "db/db.h"
 #include "ifmap/ifmap_server_table.h"
+#include "ifmap/ifmap_snapshot.h"
 #include "ifmap/ifmap_log.h"
 #include "ifmap/ifmap_log_types.h"
 
@@ -171,6 +172,9 @@ bool IFMapServerParser::ParseResultItem(
                  meta = meta.next_sibling()) {
                 if (ParseMetadata(meta, request.get())) {
                     SetOrigin(request.get());
+                    if (snapshot_ != NULL) {
+                        snapshot_->Record(add_change, request.get(), meta);
+                    }
                     DBRequest *current = request.release();
                     if (meta.next_sibling()) {
                         request.reset(IFMapServerRequestClone(current));
@@ -223,6 +227,10 @@ bool IFMapServerParser::Receive(DB *db, const char *data, size_t length,
         return false;
     }
 
+    if (snapshot_ != NULL) {
+        snapshot_->StartPollResult(sequence_number);
+    }
+
     IFMapServerParser::RequestList requests;
     ParseResults(xdoc, &requests);
 
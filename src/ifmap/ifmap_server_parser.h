@@ -12,6 +12,7 @@
 struct AutogenProperty;
 class DB;
 struct DBRequest;
+class IFMapSnapshot;
 
 namespace pugi {
 class xml_document;
@@ -26,6 +27,8 @@ public:
     typedef std::map<std::string, MetadataParseFn> MetadataParseMap;
     typedef std::list<struct DBRequest *> RequestList;
 
+    IFMapServerParser() : snapshot_(NULL) { }
+
     // Called for each resultItem element in the IF-MAP notification.
     bool ParseResultItem(const pugi::xml_node &parent, bool add_change,
                          RequestList *list) const;
@@ -34,6 +37,8 @@ public:
     void MetadataRegister(const std:: string &metadata, MetadataParseFn parser);
     void MetadataClear(const std::string &module);
     void SetOrigin(struct DBRequest *result) const;
+    bool ParseMetadata(const pugi::xml_node &node,
+                       struct DBRequest *result) const;
 
     bool Receive(DB *db, const char *data, size_t length,
                  uint64_t sequence_number);
@@ -41,14 +46,16 @@ public:
     static IFMapServerParser *GetInstance(const std::string &module);
     static void DeleteInstance(const std::string &module);
 
+    // When set, the snapshot records all the metadata that is received.
+    void set_snapshot(IFMapSnapshot *snapshot) { snapshot_ = snapshot; }
+    IFMapSnapshot *snapshot() { return snapshot_; }
+
 private:
     typedef std::map<std::string, IFMapServerParser *> ModuleMap;
     static ModuleMap module_map_;
 
-    bool ParseMetadata(const pugi::xml_node &node,
-                       struct DBRequest *result) const;
-
     MetadataParseMap metadata_map_;
+    IFMapSnapshot *snapshot_;
 };
 
 #endif
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "ifmap/ifmap_snapshot.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <pugixml/pugixml.hpp>
+
+#include "base/logging.h"
+#include "base/task.h"
+#include "base/task_trigger.h"
+#include "base/timer.h"
+#include "db/db.h"
+#include "ifmap/ifmap_log.h"
+#include "ifmap/ifmap_log_types.h"
+#include "ifmap/ifmap_server_parser.h"
+#include "ifmap/ifmap_server_table.h"
+
+using namespace std;
+using namespace pugi;
+
+namespace {
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t generation;
+    uint64_t count;
+};
+
+class StringWriter : public xml_writer {
+public:
+    explicit StringWriter(string *str) : str_(str) { }
+    virtual void write(const void *data, size_t size) {
+        str_->append(static_cast<const char *>(data), size);
+    }
+private:
+    string *str_;
+};
+
+void AppendField(const string &value, string *buffer) {
+    uint32_t length = value.size();
+    buffer->append(reinterpret_cast<const char *>(&length), sizeof(length));
+    buffer->append(value);
+}
+
+// Bounds checked read of a length prefixed field.
+bool ReadField(const char **cp, const char *end, string *value) {
+    uint32_t length;
+    if (static_cast<size_t>(end - *cp) < sizeof(length)) {
+        return false;
+    }
+    memcpy(&length, *cp, sizeof(length));
+    *cp += sizeof(length);
+    if (static_cast<size_t>(end - *cp) < length) {
+        return false;
+    }
+    value->assign(*cp, length);
+    *cp += length;
+    return true;
+}
+
+// The key is made of the identifier(s) and the metadata name, separated by
+// a NUL character.
+string RecordKey(const IFMapTable::RequestKey *key,
+                 const IFMapServerTable::RequestData *data) {
+    string result;
+    result.reserve(key->id_type.size() + key->id_name.size() + 64);
+    result.append(key->id_type).push_back('\0');
+    result.append(key->id_name).push_back('\0');
+    result.append(data->id_type).push_back('\0');
+    result.append(data->id_name).push_back('\0');
+    result.append(data->metadata);
+    return result;
+}
+
+bool SplitKey(const string &key, vector<string> *fields) {
+    size_t start = 0;
+    for (int i = 0; i < 4; i++) {
+        size_t loc = key.find('\0', start);
+        if (loc == string::npos) {
+            return false;
+        }
+        fields->push_back(string(key, start, loc - start));
+        start = loc + 1;
+    }
+    fields->push_back(string(key, start));
+    return true;
+}
+
+}  // namespace
+
+IFMapSnapshot::IFMapSnapshot(IFMapServerParser *parser, const string &filename)
+    : parser_(parser), filename_(filename), sequence_number_(0),
+      generation_(0), dirty_(false), load_count_(0), write_count_(0),
+      write_timer_(NULL) {
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    write_trigger_.reset(
+        new TaskTrigger(boost::bind(&IFMapSnapshot::WriteTask, this),
+                        scheduler->GetTaskId("ifmap::Snapshot"), 0));
+}
+
+IFMapSnapshot::~IFMapSnapshot() {
+    Shutdown();
+    if (parser_->snapshot() == this) {
+        parser_->set_snapshot(NULL);
+    }
+}
+
+size_t IFMapSnapshot::size() const {
+    tbb::mutex::scoped_lock lock(mutex_);
+    return records_.size();
+}
+
+void IFMapSnapshot::StartPollResult(uint64_t sequence_number) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    sequence_number_ = sequence_number;
+}
+
+void IFMapSnapshot::Record(bool add_change, const DBRequest *request,
+                           const xml_node &meta) {
+    const IFMapTable::RequestKey *key =
+            static_cast<const IFMapTable::RequestKey *>(request->key.get());
+    const IFMapServerTable::RequestData *data =
+            static_cast<const IFMapServerTable::RequestData *>(
+                request->data.get());
+    string record_key = RecordKey(key, data);
+
+    // Serialize outside of the lock.
+    string xml;
+    if (add_change) {
+        StringWriter writer(&xml);
+        meta.print(writer, "", format_raw);
+    }
+
+    tbb::mutex::scoped_lock lock(mutex_);
+    dirty_ = true;
+    if (!add_change) {
+        records_.erase(record_key);
+        return;
+    }
+    SnapshotRecord &record = records_[record_key];
+    record.sequence_number = sequence_number_;
+    record.xml.swap(xml);
+}
+
+void IFMapSnapshot::PurgeStale(uint64_t sequence_number) {
+    tbb::mutex::scoped_lock lock(mutex_);
+    for (RecordMap::iterator iter = records_.begin(), next = iter;
+         iter != records_.end(); iter = next) {
+        ++next;
+        if (iter->second.sequence_number < sequence_number) {
+            records_.erase(iter);
+            dirty_ = true;
+        }
+    }
+}
+
+bool IFMapSnapshot::Write() {
+    string buffer;
+    uint64_t count;
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        SnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.generation = ++generation_;
+        header.count = count = records_.size();
+        buffer.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (RecordMap::const_iterator iter = records_.begin();
+             iter != records_.end(); ++iter) {
+            AppendField(iter->first, &buffer);
+            AppendField(iter->second.xml, &buffer);
+        }
+        dirty_ = false;
+    }
+
+    // Write to a temporary file and rename it so that a crash in the middle
+    // of the write does not corrupt the previous snapshot.
+    string tmpname = filename_ + ".tmp";
+    FILE *fp = fopen(tmpname.c_str(), "w");
+    if (fp == NULL) {
+        IFMAP_WARN(IFMapSnapshotInfo, "Unable to create snapshot", tmpname,
+                   count);
+        return false;
+    }
+    bool success = (fwrite(buffer.data(), 1, buffer.size(), fp) ==
+                    buffer.size());
+    success = success && (fflush(fp) == 0) && (fsync(fileno(fp)) == 0);
+    fclose(fp);
+    if (!success || rename(tmpname.c_str(), filename_.c_str()) != 0) {
+        IFMAP_WARN(IFMapSnapshotInfo, "Unable to write snapshot", filename_,
+                   count);
+        unlink(tmpname.c_str());
+        tbb::mutex::scoped_lock lock(mutex_);
+        dirty_ = true;
+        return false;
+    }
+    write_count_++;
+    IFMAP_DEBUG(IFMapSnapshotInfo, "Snapshot written", filename_, count);
+    return true;
+}
+
+bool IFMapSnapshot::LoadRecord(DB *db, const string &key, const string &xml) {
+    vector<string> fields;
+    if (!SplitKey(key, &fields)) {
+        return false;
+    }
+    xml_document xdoc;
+    if (!xdoc.load_buffer(xml.data(), xml.size())) {
+        return false;
+    }
+
+    auto_ptr<DBRequest> request(new DBRequest);
+    request->oper = DBRequest::DB_ENTRY_ADD_CHANGE;
+    IFMapTable::RequestKey *req_key = new IFMapTable::RequestKey();
+    request->key.reset(req_key);
+    req_key->id_type = fields[0];
+    req_key->id_name = fields[1];
+    req_key->id_seq_num = 0;
+    if (!fields[2].empty()) {
+        IFMapServerTable::RequestData *data =
+                new IFMapServerTable::RequestData();
+        request->data.reset(data);
+        data->id_type = fields[2];
+        data->id_name = fields[3];
+    }
+    if (!parser_->ParseMetadata(xdoc.first_child(), request.get())) {
+        return false;
+    }
+    parser_->SetOrigin(request.get());
+
+    IFMapTable *table = IFMapTable::FindTable(db, req_key->id_type);
+    if (table == NULL) {
+        IFMAP_TRACE(IFMapTblNotFoundTrace, "Cant find table",
+                    req_key->id_type);
+        return false;
+    }
+    table->Enqueue(request.get());
+    return true;
+}
+
+bool IFMapSnapshot::Load(DB *db) {
+    int fd = open(filename_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        close(fd);
+        IFMAP_WARN(IFMapSnapshotInfo, "Invalid snapshot", filename_, 0);
+        return false;
+    }
+    size_t length = st.st_size;
+    void *addr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        IFMAP_WARN(IFMapSnapshotInfo, "Unable to map snapshot", filename_, 0);
+        return false;
+    }
+
+    const char *cp = static_cast<const char *>(addr);
+    const char *end = cp + length;
+    SnapshotHeader header;
+    memcpy(&header, cp, sizeof(header));
+    cp += sizeof(header);
+    if (header.magic != kMagic || header.version != kVersion) {
+        munmap(addr, length);
+        IFMAP_WARN(IFMapSnapshotInfo, "Snapshot version mismatch", filename_,
+                   0);
+        return false;
+    }
+
+    uint64_t count = 0;
+    bool success = true;
+    tbb::mutex::scoped_lock lock(mutex_);
+    generation_ = header.generation;
+    for (uint64_t i = 0; i < header.count; i++) {
+        string key;
+        SnapshotRecord record;
+        if (!ReadField(&cp, end, &key) || !ReadField(&cp, end, &record.xml)) {
+            success = false;
+            break;
+        }
+        if (!LoadRecord(db, key, record.xml)) {
+            continue;
+        }
+        record.sequence_number = 0;
+        records_.insert(make_pair(key, record));
+        count++;
+    }
+    munmap(addr, length);
+
+    load_count_ += count;
+    if (!success) {
+        IFMAP_WARN(IFMapSnapshotInfo, "Truncated snapshot", filename_, count);
+    } else {
+        IFMAP_DEBUG(IFMapSnapshotInfo, "Snapshot loaded", filename_, count);
+    }
+    return success;
+}
+
+void IFMapSnapshot::Start(boost::asio::io_service *io_service) {
+    assert(write_timer_ == NULL);
+    write_timer_ = TimerManager::CreateTimer(*io_service,
+                                             "IFMap snapshot timer");
+    write_timer_->Start(kWriteInterval,
+                        boost::bind(&IFMapSnapshot::ProcessTimeout, this));
+}
+
+void IFMapSnapshot::Shutdown() {
+    if (write_timer_ != NULL) {
+        write_timer_->Cancel();
+        TimerManager::DeleteTimer(write_timer_);
+        write_timer_ = NULL;
+    }
+    while (write_trigger_->IsSet()) {
+        usleep(1000);
+    }
+}
+
+// Runs in the context of the event manager thread. Returning true restarts
+// the timer.
+bool IFMapSnapshot::ProcessTimeout() {
+    bool dirty;
+    {
+        tbb::mutex::scoped_lock lock(mutex_);
+        dirty = dirty_;
+    }
+    if (dirty) {
+        write_trigger_->Set();
+    }
+    return true;
+}
+
+bool IFMapSnapshot::WriteTask() {
+    Write();
+    return true;
+}
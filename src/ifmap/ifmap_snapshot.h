@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __ctrlplane__ifmap_snapshot__
+#define __ctrlplane__ifmap_snapshot__
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <tbb/mutex.h>
+
+class DB;
+struct DBRequest;
+class IFMapServerParser;
+class TaskTrigger;
+class Timer;
+
+namespace pugi {
+class xml_node;
+}  // namespace pugi
+
+//
+// Persistent copy of the configuration received from the IF-MAP server.
+//
+// The parser records every metadata element it accepts, keyed by the
+// identifier(s) it is attached to and the metadata name. The set of records
+// is periodically written to a binary file. On restart the file is mapped
+// into memory and the records are fed to the parser, so that the tables and
+// the graph are populated before the connection to the IF-MAP server is up.
+//
+// Records loaded from the file carry sequence number 0. The resync that
+// follows the first connection refreshes the objects that still exist and
+// the stale cleaner removes the rest, both from the tables and from the
+// snapshot.
+//
+// The periodic write runs in the ifmap::Snapshot task, so that the file I/O
+// does not hold up the event manager thread. The timer only checks whether
+// the snapshot has been modified.
+//
+// File layout (host byte order):
+//   header: magic, version, generation, record count
+//   record: key length, key, xml length, xml
+//
+class IFMapSnapshot {
+public:
+    static const uint32_t kMagic = 0x49464d53;      // "IFMS"
+    static const uint32_t kVersion = 1;
+    static const int kWriteInterval = 60000;        // milliseconds
+
+    IFMapSnapshot(IFMapServerParser *parser, const std::string &filename);
+    ~IFMapSnapshot();
+
+    // Called by the parser, in the context of the ifmap client thread.
+    void StartPollResult(uint64_t sequence_number);
+    void Record(bool add_change, const DBRequest *request,
+                const pugi::xml_node &meta);
+
+    // Drop the records that have not been refreshed since sequence_number.
+    void PurgeStale(uint64_t sequence_number);
+
+    // Populate the database from the snapshot file. Must be called before
+    // the connection to the IF-MAP server is started.
+    bool Load(DB *db);
+    bool Write();
+
+    // Write the snapshot periodically, when it has been modified.
+    void Start(boost::asio::io_service *io_service);
+    // Stop the periodic write and wait for a write in progress to finish.
+    void Shutdown();
+
+    const std::string &filename() const { return filename_; }
+    size_t size() const;
+    uint64_t generation() const { return generation_; }
+    uint64_t load_count() const { return load_count_; }
+    uint64_t write_count() const { return write_count_; }
+
+private:
+    friend class IFMapSnapshotTest;
+
+    struct SnapshotRecord {
+        uint64_t sequence_number;
+        std::string xml;
+    };
+    typedef std::map<std::string, SnapshotRecord> RecordMap;
+
+    bool ProcessTimeout();
+    bool WriteTask();
+    bool LoadRecord(DB *db, const std::string &key, const std::string &xml);
+
+    IFMapServerParser *parser_;
+    std::string filename_;
+    mutable tbb::mutex mutex_;
+    RecordMap records_;
+    uint64_t sequence_number_;
+    uint64_t generation_;
+    bool dirty_;
+    uint64_t load_count_;
+    uint64_t write_count_;
+    Timer *write_timer_;
+    boost::scoped_ptr<TaskTrigger> write_trigger_;
+};
+
+#endif /* defined(__ctrlplane__ifmap_snapshot__) */
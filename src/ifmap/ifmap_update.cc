@@ -74,11 +74,11 @@ IFMapMarker::IFMapMarker()
 }
 
 IFMapState::IFMapState(IFMapNode *node)
-    : sig_(kInvalidSig), data_(node), crc_(0) {
+    : sig_(kInvalidSig), data_(node), crc_(0), encoding_crc_(0) {
 }
 
 IFMapState::IFMapState(IFMapLink *link)
-    : sig_(kInvalidSig), data_(link), crc_(0) {
+    : sig_(kInvalidSig), data_(link), crc_(0), encoding_crc_(0) {
 }
 
 IFMapState::~IFMapState() {
@@ -140,6 +140,16 @@ public:
     virtual bool IsInvalid() const { return sig_ == kInvalidSig; }
     const crc32type &crc() const { return crc_; }
     void SetCrc(crc32type &crc) { crc_ = crc; }
+
+    // XML encoding of the object as sent to the clients. It's shared by all
+    // the clients and cleared when the encoded object changes, as tracked by
+    // its crc, or when no client is interested in the object anymore.
+    const crc32type &encoding_crc() const { return encoding_crc_; }
+    void SetEncodingCrc(crc32type &crc) { encoding_crc_ = crc; }
+    const std::string &encoding() const { return encoding_; }
+    void set_encoding(const std::string &encoding) { encoding_ = encoding; }
+    void clear_encoding() { encoding_.clear(); }
+
     virtual bool CanDelete() = 0;
     const IFMapObjectPtr &data() const { return data_; }
     IFMapNode *GetIFMapNode() const;
@@ -159,6 +169,8 @@ private:
     BitSet advertised_;
     UpdateList update_list_;
     crc32type crc_;
+    crc32type encoding_crc_;
+    std::string encoding_;
 };
 
 class IFMapNodeState : public IFMapState {
@@ -181,6 +193,7 @@ public:
     const BitSet &nmask() const { return nmask_; }
     void nmask_clear() { nmask_.clear(); }
     void nmask_set(int bit) { nmask_.set(bit); }
+    void nmask_or(const BitSet &bset) { nmask_ |= bset; }
     virtual bool CanDelete() {
         return (update_list().empty() && IsInvalid() && !HasDependents());
     }
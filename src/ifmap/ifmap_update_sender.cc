@@ -215,8 +215,16 @@ void IFMapUpdateSender::ProcessUpdate(IFMapUpdate *update,
                                       const BitSet &base_send_set) {
     LogAndCountSentUpdate(update, base_send_set);
 
-    // Append the contents of the update-node to the message.
-    message_->EncodeUpdate(update);
+    // Append the contents of the update-node to the message. The encoding
+    // cached in the state is reused across clients and messages.
+    IFMapExporter *exporter = server_->exporter();
+    IFMapState *state;
+    if (update->IsNode()) {
+        state = exporter->NodeStateLookup(update->data().u.node);
+    } else {
+        state = exporter->LinkStateLookup(update->data().u.link);
+    }
+    message_->EncodeUpdate(update, state);
 
     // Clean up the node if everybody has seen it.
     update->AdvertiseReset(base_send_set);
@@ -38,6 +38,10 @@ public:
         message_->SetObjectsPerMessage(num);
     }
 
+    void SetBytesPerMessage(size_t num) {
+        message_->SetBytesPerMessage(num);
+    }
+
     bool IsClientBlocked(int client_index) {
         return send_blocked_.test(client_index);
     }
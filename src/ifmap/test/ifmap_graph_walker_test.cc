@@ -13,6 +13,7 @@
 #include "db/db_graph.h"
 #include "io/event_manager.h"
 #include "ifmap/ifmap_client.h"
+#include "ifmap/ifmap_exporter.h"
 #include "ifmap/ifmap_link_table.h"
 #include "ifmap/ifmap_server.h"
 #include "ifmap/ifmap_server_parser.h"
@@ -685,6 +686,60 @@ TEST_F(IFMapGraphWalkerTest, PopulateWhiteList) {
     }
 }
 
+// Links that are added while the walker task can't run are handled by a
+// single walk, with the same result as when they are added one at a time.
+TEST_F(IFMapGraphWalkerTest, LinkAddBatch) {
+    IFMapClientMock
+        c1("default-global-system-config:a1s27.contrail.juniper.net");
+    server_.AddClient(&c1);
+    IFMapClientMock
+        c2("default-global-system-config:a1s28.contrail.juniper.net");
+    server_.AddClient(&c2);
+    task_util::WaitForIdle();
+
+    IFMapGraphWalker *walker = server_.exporter()->walker();
+    EXPECT_EQ(0, walker->link_add_count());
+    EXPECT_EQ(0, walker->link_add_walk_count());
+
+    string content =
+        FileRead("controller/src/ifmap/testdata/cli2_vn2_vm2_add.xml");
+    assert(content.size() != 0);
+    parser_->Receive(&db_, content.c_str(), content.size(), 0);
+    task_util::WaitForIdle();
+
+    TaskScheduler *scheduler = TaskScheduler::GetInstance();
+    scheduler->Stop();
+    server_.ProcessVmSubscribe(
+        "default-global-system-config:a1s27.contrail.juniper.net",
+        "0af0866c-08c9-49ae-856b-0f4a58179920", true, 1);
+    server_.ProcessVmSubscribe(
+        "default-global-system-config:a1s28.contrail.juniper.net",
+        "0d9dd007-b25a-4d86-bf68-dc0e85e317e3", true, 1);
+    scheduler->Start();
+    task_util::WaitForIdle();
+
+    EXPECT_EQ(0, walker->link_add_pending());
+    EXPECT_NE(0, walker->link_add_walk_count());
+    EXPECT_LT(walker->link_add_walk_count(), walker->link_add_count());
+    EXPECT_NE(0, walker->walk_visit_count());
+
+    TASK_UTIL_EXPECT_TRUE(c1.NodeExists("virtual-network",
+                                        "default-domain:demo:vn104"));
+    TASK_UTIL_EXPECT_FALSE(c1.NodeExists("virtual-network",
+                                         "default-domain:demo:vn28"));
+    TASK_UTIL_EXPECT_EQ(c1.NodeKeyCount("virtual-network"), 1);
+    TASK_UTIL_EXPECT_EQ(c1.NodeKeyCount("virtual-machine"), 1);
+    TASK_UTIL_EXPECT_EQ(c1.NodeKeyCount("virtual-machine-interface"), 1);
+
+    TASK_UTIL_EXPECT_TRUE(c2.NodeExists("virtual-network",
+                                        "default-domain:demo:vn28"));
+    TASK_UTIL_EXPECT_FALSE(c2.NodeExists("virtual-network",
+                                         "default-domain:demo:vn104"));
+    TASK_UTIL_EXPECT_EQ(c2.NodeKeyCount("virtual-network"), 1);
+    TASK_UTIL_EXPECT_EQ(c2.NodeKeyCount("virtual-machine"), 1);
+    TASK_UTIL_EXPECT_EQ(c2.NodeKeyCount("virtual-machine-interface"), 1);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     LoggingInit();
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "ifmap/ifmap_snapshot.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+
+#include "base/logging.h"
+#include "base/test/task_test_util.h"
+#include "base/time_util.h"
+#include "control-node/control_node.h"
+#include "db/db.h"
+#include "db/db_graph.h"
+#include "ifmap/ifmap_link_table.h"
+#include "ifmap/ifmap_node.h"
+#include "ifmap/ifmap_server_parser.h"
+#include "ifmap/ifmap_table.h"
+#include "ifmap/test/ifmap_test_util.h"
+
+#include "schema/vnc_cfg_types.h"
+#include "testing/gunit.h"
+
+using namespace std;
+
+static const char *kSnapshotFile = "ifmap_snapshot_test.snapshot";
+
+// The second database and graph stand for the restarted control-node.
+class IFMapSnapshotTest : public ::testing::Test {
+  protected:
+    IFMapSnapshotTest() : parser_(NULL) {
+    }
+
+    virtual void SetUp() {
+        IFMapLinkTable_Init(&db_, &graph_);
+        IFMapLinkTable_Init(&db2_, &graph2_);
+        parser_ = IFMapServerParser::GetInstance("vnc_cfg");
+        vnc_cfg_ParserInit(parser_);
+        vnc_cfg_Server_ModuleInit(&db_, &graph_);
+        vnc_cfg_Server_ModuleInit(&db2_, &graph2_);
+        snapshot_.reset(new IFMapSnapshot(parser_, kSnapshotFile));
+        parser_->set_snapshot(snapshot_.get());
+    }
+
+    virtual void TearDown() {
+        parser_->set_snapshot(NULL);
+        snapshot_.reset();
+        Clear(&db_);
+        Clear(&db2_);
+        parser_->MetadataClear("vnc_cfg");
+        task_util::WaitForIdle();
+        remove(kSnapshotFile);
+    }
+
+    void Clear(DB *db) {
+        IFMapLinkTable_Clear(db);
+        IFMapTable::ClearTables(db);
+        task_util::WaitForIdle();
+        db->Clear();
+    }
+
+    void ProcessTimeout() {
+        snapshot_->ProcessTimeout();
+    }
+
+    string FileRead(const string &filename) {
+        ifstream file(filename.c_str());
+        string content((istreambuf_iterator<char>(file)),
+                       istreambuf_iterator<char>());
+        return content;
+    }
+
+    // Every node in the original graph must be present in the restarted one
+    // with the same configuration.
+    void VerifyRestored() {
+        EXPECT_EQ(graph_.vertex_count(), graph2_.vertex_count());
+        EXPECT_EQ(graph_.edge_count(), graph2_.edge_count());
+        for (DBGraph::vertex_iterator iter = graph_.vertex_list_begin();
+             iter != graph_.vertex_list_end(); ++iter) {
+            IFMapNode *node = static_cast<IFMapNode *>(iter.operator->());
+            IFMapNode *restored = ifmap_test_util::IFMapNodeLookup(
+                &db2_, node->table()->Typename(), node->name());
+            ASSERT_TRUE(restored != NULL) << node->name();
+            EXPECT_EQ(node->GetConfigCrc(), restored->GetConfigCrc())
+                << node->name();
+        }
+    }
+
+    DB db_;
+    DBGraph graph_;
+    DB db2_;
+    DBGraph graph2_;
+    IFMapServerParser *parser_;
+    auto_ptr<IFMapSnapshot> snapshot_;
+};
+
+// Stand-in for the IF-MAP server: builds a poll result with the given number
+// of virtual-networks, each with its id-perms and the link to its project.
+static string BuildPollResult(int vn_count) {
+    ostringstream out;
+    const char *ns =
+        "xmlns:contrail=\"http://www.contrailsystems.com/vnc_cfg.xsd\" "
+        "ifmap-cardinality=\"singleValue\"";
+    out << "<?xml version=\"1.0\"?>"
+        << "<ns3:Envelope "
+        << "xmlns:ns2=\"http://www.trustedcomputinggroup.org/2010/IFMAP/2\" "
+        << "xmlns:ns3=\"http://www.w3.org/2003/05/soap-envelope\">"
+        << "<ns3:Body><ns2:response><pollResult>"
+        << "<searchResult name=\"root\">";
+    for (int i = 0; i < vn_count; i++) {
+        out << "<resultItem>"
+            << "<identity name=\"contrail:virtual-network:default-domain:"
+            << "demo:vn" << i << "\"/>"
+            << "<metadata><contrail:id-perms " << ns << ">"
+            << "<uuid><uuid-mslong>" << i << "</uuid-mslong>"
+            << "<uuid-lslong>" << i << "</uuid-lslong></uuid>"
+            << "<enable>true</enable>"
+            << "</contrail:id-perms></metadata>"
+            << "</resultItem>";
+        out << "<resultItem>"
+            << "<identity name=\"contrail:project:default-domain:demo\"/>"
+            << "<identity name=\"contrail:virtual-network:default-domain:"
+            << "demo:vn" << i << "\"/>"
+            << "<metadata><contrail:project-virtual-network " << ns << "/>"
+            << "</metadata>"
+            << "</resultItem>";
+    }
+    out << "</searchResult></pollResult></ns2:response></ns3:Body>"
+        << "</ns3:Envelope>";
+    return out.str();
+}
+
+TEST_F(IFMapSnapshotTest, WriteLoad) {
+    string message =
+        FileRead("controller/src/ifmap/testdata/cli2_vn2_vm2_add.xml");
+    assert(message.size() != 0);
+    parser_->Receive(&db_, message.data(), message.size(), 1);
+    task_util::WaitForIdle();
+    EXPECT_NE(0, snapshot_->size());
+    EXPECT_TRUE(snapshot_->Write());
+    EXPECT_EQ(1, snapshot_->write_count());
+
+    IFMapSnapshot restored(parser_, kSnapshotFile);
+    EXPECT_TRUE(restored.Load(&db2_));
+    task_util::WaitForIdle();
+    EXPECT_EQ(snapshot_->size(), restored.size());
+    EXPECT_EQ(snapshot_->size(), restored.load_count());
+    EXPECT_EQ(1, restored.generation());
+    VerifyRestored();
+}
+
+// The write timer only schedules the write task, and only when the snapshot
+// has been modified since the last write.
+TEST_F(IFMapSnapshotTest, PeriodicWrite) {
+    ProcessTimeout();
+    task_util::WaitForIdle();
+    EXPECT_EQ(0, snapshot_->write_count());
+
+    string message = BuildPollResult(16);
+    parser_->Receive(&db_, message.data(), message.size(), 1);
+    task_util::WaitForIdle();
+    ProcessTimeout();
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, snapshot_->write_count());
+    EXPECT_EQ(1, snapshot_->generation());
+
+    ProcessTimeout();
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, snapshot_->write_count());
+
+    IFMapSnapshot restored(parser_, kSnapshotFile);
+    EXPECT_TRUE(restored.Load(&db2_));
+    task_util::WaitForIdle();
+    EXPECT_EQ(snapshot_->size(), restored.load_count());
+}
+
+// Deleted metadata is removed from the snapshot, and so is the metadata that
+// has not been refreshed since the given sequence number.
+TEST_F(IFMapSnapshotTest, DeleteAndPurge) {
+    string message =
+        FileRead("controller/src/ifmap/testdata/server_parser_test.xml");
+    assert(message.size() != 0);
+    parser_->Receive(&db_, message.data(), message.size(), 1);
+    task_util::WaitForIdle();
+    EXPECT_EQ(1, snapshot_->size());
+
+    snapshot_->PurgeStale(1);
+    EXPECT_EQ(1, snapshot_->size());
+    snapshot_->PurgeStale(2);
+    EXPECT_EQ(0, snapshot_->size());
+}
+
+TEST_F(IFMapSnapshotTest, Truncated) {
+    string message = BuildPollResult(16);
+    parser_->Receive(&db_, message.data(), message.size(), 1);
+    task_util::WaitForIdle();
+    EXPECT_TRUE(snapshot_->Write());
+
+    FILE *fp = fopen(kSnapshotFile, "r+");
+    ASSERT_TRUE(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    ASSERT_EQ(0, ftruncate(fileno(fp), ftell(fp) / 2));
+    fclose(fp);
+
+    IFMapSnapshot restored(parser_, kSnapshotFile);
+    EXPECT_FALSE(restored.Load(&db2_));
+    task_util::WaitForIdle();
+    EXPECT_LT(restored.load_count(), snapshot_->size());
+
+    IFMapSnapshot missing(parser_, "ifmap_snapshot_test.missing");
+    EXPECT_FALSE(missing.Load(&db2_));
+    EXPECT_EQ(0, missing.load_count());
+}
+
+// The restarted control-node has all the configuration from the snapshot
+// before it gets the first poll result from the stand-in IF-MAP server. The
+// resync that follows the connection to the server is applied on top of the
+// snapshot and must not change anything. The time it takes to populate the
+// database from the poll result and from the snapshot is logged.
+TEST_F(IFMapSnapshotTest, RestartTime) {
+    int vn_count = 10000;
+    char *str = getenv("IFMAP_SNAPSHOT_TEST_OBJECTS");
+    if (str) vn_count = strtoul(str, NULL, 0);
+    string message = BuildPollResult(vn_count);
+
+    uint64_t start = ClockMonotonicUsec();
+    parser_->Receive(&db_, message.data(), message.size(), 1);
+    task_util::WaitForIdle();
+    uint64_t resync_time = ClockMonotonicUsec() - start;
+    EXPECT_TRUE(snapshot_->Write());
+
+    parser_->set_snapshot(NULL);
+    IFMapSnapshot restored(parser_, kSnapshotFile);
+    start = ClockMonotonicUsec();
+    EXPECT_TRUE(restored.Load(&db2_));
+    task_util::WaitForIdle();
+    uint64_t load_time = ClockMonotonicUsec() - start;
+
+    // An id-perms and a project link per virtual-network, and the project.
+    EXPECT_EQ(2 * vn_count, restored.load_count());
+    EXPECT_EQ(vn_count + 1, graph2_.vertex_count());
+    EXPECT_EQ(vn_count, graph2_.edge_count());
+    VerifyRestored();
+
+    parser_->set_snapshot(&restored);
+    parser_->Receive(&db2_, message.data(), message.size(), 1);
+    task_util::WaitForIdle();
+    restored.PurgeStale(1);
+    EXPECT_EQ(snapshot_->size(), restored.size());
+    EXPECT_EQ(vn_count + 1, graph2_.vertex_count());
+    VerifyRestored();
+
+    LOG(DEBUG, "Populated " << vn_count << " virtual-networks from the "
+        "server in " << resync_time << " usecs, from the snapshot in " <<
+        load_time << " usecs");
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    LoggingInit();
+    ControlNode::SetDefaultSchedulingPolicy();
+    int status = RUN_ALL_TESTS();
+    TaskScheduler::GetInstance()->Terminate();
+    return status;
+}
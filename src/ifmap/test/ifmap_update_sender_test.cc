@@ -112,6 +112,15 @@ protected:
         sender_->SetSendBlocked(client_index);
     }
 
+    const IFMapMessage *message() const {
+        return sender_->message_;
+    }
+
+    void SetInterest(IFMapUpdate *update, const BitSet &bset) {
+        IFMapExporter *exporter = server_.exporter();
+        exporter->NodeStateLookup(update->data().u.node)->SetInterest(bset);
+    }
+
     DB db_;
     DBGraph graph_;
     EventManager evm_;
@@ -1205,6 +1214,136 @@ TEST_F(IFMapUpdateSenderTest, Bug228) {
     queue_->PrintQueue();
 }
 
+// Each object is encoded once, no matter how many clients it's sent to and
+// in how many messages.
+TEST_F(IFMapUpdateSenderTest, EncodeOnce) {
+    TestClient c0("c0");
+    TestClient c1("c1");
+    TestClient c2("c2");
+    server_.ClientRegister(&c0);
+    server_.ClientRegister(&c1);
+    server_.ClientRegister(&c2);
+
+    IFMapUpdate *u0 = CreateUpdate("u0", true);
+    IFMapUpdate *u1 = CreateUpdate("u1", true);
+    IFMapUpdate *u2 = CreateUpdate("u2", true);
+
+    BitSet cli_bs;
+    cli_bs.set(c0.index());
+    cli_bs.set(c1.index());
+    cli_bs.set(c2.index());
+    u0->AdvertiseOr(cli_bs);
+    u1->AdvertiseOr(cli_bs);
+    u2->AdvertiseOr(cli_bs);
+    SetInterest(u0, cli_bs);
+    SetInterest(u1, cli_bs);
+    SetInterest(u2, cli_bs);
+
+    queue_->Join(c0.index());
+    queue_->Join(c1.index());
+    queue_->Join(c2.index());
+
+    queue_->Enqueue(u0);
+    queue_->Enqueue(u1);
+    queue_->Enqueue(u2);
+
+    // c0 and c1 share a single message.
+    SetSendBlocked(c2.index());
+    sender_->QueueActive();
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, c0.get_send_update_cnt());
+    TASK_UTIL_EXPECT_EQ(1, c1.get_send_update_cnt());
+    TASK_UTIL_EXPECT_EQ(0, c2.get_send_update_cnt());
+    EXPECT_EQ(3, message()->encode_count());
+    EXPECT_EQ(0, message()->encode_cache_hits());
+
+    // c2 gets a message of its own, built from the cached encodings.
+    sender_->SendActive(c2.index());
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, c2.get_send_update_cnt());
+    TASK_UTIL_EXPECT_EQ(1, queue_->size()); // only TM
+    EXPECT_EQ(3, message()->encode_count());
+    EXPECT_EQ(3, message()->encode_cache_hits());
+
+    queue_->Leave(c0.index());
+    queue_->Leave(c1.index());
+    queue_->Leave(c2.index());
+}
+
+// Objects that no client is interested in are not cached, since nothing
+// would drop the encoding until the object is deleted.
+TEST_F(IFMapUpdateSenderTest, NoEncodeCacheWithoutInterest) {
+    TestClient c0("c0");
+    TestClient c1("c1");
+    server_.ClientRegister(&c0);
+    server_.ClientRegister(&c1);
+
+    IFMapUpdate *u0 = CreateUpdate("u0", true);
+    IFMapUpdate *u1 = CreateUpdate("u1", true);
+    IFMapNode *node = u0->data().u.node;
+
+    BitSet cli_bs;
+    cli_bs.set(c0.index());
+    cli_bs.set(c1.index());
+    u0->AdvertiseOr(cli_bs);
+    u1->AdvertiseOr(cli_bs);
+
+    queue_->Join(c0.index());
+    queue_->Join(c1.index());
+    queue_->Enqueue(u0);
+    queue_->Enqueue(u1);
+
+    SetSendBlocked(c1.index());
+    sender_->QueueActive();
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, c0.get_send_update_cnt());
+    EXPECT_EQ(2, message()->encode_count());
+
+    sender_->SendActive(c1.index());
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(1, c1.get_send_update_cnt());
+    TASK_UTIL_EXPECT_EQ(1, queue_->size()); // only TM
+    EXPECT_EQ(4, message()->encode_count());
+    EXPECT_EQ(0, message()->encode_cache_hits());
+
+    IFMapExporter *exporter = server_.exporter();
+    EXPECT_TRUE(exporter->NodeStateLookup(node)->encoding().empty());
+
+    queue_->Leave(c0.index());
+    queue_->Leave(c1.index());
+}
+
+// The message is full once it reaches the byte budget, even if it has fewer
+// than the maximum number of objects.
+TEST_F(IFMapUpdateSenderTest, BytesPerMessage) {
+    TestClient c0("c0");
+    server_.ClientRegister(&c0);
+
+    IFMapUpdate *u0 = CreateUpdate("u0", true);
+    IFMapUpdate *u1 = CreateUpdate("u1", true);
+    IFMapUpdate *u2 = CreateUpdate("u2", false);
+
+    BitSet cli_bs;
+    cli_bs.set(c0.index());
+    u0->AdvertiseOr(cli_bs);
+    u1->AdvertiseOr(cli_bs);
+    u2->AdvertiseOr(cli_bs);
+
+    queue_->Join(c0.index());
+    queue_->Enqueue(u0);
+    queue_->Enqueue(u1);
+    queue_->Enqueue(u2);
+
+    sender_->SetBytesPerMessage(1);
+    sender_->QueueActive();
+    task_util::WaitForIdle();
+    TASK_UTIL_EXPECT_EQ(3, c0.get_send_update_cnt());
+    TASK_UTIL_EXPECT_EQ(1, queue_->size()); // only TM
+    sender_->SetBytesPerMessage(IFMapMessage::kBytesPerMessage);
+
+    queue_->Leave(c0.index());
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     bool success = RUN_ALL_TESTS();
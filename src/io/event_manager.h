@@ -8,6 +8,7 @@
 #include <tbb/spin_mutex.h>
 
 #include "base/util.h"
+#include "io/io_buffer_pool.h"
 
 //
 // Wrapper around boost::io_service.
@@ -18,6 +19,9 @@
 // Poll directly or indirectly after having started a ServerThread (which
 // calls Run).
 //
+// The EventManager also owns the pool of receive buffers that is used by
+// all the TcpSessions that run on it.
+//
 class EventManager {
 public:
     EventManager();
@@ -35,9 +39,11 @@ public:
     void Shutdown();
 
     boost::asio::io_service *io_service() { return &io_service_; }
+    IoBufferPool *buffer_pool() { return &buffer_pool_; }
 
 private:
     boost::asio::io_service io_service_;
+    IoBufferPool buffer_pool_;
     bool shutdown_;
     tbb::spin_mutex mutex_;
 
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "io/io_buffer_pool.h"
+
+#include <boost/foreach.hpp>
+
+using std::vector;
+
+IoBufferPool::IoBufferPool(size_t cache_bytes) {
+    for (int idx = 0; idx < kSizeClassCount; ++idx) {
+        free_lists_[idx].max_count = cache_bytes / (kMinBufferSize << idx);
+    }
+    alloc_count_ = 0;
+    heap_alloc_count_ = 0;
+}
+
+IoBufferPool::~IoBufferPool() {
+    for (int idx = 0; idx < kSizeClassCount; ++idx) {
+        BOOST_FOREACH(uint8_t *data, free_lists_[idx].buffers) {
+            delete[] data;
+        }
+    }
+}
+
+//
+// Return the index of the size class for the given size or -1 if the size
+// is larger than the largest size class.
+//
+int IoBufferPool::SizeClass(size_t size) {
+    int idx = 0;
+    for (size_t class_size = kMinBufferSize; class_size < size;
+         class_size <<= 1) {
+        if (++idx == kSizeClassCount)
+            return -1;
+    }
+    return idx;
+}
+
+size_t IoBufferPool::BufferSize(size_t size) {
+    int idx = SizeClass(size);
+    if (idx < 0)
+        return size;
+    return kMinBufferSize << idx;
+}
+
+uint8_t *IoBufferPool::Allocate(size_t size) {
+    alloc_count_++;
+    int idx = SizeClass(size);
+    if (idx >= 0) {
+        FreeList *free_list = &free_lists_[idx];
+        tbb::spin_mutex::scoped_lock lock(free_list->mutex);
+        if (!free_list->buffers.empty()) {
+            uint8_t *data = free_list->buffers.back();
+            free_list->buffers.pop_back();
+            return data;
+        }
+    }
+    heap_alloc_count_++;
+    return new uint8_t[BufferSize(size)];
+}
+
+void IoBufferPool::Free(uint8_t *data, size_t size) {
+    int idx = SizeClass(size);
+    if (idx >= 0) {
+        FreeList *free_list = &free_lists_[idx];
+        tbb::spin_mutex::scoped_lock lock(free_list->mutex);
+        if (free_list->buffers.size() < free_list->max_count) {
+            free_list->buffers.push_back(data);
+            return;
+        }
+    }
+    delete[] data;
+}
+
+size_t IoBufferPool::cached_bytes() const {
+    size_t total = 0;
+    for (int idx = 0; idx < kSizeClassCount; ++idx) {
+        const FreeList *free_list = &free_lists_[idx];
+        tbb::spin_mutex::scoped_lock lock(free_list->mutex);
+        total += free_list->buffers.size() * (kMinBufferSize << idx);
+    }
+    return total;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __IO_BUFFER_POOL_H__
+#define __IO_BUFFER_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <tbb/atomic.h>
+#include <tbb/spin_mutex.h>
+
+#include "base/util.h"
+
+//
+// Pool of receive buffers shared by all the sessions of an EventManager.
+//
+// Buffers are handed out in power of 2 size classes between kMinBufferSize
+// and kMaxBufferSize. Freed buffers are kept on a free list for their size
+// class, up to a byte budget per class, so that reads in steady state don't
+// go to the heap. Requests larger than kMaxBufferSize are always satisfied
+// from the heap.
+//
+// The caller must pass the same size to Free as it passed to Allocate.
+//
+// Concurrency: buffers are typically allocated in the io thread and freed
+// from the task that consumed the data, so each free list is protected by
+// a spin mutex.
+//
+class IoBufferPool {
+public:
+    static const size_t kMinBufferSize = 4 * 1024;
+    static const size_t kMaxBufferSize = 64 * 1024;
+    static const size_t kDefaultCacheBytes = 4 * 1024 * 1024;
+
+    explicit IoBufferPool(size_t cache_bytes = kDefaultCacheBytes);
+    ~IoBufferPool();
+
+    uint8_t *Allocate(size_t size);
+    void Free(uint8_t *data, size_t size);
+
+    // Size of the buffer that gets allocated for the given size.
+    static size_t BufferSize(size_t size);
+
+    uint64_t alloc_count() const { return alloc_count_; }
+    uint64_t heap_alloc_count() const { return heap_alloc_count_; }
+    size_t cached_bytes() const;
+
+private:
+    static const int kSizeClassCount = 5;
+
+    struct FreeList {
+        mutable tbb::spin_mutex mutex;
+        std::vector<uint8_t *> buffers;
+        size_t max_count;
+    };
+
+    static int SizeClass(size_t size);
+
+    FreeList free_lists_[kSizeClassCount];
+    tbb::atomic<uint64_t> alloc_count_;
+    tbb::atomic<uint64_t> heap_alloc_count_;
+
+    DISALLOW_COPY_AND_ASSIGN(IoBufferPool);
+};
+
+#endif  // __IO_BUFFER_POOL_H__
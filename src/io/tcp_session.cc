@@ -6,11 +6,11 @@
 
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
-#include <boost/scoped_array.hpp>
 #include <boost/asio/detail/socket_option.hpp>
 
 #include "base/logging.h"
 #include "io/event_manager.h"
+#include "io/io_buffer_pool.h"
 #include "io/tcp_server.h"
 #include "io/tcp_message_write.h"
 #include "io/io_utils.h"
@@ -55,7 +55,11 @@ TcpSession::TcpSession(
     : server_(server),
       socket_(socket),
       read_on_connect_(async_read_ready),
+      buffer_pool_(NULL),
       buffer_size_(kDefaultBufferSize),
+      max_buffer_size_(kDefaultBufferSize),
+      read_buffer_size_(kDefaultBufferSize),
+      small_read_count_(0),
       established_(false),
       closed_(false),
       direction_(ACTIVE),
@@ -68,32 +72,72 @@ TcpSession::TcpSession(
     }
     if (server_) {
         io_strand_.reset(new Strand(*server->event_manager()->io_service()));
+        buffer_pool_ = server->event_manager()->buffer_pool();
     }
     defer_reader_ = false;
 }
 
+//
+// Any buffers that are still outstanding are returned to the heap instead
+// of the IoBufferPool since the session may outlive the EventManager.
+//
 TcpSession::~TcpSession() {
     assert(!established_);
     for (BufferQueue::iterator iter = buffer_queue_.begin();
          iter != buffer_queue_.end(); ++iter) {
-        DeleteBuffer(*iter);
+        uint8_t *data = buffer_cast<uint8_t *>(*iter);
+        delete[] data;
     }
     buffer_queue_.clear();
 }
 
 mutable_buffer TcpSession::AllocateBuffer() {
-    u_int8_t *data = new u_int8_t[buffer_size_];
-    mutable_buffer buffer = mutable_buffer(data, buffer_size_);
-    {
-        tbb::mutex::scoped_lock lock(mutex_);
-        buffer_queue_.push_back(buffer);
+    tbb::mutex::scoped_lock lock(mutex_);
+    size_t size = read_buffer_size_;
+    u_int8_t *data;
+    if (buffer_pool_) {
+        data = buffer_pool_->Allocate(size);
+    } else {
+        data = new u_int8_t[size];
     }
+    mutable_buffer buffer = mutable_buffer(data, size);
+    buffer_queue_.push_back(buffer);
     return buffer;
 }
 
 void TcpSession::DeleteBuffer(mutable_buffer buffer) {
     uint8_t *data = buffer_cast<uint8_t *>(buffer);
-    delete[] data;
+    if (buffer_pool_) {
+        buffer_pool_->Free(data, buffer_size(buffer));
+    } else {
+        delete[] data;
+    }
+}
+
+//
+// Adjust the size of the next read based on how much of the buffer got
+// used by the last one. A read that fills up the buffer indicates that
+// there's more data on the socket, so double the size. Halve the size if
+// a number of consecutive reads use less than a quarter of the buffer.
+//
+// Requires: mutex_ must be held.
+//
+void TcpSession::UpdateReadBufferSize(size_t buffer_size,
+                                      size_t bytes_transferred) {
+    if (max_buffer_size_ == buffer_size_)
+        return;
+    if (bytes_transferred == buffer_size) {
+        small_read_count_ = 0;
+        if (read_buffer_size_ < max_buffer_size_)
+            read_buffer_size_ = min(read_buffer_size_ * 2, max_buffer_size_);
+    } else if (bytes_transferred * 4 <= buffer_size) {
+        if (++small_read_count_ < kSmallReadThreshold)
+            return;
+        small_read_count_ = 0;
+        read_buffer_size_ = max(read_buffer_size_ / 2, buffer_size_);
+    } else {
+        small_read_count_ = 0;
+    }
 }
 
 static int BufferCmp(const mutable_buffer &lhs, const const_buffer &rhs) {
@@ -443,6 +487,8 @@ void TcpSession::AsyncReadHandler(
         }
     }
 
+    session->UpdateReadBufferSize(buffer_size(buffer), bytes_transferred);
+
     // Update read statistics.
     session->stats_.read_calls++;
     session->stats_.read_bytes += bytes_transferred;
@@ -499,19 +545,22 @@ TcpMessageReader::TcpMessageReader(TcpSession *session,
     : session_(session), callback_(callback), offset_(0), remain_(-1) {
 }
 
+TcpMessageReader::TcpMessageReader(TcpSession *session,
+                                   ReceiveGatherCallback callback)
+    : session_(session), gather_callback_(callback), offset_(0), remain_(-1) {
+}
+
 TcpMessageReader::~TcpMessageReader() {
 }
 
-// Returns a buffer allocation size that is larger than the message.
-int TcpMessageReader::AllocBufferSize(int length) {
-    const int kMaxMessageSize = GetMaxMessageSize();
-    if (length == -1) {
-        return kMaxMessageSize;
+// Returns a buffer of at least the given length that is reused across
+// messages.
+uint8_t *TcpMessageReader::ScratchBuffer(int length) {
+    size_t size = max(length, GetMaxMessageSize());
+    if (scratch_.size() < size) {
+        scratch_.resize(size);
     }
-    int bufsize = 1 << 8;
-    for (; bufsize < kMaxMessageSize && bufsize < length;
-         bufsize <<= 1);
-    return bufsize;
+    return &scratch_[0];
 }
 
 uint8_t *TcpMessageReader::BufferConcat(uint8_t *data, Buffer buffer,
@@ -539,6 +588,47 @@ uint8_t *TcpMessageReader::BufferConcat(uint8_t *data, Buffer buffer,
     return data;
 }
 
+bool TcpMessageReader::BufferGather(Buffer buffer, int msglength) {
+    int total = 0;
+    segments_.clear();
+    for (BufferQueue::const_iterator iter = queue_.begin();
+         iter != queue_.end(); ++iter) {
+        const uint8_t *cp = TcpSession::BufferData(*iter);
+        int bytes = TcpSession::BufferSize(*iter);
+        if (iter == queue_.begin()) {
+            cp += offset_;
+            bytes -= offset_;
+        }
+        assert(total + bytes < msglength);
+        segments_.push_back(Buffer(cp, bytes));
+        total += bytes;
+    }
+
+    int count = msglength - total;
+    assert(count <= (int) TcpSession::BufferSize(buffer));
+    segments_.push_back(Buffer(TcpSession::BufferData(buffer), count));
+
+    bool success = gather_callback_(segments_, msglength);
+
+    // The segments point into the queued buffers, so they can only be
+    // released after the callback.
+    while (!queue_.empty()) {
+        session_->ReleaseBuffer(queue_.front());
+        queue_.pop_front();
+    }
+    offset_ = count;
+    remain_ = -1;
+    return success;
+}
+
+bool TcpMessageReader::Receive(const uint8_t *data, int msglength) {
+    if (!gather_callback_)
+        return callback_(data, msglength);
+    segments_.clear();
+    segments_.push_back(Buffer(data, msglength));
+    return gather_callback_(segments_, msglength);
+}
+
 int TcpMessageReader::QueueByteLength() const {
     int total = 0;
     for (BufferQueue::const_iterator iter = queue_.begin();
@@ -601,8 +691,8 @@ void TcpMessageReader::OnRead(Buffer buffer) {
                 queue_.push_back(buffer);
                 return;
             }
-            boost::scoped_array<uint8_t> data(new uint8_t[kHeaderLenSize]);
-            Buffer header = PullUp(data.get(), buffer, kHeaderLenSize);
+            uint8_t *data = ScratchBuffer(kHeaderLenSize);
+            Buffer header = PullUp(data, buffer, kHeaderLenSize);
             assert(TcpSession::BufferSize(header) == (size_t) kHeaderLenSize);
 
             msglength = MsgLength(header, 0);
@@ -616,13 +706,18 @@ void TcpMessageReader::OnRead(Buffer buffer) {
             return;
         }
 
-        // concat the buffers into a contiguous message.
-        boost::scoped_array<uint8_t>
-            data(new uint8_t[AllocBufferSize(msglength)]);
-        BufferConcat(data.get(), buffer, msglength);
-        assert(remain_ == -1);
-        // Receive the message
-        bool success = callback_(data.get(), msglength);
+        bool success;
+        if (gather_callback_) {
+            // hand out the segments of the message in place.
+            success = BufferGather(buffer, msglength);
+        } else {
+            // concat the buffers into a contiguous message.
+            uint8_t *data = ScratchBuffer(msglength);
+            BufferConcat(data, buffer, msglength);
+            assert(remain_ == -1);
+            // Receive the message
+            success = callback_(data, msglength);
+        }
         if (!success)
             return;
     }
@@ -639,7 +734,7 @@ void TcpMessageReader::OnRead(Buffer buffer) {
         }
         // Receive the message
         bool success =
-            callback_(TcpSession::BufferData(buffer) + offset_, msglength);
+            Receive(TcpSession::BufferData(buffer) + offset_, msglength);
         offset_ += msglength;
         avail -= msglength;
         if (!success)
@@ -794,5 +889,19 @@ void TcpSession::GetTxSocketStats(SocketIOStats &socket_stats) const {
 }
 
 void TcpSession::SetBufferSize(int buffer_size) {
+    tbb::mutex::scoped_lock lock(mutex_);
     buffer_size_ = buffer_size;
+    max_buffer_size_ = buffer_size;
+    read_buffer_size_ = buffer_size;
+    small_read_count_ = 0;
+}
+
+void TcpSession::SetAdaptiveBufferSize(int min_buffer_size,
+                                       int max_buffer_size) {
+    assert(min_buffer_size <= max_buffer_size);
+    tbb::mutex::scoped_lock lock(mutex_);
+    buffer_size_ = min_buffer_size;
+    max_buffer_size_ = max_buffer_size;
+    read_buffer_size_ = min_buffer_size;
+    small_read_count_ = 0;
 }
@@ -7,6 +7,7 @@
 
 #include <list>
 #include <deque>
+#include <vector>
 
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/io_service.hpp>
@@ -26,6 +27,7 @@
 #include "io/tcp_server.h"
 
 class EventManager;
+class IoBufferPool;
 class TcpServer;
 class TcpSession;
 class TcpMessageWriter;
@@ -35,9 +37,15 @@ class TcpMessageWriter;
 // Concurrency: the session is created by the event manager thread, which
 // also invokes the AsyncHandlers. ReleaseBuffer and Send will typically be
 // invoked by a different thread.
+//
+// Receive buffers come from the IoBufferPool of the EventManager. By default
+// every read uses a buffer of kDefaultBufferSize. Sessions that carry bulk
+// data can use SetAdaptiveBufferSize to let the read size grow when reads
+// fill up the buffer and shrink back when the peer goes quiet.
 class TcpSession {
 public:
     static const int kDefaultBufferSize = 4 * 1024;
+    static const int kMaxBufferSize = 64 * 1024;
 
     enum Event {
         EVENT_NONE,
@@ -73,7 +81,12 @@ public:
 
     virtual std::string ToString() const { return name_; }
 
+    // Use fixed size receive buffers.
     void SetBufferSize(int buffer_size);
+    // Adapt the receive buffer size to the amount of data that's available
+    // on the socket, between the given minimum and maximum.
+    void SetAdaptiveBufferSize(int min_buffer_size, int max_buffer_size);
+    int read_buffer_size() const { return read_buffer_size_; }
 
     // Getters and setters
     virtual Socket *socket() const { return socket_.get(); }
@@ -218,6 +231,11 @@ private:
 
     boost::asio::mutable_buffer AllocateBuffer();
     void DeleteBuffer(boost::asio::mutable_buffer buffer);
+    void UpdateReadBufferSize(size_t buffer_size, size_t bytes_transferred);
+
+    // Number of consecutive reads that use less than a quarter of the buffer
+    // before the read size is halved.
+    static const int kSmallReadThreshold = 8;
 
     static int reader_task_id_;
 
@@ -225,7 +243,11 @@ private:
     boost::scoped_ptr<Socket> socket_;
     boost::scoped_ptr<Strand> io_strand_;
     bool read_on_connect_;
+    IoBufferPool *buffer_pool_;
     int buffer_size_;
+    int max_buffer_size_;
+    int read_buffer_size_;
+    int small_read_count_;
 
     /**************** protected by mutex_ ****************/
     bool established_;          // In TCP ESTABLISHED state.
@@ -266,12 +288,23 @@ inline void intrusive_ptr_release(TcpSession *session) {
 // Provides base implementation of OnRead() for TcpSession assuming
 // fixed message header length
 //
+// A message that spans multiple reads is normally copied into a contiguous
+// buffer before it's handed to the ReceiveCallback. A reader created with a
+// ReceiveGatherCallback instead hands out the list of segments of the receive
+// buffers that make up the message, without copying. The segments are only
+// valid for the duration of the callback. Messages that are contained in a
+// single read are handed out as a list with one segment.
+//
 class TcpMessageReader {
 public:
     typedef boost::asio::const_buffer Buffer;
+    typedef std::vector<Buffer> BufferList;
     typedef boost::function<bool(const u_int8_t *, size_t)> ReceiveCallback;
+    typedef boost::function<bool(const BufferList &, size_t)>
+        ReceiveGatherCallback;
 
     TcpMessageReader(TcpSession *session, ReceiveCallback callback);
+    TcpMessageReader(TcpSession *session, ReceiveGatherCallback callback);
     virtual ~TcpMessageReader();
     virtual void OnRead(Buffer buffer);
 
@@ -286,15 +319,23 @@ private:
     // Copy the queue into one contiguous buffer.
     uint8_t *BufferConcat(uint8_t *data, Buffer buffer, int msglength);
 
+    // Hand the segments of the queue and the buffer to the gather callback.
+    bool BufferGather(Buffer buffer, int msglength);
+
+    bool Receive(const uint8_t *data, int msglength);
+
     int QueueByteLength() const;
 
     Buffer PullUp(uint8_t *data, Buffer buffer, size_t size) const;
 
-    int AllocBufferSize(int length);
+    uint8_t *ScratchBuffer(int length);
 
     TcpSession *session_;
     ReceiveCallback callback_;
+    ReceiveGatherCallback gather_callback_;
     BufferQueue queue_;
+    BufferList segments_;
+    std::vector<uint8_t> scratch_;
     int offset_;
     int remain_;
 
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "io/io_buffer_pool.h"
+
+#include <vector>
+
+#include "base/logging.h"
+#include "testing/gunit.h"
+
+using std::vector;
+
+class IoBufferPoolTest : public ::testing::Test {
+};
+
+TEST_F(IoBufferPoolTest, BufferSize) {
+    EXPECT_EQ(4096, IoBufferPool::BufferSize(1));
+    EXPECT_EQ(4096, IoBufferPool::BufferSize(4096));
+    EXPECT_EQ(8192, IoBufferPool::BufferSize(4097));
+    EXPECT_EQ(16384, IoBufferPool::BufferSize(16 * 1024));
+    EXPECT_EQ(65536, IoBufferPool::BufferSize(40000));
+    EXPECT_EQ(65536, IoBufferPool::BufferSize(65536));
+    EXPECT_EQ(65537, IoBufferPool::BufferSize(65537));
+}
+
+//
+// Freed buffers are handed out again for the same size class.
+//
+TEST_F(IoBufferPoolTest, Reuse) {
+    IoBufferPool pool;
+    uint8_t *data1 = pool.Allocate(4096);
+    uint8_t *data2 = pool.Allocate(100);
+    EXPECT_EQ(2, pool.heap_alloc_count());
+    pool.Free(data1, 4096);
+    pool.Free(data2, 100);
+    EXPECT_EQ(8192, pool.cached_bytes());
+
+    uint8_t *data3 = pool.Allocate(2000);
+    EXPECT_TRUE(data3 == data1 || data3 == data2);
+    EXPECT_EQ(2, pool.heap_alloc_count());
+
+    // Different size class.
+    uint8_t *data4 = pool.Allocate(8192);
+    EXPECT_EQ(3, pool.heap_alloc_count());
+    EXPECT_EQ(4096, pool.cached_bytes());
+
+    pool.Free(data3, 2000);
+    pool.Free(data4, 8192);
+    EXPECT_EQ(16384, pool.cached_bytes());
+    EXPECT_EQ(4, pool.alloc_count());
+}
+
+//
+// Buffers beyond the cache budget and oversized buffers go back to the heap.
+//
+TEST_F(IoBufferPoolTest, CacheLimit) {
+    IoBufferPool pool(64 * 1024);
+    vector<uint8_t *> buffers;
+    for (int idx = 0; idx < 32; ++idx) {
+        buffers.push_back(pool.Allocate(4096));
+    }
+    for (int idx = 0; idx < 32; ++idx) {
+        pool.Free(buffers[idx], 4096);
+    }
+    EXPECT_EQ(64 * 1024, pool.cached_bytes());
+
+    uint8_t *data = pool.Allocate(IoBufferPool::kMaxBufferSize + 1);
+    pool.Free(data, IoBufferPool::kMaxBufferSize + 1);
+    EXPECT_EQ(64 * 1024, pool.cached_bytes());
+    EXPECT_EQ(33, pool.heap_alloc_count());
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -288,6 +288,9 @@ public:
     ReaderTest(TcpSession *session, ReceiveCallback callback)
         : TcpMessageReader(session, callback) {
     }
+    ReaderTest(TcpSession *session, ReceiveGatherCallback callback)
+        : TcpMessageReader(session, callback) {
+    }
 
     virtual const int GetHeaderLenSize() {
         return kHeaderLenSize;
@@ -318,7 +321,7 @@ private:
 
 class ReaderTestSession : public TcpSession {
   public:
-    ReaderTestSession(TcpServer *server, Socket *socket);
+    ReaderTestSession(TcpServer *server, Socket *socket, bool gather = false);
 
     void Read(Buffer buffer) {
         OnRead(buffer);
@@ -336,6 +339,7 @@ class ReaderTestSession : public TcpSession {
     }
 
     int release_count() const { return release_count_; }
+    int segment_count() const { return segment_count_; }
 
   protected:
     virtual void OnRead(Buffer buffer) {
@@ -351,16 +355,37 @@ class ReaderTestSession : public TcpSession {
         return true;
     }
 
+    bool ReceiveGatherMsg(const TcpMessageReader::BufferList &segments,
+                          size_t size) {
+        size_t total = 0;
+        for (size_t idx = 0; idx < segments.size(); ++idx) {
+            total += BufferSize(segments[idx]);
+        }
+        EXPECT_EQ(size, total);
+        segment_count_ += segments.size();
+        return ReceiveMsg(BufferData(segments[0]), size);
+    }
+
     std::auto_ptr<ReaderTest> reader_;
     vector<int> sizes;
     int release_count_;
+    int segment_count_;
 };
 
-ReaderTestSession::ReaderTestSession(TcpServer *server, Socket *socket)
+ReaderTestSession::ReaderTestSession(TcpServer *server, Socket *socket,
+                                     bool gather)
     : TcpSession(server, socket),
-      reader_(new ReaderTest(this,
-              boost::bind(&ReaderTestSession::ReceiveMsg, this, _1, _2))),
-      release_count_(0) {
+      release_count_(0),
+      segment_count_(0) {
+    if (gather) {
+        reader_.reset(new ReaderTest(this,
+            TcpMessageReader::ReceiveGatherCallback(boost::bind(
+                &ReaderTestSession::ReceiveGatherMsg, this, _1, _2))));
+    } else {
+        reader_.reset(new ReaderTest(this,
+            TcpMessageReader::ReceiveCallback(boost::bind(
+                &ReaderTestSession::ReceiveMsg, this, _1, _2))));
+    }
 }
 
 class ReaderUnitTest : public ::testing::Test {
@@ -380,7 +405,7 @@ static void CreateFakeMessage(uint8_t *data, size_t length, uint16_t msglen) {
 
 #define ARRAYLEN(_Array)    sizeof(_Array) / sizeof(_Array[0])
 
-TEST_F(ReaderUnitTest, StreamRead) {
+static void StreamRead(ReaderTestSession *session) {
     uint8_t stream[4096];
     int sizes[] = { 100, 400, 80, 110, 40, 60 };
     uint8_t *data = stream;
@@ -405,17 +430,34 @@ TEST_F(ReaderUnitTest, StreamRead) {
         data += segments[i];
     }
     for (size_t i = 0; i < buf_list.size(); i++) {
-        session_.Read(buf_list[i]);
+        session->Read(buf_list[i]);
     }
 
     int i = 0;
-    for (vector<int>::const_iterator iter = session_.begin();
-         iter != session_.end(); ++iter) {
+    for (vector<int>::const_iterator iter = session->begin();
+         iter != session->end(); ++iter) {
         TASK_UTIL_EXPECT_EQ(sizes[i], *iter);
         i++;
     }
     TASK_UTIL_EXPECT_EQ(ARRAYLEN(sizes), i);
-    TASK_UTIL_EXPECT_EQ(buf_list.size(), (size_t) session_.release_count());
+    TASK_UTIL_EXPECT_EQ(buf_list.size(), (size_t) session->release_count());
+}
+
+TEST_F(ReaderUnitTest, StreamRead) {
+    StreamRead(&session_);
+}
+
+//
+// Same as above with a reader that hands out the segments of messages that
+// span multiple reads instead of copying them.
+//
+TEST_F(ReaderUnitTest, StreamReadGather) {
+    ReaderTestSession session(NULL, NULL, true);
+    StreamRead(&session);
+
+    // The 400 byte message spans 3 reads and the 110 byte message spans 4
+    // reads. All others are contained in a single read.
+    EXPECT_EQ(1 + 3 + 1 + 4 + 1 + 1, session.segment_count());
 }
 
 TEST_F(ReaderUnitTest, ZeroMsgLengthRead) {
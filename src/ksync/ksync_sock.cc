@@ -202,6 +202,32 @@ size_t KSyncSockNetlink::SendTo(const char *data, uint32_t data_len,
     return ret_val;
 }
 
+void KSyncSockNetlink::AsyncBulkSendTo(const IoContextList &list,
+                                       HandlerCb cb) {
+    uint32_t len;
+    char *buf = EncodeNetlinkBulkMsg(list, &len);
+    if (buf == NULL) {
+        return;
+    }
+    boost::asio::netlink::raw::endpoint ep;
+    sock_.async_send_to(buffer(buf, len), ep,
+                        boost::bind(&KSyncSock::BulkWriteHandler, buf, cb,
+                                    placeholders::error,
+                                    placeholders::bytes_transferred));
+}
+
+size_t KSyncSockNetlink::BulkSendTo(const IoContextList &list) {
+    uint32_t len;
+    char *buf = EncodeNetlinkBulkMsg(list, &len);
+    if (buf == NULL) {
+        return ((size_t) -1);
+    }
+    boost::asio::netlink::raw::endpoint ep;
+    size_t ret_val = sock_.send_to(buffer((const char *)buf, len), ep);
+    delete [] buf;
+    return ret_val;
+}
+
 void KSyncSockNetlink::AsyncReceive(mutable_buffers_1 buf, HandlerCb cb) {
     sock_.async_receive(buf, cb);
 }
@@ -437,6 +463,21 @@ size_t KSyncSockTcp::SendTo(const char *data, uint32_t data_len,
     return total_length;
 }
 
+void KSyncSockTcp::AsyncBulkSendTo(const IoContextList &list, HandlerCb cb) {
+    BulkSendTo(list);
+}
+
+size_t KSyncSockTcp::BulkSendTo(const IoContextList &list) {
+    uint32_t len;
+    char *buf = EncodeNetlinkBulkMsg(list, &len);
+    if (buf == NULL) {
+        return ((size_t) -1);
+    }
+    session_->Send((const uint8_t *)buf, len, NULL);
+    delete [] buf;
+    return len;
+}
+
 void KSyncSockTcp::AsyncReceive(mutable_buffers_1 buf, HandlerCb cb) {
     //Data would be read from ksync tcp session
     //hence no socket operation would be required
@@ -555,7 +596,9 @@ int KSyncSockTcpSessionReader::MsgLength(Buffer buffer, int offset) {
     return nlh->nlmsg_len;
 }
 
-KSyncSock::KSyncSock() : tx_count_(0), err_count_(0), run_sync_mode_(true) {
+KSyncSock::KSyncSock() : bulk_buf_size_(0),
+    max_bulk_msg_count_(kMaxBulkMsgCount), max_bulk_buf_size_(kMaxBulkBufSize),
+    tx_count_(0), err_count_(0), bulk_send_count_(0), run_sync_mode_(true) {
     for(int i = 0; i < IoContext::MAX_WORK_QUEUES; i++) {
         receive_work_queue[i] = new WorkQueue<char *>(TaskScheduler::GetInstance()->
                              GetTaskId(IoContext::io_wq_names[i]), 0,
@@ -779,28 +822,136 @@ void KSyncSock::GenericSend(IoContext *ioc) {
     async_send_queue_->Enqueue(ioc);
 }
 
+// Messages are collected in bulk_list_ and written together when the count
+// or the byte budget is reached, or when the send queue is drained. The
+// flush runs in the queue runner, outside the lock of the send queue.
 bool KSyncSock::SendAsyncImpl(IoContext *ioc) {
     {
         tbb::mutex::scoped_lock lock(mutex_);
         wait_tree_.insert(*ioc);
     }
+    if (!bulk_list_.empty() &&
+        (bulk_buf_size_ + ioc->GetMsgLen()) > max_bulk_buf_size_) {
+        BulkSend();
+    }
+    bulk_list_.push_back(ioc);
+    bulk_buf_size_ += ioc->GetMsgLen();
+    if (bulk_list_.size() >= max_bulk_msg_count_ ||
+        async_send_queue_->IsQueueEmpty()) {
+        BulkSend();
+    }
+    return true;
+}
+
+// Every message keeps its own sequence number, the responses are matched to
+// their IoContext in wait_tree_ as for a single message.
+void KSyncSock::BulkSend() {
+    if (bulk_list_.empty()) {
+        return;
+    }
+    tx_count_ += bulk_list_.size();
+    bulk_send_count_++;
+
     if (!run_sync_mode_) {
-        AsyncSendTo(ioc->GetMsg(), ioc->GetMsgLen(), ioc->GetSeqno(),
-                    boost::bind(&KSyncSock::WriteHandler, this,
-                                placeholders::error,
-                                placeholders::bytes_transferred));
+        HandlerCb cb = boost::bind(&KSyncSock::WriteHandler, this,
+                                   placeholders::error,
+                                   placeholders::bytes_transferred);
+        if (bulk_list_.size() == 1) {
+            IoContext *ioc = bulk_list_.front();
+            AsyncSendTo(ioc->GetMsg(), ioc->GetMsgLen(), ioc->GetSeqno(), cb);
+        } else {
+            AsyncBulkSendTo(bulk_list_, cb);
+        }
     } else {
-        SendTo((const char *)ioc->GetMsg(),
-               ioc->GetMsgLen(), ioc->GetSeqno());
-        bool more_data = false;
-        do {
+        if (bulk_list_.size() == 1) {
+            IoContext *ioc = bulk_list_.front();
+            SendTo((const char *)ioc->GetMsg(), ioc->GetMsgLen(),
+                   ioc->GetSeqno());
+        } else {
+            BulkSendTo(bulk_list_);
+        }
+        // Wait for the last response of every message
+        size_t pending = bulk_list_.size();
+        while (pending) {
             char *rxbuf = new char[kBufLen];
             Receive(boost::asio::buffer(rxbuf, kBufLen));
-            more_data = IsMoreData(rxbuf);
+            if (!IsMoreData(rxbuf)) {
+                pending--;
+            }
             ValidateAndEnqueue(rxbuf);
-        } while(more_data);
+        }
     }
-    return true;
+    bulk_list_.clear();
+    bulk_buf_size_ = 0;
+}
+
+void KSyncSock::AsyncBulkSendTo(const IoContextList &list, HandlerCb cb) {
+    for (IoContextList::const_iterator it = list.begin(); it != list.end();
+         ++it) {
+        AsyncSendTo((*it)->GetMsg(), (*it)->GetMsgLen(), (*it)->GetSeqno(),
+                    cb);
+    }
+}
+
+size_t KSyncSock::BulkSendTo(const IoContextList &list) {
+    size_t len = 0;
+    for (IoContextList::const_iterator it = list.begin(); it != list.end();
+         ++it) {
+        len += SendTo((const char *)(*it)->GetMsg(), (*it)->GetMsgLen(),
+                      (*it)->GetSeqno());
+    }
+    return len;
+}
+
+char *KSyncSock::EncodeNetlinkBulkMsg(const IoContextList &list,
+                                      uint32_t *len) {
+    const uint32_t header_len = NLMSG_HDRLEN + GENL_HDRLEN + NLA_HDRLEN;
+    uint32_t buf_len = 0;
+    for (IoContextList::const_iterator it = list.begin(); it != list.end();
+         ++it) {
+        buf_len += NLMSG_ALIGN(header_len + (*it)->GetMsgLen());
+    }
+    char *buf = new char[buf_len];
+    memset(buf, 0, buf_len);
+
+    uint32_t offset = 0;
+    for (IoContextList::const_iterator it = list.begin(); it != list.end();
+         ++it) {
+        struct nl_client cl;
+        unsigned char *nl_buf;
+        uint32_t nl_buf_len;
+        int ret;
+
+        nl_init_generic_client_req(&cl, GetNetlinkFamilyId());
+        if ((ret = nl_build_header(&cl, &nl_buf, &nl_buf_len)) < 0) {
+            LOG(ERROR, "Error creating netlink message. Error : " << ret);
+            free(cl.cl_buf);
+            delete [] buf;
+            return NULL;
+        }
+        assert(cl.cl_buf_offset == header_len);
+
+        uint32_t msg_len = (*it)->GetMsgLen();
+        nl_update_header(&cl, msg_len);
+        struct nlmsghdr *nlh = (struct nlmsghdr *)cl.cl_buf;
+        nlh->nlmsg_pid = KSyncSock::GetPid();
+        nlh->nlmsg_seq = (*it)->GetSeqno();
+
+        memcpy(buf + offset, cl.cl_buf, header_len);
+        memcpy(buf + offset + header_len, (*it)->GetMsg(), msg_len);
+        offset += NLMSG_ALIGN(header_len + msg_len);
+        free(cl.cl_buf);
+    }
+    *len = offset;
+    return buf;
+}
+
+// The buffer of an asynchronous bulk write is freed when the write completes
+void KSyncSock::BulkWriteHandler(char *buf, HandlerCb cb,
+                                 const boost::system::error_code &error,
+                                 size_t bytes_transferred) {
+    delete [] buf;
+    cb(error, bytes_transferred);
 }
 
 KSyncIoContext::KSyncIoContext(KSyncEntry *sync_entry, int msg_len,
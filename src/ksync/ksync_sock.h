@@ -138,8 +138,12 @@ class KSyncSock {
 public:
     const static int kMsgGrowSize = 16;
     const static unsigned kBufLen = 4096;
+    // Limits on the messages packed in a single write to the socket
+    const static uint32_t kMaxBulkMsgCount = 32;
+    const static uint32_t kMaxBulkBufSize = 16 * 1024;
 
     typedef boost::function<void(const boost::system::error_code &, size_t)> HandlerCb;
+    typedef std::vector<IoContext *> IoContextList;
     KSyncSock();
     virtual ~KSyncSock();
 
@@ -176,9 +180,28 @@ public:
         agent_sandesh_ctx_ = ctx;
     }
     virtual void Decoder(char *data, SandeshContext *ctxt) = 0;
+
+    // A max_bulk_msg_count of 1 sends every message on its own
+    void set_max_bulk_msg_count(uint32_t count) { max_bulk_msg_count_ = count; }
+    uint32_t max_bulk_msg_count() const { return max_bulk_msg_count_; }
+    void set_max_bulk_buf_size(uint32_t size) { max_bulk_buf_size_ = size; }
+    uint32_t max_bulk_buf_size() const { return max_bulk_buf_size_; }
+    void set_send_queue_disable(bool disable) {
+        async_send_queue_->set_disable(disable);
+    }
+    int tx_count() const { return tx_count_; }
+    int bulk_send_count() const { return bulk_send_count_; }
+
 protected:
     static void Init(int count);
     static void SetSockTableEntry(int i, KSyncSock *sock);
+    // Encode the messages in list into one buffer allocated with new[], each
+    // message with its own generic netlink header and sequence number
+    static char *EncodeNetlinkBulkMsg(const IoContextList &list,
+                                      uint32_t *len);
+    static void BulkWriteHandler(char *buf, HandlerCb cb,
+                                 const boost::system::error_code &error,
+                                 size_t bytes_transferred);
     // Tree of all KSyncEntries pending ack from Netlink socket
     Tree wait_tree_;
     WorkQueue<IoContext *> *async_send_queue_;
@@ -199,6 +222,7 @@ private:
 
     virtual bool Validate(char *data) = 0;
     bool SendAsyncImpl(IoContext *ioc);
+    void BulkSend();
 
     bool SendAsyncStart() {
         tbb::mutex::scoped_lock lock(mutex_);
@@ -209,6 +233,10 @@ private:
     virtual void AsyncSendTo(char *, uint32_t, uint32_t, HandlerCb) = 0;
     virtual std::size_t SendTo(const char *, uint32_t, uint32_t) = 0;
     virtual void Receive(boost::asio::mutable_buffers_1) = 0;
+    // Write all the messages in list with a single write. The default sends
+    // them one at a time.
+    virtual void AsyncBulkSendTo(const IoContextList &list, HandlerCb cb);
+    virtual std::size_t BulkSendTo(const IoContextList &list);
 
     virtual uint32_t GetSeqno(char *data) = 0;
     Tree::iterator GetIoContext(char *data);
@@ -224,10 +252,17 @@ private:
     tbb::atomic<int> seqno_;
     tbb::atomic<int> uve_seqno_;
 
+    // Messages waiting to be sent in a single write
+    IoContextList bulk_list_;
+    uint32_t bulk_buf_size_;
+    uint32_t max_bulk_msg_count_;
+    uint32_t max_bulk_buf_size_;
+
     // Debug stats
     int tx_count_;
     int ack_count_;
     int err_count_;
+    int bulk_send_count_;
     bool run_sync_mode_;
     DISALLOW_COPY_AND_ASSIGN(KSyncSock);
 };
@@ -247,6 +282,8 @@ public:
     virtual void AsyncSendTo(char *, uint32_t, uint32_t,  HandlerCb);
     virtual std::size_t SendTo(const char*, uint32_t, uint32_t);
     virtual void Receive(boost::asio::mutable_buffers_1);
+    virtual void AsyncBulkSendTo(const IoContextList &list, HandlerCb cb);
+    virtual std::size_t BulkSendTo(const IoContextList &list);
 private:
     boost::asio::netlink::raw::socket sock_;
 };
@@ -317,6 +354,8 @@ public:
     virtual void AsyncSendTo(char *, uint32_t, uint32_t, HandlerCb);
     virtual std::size_t SendTo(const char *, uint32_t, uint32_t);
     virtual void Receive(boost::asio::mutable_buffers_1);
+    virtual void AsyncBulkSendTo(const IoContextList &list, HandlerCb cb);
+    virtual std::size_t BulkSendTo(const IoContextList &list);
     virtual TcpSession *AllocSession(Socket *socket);
     bool ReceiveMsg(const u_int8_t *msg, size_t size);
     void OnSessionEvent(TcpSession *session, TcpSession::Event event);
@@ -531,6 +531,39 @@ size_t KSyncSockTypeMap::SendTo(const char *data, uint32_t data_len,
     return 0;
 }
 
+//split a bulk message and process every netlink message in it
+void KSyncSockTypeMap::ProcessBulkMsg(const char *buf, uint32_t len) {
+    const uint32_t header_len = NLMSG_HDRLEN + GENL_HDRLEN + NLA_HDRLEN;
+    uint32_t offset = 0;
+    while (offset < len) {
+        const struct nlmsghdr *nlh = (const struct nlmsghdr *)(buf + offset);
+        assert(nlh->nlmsg_len >= header_len);
+        KSyncUserSockContext ctx(true, nlh->nlmsg_seq);
+        ProcessSandesh((const uint8_t *)(buf + offset + header_len),
+                       nlh->nlmsg_len - header_len, &ctx);
+        if (ctx.IsResponseReqd()) {
+            SimulateResponse(nlh->nlmsg_seq, 0, 0);
+        }
+        offset += NLMSG_ALIGN(nlh->nlmsg_len);
+    }
+}
+
+void KSyncSockTypeMap::AsyncBulkSendTo(const IoContextList &list,
+                                       HandlerCb cb) {
+    BulkSendTo(list);
+}
+
+size_t KSyncSockTypeMap::BulkSendTo(const IoContextList &list) {
+    uint32_t len;
+    char *buf = EncodeNetlinkBulkMsg(list, &len);
+    if (buf == NULL) {
+        return 0;
+    }
+    ProcessBulkMsg(buf, len);
+    delete [] buf;
+    return 0;
+}
+
 //receive msgs from datapath
 void KSyncSockTypeMap::AsyncReceive(mutable_buffers_1 buf, HandlerCb cb) {
     sock_.async_receive_from(buf, local_ep_, cb);
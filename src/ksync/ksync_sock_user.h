@@ -134,6 +134,8 @@ public:
     virtual void AsyncSendTo(char *, uint32_t, uint32_t, HandlerCb);
     virtual std::size_t SendTo(const char *, uint32_t, uint32_t);
     virtual void Receive(boost::asio::mutable_buffers_1);
+    virtual void AsyncBulkSendTo(const IoContextList &, HandlerCb);
+    virtual std::size_t BulkSendTo(const IoContextList &);
 
     static void set_error_code(int code) { error_code_ = code; }
     static int error_code() { return error_code_; }
@@ -208,6 +210,7 @@ public:
 
 private:
     void PurgeBlockedMsg();
+    void ProcessBulkMsg(const char *buf, uint32_t len);
     udp::socket sock_;
     udp::endpoint local_ep_;
     int ksync_error_[KSYNC_MAX_ENTRY_TYPE];
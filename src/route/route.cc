@@ -28,6 +28,18 @@ void Route::insert(const Path *ipath) {
     path_.push_back(*path);
 }
 
+// Insert a path before next, or at the end if next is NULL
+void Route::insert(const Path *ipath, const Path *next) {
+    Path *path = const_cast<Path *> (ipath);
+
+    path->set_time_stamp_usecs(UTCTimestampUsec());
+    if (next) {
+        path_.insert(path_.iterator_to(*const_cast<Path *>(next)), *path);
+    } else {
+        path_.push_back(*path);
+    }
+}
+
 // Remove a path
 void Route::remove(const Path *ipath) {
     Path *path = const_cast<Path *> (ipath);
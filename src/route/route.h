@@ -37,6 +37,9 @@ public:
     // Insert a path
     void insert(const Path *path);
 
+    // Insert a path before next, or at the end if next is NULL
+    void insert(const Path *path, const Path *next);
+
     // Remove a path
     void remove(const Path *path);
 
@@ -201,6 +201,8 @@ public:
     static const uint32_t kMaxOtherOpenFds = 64;
     // default timeout zero means, this timeout is not used
     static const uint32_t kDefaultFlowCacheTimeout = 0;
+    // number of Agent::FlowHandler task instances used for flow setup
+    static const uint16_t kDefaultFlowThreadCount = 1;
     enum VxLanNetworkIdentifierMode {
         AUTOMATIC,
         CONFIGURED
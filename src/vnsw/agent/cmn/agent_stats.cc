@@ -64,6 +64,23 @@ void AgentStatsReq::HandleRequest() const {
             (stats->flow_drop_due_to_linklocal_limit());
         flow->set_flow_max_system_flows(agent->flow_table_size());
         flow->set_flow_max_vm_flows(agent->pkt()->flow_table()->max_vm_flows());
+        flow->set_flow_table_memory(agent->pkt()->flow_table()->memory_size());
+        flow->set_flow_memory_per_flow
+            (agent->pkt()->flow_table()->memory_per_flow());
+        FlowTable *table = agent->pkt()->flow_table();
+        flow->set_flow_revaluate_pending(table->revaluate_pending());
+        flow->set_flow_revaluate_batches(table->revaluate_batch_count());
+        vector<FlowRevaluateStats> revaluate_list;
+        for (int i = 0; i < FlowTable::REVALUATE_MAX; i++) {
+            FlowTable::RevaluateCause cause =
+                static_cast<FlowTable::RevaluateCause>(i);
+            FlowRevaluateStats revaluate;
+            revaluate.set_cause(FlowTable::RevaluateCauseToString(cause));
+            revaluate.set_enqueued(table->revaluate_enqueue_count(cause));
+            revaluate.set_revaluated(table->revaluate_count(cause));
+            revaluate_list.push_back(revaluate);
+        }
+        flow->set_flow_revaluate_list(revaluate_list);
         flow->set_context(context());
         flow->set_more(true);
         flow->Response();
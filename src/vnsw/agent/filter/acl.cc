@@ -114,6 +114,7 @@ DBEntry *AclTable::Add(const DBRequest *req) {
          ++it) {
         acl->AddAclEntry(*it, acl->acl_entries_);
     }
+    acl->BuildClassifier();
     return acl;
 }
 
@@ -161,6 +162,8 @@ bool AclTable::OnChange(DBEntry *entry, const DBRequest *req) {
             entries.erase(iter++);
             delete ae;
         }
+    } else {
+        acl->BuildClassifier();
     }
     return changed;
 }
@@ -501,6 +504,7 @@ bool AclDBEntry::DeleteAclEntry(const uint32_t acl_entry_id)
             AclEntry *ae = iter.operator->();
             acl_entries_.erase(acl_entries_.iterator_to(*iter));
             ACL_TRACE(Info, "acl entry " + integerToString(acl_entry_id) + " deleted");
+            BuildClassifier();
             delete ae;
             return true;
         }
@@ -511,6 +515,7 @@ bool AclDBEntry::DeleteAclEntry(const uint32_t acl_entry_id)
 
 void AclDBEntry::DeleteAllAclEntries()
 {
+    classifier_.reset();
     AclEntries::iterator iter;
     iter = acl_entries_.begin();
     while (iter != acl_entries_.end()) {
@@ -521,67 +526,119 @@ void AclDBEntry::DeleteAllAclEntries()
     return;
 }
 
-bool AclDBEntry::PacketMatch(const PacketHeader &packet_header, 
-			                 MatchAclParams &m_acl, FlowPolicyInfo *info) const
+void AclDBEntry::BuildClassifier()
+{
+    if (acl_entries_.empty()) {
+        classifier_.reset();
+        return;
+    }
+    AclClassifier *classifier = new AclClassifier();
+    AclEntries::const_iterator iter;
+    for (iter = acl_entries_.begin(); iter != acl_entries_.end(); ++iter) {
+        classifier->AddEntry(iter.operator->());
+    }
+    classifier->Compile();
+    classifier_.reset(classifier);
+}
+
+// Applies the actions of a matching entry, returns true if the entry is
+// terminal and no further entries must be looked at
+bool AclDBEntry::ApplyAclEntry(const AclEntry &entry, MatchAclParams &m_acl,
+                               FlowPolicyInfo *info) const
+{
+    const AclEntry::ActionList &al = entry.Actions();
+    AclEntry::ActionList::const_iterator al_it;
+    for (al_it = al.begin(); al_it != al.end(); ++al_it) {
+        TrafficAction *ta = static_cast<TrafficAction *>(*al_it.operator->());
+        m_acl.action_info.action |= 1 << ta->GetAction();
+        if (ta->GetActionType() == TrafficAction::MIRROR_ACTION) {
+            MirrorAction *a = static_cast<MirrorAction *>(*al_it.operator->());
+            MirrorActionSpec as;
+            as.ip = a->GetIp();
+            as.port = a->GetPort();
+            as.vrf_name = a->vrf_name();
+            as.analyzer_name = a->GetAnalyzerName();
+            as.encap = a->GetEncap();
+            m_acl.action_info.mirror_l.push_back(as);
+        }
+        if (ta->GetActionType() == TrafficAction::VRF_TRANSLATE_ACTION) {
+            const VrfTranslateAction *a =
+                static_cast<VrfTranslateAction *>(*al_it.operator->());
+            VrfTranslateActionSpec vrf_translate_action(a->vrf_name(),
+                                                        a->ignore_acl());
+            m_acl.action_info.vrf_translate_action_ = vrf_translate_action;
+        }
+        if (info && ta->IsDrop()) {
+            if (!info->drop) {
+                info->drop = true;
+                info->terminal = false;
+                info->other = false;
+                info->uuid = entry.uuid();
+            }
+        }
+    }
+
+    m_acl.ace_id_list.push_back((int32_t)(entry.id()));
+    if (entry.IsTerminal()) {
+        m_acl.terminal_rule = true;
+        /* Set uuid only if it is NOT already set as
+         * drop/terminal uuid */
+        if (info && !info->drop && !info->terminal) {
+            info->terminal = true;
+            info->other = false;
+            info->uuid = entry.uuid();
+        }
+        return true;
+    }
+    /* If the ace action is not drop and if ace is not terminal rule
+     * then set the uuid with the first matching uuid */
+    if (info && !info->drop && !info->terminal && !info->other) {
+        info->other = true;
+        info->uuid = entry.uuid();
+    }
+    return false;
+}
+
+// The classifier returns the matching entries in rule order, the result is
+// the same as the one of LinearPacketMatch
+bool AclDBEntry::PacketMatch(const PacketHeader &packet_header,
+                             MatchAclParams &m_acl, FlowPolicyInfo *info) const
+{
+    if (classifier_.get() == NULL) {
+        return LinearPacketMatch(packet_header, m_acl, info);
+    }
+
+    m_acl.terminal_rule = false;
+    m_acl.action_info.action = 0;
+    AclClassifier::EntryList matches;
+    classifier_->Match(packet_header, &matches);
+    AclClassifier::EntryList::const_iterator it;
+    for (it = matches.begin(); it != matches.end(); ++it) {
+        if (ApplyAclEntry(**it, m_acl, info)) {
+            break;
+        }
+    }
+    return !matches.empty();
+}
+
+bool AclDBEntry::LinearPacketMatch(const PacketHeader &packet_header,
+                                   MatchAclParams &m_acl,
+                                   FlowPolicyInfo *info) const
 {
     AclEntries::const_iterator iter;
     bool ret_val = false;
     m_acl.terminal_rule = false;
-	m_acl.action_info.action = 0;
+    m_acl.action_info.action = 0;
     for (iter = acl_entries_.begin();
          iter != acl_entries_.end();
          ++iter) {
         const AclEntry::ActionList &al = iter->PacketMatch(packet_header);
-	AclEntry::ActionList::const_iterator al_it;
-	for (al_it = al.begin(); al_it != al.end(); ++al_it) {
-	     TrafficAction *ta = static_cast<TrafficAction *>(*al_it.operator->());
-	     m_acl.action_info.action |= 1 << ta->GetAction();
-	     if (ta->GetActionType() == TrafficAction::MIRROR_ACTION) {
-	         MirrorAction *a = static_cast<MirrorAction *>(*al_it.operator->());
-                 MirrorActionSpec as;
-		 as.ip = a->GetIp();
-		 as.port = a->GetPort();
-                 as.vrf_name = a->vrf_name();
-                 as.analyzer_name = a->GetAnalyzerName();
-                 as.encap = a->GetEncap();
-                 m_acl.action_info.mirror_l.push_back(as);
-	     }
-         if (ta->GetActionType() == TrafficAction::VRF_TRANSLATE_ACTION) {
-             const VrfTranslateAction *a =
-                 static_cast<VrfTranslateAction *>(*al_it.operator->());
-             VrfTranslateActionSpec vrf_translate_action(a->vrf_name(),
-                                                         a->ignore_acl());
-             m_acl.action_info.vrf_translate_action_ = vrf_translate_action;
-         }
-         if (info && ta->IsDrop()) {
-             if (!info->drop) {
-                 info->drop = true;
-                 info->terminal = false;
-                 info->other = false;
-                 info->uuid = iter->uuid();
-             }
-         }
-	}
-        if (!(al.empty())) {
-            ret_val = true;
-            m_acl.ace_id_list.push_back((int32_t)(iter->id()));
-            if (iter->IsTerminal()) {
-                m_acl.terminal_rule = true;
-                /* Set uuid only if it is NOT already set as
-                 * drop/terminal uuid */
-                if (info && !info->drop && !info->terminal) {
-                    info->terminal = true;
-                    info->other = false;
-                    info->uuid = iter->uuid();
-                }
-                return ret_val;
-            }
-            /* If the ace action is not drop and if ace is not terminal rule
-             * then set the uuid with the first matching uuid */
-            if (info && !info->drop && !info->terminal && !info->other) {
-                info->other = true;
-                info->uuid = iter->uuid();
-            }
+        if (al.empty()) {
+            continue;
+        }
+        ret_val = true;
+        if (ApplyAclEntry(*iter, m_acl, info)) {
+            break;
         }
     }
     return ret_val;
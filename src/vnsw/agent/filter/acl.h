@@ -8,12 +8,14 @@
 #include <boost/intrusive/list.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/intrusive_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <tbb/atomic.h>
 
 #include <filter/traffic_action.h>
 #include <filter/acl_entry_match.h>
 #include <filter/acl_entry_spec.h>
 #include <filter/acl_entry.h>
+#include <filter/acl_classifier.h>
 
 struct FlowKey;
 
@@ -110,15 +112,24 @@ public:
     // Packet Match
     bool PacketMatch(const PacketHeader &packet_header, MatchAclParams &m_acl,
                      FlowPolicyInfo *info) const;
+    // Walks the entries one by one instead of using the classifier
+    bool LinearPacketMatch(const PacketHeader &packet_header,
+                           MatchAclParams &m_acl, FlowPolicyInfo *info) const;
+    // Rebuild the classifier after the entries have changed
+    void BuildClassifier();
     bool Changed(const AclEntries &new_acl_entries) const;
     uint32_t ace_count() const { return acl_entries_.size();}
     bool IsRulePresent(const std::string &uuid) const;
 private:
     friend class AclTable;
+    bool ApplyAclEntry(const AclEntry &entry, MatchAclParams &m_acl,
+                       FlowPolicyInfo *info) const;
+
     uuid uuid_;
     bool dynamic_acl_;
     std::string name_;
     AclEntries acl_entries_;
+    boost::scoped_ptr<AclClassifier> classifier_;
     DISALLOW_COPY_AND_ASSIGN(AclDBEntry);
 };
 
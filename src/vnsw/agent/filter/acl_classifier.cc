@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <algorithm>
+
+#include <filter/acl_classifier.h>
+#include <filter/acl_entry.h>
+#include <filter/acl_entry_match.h>
+#include <filter/packet_header.h>
+
+static const int kBitsPerWord = 64;
+static const uint32_t kPortCount = 0x10000;
+static const uint16_t kProtocolCount = 0x100;
+
+AclClassifier::AclClassifier() : words_(0) {
+}
+
+AclClassifier::~AclClassifier() {
+}
+
+void AclClassifier::AddEntry(const AclEntry *entry) {
+    entries_.push_back(entry);
+}
+
+void AclClassifier::SetBit(Bitmap *bitmap, size_t index) const {
+    if (bitmap->empty()) {
+        bitmap->resize(words_, 0);
+    }
+    (*bitmap)[index / kBitsPerWord] |= (1ULL << (index % kBitsPerWord));
+}
+
+void AclClassifier::Compile() {
+    words_ = (entries_.size() + kBitsPerWord - 1) / kBitsPerWord;
+    valid_.assign(words_, 0);
+    protocol_.assign(kProtocolCount, Bitmap(words_, 0));
+
+    // Entries without actions never match, leave them out
+    for (size_t index = 0; index < entries_.size(); index++) {
+        if (entries_[index]->Actions().empty()) {
+            continue;
+        }
+        SetBit(&valid_, index);
+    }
+    for (int field = 0; field < MAX_FIELD; field++) {
+        any_[field] = valid_;
+    }
+    for (size_t index = 0; index < entries_.size(); index++) {
+        if (entries_[index]->Actions().empty()) {
+            continue;
+        }
+        entries_[index]->Compile(this, index);
+    }
+
+    for (uint16_t protocol = 0; protocol < kProtocolCount; protocol++) {
+        Bitmap &bitmap = protocol_[protocol];
+        for (size_t word = 0; word < words_; word++) {
+            bitmap[word] |= any_[PROTOCOL][word];
+        }
+    }
+    src_port_.Build(any_[SRC_PORT]);
+    dst_port_.Build(any_[DST_PORT]);
+    src_address_.any_ = any_[SRC_ADDRESS];
+    dst_address_.any_ = any_[DST_ADDRESS];
+}
+
+void AclClassifier::ResetAny(Field field, size_t index) {
+    any_[field][index / kBitsPerWord] &= ~(1ULL << (index % kBitsPerWord));
+}
+
+void AclClassifier::AddProtocolRange(size_t index, uint16_t min,
+                                     uint16_t max) {
+    for (uint32_t protocol = min;
+         protocol <= max && protocol < kProtocolCount; protocol++) {
+        SetBit(&protocol_[protocol], index);
+    }
+}
+
+void AclClassifier::AddPortRange(bool src, size_t index, uint16_t min,
+                                 uint16_t max) {
+    if (min > max) {
+        return;
+    }
+    PortTable *table = src ? &src_port_ : &dst_port_;
+    table->ranges_.push_back(PortRange(index, min, max));
+}
+
+// The address must be in the same family as the rule and the masked address
+// must be equal to the rule address, the same as AddressMatch::Match.
+// Rules that can never match are not added anywhere.
+void AclClassifier::AddPrefix(bool src, size_t index, const IpAddress &ip,
+                              const IpAddress &mask) {
+    AddressTable *table = address_table(src);
+    if (ip.is_v4() && mask.is_v4()) {
+        uint32_t addr = ip.to_v4().to_ulong();
+        uint32_t mask4 = mask.to_v4().to_ulong();
+        if ((addr & mask4) != addr) {
+            return;
+        }
+        std::vector<Prefix4Table>::iterator it;
+        for (it = table->prefix4_.begin(); it != table->prefix4_.end(); ++it) {
+            if (it->mask_ == mask4) {
+                break;
+            }
+        }
+        if (it == table->prefix4_.end()) {
+            it = table->prefix4_.insert(it, Prefix4Table());
+            it->mask_ = mask4;
+        }
+        SetBit(&it->table_[addr], index);
+        return;
+    }
+
+    if (ip.is_v6() && mask.is_v6()) {
+        Ip6Address::bytes_type addr = ip.to_v6().to_bytes();
+        Ip6Address::bytes_type mask6 = mask.to_v6().to_bytes();
+        for (size_t i = 0; i < addr.size(); i++) {
+            if ((addr[i] & mask6[i]) != addr[i]) {
+                return;
+            }
+        }
+        std::vector<Prefix6Table>::iterator it;
+        for (it = table->prefix6_.begin(); it != table->prefix6_.end(); ++it) {
+            if (it->mask_ == mask6) {
+                break;
+            }
+        }
+        if (it == table->prefix6_.end()) {
+            it = table->prefix6_.insert(it, Prefix6Table());
+            it->mask_ = mask6;
+        }
+        SetBit(&it->table_[Ip6Address(addr)], index);
+    }
+}
+
+void AclClassifier::AddNetwork(bool src, size_t index,
+                               const std::string &network) {
+    SetBit(&address_table(src)->network_[network], index);
+}
+
+void AclClassifier::AddSecurityGroup(bool src, size_t index, int sg_id) {
+    AddressTable *table = address_table(src);
+    if (sg_id == AddressMatch::kAny) {
+        SetBit(&table->sg_any_, index);
+    } else {
+        SetBit(&table->sg_[sg_id], index);
+    }
+}
+
+void AclClassifier::PortTable::Build(const Bitmap &any) {
+    bounds_.clear();
+    bounds_.push_back(0);
+    std::vector<PortRange>::const_iterator it;
+    for (it = ranges_.begin(); it != ranges_.end(); ++it) {
+        bounds_.push_back(it->min);
+        bounds_.push_back(it->max + 1);
+    }
+    std::sort(bounds_.begin(), bounds_.end());
+    bounds_.erase(std::unique(bounds_.begin(), bounds_.end()), bounds_.end());
+    if (bounds_.back() == kPortCount) {
+        bounds_.pop_back();
+    }
+
+    bitmaps_.assign(bounds_.size(), any);
+    for (it = ranges_.begin(); it != ranges_.end(); ++it) {
+        size_t first = std::lower_bound(bounds_.begin(), bounds_.end(),
+                                        it->min) - bounds_.begin();
+        size_t last = std::upper_bound(bounds_.begin(), bounds_.end(),
+                                       it->max) - bounds_.begin();
+        for (size_t i = first; i < last; i++) {
+            bitmaps_[i][it->index / kBitsPerWord] |=
+                (1ULL << (it->index % kBitsPerWord));
+        }
+    }
+    ranges_.clear();
+}
+
+const uint64_t *AclClassifier::PortTable::Lookup(uint16_t port) const {
+    size_t i = std::upper_bound(bounds_.begin(), bounds_.end(),
+                                (uint32_t)port) - bounds_.begin();
+    return &bitmaps_[i - 1][0];
+}
+
+void AclClassifier::AddressTable::Lookup(const IpAddress &ip,
+                                         const std::string *network,
+                                         const SecurityGroupList *sg_list,
+                                         BitmapList *bitmaps) const {
+    bitmaps->push_back(&any_[0]);
+
+    if (ip.is_v4()) {
+        uint32_t addr = ip.to_v4().to_ulong();
+        std::vector<Prefix4Table>::const_iterator it;
+        for (it = prefix4_.begin(); it != prefix4_.end(); ++it) {
+            std::map<uint32_t, Bitmap>::const_iterator match =
+                it->table_.find(addr & it->mask_);
+            if (match != it->table_.end()) {
+                bitmaps->push_back(&match->second[0]);
+            }
+        }
+    } else if (ip.is_v6()) {
+        Ip6Address::bytes_type addr = ip.to_v6().to_bytes();
+        std::vector<Prefix6Table>::const_iterator it;
+        for (it = prefix6_.begin(); it != prefix6_.end(); ++it) {
+            Ip6Address::bytes_type masked;
+            for (size_t i = 0; i < masked.size(); i++) {
+                masked[i] = addr[i] & it->mask_[i];
+            }
+            std::map<Ip6Address, Bitmap>::const_iterator match =
+                it->table_.find(Ip6Address(masked));
+            if (match != it->table_.end()) {
+                bitmaps->push_back(&match->second[0]);
+            }
+        }
+    }
+
+    if (network && !network_.empty()) {
+        std::map<std::string, Bitmap>::const_iterator match =
+            network_.find(*network);
+        if (match != network_.end()) {
+            bitmaps->push_back(&match->second[0]);
+        }
+    }
+
+    if (sg_list == NULL) {
+        return;
+    }
+    if (!sg_any_.empty()) {
+        bitmaps->push_back(&sg_any_[0]);
+    }
+    if (sg_.empty()) {
+        return;
+    }
+    SecurityGroupList::const_iterator it;
+    for (it = sg_list->begin(); it != sg_list->end(); ++it) {
+        std::map<int, Bitmap>::const_iterator match = sg_.find(*it);
+        if (match != sg_.end()) {
+            bitmaps->push_back(&match->second[0]);
+        }
+    }
+}
+
+void AclClassifier::Match(const PacketHeader &packet_header,
+                          EntryList *matches) const {
+    if (words_ == 0) {
+        return;
+    }
+
+    const uint64_t *protocol = &protocol_[packet_header.protocol][0];
+    const uint64_t *src_port = NULL;
+    const uint64_t *dst_port = NULL;
+    // Port conditions only apply to TCP and UDP
+    if (packet_header.protocol == IPPROTO_TCP ||
+        packet_header.protocol == IPPROTO_UDP) {
+        src_port = src_port_.Lookup(packet_header.src_port);
+        dst_port = dst_port_.Lookup(packet_header.dst_port);
+    }
+
+    BitmapList src_address, dst_address;
+    src_address_.Lookup(packet_header.src_ip, packet_header.src_policy_id,
+                        packet_header.src_sg_id_l, &src_address);
+    dst_address_.Lookup(packet_header.dst_ip, packet_header.dst_policy_id,
+                        packet_header.dst_sg_id_l, &dst_address);
+
+    for (size_t word = 0; word < words_; word++) {
+        uint64_t bits = valid_[word] & protocol[word];
+        if (src_port) {
+            bits &= src_port[word] & dst_port[word];
+        }
+        if (bits == 0) {
+            continue;
+        }
+        uint64_t src = 0;
+        for (BitmapList::const_iterator it = src_address.begin();
+             it != src_address.end(); ++it) {
+            src |= (*it)[word];
+        }
+        uint64_t dst = 0;
+        for (BitmapList::const_iterator it = dst_address.begin();
+             it != dst_address.end(); ++it) {
+            dst |= (*it)[word];
+        }
+        bits &= src & dst;
+        while (bits) {
+            int bit = __builtin_ctzll(bits);
+            matches->push_back(entries_[word * kBitsPerWord + bit]);
+            bits &= bits - 1;
+        }
+    }
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __AGENT_ACL_CLASSIFIER_H__
+#define __AGENT_ACL_CLASSIFIER_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cmn/agent_cmn.h>
+
+struct PacketHeader;
+class AclEntry;
+
+// Compiled form of the entries of an ACL.
+//
+// Every entry is given a bit, in rule order. Each field of the packet header
+// is looked up in a table built for that field, which yields the bitmap of
+// the entries accepting the value:
+//   protocol      - one bitmap per protocol number
+//   ports         - the port ranges are split into disjoint intervals, with
+//                   one bitmap per interval found with a binary search
+//   addresses     - a table per distinct mask, indexed by the masked address
+//                   (tuple space search), plus tables for the virtual-network
+//                   names and the security-group ids
+// Entries without a condition on a field are set in every bitmap of that
+// field. The intersection of the bitmaps gives the matching entries, in the
+// same order as the linear walk of the entries would find them.
+//
+// The classifier keeps pointers to the entries and must be rebuilt whenever
+// the entries of the ACL change.
+class AclClassifier {
+public:
+    enum Field {
+        PROTOCOL,
+        SRC_PORT,
+        DST_PORT,
+        SRC_ADDRESS,
+        DST_ADDRESS,
+        MAX_FIELD
+    };
+    typedef std::vector<const AclEntry *> EntryList;
+
+    AclClassifier();
+    ~AclClassifier();
+
+    // Entries must be added in rule order, before Compile is called
+    void AddEntry(const AclEntry *entry);
+    void Compile();
+
+    // Appends the entries that match the packet to matches, in rule order
+    void Match(const PacketHeader &packet_header, EntryList *matches) const;
+
+    size_t size() const { return entries_.size(); }
+
+    // Called from AclEntryMatch::Compile for the entry at index. ResetAny
+    // removes the entry from the wildcard of the field, the Add methods list
+    // the values accepted by the entry.
+    void ResetAny(Field field, size_t index);
+    void AddProtocolRange(size_t index, uint16_t min, uint16_t max);
+    void AddPortRange(bool src, size_t index, uint16_t min, uint16_t max);
+    void AddPrefix(bool src, size_t index, const IpAddress &ip,
+                   const IpAddress &mask);
+    void AddNetwork(bool src, size_t index, const std::string &network);
+    void AddSecurityGroup(bool src, size_t index, int sg_id);
+
+private:
+    typedef std::vector<uint64_t> Bitmap;
+    typedef std::vector<const uint64_t *> BitmapList;
+
+    struct PortRange {
+        PortRange(size_t i, uint16_t lo, uint16_t hi) :
+            index(i), min(lo), max(hi) { }
+        size_t index;
+        uint16_t min;
+        uint16_t max;
+    };
+
+    // Port ranges split into disjoint intervals, interval i starts at
+    // bounds_[i] and ends before bounds_[i + 1]
+    struct PortTable {
+        void Build(const Bitmap &any);
+        const uint64_t *Lookup(uint16_t port) const;
+
+        std::vector<PortRange> ranges_;
+        std::vector<uint32_t> bounds_;
+        std::vector<Bitmap> bitmaps_;
+    };
+
+    struct Prefix4Table {
+        uint32_t mask_;
+        std::map<uint32_t, Bitmap> table_;
+    };
+
+    struct Prefix6Table {
+        Ip6Address::bytes_type mask_;
+        std::map<Ip6Address, Bitmap> table_;
+    };
+
+    struct AddressTable {
+        void Lookup(const IpAddress &ip, const std::string *network,
+                    const SecurityGroupList *sg_list,
+                    BitmapList *bitmaps) const;
+
+        Bitmap any_;
+        Bitmap sg_any_;
+        std::vector<Prefix4Table> prefix4_;
+        std::vector<Prefix6Table> prefix6_;
+        std::map<std::string, Bitmap> network_;
+        std::map<int, Bitmap> sg_;
+    };
+
+    void SetBit(Bitmap *bitmap, size_t index) const;
+    AddressTable *address_table(bool src) {
+        return src ? &src_address_ : &dst_address_;
+    }
+
+    EntryList entries_;
+    size_t words_;
+    Bitmap valid_;
+    Bitmap any_[MAX_FIELD];
+    std::vector<Bitmap> protocol_;
+    PortTable src_port_;
+    PortTable dst_port_;
+    AddressTable src_address_;
+    AddressTable dst_address_;
+    DISALLOW_COPY_AND_ASSIGN(AclClassifier);
+};
+
+#endif
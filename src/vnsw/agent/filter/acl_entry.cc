@@ -15,6 +15,7 @@
 #include <agent_types.h>
 
 #include <filter/traffic_action.h>
+#include <filter/acl_classifier.h>
 #include <filter/acl_entry_match.h>
 #include <filter/acl_entry.h>
 #include <filter/acl_entry_spec.h>
@@ -159,6 +160,13 @@ const AclEntry::ActionList &AclEntry::PacketMatch(const PacketHeader &packet_hea
     return Actions();
 }
 
+void AclEntry::Compile(AclClassifier *classifier, size_t index) const {
+    std::vector<AclEntryMatch *>::const_iterator it;
+    for (it = matches_.begin(); it != matches_.end(); it++) {
+        (*it)->Compile(classifier, index);
+    }
+}
+
 void AclEntry::SetAclEntrySandeshData(AclEntrySandeshData &data) const {
 
     // Set match data
@@ -362,6 +370,22 @@ bool AddressMatch::Match(const PacketHeader *pheader) const
     return false;
 }
 
+void AddressMatch::Compile(AclClassifier *classifier, size_t index) const
+{
+    if (policy_id_s_.compare("any") == 0) {
+        return;
+    }
+    classifier->ResetAny(src_ ? AclClassifier::SRC_ADDRESS :
+                         AclClassifier::DST_ADDRESS, index);
+    if (addr_type_ == IP_ADDR) {
+        classifier->AddPrefix(src_, index, ip_addr_, ip_mask_);
+    } else if (addr_type_ == NETWORK_ID) {
+        classifier->AddNetwork(src_, index, policy_id_s_);
+    } else if (addr_type_ == SG) {
+        classifier->AddSecurityGroup(src_, index, sg_id_);
+    }
+}
+
 bool AddressMatch::Compare(const AclEntryMatch &rhs) const {
     const AddressMatch &rhs_address_match =
         static_cast<const AddressMatch &>(rhs);
@@ -470,6 +494,15 @@ bool ProtocolMatch::Match(const PacketHeader *packet_header) const
     return false;
 }
 
+void ProtocolMatch::Compile(AclClassifier *classifier, size_t index) const
+{
+    classifier->ResetAny(AclClassifier::PROTOCOL, index);
+    for (RangeSList::const_iterator it = protocol_ranges_.begin();
+         it != protocol_ranges_.end(); it++) {
+        classifier->AddProtocolRange(index, (*it).min, (*it).max);
+    }
+}
+
 void ProtocolMatch::SetAclEntryMatchSandeshData(AclEntrySandeshData &data)
 {
     for (RangeSList::const_iterator it = protocol_ranges_.begin(); 
@@ -527,6 +560,15 @@ bool SrcPortMatch::Match(const PacketHeader *packet_header) const
     return false;
 }
 
+void SrcPortMatch::Compile(AclClassifier *classifier, size_t index) const
+{
+    classifier->ResetAny(AclClassifier::SRC_PORT, index);
+    for (RangeSList::const_iterator it = port_ranges_.begin();
+         it != port_ranges_.end(); it++) {
+        classifier->AddPortRange(true, index, (*it).min, (*it).max);
+    }
+}
+
 void SrcPortMatch::SetAclEntryMatchSandeshData(AclEntrySandeshData &data)
 {
     for (RangeSList::const_iterator it = port_ranges_.begin(); 
@@ -558,6 +600,15 @@ bool DstPortMatch::Match(const PacketHeader *packet_header) const
     return false;
 }
 
+void DstPortMatch::Compile(AclClassifier *classifier, size_t index) const
+{
+    classifier->ResetAny(AclClassifier::DST_PORT, index);
+    for (RangeSList::const_iterator it = port_ranges_.begin();
+         it != port_ranges_.end(); it++) {
+        classifier->AddPortRange(false, index, (*it).min, (*it).max);
+    }
+}
+
 void DstPortMatch::SetAclEntryMatchSandeshData(AclEntrySandeshData &data)
 {
     for (RangeSList::const_iterator it = port_ranges_.begin(); 
@@ -19,6 +19,7 @@ struct PacketHeader;
 class AclEntrySpec;
 class TrafficAction;
 class AclEntryMatch;
+class AclClassifier;
 
 typedef std::vector<int32_t> AclEntryIDList;
 
@@ -49,6 +50,8 @@ public:
     // Match packet header
     const ActionList &PacketMatch(const PacketHeader &packet_header) const;
     const ActionList &Actions() const {return actions_;};
+    // Add the match conditions to the classifier for the entry at index
+    void Compile(AclClassifier *classifier, size_t index) const;
 
     void SetAclEntrySandeshData(AclEntrySandeshData &data) const;
 
@@ -15,6 +15,7 @@
 #include <agent_types.h>
 
 class PacketHeader;
+class AclClassifier;
 class AclEntryMatch {
 public:
     enum Type {
@@ -28,6 +29,8 @@ public:
     virtual bool Match(const PacketHeader *packet_header) const = 0;
     virtual void SetAclEntryMatchSandeshData(AclEntrySandeshData &data) = 0;
     virtual bool Compare(const AclEntryMatch &rhs) const = 0;
+    // Add the condition to the classifier for the entry at index
+    virtual void Compile(AclClassifier *classifier, size_t index) const = 0;
     bool operator ==(const AclEntryMatch &rhs) const {
         if (type_ != rhs.type_) {
             return false;
@@ -74,6 +77,7 @@ public:
     void SetPortRange(const uint16_t min_port, const uint16_t max_port);
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data) = 0;
     virtual bool Match(const PacketHeader *packet_header) const = 0;
+    virtual void Compile(AclClassifier *classifier, size_t index) const = 0;
     virtual bool Compare(const AclEntryMatch &rhs) const;
 protected:
     RangeSList port_ranges_;
@@ -83,12 +87,14 @@ class SrcPortMatch : public PortMatch {
 public:
     SrcPortMatch(): PortMatch(SOURCE_PORT_MATCH) {}
     bool Match(const PacketHeader *packet_header) const;
+    void Compile(AclClassifier *classifier, size_t index) const;
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data);
 };
 class DstPortMatch : public PortMatch {
 public:
     DstPortMatch(): PortMatch(DESTINATION_PORT_MATCH) {}
     bool Match(const PacketHeader *packet_header) const;
+    void Compile(AclClassifier *classifier, size_t index) const;
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data);
 };
 
@@ -98,6 +104,7 @@ public:
     ~ProtocolMatch() {protocol_ranges_.clear_and_dispose(delete_disposer());}
     void SetProtocolRange(const uint16_t min, const uint16_t max);
     bool Match(const PacketHeader *packet_header) const;
+    void Compile(AclClassifier *classifier, size_t index) const;
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data);
     virtual bool Compare(const AclEntryMatch &rhs) const;
 
@@ -131,6 +138,7 @@ public:
     void SetIPAddress(const IpAddress &ip, const IpAddress &mask);
     // Match packet header for address
     bool Match(const PacketHeader *packet_header) const;
+    void Compile(AclClassifier *classifier, size_t index) const;
     void SetAclEntryMatchSandeshData(AclEntrySandeshData &data);
     virtual bool Compare(const AclEntryMatch &rhs) const;
 private:
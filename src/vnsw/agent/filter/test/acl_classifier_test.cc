@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <stdlib.h>
+
+#include <boost/uuid/nil_generator.hpp>
+
+#include "base/logging.h"
+#include "base/time_util.h"
+#include "testing/gunit.h"
+
+#include "filter/acl.h"
+#include "filter/acl_classifier.h"
+#include "filter/acl_entry.h"
+#include "filter/acl_entry_spec.h"
+#include "filter/packet_header.h"
+#include "filter/traffic_action.h"
+
+#include "net/address.h"
+
+void RouterIdDepInit(Agent *agent) {
+}
+
+namespace {
+
+static const char *kNetworks[] = { "vn1", "vn2", "vn3", "any" };
+
+class AclClassifierTest : public ::testing::Test {
+protected:
+    AclClassifierTest() : acl_(new AclDBEntry(boost::uuids::nil_uuid())) {
+    }
+
+    virtual void TearDown() {
+        for (std::vector<AclEntry *>::iterator it = entries_.begin();
+             it != entries_.end(); ++it) {
+            delete *it;
+        }
+        entries_.clear();
+        acl_->DeleteAllAclEntries();
+    }
+
+    AclEntry *AddEntry(const AclEntrySpec &spec) {
+        AclEntry *entry = new AclEntry();
+        entry->PopulateAclEntry(spec);
+        entries_.push_back(entry);
+        return entry;
+    }
+
+    void Compile() {
+        for (std::vector<AclEntry *>::iterator it = entries_.begin();
+             it != entries_.end(); ++it) {
+            classifier_.AddEntry(*it);
+        }
+        classifier_.Compile();
+    }
+
+    // Results of one of the AclDBEntry match functions
+    struct MatchResult {
+        MatchResult() : matched(false), info("") {
+        }
+        bool operator==(const MatchResult &rhs) const {
+            return matched == rhs.matched &&
+                params.ace_id_list == rhs.params.ace_id_list &&
+                params.action_info.action == rhs.params.action_info.action &&
+                params.terminal_rule == rhs.params.terminal_rule &&
+                info.uuid == rhs.info.uuid && info.drop == rhs.info.drop &&
+                info.terminal == rhs.info.terminal &&
+                info.other == rhs.info.other;
+        }
+        bool matched;
+        MatchAclParams params;
+        FlowPolicyInfo info;
+    };
+
+    void LinearMatch(const PacketHeader &header, MatchResult *result) const {
+        result->matched = acl_->LinearPacketMatch(header, result->params,
+                                                  &result->info);
+    }
+
+    void ClassifierMatch(const PacketHeader &header,
+                         MatchResult *result) const {
+        result->matched = acl_->PacketMatch(header, result->params,
+                                            &result->info);
+    }
+
+    static IpAddress RandomAddress(bool v6) {
+        if (v6) {
+            Ip6Address::bytes_type bytes = {{ 0xfd }};
+            bytes[14] = rand() % 4;
+            bytes[15] = rand() % 16;
+            return Ip6Address(bytes);
+        }
+        return Ip4Address(0x0a000000 | (rand() % 4) << 8 | (rand() % 16));
+    }
+
+    static void RandomAddressSpec(AddressMatch::AddressType *type,
+                                  IpAddress *ip, IpAddress *mask,
+                                  std::string *network, int *sg_id) {
+        switch (rand() % 4) {
+        case 0:
+            *type = AddressMatch::UNKNOWN_TYPE;
+            break;
+        case 1:
+            *type = AddressMatch::IP_ADDR;
+            if (rand() % 3 == 0) {
+                *ip = RandomAddress(true);
+                Ip6Address::bytes_type bytes = {{ 0 }};
+                bytes.assign(0xff);
+                bytes[15] = (rand() % 2) ? 0xf0 : 0xff;
+                *mask = Ip6Address(bytes);
+                bytes = ip->to_v6().to_bytes();
+                bytes[15] &= mask->to_v6().to_bytes()[15];
+                *ip = Ip6Address(bytes);
+            } else {
+                uint32_t mask4 = (rand() % 2) ? 0xffffff00 : 0xffffffff;
+                *ip = Ip4Address(RandomAddress(false).to_v4().to_ulong() &
+                                 mask4);
+                *mask = Ip4Address(mask4);
+            }
+            break;
+        case 2:
+            *type = AddressMatch::NETWORK_ID;
+            *network = kNetworks[rand() % 4];
+            break;
+        default:
+            *type = AddressMatch::SG;
+            *sg_id = (rand() % 8 == 0) ? AddressMatch::kAny : rand() % 8;
+            break;
+        }
+    }
+
+    static void RandomRanges(int max, std::vector<RangeSpec> *ranges) {
+        int count = rand() % 3;
+        for (int i = 0; i < count; i++) {
+            RangeSpec range;
+            range.min = rand() % max;
+            range.max = (rand() % 4 == 0) ? 65535 : range.min + rand() % 32;
+            ranges->push_back(range);
+        }
+    }
+
+    void AddRandomEntries(int count) {
+        for (int i = 0; i < count; i++) {
+            AclEntrySpec spec;
+            spec.id = i + 1;
+            RandomAddressSpec(&spec.src_addr_type, &spec.src_ip_addr,
+                              &spec.src_ip_mask, &spec.src_policy_id_str,
+                              &spec.src_sg_id);
+            RandomAddressSpec(&spec.dst_addr_type, &spec.dst_ip_addr,
+                              &spec.dst_ip_mask, &spec.dst_policy_id_str,
+                              &spec.dst_sg_id);
+            if (rand() % 2) {
+                RangeSpec protocol;
+                protocol.min = protocol.max =
+                    (rand() % 2) ? IPPROTO_TCP : IPPROTO_UDP;
+                spec.protocol.push_back(protocol);
+            }
+            if (rand() % 4 == 0) {
+                RandomRanges(256, &spec.src_port);
+            }
+            if (rand() % 2) {
+                RandomRanges(256, &spec.dst_port);
+            }
+            // Entries without actions never match
+            if (rand() % 16) {
+                ActionSpec action;
+                action.ta_type = TrafficAction::SIMPLE_ACTION;
+                action.simple_action = (rand() % 2) ? TrafficAction::PASS :
+                    TrafficAction::DENY;
+                spec.action_l.push_back(action);
+            }
+            spec.terminal = (rand() % 8 == 0);
+            acl_->AddAclEntry(spec, acl_entries_);
+        }
+        acl_->SetAclEntries(acl_entries_);
+    }
+
+    struct Packet {
+        PacketHeader header;
+        std::string src_network;
+        std::string dst_network;
+        SecurityGroupList src_sg_list;
+        SecurityGroupList dst_sg_list;
+    };
+
+    static void RandomPacket(Packet *packet) {
+        PacketHeader &header = packet->header;
+        bool v6 = (rand() % 3 == 0);
+        header.src_ip = RandomAddress(v6);
+        header.dst_ip = RandomAddress(v6);
+        header.protocol = (rand() % 4) ? IPPROTO_TCP : IPPROTO_ICMP;
+        header.src_port = rand() % 300;
+        header.dst_port = rand() % 300;
+        packet->src_network = kNetworks[rand() % 3];
+        packet->dst_network = kNetworks[rand() % 3];
+        header.src_policy_id = &packet->src_network;
+        header.dst_policy_id = &packet->dst_network;
+        packet->src_sg_list.push_back(rand() % 8);
+        packet->dst_sg_list.push_back(rand() % 8);
+        header.src_sg_id_l = &packet->src_sg_list;
+        header.dst_sg_id_l = (rand() % 8) ? &packet->dst_sg_list : NULL;
+    }
+
+    std::vector<AclEntry *> entries_;
+    AclClassifier classifier_;
+    boost::scoped_ptr<AclDBEntry> acl_;
+    AclDBEntry::AclEntries acl_entries_;
+};
+
+TEST_F(AclClassifierTest, Basic) {
+    AclEntrySpec spec;
+    spec.id = 1;
+    spec.src_addr_type = AddressMatch::IP_ADDR;
+    spec.src_ip_addr = IpAddress::from_string("1.1.1.0");
+    spec.src_ip_mask = IpAddress::from_string("255.255.255.0");
+    RangeSpec protocol;
+    protocol.min = protocol.max = IPPROTO_TCP;
+    spec.protocol.push_back(protocol);
+    RangeSpec port;
+    port.min = 10;
+    port.max = 100;
+    spec.dst_port.push_back(port);
+    ActionSpec action;
+    action.ta_type = TrafficAction::SIMPLE_ACTION;
+    action.simple_action = TrafficAction::PASS;
+    spec.action_l.push_back(action);
+    spec.terminal = false;
+    AclEntry *entry1 = AddEntry(spec);
+
+    AclEntrySpec spec2;
+    spec2.id = 2;
+    spec2.dst_addr_type = AddressMatch::NETWORK_ID;
+    spec2.dst_policy_id_str = "vn2";
+    action.simple_action = TrafficAction::DENY;
+    spec2.action_l.push_back(action);
+    AclEntry *entry2 = AddEntry(spec2);
+    Compile();
+
+    std::string vn2("vn2");
+    PacketHeader header;
+    header.src_ip = Ip4Address(0x01010102);
+    header.dst_ip = Ip4Address(0x02020202);
+    header.dst_policy_id = &vn2;
+    header.protocol = IPPROTO_TCP;
+    header.dst_port = 99;
+    AclClassifier::EntryList matches;
+    classifier_.Match(header, &matches);
+    ASSERT_EQ(2U, matches.size());
+    EXPECT_EQ(entry1, matches[0]);
+    EXPECT_EQ(entry2, matches[1]);
+
+    header.dst_port = 101;
+    matches.clear();
+    classifier_.Match(header, &matches);
+    ASSERT_EQ(1U, matches.size());
+    EXPECT_EQ(entry2, matches[0]);
+
+    // Ports do not apply to other protocols, the protocol does not match
+    header.protocol = IPPROTO_UDP;
+    header.dst_policy_id = NULL;
+    matches.clear();
+    classifier_.Match(header, &matches);
+    EXPECT_EQ(0U, matches.size());
+}
+
+// AclDBEntry::PacketMatch, with the classifier, must find the same entries
+// and apply the same actions as AclDBEntry::LinearPacketMatch, for random
+// entries and packets
+TEST_F(AclClassifierTest, RuleOrderEquivalence) {
+    srand(1);
+    AddRandomEntries(300);
+    acl_->BuildClassifier();
+    for (int i = 0; i < 20000; i++) {
+        Packet packet;
+        RandomPacket(&packet);
+        MatchResult expected, result;
+        LinearMatch(packet.header, &expected);
+        ClassifierMatch(packet.header, &result);
+        ASSERT_TRUE(expected == result) << "packet " << i;
+    }
+}
+
+// Compares the time it takes to classify packets against a large ACL by
+// walking the entries with the time it takes with the classifier. By default
+// the times are only logged. Set ACL_CLASSIFIER_TEST_BENCHMARK to require
+// the classifier to be at least kMinSpeedup times faster.
+TEST_F(AclClassifierTest, Performance) {
+    static const int kMinSpeedup = 2;
+    int entry_count = 1000;
+    int packet_count = 100000;
+    char *str = getenv("ACL_CLASSIFIER_TEST_ENTRIES");
+    if (str) entry_count = strtoul(str, NULL, 0);
+    str = getenv("ACL_CLASSIFIER_TEST_PACKETS");
+    if (str) packet_count = strtoul(str, NULL, 0);
+    bool benchmark = (getenv("ACL_CLASSIFIER_TEST_BENCHMARK") != NULL);
+
+    srand(2);
+    AddRandomEntries(entry_count);
+    uint64_t start = ClockMonotonicUsec();
+    acl_->BuildClassifier();
+    uint64_t compile_time = ClockMonotonicUsec() - start;
+
+    std::vector<Packet> packets(1024);
+    for (size_t i = 0; i < packets.size(); i++) {
+        RandomPacket(&packets[i]);
+    }
+
+    size_t linear_count = 0;
+    start = ClockMonotonicUsec();
+    for (int i = 0; i < packet_count; i++) {
+        MatchResult result;
+        LinearMatch(packets[i % packets.size()].header, &result);
+        linear_count += result.params.ace_id_list.size();
+    }
+    uint64_t linear_time = ClockMonotonicUsec() - start;
+
+    size_t classifier_count = 0;
+    start = ClockMonotonicUsec();
+    for (int i = 0; i < packet_count; i++) {
+        MatchResult result;
+        ClassifierMatch(packets[i % packets.size()].header, &result);
+        classifier_count += result.params.ace_id_list.size();
+    }
+    uint64_t classifier_time = ClockMonotonicUsec() - start;
+
+    EXPECT_EQ(linear_count, classifier_count);
+    LOG(DEBUG, "Classified " << packet_count << " packets against " <<
+        entry_count << " entries in " << linear_time << " usecs with the "
+        "linear walk, in " << classifier_time << " usecs with the "
+        "classifier (compiled in " << compile_time << " usecs)");
+    if (benchmark) {
+        EXPECT_LT(classifier_time * kMinSpeedup, linear_time);
+    }
+}
+
+} // namespace
+
+int main (int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
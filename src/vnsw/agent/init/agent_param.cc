@@ -476,6 +476,10 @@ void AgentParam::ParseFlows() {
         "FLOWS.max_vm_linklocal_flows")) {
         linklocal_vm_flows_ = Agent::kDefaultMaxLinkLocalOpenFds;
     }
+    if (!GetValueFromTree<uint16_t>(flow_thread_count_,
+                                    "FLOWS.thread_count")) {
+        flow_thread_count_ = Agent::kDefaultFlowThreadCount;
+    }
 }
 
 void AgentParam::ParseHeadlessMode() {
@@ -677,6 +681,7 @@ void AgentParam::ParseFlowArguments
                           "FLOWS.max_system_linklocal_flows");
     GetOptValue<uint16_t>(var_map, linklocal_vm_flows_,
                           "FLOWS.max_vm_linklocal_flows");
+    GetOptValue<uint16_t>(var_map, flow_thread_count_, "FLOWS.thread_count");
 }
 
 void AgentParam::ParseHeadlessModeArguments
@@ -829,6 +834,10 @@ void AgentParam::ComputeFlowLimits() {
         cout << "Updating flows configuration max-vm-flows to : 0%\n";
         max_vm_flows_ = 0;
     }
+    if (flow_thread_count_ == 0) {
+        cout << "Updating flows configuration thread-count to : 1\n";
+        flow_thread_count_ = 1;
+    }
 
     struct rlimit rl;
     int result = getrlimit(RLIMIT_NOFILE, &rl);
@@ -1033,6 +1042,7 @@ void AgentParam::LogConfig() const {
     LOG(DEBUG, "Linklocal Max System Flows  : " << linklocal_system_flows_);
     LOG(DEBUG, "Linklocal Max Vm Flows      : " << linklocal_vm_flows_);
     LOG(DEBUG, "Flow cache timeout          : " << flow_cache_timeout_);
+    LOG(DEBUG, "Flow thread count           : " << flow_thread_count_);
 
     if (agent_mode_ == VROUTER_AGENT)
         LOG(DEBUG, "Agent Mode                  : Vrouter");
@@ -1124,7 +1134,9 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
         mgmt_ip_(), hypervisor_mode_(MODE_KVM), xen_ll_(),
         tunnel_type_(), metadata_shared_secret_(), max_vm_flows_(),
         linklocal_system_flows_(), linklocal_vm_flows_(),
-        flow_cache_timeout_(), config_file_(), program_name_(),
+        flow_cache_timeout_(),
+        flow_thread_count_(Agent::kDefaultFlowThreadCount), config_file_(),
+        program_name_(),
         log_file_(), log_local_(false), log_flow_(false), log_level_(),
         log_category_(), use_syslog_(false),
         http_server_port_(), host_name_(),
@@ -1257,6 +1269,8 @@ AgentParam::AgentParam(Agent *agent, bool enable_flow_options,
              "Maximum number of link-local flows allowed across all VMs")
             ("FLOWS.max_vm_linklocal_flows", opt::value<uint16_t>(),
              "Maximum number of link-local flows allowed per VM")
+            ("FLOWS.thread_count", opt::value<uint16_t>(),
+             "Number of threads used for flow setup")
             ;
         options_.add(flow);
     }
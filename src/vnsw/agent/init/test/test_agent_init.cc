@@ -54,6 +54,7 @@ TEST_F(FlowTest, Agent_Conf_file_1) {
     EXPECT_EQ(param.linklocal_system_flows(), 1024);
     EXPECT_EQ(param.linklocal_vm_flows(), 512);
     EXPECT_EQ(param.flow_cache_timeout(), 30);
+    EXPECT_EQ(param.flow_thread_count(), 4);
     EXPECT_STREQ(param.config_file().c_str(), 
                  "controller/src/vnsw/agent/init/test/cfg.ini");
     EXPECT_STREQ(param.program_name().c_str(), "test-param");
@@ -68,6 +69,7 @@ TEST_F(FlowTest, Agent_Conf_file_2) {
     EXPECT_EQ(param.max_vm_flows(), 100);
     EXPECT_EQ(param.linklocal_system_flows(), 2048);
     EXPECT_EQ(param.linklocal_vm_flows(), 2048);
+    EXPECT_EQ(param.flow_thread_count(), 1);
     EXPECT_EQ(param.xmpp_server_1().to_ulong(),
               Ip4Address::from_string("11.1.1.1").to_ulong());
     EXPECT_EQ(param.xmpp_server_2().to_ulong(),
@@ -21,9 +21,24 @@ static const VmEntry *InterfaceToVm(const Interface *intf) {
 }
 
 bool FlowHandler::Run() {
+    FlowTable *flow_table = agent_->pkt()->flow_table();
+    // Flow setup runs in several task instances in parallel. Classification
+    // only reads the oper DB, but updates to the FlowTable must be serialized.
+    // Recompute messages and ECMP resolve requests read flow entries while
+    // being classified, so they hold the lock throughout. The lock is
+    // declared first so that the flow references below are released with
+    // the lock held.
+    tbb::mutex::scoped_lock lock;
+    bool locked = false;
+    if (pkt_info_->type == PktType::MESSAGE ||
+        pkt_info_->agent_hdr.cmd == AgentHdr::TRAP_ECMP_RESOLVE) {
+        lock.acquire(flow_table->mutex());
+        locked = true;
+    }
+
     PktControlInfo in;
     PktControlInfo out;
-    PktFlowInfo info(pkt_info_, agent_->pkt()->flow_table());
+    PktFlowInfo info(pkt_info_, flow_table);
     std::auto_ptr<FlowTaskMsg> ipc;
 
     if (pkt_info_->type == PktType::MESSAGE) {
@@ -77,6 +92,9 @@ bool FlowHandler::Run() {
         out.vm_ = InterfaceToVm(out.intf_);
     }
 
+    if (!locked) {
+        lock.acquire(flow_table->mutex());
+    }
     info.Add(pkt_info_.get(), &in, &out);
     return true;
 }
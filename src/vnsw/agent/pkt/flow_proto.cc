@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
+#include "init/agent_param.h"
+#include "pkt/flow_proto.h"
+
+FlowProto::FlowProto(Agent *agent, boost::asio::io_service &io) :
+    Proto(agent, "Agent::FlowHandler", PktHandler::FLOW, io) {
+    agent->SetFlowProto(this);
+
+    uint16_t count = agent->params()->flow_thread_count();
+    if (count == 0) {
+        count = 1;
+    }
+    int task_id = TaskScheduler::GetInstance()->GetTaskId("Agent::FlowHandler");
+    for (uint16_t i = 0; i < count; i++) {
+        flow_work_queue_list_.push_back(
+            new FlowWorkQueue(task_id, i,
+                              boost::bind(&Proto::ProcessProto, this, _1)));
+    }
+}
+
+FlowProto::~FlowProto() {
+    for (std::vector<FlowWorkQueue *>::iterator it =
+         flow_work_queue_list_.begin(); it != flow_work_queue_list_.end();
+         ++it) {
+        (*it)->Shutdown();
+        delete *it;
+    }
+    flow_work_queue_list_.clear();
+}
+
+static void HashAddress(const IpAddress &addr, std::size_t *hash) {
+    if (addr.is_v4()) {
+        boost::hash_combine(*hash, addr.to_v4().to_ulong());
+    } else {
+        Ip6Address::bytes_type bytes = addr.to_v6().to_bytes();
+        boost::hash_range(*hash, bytes.begin(), bytes.end());
+    }
+}
+
+// Hash the endpoints in a fixed order, so that swapping source and
+// destination yields the same value.
+std::size_t FlowProto::FlowHash(const IpAddress &sip, const IpAddress &dip,
+                                uint8_t proto, uint16_t sport,
+                                uint16_t dport) {
+    std::size_t hash = 0;
+    boost::hash_combine(hash, proto);
+    if (sip < dip || (sip == dip && sport <= dport)) {
+        HashAddress(sip, &hash);
+        boost::hash_combine(hash, sport);
+        HashAddress(dip, &hash);
+        boost::hash_combine(hash, dport);
+    } else {
+        HashAddress(dip, &hash);
+        boost::hash_combine(hash, dport);
+        HashAddress(sip, &hash);
+        boost::hash_combine(hash, sport);
+    }
+    return hash;
+}
+
+uint16_t FlowProto::FlowShard(const PktInfo *msg) const {
+    if (flow_work_queue_list_.size() == 1) {
+        return 0;
+    }
+
+    std::size_t hash;
+    if (msg->type == PktType::MESSAGE) {
+        const FlowTaskMsg *ipc = static_cast<const FlowTaskMsg *>(msg->ipc);
+        const FlowKey &key = ipc->fe_ptr->key();
+        hash = FlowHash(key.src_addr, key.dst_addr, key.protocol,
+                        key.src_port, key.dst_port);
+    } else {
+        hash = FlowHash(msg->ip_saddr, msg->ip_daddr, msg->ip_proto,
+                        msg->sport, msg->dport);
+    }
+    return hash % flow_work_queue_list_.size();
+}
+
+bool FlowProto::Enqueue(boost::shared_ptr<PktInfo> msg) {
+    return flow_work_queue_list_[FlowShard(msg.get())]->Enqueue(msg);
+}
@@ -13,16 +13,30 @@
 #include "pkt/flow_table.h"
 #include "pkt/flow_handler.h"
 
+// Flow setup is sharded across several instances of the Agent::FlowHandler
+// task. Packets are dispatched using a hash of the 5-tuple that is symmetric
+// in source and destination, so that the forward and reverse packets of a
+// flow are processed by the same instance, in order. Flow classification
+// runs in parallel; updates to the FlowTable are serialized by its mutex.
 class FlowProto : public Proto {
 public:
-    FlowProto(Agent *agent, boost::asio::io_service &io) :
-        Proto(agent, "Agent::FlowHandler", PktHandler::FLOW, io) {
-        agent->SetFlowProto(this);
-    }
-    virtual ~FlowProto() {}
+    typedef WorkQueue<boost::shared_ptr<PktInfo> > FlowWorkQueue;
+
+    FlowProto(Agent *agent, boost::asio::io_service &io);
+    virtual ~FlowProto();
     void Init() {}
     void Shutdown() {}
 
+    virtual bool Enqueue(boost::shared_ptr<PktInfo> msg);
+    uint16_t FlowShard(const PktInfo *msg) const;
+    static std::size_t FlowHash(const IpAddress &sip, const IpAddress &dip,
+                                uint8_t proto, uint16_t sport, uint16_t dport);
+
+    uint16_t flow_thread_count() const { return flow_work_queue_list_.size(); }
+    const FlowWorkQueue *flow_work_queue(uint16_t index) const {
+        return flow_work_queue_list_[index];
+    }
+
     FlowHandler *AllocProtoHandler(boost::shared_ptr<PktInfo> info,
                                    boost::asio::io_service &io) {
         return new FlowHandler(agent(), info, io);
@@ -43,6 +57,10 @@ public:
     bool RemovePktBuff() {
         return true;
     }
+
+private:
+    std::vector<FlowWorkQueue *> flow_work_queue_list_;
+    DISALLOW_COPY_AND_ASSIGN(FlowProto);
 };
 
 extern SandeshTraceBufferPtr PktFlowTraceBuf;
@@ -8,6 +8,7 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/assign/list_of.hpp>
 #include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
 #include <sandesh/sandesh_types.h>
 #include <sandesh/sandesh.h>
 #include <sandesh/sandesh_trace.h>
@@ -62,8 +63,204 @@ const std::map<FlowEntry::FlowPolicyState, const char*>
 
 boost::uuids::random_generator FlowTable::rand_gen_ = boost::uuids::random_generator();
 tbb::atomic<int> FlowEntry::alloc_count_;
+FlowEntrySlab FlowEntry::slab_(sizeof(FlowEntry));
 SecurityGroupList FlowTable::default_sg_list_;
 
+static void HashAddress(const IpAddress &addr, std::size_t *hash) {
+    if (addr.is_v4()) {
+        boost::hash_combine(*hash, addr.to_v4().to_ulong());
+    } else {
+        Ip6Address::bytes_type bytes = addr.to_v6().to_bytes();
+        boost::hash_range(*hash, bytes.begin(), bytes.end());
+    }
+}
+
+uint32_t FlowKey::Hash() const {
+    std::size_t hash = 0;
+    boost::hash_combine(hash, nh);
+    HashAddress(src_addr, &hash);
+    HashAddress(dst_addr, &hash);
+    boost::hash_combine(hash, protocol);
+    boost::hash_combine(hash, src_port);
+    boost::hash_combine(hash, dst_port);
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+FlowEntryHashTable::FlowEntryHashTable() :
+    slots_(kInitialSize), size_(0), tombstones_(0) {
+}
+
+FlowEntryHashTable::~FlowEntryHashTable() {
+}
+
+size_t FlowEntryHashTable::NextSlot(size_t slot) const {
+    while (slot < slots_.size() && slots_[slot].entry == NULL) {
+        slot++;
+    }
+    return slot;
+}
+
+// Returns the slot holding key, or slots_.size() if key is not present. The
+// load factor guarantees an empty slot that terminates the probe.
+size_t FlowEntryHashTable::Lookup(const FlowKey &key, uint32_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+        const Slot &entry = slots_[slot];
+        if (entry.entry == NULL) {
+            if (entry.tombstone) {
+                continue;
+            }
+            return slots_.size();
+        }
+        if (entry.hash == hash && entry.entry->key().IsEqual(key)) {
+            return slot;
+        }
+    }
+}
+
+size_t FlowEntryHashTable::Insert(FlowEntry *flow, uint32_t hash) {
+    size_t mask = slots_.size() - 1;
+    size_t slot = hash & mask;
+    while (slots_[slot].entry != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    if (slots_[slot].tombstone) {
+        tombstones_--;
+    }
+    slots_[slot].entry = flow;
+    slots_[slot].hash = hash;
+    slots_[slot].tombstone = false;
+    size_++;
+    return slot;
+}
+
+// Grow the table when more than half of it is in use by flows, otherwise
+// rehash in place to drop the tombstones.
+void FlowEntryHashTable::Rehash() {
+    size_t count = slots_.size();
+    if ((size_ + 1) * 2 > count) {
+        count *= 2;
+    }
+    std::vector<Slot> old_slots(count);
+    old_slots.swap(slots_);
+    size_ = 0;
+    tombstones_ = 0;
+    for (std::vector<Slot>::const_iterator it = old_slots.begin();
+         it != old_slots.end(); ++it) {
+        if (it->entry != NULL) {
+            Insert(it->entry, it->hash);
+        }
+    }
+}
+
+FlowEntryHashTable::iterator
+FlowEntryHashTable::find(const FlowKey &key) const {
+    return iterator(this, Lookup(key, key.Hash()));
+}
+
+// A key with no family starts the walk from the beginning of the table. The
+// key is looked up only when the saved slot no longer holds it, the walk then
+// resumes after the slot of the key if it moved with a rehash, or after the
+// saved slot if it is gone.
+FlowEntryHashTable::iterator
+FlowEntryHashTable::FindNext(const FlowKey &key, size_t slot) const {
+    if (key.family == Address::UNSPEC) {
+        return begin();
+    }
+    if (slot >= slots_.size() || slots_[slot].entry == NULL ||
+        !slots_[slot].entry->key().IsEqual(key)) {
+        size_t found = Lookup(key, key.Hash());
+        if (found != slots_.size()) {
+            slot = found;
+        } else if (slot >= slots_.size()) {
+            return end();
+        }
+    }
+    return iterator(this, NextSlot(slot + 1));
+}
+
+std::pair<FlowEntryHashTable::iterator, bool>
+FlowEntryHashTable::insert(FlowEntry *flow) {
+    uint32_t hash = flow->key().Hash();
+    size_t slot = Lookup(flow->key(), hash);
+    if (slot != slots_.size()) {
+        return std::make_pair(iterator(this, slot), false);
+    }
+    // Keep the load factor, flows and tombstones, under 3/4
+    if ((size_ + tombstones_ + 1) * 4 > slots_.size() * 3) {
+        Rehash();
+    }
+    slot = Insert(flow, hash);
+    return std::make_pair(iterator(this, slot), true);
+}
+
+void FlowEntryHashTable::erase(iterator it) {
+    Slot &slot = slots_[it.slot_];
+    assert(slot.entry != NULL);
+    slot.entry = NULL;
+    slot.tombstone = true;
+    size_--;
+    tombstones_++;
+}
+
+FlowEntrySlab::FlowEntrySlab(size_t block_size) :
+    block_size_(block_size), free_list_(NULL), free_count_(0) {
+    // Keep the blocks aligned for any type
+    const size_t align = 2 * sizeof(void *);
+    if (block_size_ < sizeof(FreeBlock)) {
+        block_size_ = sizeof(FreeBlock);
+    }
+    block_size_ = (block_size_ + align - 1) & ~(align - 1);
+}
+
+// Flows still in use at exit hold on to their chunks.
+FlowEntrySlab::~FlowEntrySlab() {
+    if (free_count_ != chunks_.size() * kBlocksPerChunk) {
+        return;
+    }
+    for (std::vector<char *>::iterator it = chunks_.begin();
+         it != chunks_.end(); ++it) {
+        delete [] *it;
+    }
+}
+
+void *FlowEntrySlab::Allocate() {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    if (free_list_ == NULL) {
+        char *chunk = new char[block_size_ * kBlocksPerChunk];
+        chunks_.push_back(chunk);
+        for (size_t i = kBlocksPerChunk; i > 0; i--) {
+            FreeBlock *block =
+                reinterpret_cast<FreeBlock *>(chunk + (i - 1) * block_size_);
+            block->next = free_list_;
+            free_list_ = block;
+        }
+        free_count_ += kBlocksPerChunk;
+    }
+    FreeBlock *block = free_list_;
+    free_list_ = block->next;
+    free_count_--;
+    return block;
+}
+
+void FlowEntrySlab::Free(void *ptr) {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+    block->next = free_list_;
+    free_list_ = block;
+    free_count_++;
+}
+
+size_t FlowEntrySlab::memory_size() const {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    return chunks_.size() * kBlocksPerChunk * block_size_;
+}
+
+size_t FlowEntrySlab::free_count() const {
+    tbb::spin_mutex::scoped_lock lock(mutex_);
+    return free_count_;
+}
+
 static bool ShouldDrop(uint32_t action) {
     if ((action & TrafficAction::DROP_FLAGS) || (action & TrafficAction::IMPLICIT_DENY_FLAGS))
         return true;
@@ -107,6 +304,25 @@ FlowEntry::FlowEntry(const FlowKey &k) :
     alloc_count_.fetch_and_increment();
 }
 
+// Classes derived from FlowEntry do not fit in the slab blocks
+void *FlowEntry::operator new(size_t size) {
+    if (size != sizeof(FlowEntry)) {
+        return ::operator new(size);
+    }
+    return slab_.Allocate();
+}
+
+void FlowEntry::operator delete(void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    if (size != sizeof(FlowEntry)) {
+        ::operator delete(ptr);
+        return;
+    }
+    slab_.Free(ptr);
+}
+
 void FlowEntry::GetSourceRouteInfo(const AgentRoute *rt) {
     const AgentPath *path = NULL;
     if (rt) {
@@ -1559,10 +1775,10 @@ void FlowEntry::InitAuditFlow(uint32_t flow_idx) {
 FlowEntry *FlowTable::Allocate(const FlowKey &key) {
     FlowEntry *flow = new FlowEntry(key);
     std::pair<FlowEntryMap::iterator, bool> ret;
-    ret = flow_entry_map_.insert(std::pair<FlowKey, FlowEntry*>(key, flow));
+    ret = flow_entry_map_.insert(flow);
     if (ret.second == false) {
         delete flow;
-        flow = ret.first->second;
+        flow = *ret.first;
         flow->set_deleted(false);
         DeleteFlowInfo(flow);
     } else {
@@ -1579,21 +1795,32 @@ FlowEntry *FlowTable::Find(const FlowKey &key) {
 
     it = flow_entry_map_.find(key);
     if (it != flow_entry_map_.end()) {
-        return it->second;
+        return *it;
     } else {
         return NULL;
     }
 }
 
+size_t FlowTable::memory_size() const {
+    return FlowEntry::slab().memory_size() + flow_entry_map_.memory_size();
+}
+
+size_t FlowTable::memory_per_flow() const {
+    size_t count = flow_entry_map_.size();
+    if (count == 0) {
+        return 0;
+    }
+    return memory_size() / count;
+}
+
 RouteFlowInfo *FlowTable::RouteFlowInfoFind(RouteFlowKey &key) {
     RouteFlowInfo rt_key(key);
     return route_flow_tree_.Find(&rt_key);
 }
 
-void FlowTable::DeleteInternal(FlowEntryMap::iterator &it, uint64_t time)
+void FlowTable::DeleteInternal(FlowEntry *fe, uint64_t time)
 {
     FlowInfo flow_info;
-    FlowEntry *fe = it->second;
     if (fe->deleted()) {
         /* Already deleted return from here. */
         return;
@@ -1632,15 +1859,26 @@ void FlowTable::DeleteInternal(FlowEntryMap::iterator &it, uint64_t time)
 bool FlowTable::Delete(const FlowKey &key, bool del_reverse_flow)
 {
     FlowEntryMap::iterator it;
-    FlowEntry *fe;
-    uint64_t time = 0;
 
     it = flow_entry_map_.find(key);
     if (it == flow_entry_map_.end()) {
         return false;
     }
-    fe = it->second;
+    return DeleteFlowPair(*it, del_reverse_flow, UTCTimestampUsec());
+}
+
+void FlowTable::DeleteBatch(const FlowEntryPtrList &list)
+{
+    uint64_t time = UTCTimestampUsec();
+    for (FlowEntryPtrList::const_iterator it = list.begin();
+         it != list.end(); ++it) {
+        DeleteFlowPair(it->get(), true, time);
+    }
+}
 
+bool FlowTable::DeleteFlowPair(FlowEntry *fe, bool del_reverse_flow,
+                               uint64_t time)
+{
     FlowEntry *reverse_flow = NULL;
     if (del_reverse_flow) {
         reverse_flow = fe->reverse_flow_entry();
@@ -1651,19 +1889,19 @@ bool FlowTable::Delete(const FlowKey &key, bool del_reverse_flow)
      * reverse flow during FlowExport. This relationship will be broken if
      * either of forward or reverse flow is deleted */
     if (!fe->deleted() || (reverse_flow && !reverse_flow->deleted())) {
-        time = UTCTimestampUsec();
         SendFlows(fe, reverse_flow, time);
     }
-    /* Delete the forward flow */
-    DeleteInternal(it, time);
+    /* Delete the forward flow. Hold a reference to the reverse flow, it may
+     * be released when the forward flow drops it */
+    FlowEntryPtr reverse_ptr(reverse_flow);
+    DeleteInternal(fe, time);
 
     if (!reverse_flow) {
         return true;
     }
 
-    it = flow_entry_map_.find(reverse_flow->key());
-    if (it != flow_entry_map_.end()) {
-        DeleteInternal(it, time);
+    if (flow_entry_map_.find(reverse_flow->key()) != flow_entry_map_.end()) {
+        DeleteInternal(reverse_flow, time);
         return true;
     }
     return false;
@@ -1692,20 +1930,17 @@ void FlowTable::SendFlows(FlowEntry *flow, FlowEntry *rflow, uint64_t time)
     }
 }
 
+// Take a reference to all the flows first, the walk must not run into
+// the entries released by the delete.
 void FlowTable::DeleteAll()
 {
-    FlowEntryMap::iterator it;
-
-    it = flow_entry_map_.begin();
-    while (it != flow_entry_map_.end()) {
-        FlowEntry *entry = it->second;
-        ++it;
-        if (it != flow_entry_map_.end() &&
-            it->second == entry->reverse_flow_entry()) {
-            ++it;
-        }
-        Delete(entry->key(), true);
+    FlowEntryPtrList list;
+    list.reserve(flow_entry_map_.size());
+    for (FlowEntryMap::iterator it = flow_entry_map_.begin();
+         it != flow_entry_map_.end(); ++it) {
+        list.push_back(*it);
     }
+    DeleteBatch(list);
 }
 
 void FlowTable::DeleteAclFlows(const AclDBEntry *acl)
@@ -2171,8 +2406,6 @@ bool InetRouteFlowUpdate::SgUpdate(FlowEntry *fe, FlowTable *table,
         return true;
     }
 
-    fe->GetPolicyInfo();
-
     // Update SG-ID List
     if (key.FlowSrcMatch(fe)) {
         fe->set_source_sg_id_l(sg_list);
@@ -2198,10 +2431,10 @@ bool InetRouteFlowUpdate::SgUpdate(FlowEntry *fe, FlowTable *table,
     if (fe->is_flags_set(FlowEntry::ReverseFlow)) {
         FlowEntry *fwd_flow = fe->reverse_flow_entry();
         if (fwd_flow) {
-            table->ResyncAFlow(fwd_flow);
-            table->AddFlowInfo(fwd_flow);
+            table->RevaluateFlow(fwd_flow, FlowTable::REVALUATE_SG);
         }
     }
+    table->RevaluateFlow(fe, FlowTable::REVALUATE_SG);
 
     return true;
 }
@@ -2286,8 +2519,6 @@ bool BridgeEntryFlowUpdate::SgUpdate(FlowEntry *fe, FlowTable *table,
     if (fe->l3_flow() == true) {
         return true;
     }
-    fe->GetPolicyInfo();
-
     // Update SG-ID List
     if (key.FlowSrcMatch(fe)) {
         fe->set_source_sg_id_l(sg_list);
@@ -2313,10 +2544,10 @@ bool BridgeEntryFlowUpdate::SgUpdate(FlowEntry *fe, FlowTable *table,
     if (fe->is_flags_set(FlowEntry::ReverseFlow)) {
         FlowEntry *fwd_flow = fe->reverse_flow_entry();
         if (fwd_flow) {
-            table->ResyncAFlow(fwd_flow);
-            table->AddFlowInfo(fwd_flow);
+            table->RevaluateFlow(fwd_flow, FlowTable::REVALUATE_SG);
         }
     }
+    table->RevaluateFlow(fe, FlowTable::REVALUATE_SG);
 
     return true;
 }
@@ -2446,28 +2677,10 @@ void FlowTable::ResyncVnFlows(const VnEntry *vn) {
         return;
     }
 
-    FlowEntryTree fet = vn_it->second->fet;
-    FlowEntryTree::iterator fet_it, it;
-    it = fet.begin();
-    while (it != fet.end()) {
-        fet_it = it++;
-        FlowEntry *fe = (*fet_it).get();
-        DeleteFlowInfo(fe);
-        //Mark the flow as short if flood unknown
-        //unicast flag is reset
-        if (vn->flood_unknown_unicast() == false &&
-            fe->is_flags_set(FlowEntry::UnknownUnicastFlood)) {
-            fe->MakeShortFlow(FlowEntry::SHORT_NO_DST_ROUTE);
-            fe->GetPolicyInfo(vn);
-            ResyncAFlow(fe);
-            continue;
-        }
-        fe->GetPolicyInfo(vn);
-        ResyncAFlow(fe);
-        AddFlowInfo(fe);
-        FlowInfo flow_info;
-        fe->FillFlowInfo(flow_info);
-        FLOW_TRACE(Trace, "Evaluate Vn Flows", flow_info);
+    FlowEntryTree::iterator it;
+    for (it = vn_it->second->fet.begin(); it != vn_it->second->fet.end();
+         ++it) {
+        RevaluateFlow((*it).get(), REVALUATE_VN);
     }
 }
 
@@ -2479,19 +2692,10 @@ void FlowTable::ResyncAclFlows(const AclDBEntry *acl)
         return;
     }
 
-    FlowEntryTree fet = acl_it->second->fet;
-    FlowEntryTree::iterator fet_it, it;
-    it = fet.begin();
-    while (it != fet.end()) {
-        fet_it = it++;
-        FlowEntry *fe = (*fet_it).get();
-        DeleteFlowInfo(fe);
-        fe->GetPolicyInfo();
-        ResyncAFlow(fe);
-        AddFlowInfo(fe);
-        FlowInfo flow_info;
-        fe->FillFlowInfo(flow_info);
-        FLOW_TRACE(Trace, "Evaluate Acl Flows", flow_info);
+    FlowEntryTree::iterator it;
+    for (it = acl_it->second->fet.begin(); it != acl_it->second->fet.end();
+         ++it) {
+        RevaluateFlow((*it).get(), REVALUATE_ACL);
     }
 }
 
@@ -2540,10 +2744,7 @@ void FlowTable::FlowRecompute(RouteFlowInfo *rt_info) {
         if (fe->l3_flow() == false) {
             continue;
         }
-        if (fe->set_pending_recompute(true)) {
-            agent_->pkt()->pkt_handler()->SendMessage(PktHandler::FLOW,
-                    new FlowTaskMsg(fe));
-        }
+        RevaluateFlow(fe, REVALUATE_ROUTE);
     }
 }
 
@@ -2566,10 +2767,7 @@ void FlowTable::FlowL2Recompute(RouteFlowInfo *rt_info) {
             /* for reverse flow trigger a re-eval on its forward flow */
             fe = fe->reverse_flow_entry();
         }
-        if (fe->set_pending_recompute(true)) {
-            agent_->pkt()->pkt_handler()->SendMessage(PktHandler::FLOW,
-                    new FlowTaskMsg(fe));
-        }
+        RevaluateFlow(fe, REVALUATE_ROUTE);
     }
 }
 
@@ -2595,7 +2793,6 @@ void FlowTable::IterateFlowInfoEntries(const RouteFlowKey &key, FlowEntryCb cb)
         if (cb(fe) == false) {
             fet.erase(fet_it);
         } else {
-            ResyncAFlow(fe);
             AddFlowInfo(fe);
         }
     }
@@ -2608,34 +2805,119 @@ void FlowTable::ResyncVmPortFlows(const VmInterface *intf) {
         return;
     }
 
-    FlowEntryTree fet = intf_it->second->fet;
-    FlowEntryTree::iterator fet_it, it;
-    it = fet.begin();
-    while (it != fet.end()) {
-        fet_it = it++;
-        FlowEntry *fe = (*fet_it).get();
+    FlowEntryTree::iterator it;
+    for (it = intf_it->second->fet.begin(); it != intf_it->second->fet.end();
+         ++it) {
+        FlowEntry *fe = (*it).get();
         // Local flow needs to evaluate fwd flow then reverse flow
         if (fe->is_flags_set(FlowEntry::LocalFlow) && 
             fe->is_flags_set(FlowEntry::ReverseFlow)) {
             FlowEntry *fwd_flow = fe->reverse_flow_entry();
             if (fwd_flow) {
-                DeleteFlowInfo(fwd_flow);
-                fwd_flow->GetPolicyInfo();
-                ResyncAFlow(fwd_flow);
-                AddFlowInfo(fwd_flow);
-                FlowInfo flow_info;
-                fwd_flow->FillFlowInfo(flow_info);
-                FLOW_TRACE(Trace, "Evaluate VmPort Flows", flow_info);
+                RevaluateFlow(fwd_flow, REVALUATE_INTERFACE);
             }
         }
-        DeleteFlowInfo(fe);
-        fe->GetPolicyInfo(intf->vn());
+        RevaluateFlow(fe, REVALUATE_INTERFACE);
+    }
+}
+
+const char *FlowTable::RevaluateCauseToString(RevaluateCause cause) {
+    switch (cause) {
+    case REVALUATE_ACL:
+        return "acl";
+    case REVALUATE_VN:
+        return "vn";
+    case REVALUATE_INTERFACE:
+        return "interface";
+    case REVALUATE_SG:
+        return "sg";
+    case REVALUATE_ROUTE:
+        return "route";
+    default:
+        break;
+    }
+    return "unknown";
+}
+
+// Queue the flow to be revaluated for the cause. A flow already queued is
+// not queued again, the causes are merged and the flow is revaluated once.
+//
+// Runs in the db::DBTable task, which excludes the Agent::FlowHandler task
+// draining the list
+void FlowTable::RevaluateFlow(FlowEntry *fe, RevaluateCause cause) {
+    revaluate_enqueue_count_[cause]++;
+    uint8_t pending = fe->data_.pending_revaluate;
+    fe->data_.pending_revaluate |= (1 << cause);
+    if (pending == 0) {
+        revaluate_list_.push_back(fe);
+        revaluate_trigger_->Set();
+    }
+}
+
+// Revaluate at most revaluate_batch_size_ flows and yield, so that the flow
+// setup requests queued meanwhile are not held behind a large change
+bool FlowTable::RevaluateRun() {
+    // Flow references must be released with the lock held
+    tbb::mutex::scoped_lock lock(mutex_);
+    revaluate_batch_count_++;
+    uint32_t count = 0;
+    while (count < revaluate_batch_size_ && !revaluate_list_.empty()) {
+        FlowEntryPtr fe = revaluate_list_.front();
+        revaluate_list_.pop_front();
+        uint8_t causes = fe->data_.pending_revaluate;
+        fe->data_.pending_revaluate = 0;
+        if (causes == 0 || fe->deleted()) {
+            continue;
+        }
+        RevaluateAFlow(fe.get(), causes);
+        count++;
+    }
+    return revaluate_list_.empty();
+}
+
+void FlowTable::RevaluateAFlow(FlowEntry *fe, uint8_t causes) {
+    for (int i = 0; i < REVALUATE_MAX; i++) {
+        if (causes & (1 << i)) {
+            revaluate_count_[i]++;
+        }
+    }
+
+    // Route changes recompute the flow from the packet path, which
+    // evaluates the policy as well
+    if (causes & (1 << REVALUATE_ROUTE)) {
+        if (fe->is_flags_set(FlowEntry::ShortFlow) == false &&
+            fe->set_pending_recompute(true)) {
+            agent_->pkt()->pkt_handler()->SendMessage(PktHandler::FLOW,
+                    new FlowTaskMsg(fe));
+        }
+        return;
+    }
+
+    const VnEntry *vn = fe->vn_entry();
+    if (causes & (1 << REVALUATE_INTERFACE)) {
+        const Interface *intf = fe->intf_entry();
+        if (intf && intf->type() == Interface::VM_INTERFACE) {
+            vn = static_cast<const VmInterface *>(intf)->vn();
+        }
+    }
+
+    DeleteFlowInfo(fe);
+    //Mark the flow as short if flood unknown
+    //unicast flag is reset
+    if ((causes & (1 << REVALUATE_VN)) && vn &&
+        vn->flood_unknown_unicast() == false &&
+        fe->is_flags_set(FlowEntry::UnknownUnicastFlood)) {
+        fe->MakeShortFlow(FlowEntry::SHORT_NO_DST_ROUTE);
+        fe->GetPolicyInfo(vn);
         ResyncAFlow(fe);
-        AddFlowInfo(fe);
-        FlowInfo flow_info;
-        fe->FillFlowInfo(flow_info);
-        FLOW_TRACE(Trace, "Evaluate VmPort Flows", flow_info);
+        return;
     }
+    fe->GetPolicyInfo(vn);
+    ResyncAFlow(fe);
+    AddFlowInfo(fe);
+    FlowInfo flow_info;
+    fe->FillFlowInfo(flow_info);
+    FLOW_TRACE(Trace, "Revaluate Flow", flow_info);
 }
 
 
@@ -3242,16 +3524,11 @@ AgentRoute *FlowTable::GetL2Route(const VrfEntry *vrf,
     return table->FindRoute(mac);
 }
 
+// Called from flow classification, which runs in parallel in all the
+// Agent::FlowHandler instances. The lookup key is built on the stack.
 AgentRoute *FlowTable::GetUcRoute(const VrfEntry *entry,
                                   const IpAddress &addr) {
-    AgentRoute *rt = NULL;
-    if (addr.is_v4()) {
-        inet4_route_key_.set_addr(addr.to_v4());
-        rt = entry->GetUcRoute(inet4_route_key_);
-    } else {
-        inet6_route_key_.set_addr(addr.to_v6());
-        rt = entry->GetUcRoute(inet6_route_key_);
-    }
+    AgentRoute *rt = entry->GetUcRoute(addr);
     if (rt != NULL && rt->IsRPFInvalid()) {
         return NULL;
     }
@@ -3475,11 +3752,19 @@ FlowTable::FlowTable(Agent *agent) :
     linklocal_flow_count_(), acl_listener_id_(),
     intf_listener_id_(), vn_listener_id_(), vm_listener_id_(),
     vrf_listener_id_(), nh_listener_(NULL),
-    inet4_route_key_(NULL, Ip4Address(), 32, false),
-    inet6_route_key_(NULL, Ip6Address(), 128, false) {
+    revaluate_batch_size_(kRevaluateBatchSize), revaluate_batch_count_(0) {
     max_vm_flows_ = (uint32_t)
         (agent->ksync()->flowtable_ksync_obj()->flow_table_entries_count() *
          agent->params()->max_vm_flows()) / 100;
+    for (int i = 0; i < REVALUATE_MAX; i++) {
+        revaluate_enqueue_count_[i] = 0;
+        revaluate_count_[i] = 0;
+    }
+    int task_id =
+        TaskScheduler::GetInstance()->GetTaskId("Agent::FlowHandler");
+    revaluate_trigger_.reset
+        (new TaskTrigger(boost::bind(&FlowTable::RevaluateRun, this),
+                         task_id, 0));
 }
 
 FlowTable::~FlowTable() {
@@ -3492,6 +3777,8 @@ void FlowTable::Shutdown() {
     agent_->vm_table()->Unregister(vm_listener_id_);
     agent_->vrf_table()->Unregister(vrf_listener_id_);
     delete nh_listener_;
+    revaluate_list_.clear();
+    revaluate_trigger_->Reset();
 }
 
 bool FlowTable::SetUnderlayPort(FlowEntry *flow, FlowDataIpv4 &s_flow) {
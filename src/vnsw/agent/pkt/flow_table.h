@@ -5,7 +5,9 @@
 #ifndef __AGENT_FLOW_TABLE_H__
 #define __AGENT_FLOW_TABLE_H__
 
+#include <deque>
 #include <map>
+#include <vector>
 #if defined(__GNUC__)
 #include "base/compiler.h"
 #if __GNUC_PREREQ(4, 5)
@@ -22,6 +24,7 @@
 #include <boost/intrusive_ptr.hpp>
 #include <tbb/atomic.h>
 #include <tbb/mutex.h>
+#include <tbb/spin_mutex.h>
 #include <base/util.h>
 #include <net/address.h>
 #include <db/db_table_walker.h>
@@ -115,6 +118,15 @@ struct FlowKey {
         return dst_port < key.dst_port;
     }
 
+    bool IsEqual(const FlowKey &key) const {
+        return (family == key.family && nh == key.nh &&
+                src_port == key.src_port && dst_port == key.dst_port &&
+                protocol == key.protocol && src_addr == key.src_addr &&
+                dst_addr == key.dst_addr);
+    }
+
+    uint32_t Hash() const;
+
     void Reset() {
         family = Address::UNSPEC;
         nh = -1;
@@ -141,6 +153,121 @@ struct Inet4FlowKeyCmp {
     }
 };
 
+////////////////////////////////////////////////////////////////////////////
+// Open addressing hash table of flows, keyed by FlowKey.
+//
+// A slot holds the flow and the hash of its key, the key itself is the one
+// in the FlowEntry. Collisions are resolved with linear probing. Erase leaves
+// a tombstone in the slot instead of moving the entries that follow, so that
+// iterators stay valid across erase. Tombstones are reclaimed when the table
+// is rehashed, which only happens on insert.
+//
+// The table is not ordered. FindNext() resumes a walk from the key and the
+// slot of the last entry visited: from the slot after the key or, when the
+// key is gone, from the slot after the saved one. A rehash between two calls
+// changes the order of the walk.
+////////////////////////////////////////////////////////////////////////////
+class FlowEntryHashTable {
+public:
+    static const size_t kInitialSize = 1024;    // must be a power of 2
+
+    class iterator {
+    public:
+        iterator() : table_(NULL), slot_(0) { }
+        FlowEntry *operator*() const { return table_->slots_[slot_].entry; }
+        iterator &operator++() {
+            slot_ = table_->NextSlot(slot_ + 1);
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+        bool operator==(const iterator &rhs) const {
+            return slot_ == rhs.slot_;
+        }
+        bool operator!=(const iterator &rhs) const {
+            return slot_ != rhs.slot_;
+        }
+        size_t slot() const { return slot_; }
+
+    private:
+        friend class FlowEntryHashTable;
+        iterator(const FlowEntryHashTable *table, size_t slot) :
+            table_(table), slot_(slot) { }
+
+        const FlowEntryHashTable *table_;
+        size_t slot_;
+    };
+
+    FlowEntryHashTable();
+    ~FlowEntryHashTable();
+
+    iterator begin() const { return iterator(this, NextSlot(0)); }
+    iterator end() const { return iterator(this, slots_.size()); }
+    iterator find(const FlowKey &key) const;
+    iterator FindNext(const FlowKey &key, size_t slot) const;
+    std::pair<iterator, bool> insert(FlowEntry *flow);
+    void erase(iterator it);
+
+    size_t size() const { return size_; }
+    size_t bucket_count() const { return slots_.size(); }
+    size_t memory_size() const { return slots_.size() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        Slot() : entry(NULL), hash(0), tombstone(false) { }
+        FlowEntry *entry;
+        uint32_t hash;
+        bool tombstone;
+    };
+
+    size_t NextSlot(size_t slot) const;
+    size_t Lookup(const FlowKey &key, uint32_t hash) const;
+    size_t Insert(FlowEntry *flow, uint32_t hash);
+    void Rehash();
+
+    std::vector<Slot> slots_;
+    size_t size_;
+    size_t tombstones_;
+    DISALLOW_COPY_AND_ASSIGN(FlowEntryHashTable);
+};
+
+////////////////////////////////////////////////////////////////////////////
+// Free list allocator for FlowEntry objects. Blocks are carved out of chunks
+// of kBlocksPerChunk blocks and freed blocks are kept in the free list for
+// the next allocation. Chunks are given back only when the slab is destroyed
+// with no block in use.
+////////////////////////////////////////////////////////////////////////////
+class FlowEntrySlab {
+public:
+    static const size_t kBlocksPerChunk = 1024;
+
+    explicit FlowEntrySlab(size_t block_size);
+    ~FlowEntrySlab();
+
+    void *Allocate();
+    void Free(void *block);
+
+    size_t block_size() const { return block_size_; }
+    // Memory taken from the system, including the blocks in the free list
+    size_t memory_size() const;
+    size_t free_count() const;
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    mutable tbb::spin_mutex mutex_;
+    size_t block_size_;
+    std::vector<char *> chunks_;
+    FreeBlock *free_list_;
+    size_t free_count_;
+    DISALLOW_COPY_AND_ASSIGN(FlowEntrySlab);
+};
+
 struct FlowStats {
     FlowStats() : setup_time(0), teardown_time(0), last_modified_time(0),
         bytes(0), packets(0), intf_in(0), exported(false), fip(0),
@@ -220,7 +347,8 @@ struct FlowData {
         mirror_vrf(VrfEntry::kInvalidIndex), dest_vrf(),
         component_nh_idx((uint32_t)CompositeNH::kInvalidComponentNHIdx),
         nh_state_(NULL), source_plen(0), dest_plen(0), drop_reason(0),
-        vrf_assign_evaluated(false), pending_recompute(false), enable_rpf(true),
+        vrf_assign_evaluated(false), pending_recompute(false),
+        pending_revaluate(0), enable_rpf(true),
         l2_rpf_plen(Address::kMaxV4PrefixLen) {}
 
     MacAddress smac;
@@ -251,6 +379,8 @@ struct FlowData {
     uint16_t drop_reason;
     bool vrf_assign_evaluated;
     bool pending_recompute;
+    // Bitmap of FlowTable::RevaluateCause the flow is queued for
+    uint8_t pending_revaluate;
     uint32_t            if_index_info;
     TunnelInfo          tunnel_info;
     // map for references to the routes which were ignored due to more specific
@@ -337,6 +467,11 @@ class FlowEntry {
         alloc_count_.fetch_and_decrement();
     };
 
+    // FlowEntry objects are allocated from slab_
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+    static const FlowEntrySlab &slab() { return slab_; }
+
     bool ActionRecompute();
     void UpdateKSync(FlowTable* table);
     int GetRefCount() { return refcount_; }
@@ -456,6 +591,7 @@ private:
     FlowEntryPtr reverse_flow_entry_;
     FlowTableKSyncEntry *ksync_entry_;
     static tbb::atomic<int> alloc_count_;
+    static FlowEntrySlab slab_;
     bool deleted_;
     uint32_t flags_;
     uint16_t short_flow_reason_;
@@ -576,7 +712,10 @@ struct RouteFlowInfo {
 class FlowTable {
 public:
     static const int MaxResponses = 100;
-    typedef std::map<FlowKey, FlowEntry *, Inet4FlowKeyCmp> FlowEntryMap;
+    // Number of flows revaluated in one run of the revaluation task
+    static const uint32_t kRevaluateBatchSize = 64;
+    typedef FlowEntryHashTable FlowEntryMap;
+    typedef std::vector<FlowEntryPtr> FlowEntryPtrList;
 
     typedef std::map<int, int> AceIdFlowCntMap;
     typedef std::map<const AclDBEntry *, AclFlowInfo *> AclFlowTree;
@@ -595,6 +734,16 @@ public:
     typedef Patricia::Tree<RouteFlowInfo, &RouteFlowInfo::node, RouteFlowInfo::KeyCmp> RouteFlowTree;
     typedef boost::function<bool(FlowEntry *flow)> FlowEntryCb;
 
+    // Changes that make the flows depending on an object to be revaluated
+    enum RevaluateCause {
+        REVALUATE_ACL,          // ACL entries changed
+        REVALUATE_VN,           // VN policy, RPF or flood setting changed
+        REVALUATE_INTERFACE,    // VM interface VN, policy or SG changed
+        REVALUATE_SG,           // SG list of a route changed
+        REVALUATE_ROUTE,        // Route added or deleted, recompute the flow
+        REVALUATE_MAX
+    };
+
     struct VnFlowHandlerState : public DBState {
         AclDBEntryConstRef acl_;
         AclDBEntryConstRef macl_;
@@ -650,8 +799,13 @@ public:
     void Add(FlowEntry *flow, FlowEntry *rflow);
     FlowEntry *Find(const FlowKey &key);
     bool Delete(const FlowKey &key, bool del_reverse_flow);
+    // Delete the flows, and their reverse flows, with one timestamp
+    void DeleteBatch(const FlowEntryPtrList &list);
 
     size_t Size() { return flow_entry_map_.size(); }
+    // Memory used by the flow entries and the hash table, in bytes
+    size_t memory_size() const;
+    size_t memory_per_flow() const;
     void VnFlowCounters(const VnEntry *vn, uint32_t *in_count, 
                         uint32_t *out_count);
     uint32_t VmFlowCount(const VmEntry *vm);
@@ -660,6 +814,23 @@ public:
     void set_max_vm_flows(uint32_t num_flows) { max_vm_flows_ = num_flows; }
     uint32_t linklocal_flow_count() const { return linklocal_flow_count_; }
     Agent *agent() const { return agent_; }
+    // Serializes the flow setup done in the Agent::FlowHandler instances
+    tbb::mutex &mutex() { return mutex_; }
+
+    static const char *RevaluateCauseToString(RevaluateCause cause);
+    // Flows queued for the cause, including the ones already queued
+    uint64_t revaluate_enqueue_count(RevaluateCause cause) const {
+        return revaluate_enqueue_count_[cause];
+    }
+    // Flows revaluated for the cause
+    uint64_t revaluate_count(RevaluateCause cause) const {
+        return revaluate_count_[cause];
+    }
+    uint64_t revaluate_batch_count() const { return revaluate_batch_count_; }
+    size_t revaluate_pending() const { return revaluate_list_.size(); }
+    void set_revaluate_batch_size(uint32_t size) {
+        revaluate_batch_size_ = size;
+    }
 
     // Test code only used method
     RouteFlowInfo *RouteFlowInfoFind(RouteFlowKey &key);
@@ -709,6 +880,7 @@ private:
     static SecurityGroupList default_sg_list_;
 
     Agent *agent_;
+    tbb::mutex mutex_;
     FlowEntryMap flow_entry_map_;
 
     AclFlowTree acl_flow_tree_;
@@ -727,8 +899,14 @@ private:
     DBTableBase::ListenerId vrf_listener_id_;
     NhListener *nh_listener_;
 
-    InetUnicastRouteEntry inet4_route_key_;
-    InetUnicastRouteEntry inet6_route_key_;
+    // Flows waiting to be revaluated, processed in batches in the
+    // Agent::FlowHandler task
+    std::auto_ptr<TaskTrigger> revaluate_trigger_;
+    std::deque<FlowEntryPtr> revaluate_list_;
+    uint32_t revaluate_batch_size_;
+    uint64_t revaluate_enqueue_count_[REVALUATE_MAX];
+    uint64_t revaluate_count_[REVALUATE_MAX];
+    uint64_t revaluate_batch_count_;
 
     void AclNotify(DBTablePartBase *part, DBEntryBase *e);
     void IntfNotify(DBTablePartBase *part, DBEntryBase *e);
@@ -743,6 +921,9 @@ private:
     void ResyncAFlow(FlowEntry *fe);
     void ResyncVmPortFlows(const VmInterface *intf);
     void ResyncRpfNH(const RouteFlowKey &key, const AgentRoute *rt);
+    void RevaluateFlow(FlowEntry *fe, RevaluateCause cause);
+    bool RevaluateRun();
+    void RevaluateAFlow(FlowEntry *fe, uint8_t causes);
 
     void DeleteFlowInfo(FlowEntry *fe);
     void DeleteVnFlowInfo(FlowEntry *fe);
@@ -772,7 +953,8 @@ private:
     void AddRouteFlowInfo(FlowEntry *fe);
 
     void DeleteAclFlows(const AclDBEntry *acl);
-    void DeleteInternal(FlowEntryMap::iterator &it, uint64_t time);
+    void DeleteInternal(FlowEntry *fe, uint64_t time);
+    bool DeleteFlowPair(FlowEntry *fe, bool del_reverse_flow, uint64_t time);
     void SendFlows(FlowEntry *flow, FlowEntry *rflow, uint64_t time);
     void SendFlowInternal(FlowEntry *fe, uint64_t time);
 
@@ -791,7 +973,8 @@ inline void intrusive_ptr_release(FlowEntry *fe) {
     int prev = fe->refcount_.fetch_and_decrement();
     if (prev == 1) {
         FlowTable *table = Agent::GetInstance()->pkt()->flow_table();
-        FlowTable::FlowEntryMap::iterator it = table->flow_entry_map_.find(fe->key());
+        FlowTable::FlowEntryMap::iterator it =
+            table->flow_entry_map_.find(fe->key());
         assert(it != table->flow_entry_map_.end());
         table->flow_entry_map_.erase(it);
         delete fe;
@@ -220,7 +220,8 @@ PktSandeshFlow::PktSandeshFlow(FlowRecordsResp *obj, std::string resp_ctx,
                                std::string key) :
     Task((TaskScheduler::GetInstance()->GetTaskId("Agent::PktFlowResponder")),
           0), resp_obj_(obj), resp_data_(resp_ctx), 
-    flow_iteration_key_(), key_valid_(false), delete_op_(false) {
+    flow_iteration_key_(), flow_iteration_slot_(0), key_valid_(false),
+    delete_op_(false) {
     if (key != Agent::GetInstance()->NullString()) {
         if (SetFlowKey(key)) {
             key_valid_ = true;
@@ -244,21 +245,29 @@ void PktSandeshFlow::SendResponse(SandeshResponse *resp) {
     resp->Response();
 }
 
-string PktSandeshFlow::GetFlowKey(const FlowKey &key) {
+// The slot of the flow in the flow table is saved with its key, the next
+// walk resumes from it.
+string PktSandeshFlow::GetFlowKey(const FlowKey &key, size_t slot) {
     stringstream ss;
     ss << key.nh << kDelimiter;
     ss << key.src_port << kDelimiter;
     ss << key.dst_port << kDelimiter;
     ss << (uint16_t)key.protocol << kDelimiter;
     ss << key.src_addr.to_string() << kDelimiter;
-    ss << key.dst_addr.to_string();
+    ss << key.dst_addr.to_string() << kDelimiter;
+    ss << slot;
     return ss.str();
 }
 
 bool PktSandeshFlow::SetFlowKey(string key) {
+    // The flow table is not ordered, start the walk from its first entry
+    if (key == start_key) {
+        flow_iteration_key_.Reset();
+        return true;
+    }
     const char ch = kDelimiter;
     size_t n = std::count(key.begin(), key.end(), ch);
-    if (n != 5) {
+    if (n != 6) {
         return false;
     }
     stringstream ss(key);
@@ -282,6 +291,9 @@ bool PktSandeshFlow::SetFlowKey(string key) {
     if (getline(ss, item, ch)) {
         dip = item;
     }
+    if (getline(ss, item, ch)) {
+        istringstream(item) >> flow_iteration_slot_;
+    }
 
     error_code ec;
     flow_iteration_key_.src_addr = IpAddress::from_string(sip.c_str(), ec);
@@ -310,20 +322,22 @@ bool PktSandeshFlow::Run() {
     }
 
     if (key_valid_) {
-        it = flow_obj->flow_entry_map_.upper_bound(flow_iteration_key_);
+        it = flow_obj->flow_entry_map_.FindNext(flow_iteration_key_,
+                                                flow_iteration_slot_);
     } else {
         FlowErrorResp *resp = new FlowErrorResp();
         SendResponse(resp);
         return true;
     }
     while (it != flow_obj->flow_entry_map_.end()) {
-        FlowEntry *fe = it->second;
+        FlowEntry *fe = *it;
+        size_t slot = it.slot();
         SetSandeshFlowData(list, fe);
         ++it;
         count++;
         if (count == kMaxFlowResponse) {
             if (it != flow_obj->flow_entry_map_.end()) {
-                resp_obj_->set_flow_key(GetFlowKey(fe->key()));
+                resp_obj_->set_flow_key(GetFlowKey(fe->key(), slot));
                 flow_key_set = true;
             }
             break;
@@ -386,7 +400,7 @@ void FetchFlowRecord::HandleRequest() const {
     SandeshResponse *resp;
     if (it != flow_obj->flow_entry_map_.end()) {
         FlowRecordResp *flow_resp = new FlowRecordResp();
-        FlowEntry *fe = it->second;
+        FlowEntry *fe = *it;
         SandeshFlowData data;
         SET_SANDESH_FLOW_DATA(data, fe);
         flow_resp->set_record(data);
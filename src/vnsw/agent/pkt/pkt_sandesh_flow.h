@@ -20,7 +20,7 @@ public:
 
     void SendResponse(SandeshResponse *resp);
     bool SetFlowKey(std::string key);
-    static std::string GetFlowKey(const FlowKey &key);
+    static std::string GetFlowKey(const FlowKey &key, size_t slot);
     
     virtual bool Run();
     void SetSandeshFlowData(std::vector<SandeshFlowData> &list, FlowEntry *fe);
@@ -30,6 +30,7 @@ protected:
     FlowRecordsResp *resp_obj_;
     std::string resp_data_;
     FlowKey flow_iteration_key_;
+    size_t flow_iteration_slot_;
     bool key_valid_;
     bool delete_op_;
 
@@ -36,6 +36,10 @@ bool Proto::ValidateAndEnqueueMessage(boost::shared_ptr<PktInfo> msg) {
         msg->data = NULL;
     }
 
+    return Enqueue(msg);
+}
+
+bool Proto::Enqueue(boost::shared_ptr<PktInfo> msg) {
     return work_queue_.Enqueue(msg);
 }
 
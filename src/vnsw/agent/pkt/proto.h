@@ -30,6 +30,7 @@ public:
     virtual ProtoHandler *AllocProtoHandler(boost::shared_ptr<PktInfo> info,
                                             boost::asio::io_service &io) = 0;
     virtual bool ValidateAndEnqueueMessage(boost::shared_ptr<PktInfo> msg);
+    virtual bool Enqueue(boost::shared_ptr<PktInfo> msg);
     bool ProcessProto(boost::shared_ptr<PktInfo> msg_info);
 
 protected:
@@ -3,6 +3,7 @@
  */
 
 #include "base/os.h"
+#include "base/time_util.h"
 #include "test/test_cmn_util.h"
 #include "test_pkt_util.h"
 #include "pkt/flow_proto.h"
@@ -75,10 +76,115 @@ TEST_F(FlowTest, FlowScaling_1) {
              (count == flow_count + (int) Agent::GetInstance()->pkt()->flow_table()->Size()));
 }
 
+// The forward and reverse packets of a flow must be processed by the same
+// flow setup instance.
+TEST_F(FlowTest, FlowShardSymmetric) {
+    for (int i = 0; i < 64; i++) {
+        IpAddress sip = Ip4Address(0x01010101);
+        IpAddress dip = Ip4Address(0x05000000 + i);
+        EXPECT_EQ(FlowProto::FlowHash(sip, dip, 6, 1000 + i, 80),
+                  FlowProto::FlowHash(dip, sip, 6, 80, 1000 + i));
+    }
+
+    boost::system::error_code ec;
+    IpAddress sip6 = Ip6Address::from_string("1::1", ec);
+    IpAddress dip6 = Ip6Address::from_string("5::1", ec);
+    EXPECT_EQ(FlowProto::FlowHash(sip6, dip6, 17, 1000, 53),
+              FlowProto::FlowHash(dip6, sip6, 17, 53, 1000));
+    // Same addresses, the ports decide the order
+    EXPECT_EQ(FlowProto::FlowHash(sip6, sip6, 17, 1000, 53),
+              FlowProto::FlowHash(sip6, sip6, 17, 53, 1000));
+}
+
+// Flows are classified in parallel by all the flow setup instances. Each
+// flow must resolve its routes and get its reverse flow.
+TEST_F(FlowTest, FlowSetupMultiThread) {
+    FlowTable *table = Agent::GetInstance()->pkt()->flow_table();
+    FlowProto *proto = Agent::GetInstance()->GetFlowProto();
+    EXPECT_LT(1, proto->flow_thread_count());
+    std::vector<size_t> dequeues;
+    for (uint16_t i = 0; i < proto->flow_thread_count(); i++) {
+        dequeues.push_back(proto->flow_work_queue(i)->NumDequeues());
+    }
+
+    int count = 256;
+    for (int i = 0; i < count; i++) {
+        Ip4Address addr(0x05000000 + i);
+        TxTcpPacket(vnet->id(), vnet_addr, addr.to_string().c_str(),
+                    1000 + i, 80, false);
+    }
+    WAIT_FOR(count * 10, 1000, ((size_t)(count * 2) == table->Size()));
+    client->WaitForIdle();
+
+    int nh_id = GetFlowKeyNH(input[0].intf_id);
+    for (int i = 0; i < count; i++) {
+        Ip4Address addr(0x05000000 + i);
+        FlowEntry *fe = FlowGet(VrfGet("vrf1")->vrf_id(), vnet_addr,
+                                addr.to_string(), 6, 1000 + i, 80, nh_id);
+        EXPECT_TRUE(fe != NULL);
+        if (fe == NULL)
+            continue;
+        EXPECT_EQ("vn1", fe->data().source_vn);
+        EXPECT_EQ("TestVn", fe->data().dest_vn);
+        const FlowEntry *rev = fe->reverse_flow_entry();
+        EXPECT_TRUE(rev != NULL);
+        if (rev == NULL)
+            continue;
+        EXPECT_EQ(fe, rev->reverse_flow_entry());
+        EXPECT_EQ("TestVn", rev->data().source_vn);
+        EXPECT_EQ("vn1", rev->data().dest_vn);
+    }
+
+    int busy = 0;
+    for (uint16_t i = 0; i < proto->flow_thread_count(); i++) {
+        if (proto->flow_work_queue(i)->NumDequeues() > dequeues[i])
+            busy++;
+    }
+    EXPECT_LT(1, busy);
+}
+
+// Flow setup benchmark. The number of flow setup instances comes from the
+// FLOWS.thread_count parameter of the config file given with --config,
+// four by default.
+TEST_F(FlowTest, FlowSetupRate) {
+    int count = 1000;
+    if (getenv("AGENT_FLOW_SETUP_RATE_COUNT")) {
+        count = strtoul(getenv("AGENT_FLOW_SETUP_RATE_COUNT"), NULL, 0);
+    }
+    FlowTable *table = Agent::GetInstance()->pkt()->flow_table();
+    FlowProto *proto = Agent::GetInstance()->GetFlowProto();
+    std::vector<size_t> dequeues;
+    for (uint16_t i = 0; i < proto->flow_thread_count(); i++) {
+        dequeues.push_back(proto->flow_work_queue(i)->NumDequeues());
+    }
+
+    uint64_t start = ClockMonotonicUsec();
+    for (int i = 0; i < count; i++) {
+        Ip4Address addr(0x05000000 + i);
+        TxTcpPacket(vnet->id(), vnet_addr, addr.to_string().c_str(),
+                    1000 + (i % 1000), 80, false);
+    }
+    WAIT_FOR(count * 10, 1000, ((size_t)(count * 2) == table->Size()));
+    uint64_t elapsed = ClockMonotonicUsec() - start;
+
+    std::ostringstream shards;
+    for (uint16_t i = 0; i < proto->flow_thread_count(); i++) {
+        shards << " " << (proto->flow_work_queue(i)->NumDequeues() -
+                          dequeues[i]);
+    }
+    LOG(DEBUG, "Setup " << count << " flows using " <<
+        proto->flow_thread_count() << " threads in " << elapsed <<
+        " usecs, " << (uint64_t) count * 1000000 / std::max<uint64_t>(elapsed, 1)
+        << " flows/sec, packets per thread:" << shards.str());
+}
+
 int main(int argc, char *argv[]) {
     int ret = 0;
 
     GETUSERARGS();
+    if (vm.count("config") == 0) {
+        strcpy(init_file, DEFAULT_VNSW_FLOW_MT_CONFIG_FILE);
+    }
     client = TestInit(init_file, ksync_init, true, true, true, 100*1000);
     ret = RUN_ALL_TESTS();
     TestShutdown();
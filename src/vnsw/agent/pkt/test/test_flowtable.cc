@@ -478,6 +478,143 @@ TEST_F(FlowTableTest, RevFlowDelete_before_KSyncAck) {
 
 }
 
+static FlowKey MakeFlowKey(uint32_t i) {
+    FlowKey key;
+    key.family = Address::INET;
+    key.nh = i % 8;
+    key.src_addr = Ip4Address(0x0A000000 + i);
+    key.dst_addr = Ip4Address(0x0B000001);
+    key.protocol = IPPROTO_TCP;
+    key.src_port = i;
+    key.dst_port = 80;
+    return key;
+}
+
+// Grow the table past its initial size, walk it the way the aging and the
+// introspect do and verify that the tombstones left by erase are reused.
+TEST(FlowEntryHashTableTest, InsertFindErase) {
+    const uint32_t count = 4 * FlowEntryHashTable::kInitialSize;
+    FlowEntryHashTable table;
+    std::vector<FlowEntry *> flows;
+    for (uint32_t i = 0; i < count; i++) {
+        FlowEntry *fe = new FlowEntry(MakeFlowKey(i));
+        flows.push_back(fe);
+        EXPECT_TRUE(table.insert(fe).second);
+        EXPECT_FALSE(table.insert(fe).second);
+    }
+    EXPECT_EQ(count, table.size());
+    EXPECT_LT(table.size(), table.bucket_count());
+
+    std::set<FlowEntry *> visited;
+    FlowKey key;
+    key.Reset();
+    size_t slot = 0;
+    FlowEntryHashTable::iterator it = table.FindNext(key, slot);
+    while (it != table.end()) {
+        for (int i = 0; i < 100 && it != table.end(); i++, ++it) {
+            EXPECT_TRUE(visited.insert(*it).second);
+            key = (*it)->key();
+            slot = it.slot();
+        }
+        it = table.FindNext(key, slot);
+    }
+    EXPECT_EQ(count, visited.size());
+
+    for (uint32_t i = 0; i < count; i += 2) {
+        table.erase(table.find(flows[i]->key()));
+    }
+    EXPECT_EQ(count / 2, table.size());
+    for (uint32_t i = 0; i < count; i++) {
+        EXPECT_EQ((i % 2) != 0, table.find(flows[i]->key()) != table.end());
+    }
+
+    size_t bucket_count = table.bucket_count();
+    for (uint32_t i = 0; i < count; i += 2) {
+        EXPECT_TRUE(table.insert(flows[i]).second);
+    }
+    EXPECT_EQ(count, table.size());
+    EXPECT_EQ(bucket_count, table.bucket_count());
+
+    for (uint32_t i = 0; i < count; i++) {
+        table.erase(table.find(flows[i]->key()));
+        delete flows[i];
+    }
+    EXPECT_EQ(0U, table.size());
+}
+
+// Erase the last entry visited before resuming the walk. The walk resumes
+// after the saved slot, also for an entry whose probe wrapped past the end of
+// the table.
+TEST(FlowEntryHashTableTest, FindNextErased) {
+    const uint32_t count = 3 * FlowEntryHashTable::kInitialSize / 4 - 8;
+    FlowEntryHashTable table;
+    std::vector<FlowEntry *> flows;
+    for (uint32_t i = 0; i < count; i++) {
+        FlowEntry *fe = new FlowEntry(MakeFlowKey(i));
+        flows.push_back(fe);
+        EXPECT_TRUE(table.insert(fe).second);
+    }
+    EXPECT_EQ(FlowEntryHashTable::kInitialSize, table.bucket_count());
+
+    size_t mask = table.bucket_count() - 1;
+    FlowEntryHashTable::iterator wrapped = table.end();
+    for (FlowEntryHashTable::iterator it = table.begin(); it != table.end();
+         ++it) {
+        if (it.slot() < ((*it)->key().Hash() & mask)) {
+            wrapped = it;
+            break;
+        }
+    }
+    if (wrapped != table.end()) {
+        FlowKey key = (*wrapped)->key();
+        size_t slot = wrapped.slot();
+        FlowEntryHashTable::iterator next = wrapped;
+        ++next;
+        table.erase(wrapped);
+        EXPECT_TRUE(next == table.FindNext(key, slot));
+    }
+
+    size_t size = table.size();
+    std::set<FlowEntry *> visited;
+    FlowKey key;
+    key.Reset();
+    size_t slot = 0;
+    FlowEntryHashTable::iterator it = table.FindNext(key, slot);
+    while (it != table.end()) {
+        for (int i = 0; i < 100 && it != table.end(); i++, ++it) {
+            EXPECT_TRUE(visited.insert(*it).second);
+            key = (*it)->key();
+            slot = it.slot();
+        }
+        table.erase(table.find(key));
+        it = table.FindNext(key, slot);
+    }
+    EXPECT_EQ(size, visited.size());
+
+    for (uint32_t i = 0; i < count; i++) {
+        FlowEntryHashTable::iterator it = table.find(flows[i]->key());
+        if (it != table.end()) {
+            table.erase(it);
+        }
+        delete flows[i];
+    }
+}
+
+// A freed flow entry is reused by the next allocation
+TEST(FlowEntrySlabTest, Reuse) {
+    FlowEntry *fe = new FlowEntry(MakeFlowKey(1));
+    size_t memory_size = FlowEntry::slab().memory_size();
+    size_t free_count = FlowEntry::slab().free_count();
+    EXPECT_NE(0U, memory_size);
+    delete fe;
+    EXPECT_EQ(free_count + 1, FlowEntry::slab().free_count());
+
+    FlowEntry *fe2 = new FlowEntry(MakeFlowKey(2));
+    EXPECT_EQ(fe, fe2);
+    EXPECT_EQ(memory_size, FlowEntry::slab().memory_size());
+    delete fe2;
+}
+
 int main(int argc, char *argv[]) {
     GETUSERARGS();
 
@@ -3691,6 +3691,71 @@ TEST_F(FlowTest, AclRuleUpdate) {
     client->WaitForIdle(5);
 }
 
+// Flows using an ACL are revaluated in batches when the ACL changes
+TEST_F(FlowTest, AclUpdateRevaluate) {
+    FlowTable *table = agent()->pkt()->flow_table();
+    AddAclEntry("acl4", 4, 1, "pass", "fe6a4dcb-dde4-48e6-8957-856a7aacb2e2");
+    FlowSetup();
+    AddLink("virtual-network", "vn6", "access-control-list", "acl4");
+    client->WaitForIdle();
+
+    TestFlow flow[] = {
+        //Add a ICMP forward and reverse flow
+        {  TestFlowPkt(Address::INET, vm_a_ip, vm_b_ip, 1, 0, 0, "vrf6",
+                       flow5->id()),
+        {
+            new VerifyVn("vn6", "vn6"),
+            new VerifyVrf("vrf6", "vrf6")
+        }
+        },
+        {  TestFlowPkt(Address::INET, vm_b_ip, vm_a_ip, 1, 0, 0, "vrf6",
+                       flow6->id()),
+        {
+            new VerifyVn("vn6", "vn6"),
+            new VerifyVrf("vrf6", "vrf6")
+        }
+        }
+    };
+
+    CreateFlow(flow, 2);
+    EXPECT_EQ(2U, table->Size());
+    const FlowEntry *fe = flow[0].pkt_.FlowFetch();
+    EXPECT_STREQ("fe6a4dcb-dde4-48e6-8957-856a7aacb2e2",
+                 fe->nw_ace_uuid().c_str());
+
+    uint64_t enqueue_count =
+        table->revaluate_enqueue_count(FlowTable::REVALUATE_ACL);
+    uint64_t revaluate_count =
+        table->revaluate_count(FlowTable::REVALUATE_ACL);
+    uint64_t batch_count = table->revaluate_batch_count();
+    table->set_revaluate_batch_size(1);
+
+    //Replace the rule, both flows must pick the new rule
+    AddAclEntry("acl4", 4, 1, "deny", "fe6a4dcb-dde4-48e6-8957-856a7aacb2e3");
+    client->WaitForIdle();
+    EXPECT_EQ(0U, table->revaluate_pending());
+    EXPECT_LE(enqueue_count + 2,
+              table->revaluate_enqueue_count(FlowTable::REVALUATE_ACL));
+    EXPECT_LE(revaluate_count + 2,
+              table->revaluate_count(FlowTable::REVALUATE_ACL));
+    EXPECT_LE(batch_count + 2, table->revaluate_batch_count());
+    fe = flow[0].pkt_.FlowFetch();
+    EXPECT_STREQ("fe6a4dcb-dde4-48e6-8957-856a7aacb2e3",
+                 fe->nw_ace_uuid().c_str());
+    EXPECT_TRUE((fe->data().match_p.action_info.action &
+                (1 << TrafficAction::DENY)) != 0);
+
+    //cleanup
+    table->set_revaluate_batch_size(FlowTable::kRevaluateBatchSize);
+    FlushFlowTable();
+    client->WaitForIdle();
+    EXPECT_EQ(0U, table->Size());
+    DelLink("virtual-network", "vn6", "access-control-list", "acl4");
+    FlowTeardown();
+    DelNode("access-control-list", "acl4");
+    client->WaitForIdle(5);
+}
+
 int main(int argc, char *argv[]) {
     GETUSERARGS();
 
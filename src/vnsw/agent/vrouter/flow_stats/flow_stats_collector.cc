@@ -21,6 +21,7 @@
 #include <uve/vm_uve_table.h>
 #include <uve/interface_uve_stats_table.h>
 #include <algorithm>
+#include <set>
 #include <pkt/flow_proto.h>
 #include <vrouter/ksync/ksync_init.h>
 #include <vrouter/flow_stats/flow_stats_interval_types.h>
@@ -232,7 +233,11 @@ bool FlowStatsCollector::Run() {
         return true;
     }
     uint64_t curr_time = UTCTimestampUsec();
-    it = flow_obj->flow_entry_map_.upper_bound(flow_iteration_key_);
+    // Flows to be deleted are collected and deleted at the end of the pass,
+    // the walk does not have to step over the entries released by a delete
+    FlowTable::FlowEntryPtrList delete_list;
+    std::set<const FlowEntry *> delete_set;
+    it = flow_obj->flow_entry_map_.FindNext(flow_iteration_key_);
     if (it == flow_obj->flow_entry_map_.end()) {
         it = flow_obj->flow_entry_map_.begin();
     }
@@ -240,13 +245,13 @@ bool FlowStatsCollector::Run() {
         Agent::GetInstance()->ksync()->flowtable_ksync_obj();
 
     while (it != flow_obj->flow_entry_map_.end()) {
-        entry = it->second;
+        entry = *it;
         stats = &(entry->stats_);
         it++;
         assert(entry);
         deleted = false;
 
-        if (entry->deleted()) {
+        if (entry->deleted() || delete_set.count(entry)) {
             continue;
         }
 
@@ -271,14 +276,9 @@ bool FlowStatsCollector::Run() {
         }
 
         if (deleted == true) {
-            if (it != flow_obj->flow_entry_map_.end()) {
-                if (it->second == reverse_flow) {
-                    it++;
-                }
-            }
-            Agent::GetInstance()->pkt()->flow_table()->Delete
-                (entry->key(), reverse_flow != NULL? true : false);
-            entry = NULL;
+            delete_list.push_back(entry);
+            delete_set.insert(entry);
+            delete_set.insert(reverse_flow);
             if (reverse_flow) {
                 count++;
                 if (count == flow_count_per_pass_) {
@@ -324,14 +324,9 @@ bool FlowStatsCollector::Run() {
 
         if ((!deleted) && (delete_short_flow_ == true) &&
             entry->is_flags_set(FlowEntry::ShortFlow)) {
-            if (it != flow_obj->flow_entry_map_.end()) {
-                if (it->second == reverse_flow) {
-                    it++;
-                }
-            }
-            Agent::GetInstance()->pkt()->flow_table()->Delete
-                (entry->key(), true);
-            entry = NULL;
+            delete_list.push_back(entry);
+            delete_set.insert(entry);
+            delete_set.insert(reverse_flow);
             if (reverse_flow) {
                 count++;
                 if (count == flow_count_per_pass_) {
@@ -351,6 +346,7 @@ bool FlowStatsCollector::Run() {
             key_updation_reqd = false;
         }
     }
+    flow_obj->DeleteBatch(delete_list);
 
     /* Reset the iteration key if we are done with all the elements */
     if (key_updation_reqd) {
@@ -6,8 +6,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "base/time_util.h"
 #include "testing/gunit.h"
 #include "test/test_cmn_util.h"
+#include "ksync/ksync_sock_user.h"
 #include "vrouter/ksync/route_ksync.h"
 
 struct PortInfo input[] = {
@@ -94,6 +96,37 @@ public:
         client->WaitForIdle();
     }
 
+    // Adds count remote routes while the ksync send queue is held, then
+    // returns the time taken to program them once the queue is released
+    uint64_t ProgramRoutes(Peer *peer, int count, const string &vn) {
+        SecurityGroupList sg_list;
+        PathPreference path_pref;
+        KSyncSock *sock = KSyncSock::Get(0);
+        sock->set_send_queue_disable(true);
+        for (int i = 0; i < count; i++) {
+            ControllerVmRoute *data = ControllerVmRoute::MakeControllerVmRoute
+                (NULL, agent_->fabric_vrf_name(), agent_->router_id(),
+                 "vrf1", Ip4Address::from_string("10.10.10.2"),
+                 TunnelType::GREType(), 100, vn, sg_list, path_pref);
+            vrf1_uc_table_->AddRemoteVmRouteReq(peer, "vrf1",
+                Ip4Address(0x64000000 + i), 32, data);
+        }
+        client->WaitForIdle();
+        uint64_t start = ClockMonotonicUsec();
+        sock->set_send_queue_disable(false);
+        client->WaitForIdle();
+        return ClockMonotonicUsec() - start;
+    }
+
+    void DeleteRoutes(Peer *peer, int count) {
+        for (int i = 0; i < count; i++) {
+            vrf1_uc_table_->DeleteReq(peer, "vrf1",
+                                      Ip4Address(0x64000000 + i), 32,
+                                      (new ControllerVmRoute(peer)));
+        }
+        client->WaitForIdle();
+    }
+
     Agent *agent_;
     VnswInterfaceListener *vnswif_;
     VmInterface *vnet1_;
@@ -422,6 +455,50 @@ TEST_F(TestKSyncRoute, ecmp_ipam_subnet_route_2) {
     client->WaitForIdle();
 }
 
+// Compares the rate at which routes are programmed when every netlink
+// message is sent on its own with the rate when they are sent in bulk
+TEST_F(TestKSyncRoute, route_programming_rate) {
+    int count = 10000;
+    char *str = getenv("AGENT_KSYNC_ROUTE_COUNT");
+    if (str) count = strtoul(str, NULL, 0);
+
+    boost::system::error_code ec;
+    BgpPeer *bgp_peer = CreateBgpPeer(Ip4Address::from_string("0.0.0.1", ec),
+                                      "xmpp channel");
+    client->WaitForIdle();
+    KSyncSock *sock = KSyncSock::Get(0);
+    uint32_t max_bulk_msg_count = sock->max_bulk_msg_count();
+    int route_count = KSyncSockTypeMap::RouteCount();
+
+    sock->set_max_bulk_msg_count(1);
+    int tx_count = sock->tx_count();
+    int bulk_send_count = sock->bulk_send_count();
+    uint64_t single_time = ProgramRoutes(bgp_peer, count, "vn1");
+    EXPECT_EQ(route_count + count, KSyncSockTypeMap::RouteCount());
+    EXPECT_EQ(sock->tx_count() - tx_count,
+              sock->bulk_send_count() - bulk_send_count);
+    DeleteRoutes(bgp_peer, count);
+    EXPECT_EQ(route_count, KSyncSockTypeMap::RouteCount());
+
+    sock->set_max_bulk_msg_count(max_bulk_msg_count);
+    tx_count = sock->tx_count();
+    bulk_send_count = sock->bulk_send_count();
+    uint64_t bulk_time = ProgramRoutes(bgp_peer, count, "vn1");
+    EXPECT_EQ(route_count + count, KSyncSockTypeMap::RouteCount());
+    EXPECT_GE(sock->tx_count() - tx_count, count);
+    EXPECT_LT(sock->bulk_send_count() - bulk_send_count,
+              sock->tx_count() - tx_count);
+    DeleteRoutes(bgp_peer, count);
+    EXPECT_EQ(route_count, KSyncSockTypeMap::RouteCount());
+
+    LOG(DEBUG, "Programmed " << count << " routes in " << single_time <<
+        " usecs one message at a time, in " << bulk_time << " usecs with "
+        "up to " << max_bulk_msg_count << " messages per send");
+
+    DeleteBgpPeer(bgp_peer);
+    client->WaitForIdle();
+}
+
 int main(int argc, char **argv) {
     GETUSERARGS();
 
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "xmpp/xmpp_stanza_scanner.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/regex.hpp>
+
+#include "base/logging.h"
+#include "base/time_util.h"
+#include "xmpp/xmpp_str.h"
+#include "testing/gunit.h"
+
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+//
+// Splits a byte stream into stanzas the way XmppSession does i.e. the bytes
+// of an incomplete stanza are kept across reads and each stanza is copied
+// into a string when it's complete.
+//
+class ScannerStanzaSplitter {
+public:
+    ScannerStanzaSplitter() : expected_(XmppStanzaScanner::MESSAGE) { }
+
+    void set_expected(XmppStanzaScanner::Stanza expected) {
+        expected_ = expected;
+    }
+
+    void Read(const string &data, vector<string> *stanzas,
+              vector<XmppStanzaScanner::Stanza> *types = NULL) {
+        if (!buf_.empty() && scanner_.RescanRequired(expected_)) {
+            string pending;
+            pending.swap(buf_);
+            pending += data;
+            scanner_.Reset();
+            ReadInternal(pending, stanzas, types);
+        } else {
+            ReadInternal(data, stanzas, types);
+        }
+    }
+
+    const string &pending() const { return buf_; }
+
+private:
+    void ReadInternal(const string &data, vector<string> *stanzas,
+                      vector<XmppStanzaScanner::Stanza> *types) {
+        const uint8_t *cp = reinterpret_cast<const uint8_t *>(data.data());
+        size_t size = data.size();
+        size_t start = 0;
+        size_t offset = 0;
+        while (offset < size) {
+            bool complete;
+            offset += scanner_.Scan(expected_, cp + offset, size - offset,
+                                    &complete);
+            if (!complete) {
+                buf_.append(cp + start, cp + size);
+                break;
+            }
+            string xml;
+            if (buf_.empty()) {
+                xml.assign(cp + start, cp + offset);
+            } else {
+                buf_.append(cp + start, cp + offset);
+                xml.swap(buf_);
+            }
+            EXPECT_EQ(xml.size(), scanner_.length());
+            start = offset;
+            stanzas->push_back(xml);
+            if (types)
+                types->push_back(scanner_.stanza());
+        }
+    }
+
+    XmppStanzaScanner scanner_;
+    XmppStanzaScanner::Stanza expected_;
+    string buf_;
+};
+
+//
+// Splits a byte stream into stanzas using the boost::regex based algorithm
+// that XmppSession used for the OPENCONFIRM and ESTABLISHED states before it
+// switched to XmppStanzaScanner. Used as the baseline for the benchmarks.
+//
+class RegexStanzaSplitter {
+public:
+    RegexStanzaSplitter() : patt_(rXMPP_MESSAGE), tag_known_(false) {
+        offset_ = buf_.begin();
+    }
+
+    void Read(const string &data, vector<string> *stanzas) {
+        SetBuf(data);
+        while (Match()) {
+            string::const_iterator st = buf_.begin();
+            stanzas->push_back(string(st, offset_));
+            if (offset_ == buf_.end()) {
+                buf_.clear();
+                offset_ = buf_.begin();
+                break;
+            }
+            string::const_iterator end = buf_.end();
+            ReplaceBuf(string(offset_, end));
+        }
+    }
+
+private:
+    void SetBuf(const string &str) {
+        if (buf_.empty()) {
+            ReplaceBuf(str);
+        } else {
+            int pos = offset_ - buf_.begin();
+            buf_ += str;
+            offset_ = buf_.begin() + pos;
+        }
+    }
+
+    void ReplaceBuf(const string &str) {
+        buf_ = str;
+        offset_ = buf_.begin();
+    }
+
+    int MatchRegex(const boost::regex &patt) {
+        string::const_iterator end = buf_.end();
+        if (regex_search(offset_, end, res_, patt,
+                         boost::match_default | boost::match_partial) == 0) {
+            return -1;
+        }
+        if (res_[0].matched == false) {
+            offset_ = res_[0].first;
+            return 1;
+        }
+        begin_tag_ = string(res_[0].first, res_[0].second);
+        offset_ = res_[0].second;
+        return 0;
+    }
+
+    boost::regex TagToPattern(const string &tag) {
+        string token("</");
+        token += tag.substr(1);
+        token += "[\\s\\t\\r\\n]*>";
+        return boost::regex(token.c_str());
+    }
+
+    // Returns true if buf_ up to offset_ is a complete stanza.
+    bool Match() {
+        while (true) {
+            if (!tag_known_) {
+                size_t pos = buf_.find_first_not_of(sXMPP_VALIDWS);
+                if (pos != 0) {
+                    if (pos == string::npos) pos = buf_.size();
+                    offset_ = buf_.begin() + pos;
+                    return true;
+                }
+            }
+            int m = MatchRegex(tag_known_ ? TagToPattern(begin_tag_) : patt_);
+            if (m != 0)
+                return false;
+            tag_known_ = !tag_known_;
+            if (!tag_known_)
+                return true;
+        }
+    }
+
+    boost::regex patt_;
+    string buf_;
+    string::const_iterator offset_;
+    string begin_tag_;
+    bool tag_known_;
+    boost::match_results<string::const_iterator> res_;
+};
+
+class XmppStanzaScannerTest : public ::testing::Test {
+protected:
+    // Split the data into reads of the given size and return the stanzas.
+    vector<string> Split(XmppStanzaScanner::Stanza expected,
+                         const string &data, size_t chunk,
+                         string *pending = NULL) {
+        ScannerStanzaSplitter splitter;
+        splitter.set_expected(expected);
+        vector<string> stanzas;
+        for (size_t pos = 0; pos < data.size(); pos += chunk) {
+            splitter.Read(data.substr(pos, chunk), &stanzas);
+        }
+        if (pending)
+            *pending = splitter.pending();
+        return stanzas;
+    }
+
+    // Verify that the stanzas are found irrespective of how the data is
+    // split up into reads.
+    void Verify(XmppStanzaScanner::Stanza expected,
+                const vector<string> &expected_stanzas,
+                const string &expected_pending = "") {
+        string data;
+        for (size_t idx = 0; idx < expected_stanzas.size(); ++idx) {
+            data += expected_stanzas[idx];
+        }
+        data += expected_pending;
+        for (size_t chunk = 1; chunk <= data.size(); ++chunk) {
+            string pending;
+            vector<string> stanzas = Split(expected, data, chunk, &pending);
+            EXPECT_EQ(expected_stanzas, stanzas) << "chunk " << chunk;
+            EXPECT_EQ(expected_pending, pending) << "chunk " << chunk;
+        }
+    }
+
+    // Verify that the stanzas found in the data are the same as the ones
+    // found by the regex based implementation irrespective of how the data
+    // is split up into reads.
+    void VerifyRegex(const string &data) {
+        for (size_t chunk = 1; chunk <= data.size(); ++chunk) {
+            RegexStanzaSplitter splitter;
+            vector<string> regex_stanzas;
+            for (size_t pos = 0; pos < data.size(); pos += chunk) {
+                splitter.Read(data.substr(pos, chunk), &regex_stanzas);
+            }
+            vector<string> stanzas =
+                Split(XmppStanzaScanner::MESSAGE, data, chunk);
+            EXPECT_EQ(regex_stanzas, stanzas) << "chunk " << chunk;
+        }
+    }
+
+    string BuildRouteAdd(int idx) {
+        ostringstream oss;
+        oss << "<iq type=\"set\" from=\"agent-" << idx % 64 <<
+            "@vnsw.contrailsystems.com\" "
+            "to=\"network-control@contrailsystems.com/bgp-peer\" "
+            "id=\"pubsub" << idx << "\">"
+            "<pubsub xmlns=\"http://jabber.org/protocol/pubsub\">"
+            "<publish node=\"1/1/default-domain:demo:vn1:vn1/10.1." <<
+            (idx >> 8) % 256 << "." << idx % 256 << "/32\"><item><entry>"
+            "<nlri><af>1</af><safi>1</safi><address>10.1." <<
+            (idx >> 8) % 256 << "." << idx % 256 << "/32</address></nlri>"
+            "<next-hops><next-hop><af>1</af><address>192.168.1.1</address>"
+            "<label>" << 16 + idx % 1000 << "</label>"
+            "<tunnel-encapsulation-list><tunnel-encapsulation>gre"
+            "</tunnel-encapsulation></tunnel-encapsulation-list>"
+            "</next-hop></next-hops><virtual-network>"
+            "default-domain:demo:vn1</virtual-network>"
+            "<sequence-number>0</sequence-number>"
+            "<security-group-list><security-group>8000001</security-group>"
+            "</security-group-list><local-preference>100</local-preference>"
+            "</entry></item></publish></pubsub></iq>";
+        return oss.str();
+    }
+
+    void RunBenchmark(const string &name, const string &data, size_t chunk) {
+        vector<string> reads;
+        for (size_t pos = 0; pos < data.size(); pos += chunk) {
+            reads.push_back(data.substr(pos, chunk));
+        }
+
+        RegexStanzaSplitter regex_splitter;
+        vector<string> regex_stanzas;
+        uint64_t start = ClockMonotonicUsec();
+        for (size_t idx = 0; idx < reads.size(); ++idx) {
+            regex_splitter.Read(reads[idx], &regex_stanzas);
+        }
+        uint64_t regex_usec =
+            std::max<uint64_t>(ClockMonotonicUsec() - start, 1);
+
+        ScannerStanzaSplitter scanner_splitter;
+        vector<string> scanner_stanzas;
+        start = ClockMonotonicUsec();
+        for (size_t idx = 0; idx < reads.size(); ++idx) {
+            scanner_splitter.Read(reads[idx], &scanner_stanzas);
+        }
+        uint64_t scanner_usec =
+            std::max<uint64_t>(ClockMonotonicUsec() - start, 1);
+
+        EXPECT_EQ(regex_stanzas.size(), scanner_stanzas.size());
+        EXPECT_TRUE(regex_stanzas == scanner_stanzas);
+        LOG(DEBUG, name << ": " << data.size() << " bytes in " <<
+            reads.size() << " reads, " << scanner_stanzas.size() <<
+            " stanzas, regex " << data.size() / regex_usec << " MB/s" <<
+            ", scanner " << data.size() / scanner_usec << " MB/s");
+    }
+};
+
+TEST_F(XmppStanzaScannerTest, Message) {
+    vector<string> stanzas;
+    stanzas.push_back("<iq type='set'><pubsub><item/></pubsub></iq>");
+    stanzas.push_back("<message to='a'><event>x</event></message>");
+    stanzas.push_back("<iq></iq>");
+    Verify(XmppStanzaScanner::MESSAGE, stanzas);
+}
+
+//
+// Whitespace at the beginning of a stanza is a separate stanza. Junk and any
+// whitespace following it are part of the next stanza.
+//
+TEST_F(XmppStanzaScannerTest, WhitespaceAndJunk) {
+    vector<string> stanzas;
+    stanzas.push_back("<iq> blah blah </iq>");
+    stanzas.push_back("   ");
+    stanzas.push_back("abc   <iq> Rest </iq>");
+    stanzas.push_back(" \r\n\t\xc8\x80");
+    stanzas.push_back("<message>x</message>");
+    string data;
+    for (size_t idx = 0; idx < stanzas.size(); ++idx) {
+        data += stanzas[idx];
+    }
+    EXPECT_EQ(stanzas, Split(XmppStanzaScanner::MESSAGE, data, data.size()));
+
+    // A whitespace run that is split across reads results in a stanza for
+    // each part, same as with the regex based implementation.
+    VerifyRegex(data + "junk <i");
+}
+
+//
+// Whitespace is allowed before the closing '>' of the end tag. Look-alikes
+// of the start and end tags don't match.
+//
+TEST_F(XmppStanzaScannerTest, EndTag) {
+    vector<string> stanzas;
+    stanzas.push_back("<iq><iqx/></iqx></i</iq \t\r\n>");
+    stanzas.push_back("<messag<message></iq></message2></message>");
+    stanzas.push_back("<<<iq></</</iq>");
+    Verify(XmppStanzaScanner::MESSAGE, stanzas, "<iq></iq x>");
+    VerifyRegex(stanzas[0] + stanzas[1] + stanzas[2] + "<iq></iq x>");
+}
+
+TEST_F(XmppStanzaScannerTest, Stream) {
+    vector<string> stanzas;
+    stanzas.push_back("<?xml version='1.0'?><stream:stream from='a' to='b' "
+        "xmlns='jabber:client' "
+        "xmlns:stream='http://etherx.jabber.org/streams'>");
+    stanzas.push_back("<stream:stream "
+        "xmlns:stream=\"http://etherx.jabber.org/streams\"\n >");
+    stanzas.push_back("<stream:stream "
+        "xmlns:stream='http://etherx.jabber.org/streams2' "
+        "xmlns:x='http://etherx.jabber.org/streamshttp://etherx.jabber.org"
+        "/streams'>");
+    Verify(XmppStanzaScanner::STREAM, stanzas);
+}
+
+TEST_F(XmppStanzaScannerTest, Features) {
+    vector<string> stanzas;
+    stanzas.push_back("<stream:features><starttls "
+        "xmlns='urn:ietf:params:xml:ns:xmpp-tls'><required/></starttls>"
+        "</stream:features >");
+    Verify(XmppStanzaScanner::STREAM_FEATURES, stanzas);
+}
+
+TEST_F(XmppStanzaScannerTest, StartTls) {
+    vector<string> stanzas;
+    stanzas.push_back("<starttls xmlns='urn:ietf:params:xml:ns:xmpp-tls'/>");
+    stanzas.push_back("<starttls xmlns='urn:ietf:params:xml:ns:xmpp-tls' />");
+    Verify(XmppStanzaScanner::STARTTLS, stanzas);
+
+    stanzas.clear();
+    stanzas.push_back("<proceed xmlns='urn:ietf:params:xml:ns:xmpp-tls'/>");
+    Verify(XmppStanzaScanner::PROCEED, stanzas);
+}
+
+//
+// Data received when nothing is expected is kept and becomes part of the
+// next stanza. The type of stanza expected can change between reads.
+//
+TEST_F(XmppStanzaScannerTest, ExpectedChange) {
+    ScannerStanzaSplitter splitter;
+    vector<string> stanzas;
+    vector<XmppStanzaScanner::Stanza> types;
+
+    splitter.set_expected(XmppStanzaScanner::NONE);
+    splitter.Read("<iq></iq><stream:str", &stanzas, &types);
+    EXPECT_TRUE(stanzas.empty());
+    splitter.set_expected(XmppStanzaScanner::STREAM);
+    splitter.Read("eam xmlns:stream='http://etherx.jabber.org/streams'>",
+                  &stanzas, &types);
+    splitter.set_expected(XmppStanzaScanner::MESSAGE);
+    splitter.Read("<stream:features></stream:features><iq></iq>",
+                  &stanzas, &types);
+    EXPECT_TRUE(splitter.pending().empty());
+
+    ASSERT_EQ(2, stanzas.size());
+    EXPECT_EQ("<iq></iq><stream:stream "
+              "xmlns:stream='http://etherx.jabber.org/streams'>", stanzas[0]);
+    EXPECT_EQ(XmppStanzaScanner::STREAM, types[0]);
+    EXPECT_EQ("<stream:features></stream:features><iq></iq>", stanzas[1]);
+    EXPECT_EQ(XmppStanzaScanner::MESSAGE, types[1]);
+}
+
+//
+// Throughput with a burst of route adds from an agent, split into reads of
+// the size that the TcpSession uses.
+//
+TEST_F(XmppStanzaScannerTest, ThroughputSmallStanzas) {
+    size_t size = 16 * 1024 * 1024;
+    char *str = getenv("XMPP_STANZA_SCANNER_TEST_BYTES");
+    if (str) size = strtoul(str, NULL, 0);
+
+    string data;
+    data.reserve(size + 4096);
+    for (int idx = 0; data.size() < size; ++idx) {
+        data += BuildRouteAdd(idx);
+        if (idx % 100 == 0)
+            data += " ";
+    }
+    RunBenchmark("small stanzas", data, 4096);
+}
+
+//
+// Throughput with large stanzas that span many reads.
+//
+TEST_F(XmppStanzaScannerTest, ThroughputLargeStanzas) {
+    size_t size = 512 * 1024;
+    char *str = getenv("XMPP_STANZA_SCANNER_TEST_LARGE_BYTES");
+    if (str) size = strtoul(str, NULL, 0);
+
+    string data;
+    for (int count = 0; count < 4; ++count) {
+        string stanza("<iq type=\"set\"><pubsub><publish>");
+        for (int idx = 0; stanza.size() < size; ++idx) {
+            stanza += "<item><entry><nlri><address>10.1.1.1/32</address>"
+                "</nlri><label>16</label></entry></item>";
+        }
+        stanza += "</publish></pubsub></iq>";
+        data += stanza;
+    }
+    RunBenchmark("large stanzas", data, 4096);
+}
+
+int main(int argc, char **argv) {
+    LoggingInit();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
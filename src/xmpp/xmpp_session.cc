@@ -19,25 +19,13 @@ using namespace std;
 
 using boost::asio::mutable_buffer;
 
-const boost::regex XmppSession::patt_(rXMPP_MESSAGE);
-const boost::regex XmppSession::stream_patt_(rXMPP_STREAM_START);
-const boost::regex XmppSession::stream_res_end_(rXMPP_STREAM_END);
-const boost::regex XmppSession::whitespace_(sXMPP_WHITESPACE);
-const boost::regex XmppSession::stream_features_patt_(rXMPP_STREAM_FEATURES);
-const boost::regex XmppSession::starttls_patt_(rXMPP_STREAM_STARTTLS);
-const boost::regex XmppSession::proceed_patt_(rXMPP_STREAM_PROCEED);
-const boost::regex XmppSession::end_patt_(rXMPP_STREAM_STANZA_END);
-
 XmppSession::XmppSession(XmppConnectionManager *manager, SslSocket *socket,
     bool async_ready)
     : SslSession(manager, socket, async_ready),
       manager_(manager),
       connection_(NULL),
-      tag_known_(0),
       index_(-1),
       stats_(XmppStanza::RESERVED_STANZA, XmppSession::StatsPair(0, 0)) {
-    buf_.reserve(kMaxMessageSize);
-    offset_ = buf_.begin();
     stream_open_matched_ = false;
 }
 
@@ -97,151 +85,113 @@ void XmppSession::IncStats(unsigned int type, uint64_t bytes) {
     stats_[type].second += bytes;
 }
 
-boost::regex XmppSession::tag_to_pattern(const char *tag) {
-    std::string token("</");
-    token += ++tag;
-    token += "[\\s\\t\\r\\n]*>";
-
-    boost::regex exp(token.c_str());
-    return exp;
-}
+//
+// Return the type of stanza to look for based on the state of the connection.
+//
+XmppStanzaScanner::Stanza XmppSession::ExpectedStanza() {
+    const XmppConnection *connection = connection_;
+    xmsm::XmState state = connection->GetStateMcState();
+    xmsm::XmOpenConfirmState oc_state =
+        connection->GetStateMcOpenConfirmState();
 
-void XmppSession::SetBuf(const std::string &str) {
-    if (buf_.empty()) {
-        ReplaceBuf(str);
-    } else {
-        int pos = offset_ - buf_.begin();
-        buf_ += str;
-        offset_ = buf_.begin() + pos;
+    if (state == xmsm::ACTIVE || state == xmsm::IDLE) {
+        return XmppStanzaScanner::STREAM;
+    } else if (state == xmsm::CONNECT || state == xmsm::OPENSENT) {
+        // Note, these are client only states
+        if (!stream_open_matched_)
+            return XmppStanzaScanner::STREAM;
+        return XmppStanzaScanner::STREAM_FEATURES;
+    } else if ((state == xmsm::OPENCONFIRM) && !(IsSslDisabled())) {
+        if (connection->IsClient()) {
+            if (oc_state == xmsm::OPENCONFIRM_FEATURE_NEGOTIATION) {
+                return XmppStanzaScanner::PROCEED;
+            } else if (oc_state == xmsm::OPENCONFIRM_FEATURE_SUCCESS) {
+                return XmppStanzaScanner::STREAM;
+            } else {
+                return XmppStanzaScanner::STREAM_FEATURES;
+            }
+        } else {
+            if (oc_state == xmsm::OPENCONFIRM_FEATURE_SUCCESS) {
+                return XmppStanzaScanner::STREAM;
+            } else {
+                return XmppStanzaScanner::STARTTLS;
+            }
+        }
+    } else if (state == xmsm::OPENCONFIRM || state == xmsm::ESTABLISHED) {
+        return XmppStanzaScanner::MESSAGE;
     }
+    return XmppStanzaScanner::NONE;
 }
 
-void XmppSession::ReplaceBuf(const std::string &str) {
-    buf_ = str;
-    buf_.reserve(kMaxMessageSize+8);
-    offset_ = buf_.begin();
-}
-
-bool XmppSession::LeftOver() const {
-    if (buf_.empty())
-        return false;
-    return (buf_.end() != offset_);
-}
-
-// Match a pattern in the buffer. Partially matched string is
-// kept in buf_ for use in conjucntion with next buffer read.
-int XmppSession::MatchRegex(const boost::regex &patt) {
-
-    std::string::const_iterator end = buf_.end();
-
-    if (regex_search(offset_, end, res_, patt, 
-                     boost::match_default | boost::match_partial) == 0) {
-        return -1;
+//
+// Update session state when a stanza has been found, before it's handed to
+// the connection.
+//
+void XmppSession::StanzaComplete(XmppStanzaScanner::Stanza stanza) {
+    switch (stanza) {
+    case XmppStanzaScanner::STREAM: {
+        xmsm::XmState state = connection_->GetStateMcState();
+        if (state == xmsm::CONNECT || state == xmsm::OPENSENT)
+            stream_open_matched_ = true;
+        break;
     }
-    if(res_[0].matched == false) {
-        // partial match
-        offset_ = res_[0].first;
-        return 1;
-    } else {
-        begin_tag_ = string(res_[0].first, res_[0].second);
-        offset_ = res_[0].second;
-        return 0; 
+    case XmppStanzaScanner::STARTTLS:
+    case XmppStanzaScanner::PROCEED:
+        // set the flag, as we do not want OnRead function to
+        // read any more data from basic socket.
+        SetSslHandShakeInProgress(true);
+        break;
+    default:
+        break;
     }
 }
 
-bool XmppSession::Match(Buffer buffer, int *result, bool NewBuf) {
-    const XmppConnection *connection = this->Connection();
-
-    if (connection == NULL) {
-        return true;
-    }
-
-    xmsm::XmState state = connection->GetStateMcState();
-    xmsm::XmOpenConfirmState oc_state =
-        connection->GetStateMcOpenConfirmState();
-
-    if (NewBuf) {
-        const uint8_t *cp = BufferData(buffer);
-        // TODO Avoid this copy
-        std::string str(cp, cp + BufferSize(buffer));
-        XmppSession::SetBuf(str);
-    }
-
-    int m = -1;
-    *result = 0;
-    do {
-        if (!tag_known_) {
-            // check for whitespaces
-            size_t pos = buf_.find_first_not_of(sXMPP_VALIDWS);
-            if (pos != 0) {
-                if (pos == string::npos) pos = buf_.size();
-                offset_ = buf_.begin() + pos;
-                return false;
-            }
-        }
+//
+// Find the stanzas in the data and send them to the connection object.
+//
+// The scanner finds the stanza boundaries directly in the data. Only the
+// bytes of a stanza that is still incomplete at the end of the data get
+// copied into buf_, so each received byte is scanned exactly once even when
+// a large stanza is split across many reads.
+//
+void XmppSession::ScanData(const uint8_t *data, size_t size) {
+    size_t start = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        //
+        // XXX Connection gone ?
+        //
+        if (!connection_)
+            break;
 
-        if (state == xmsm::ACTIVE || state == xmsm::IDLE) {
-            m = MatchRegex(tag_known_ ? stream_res_end_:stream_patt_);
-        } else if (state == xmsm::CONNECT || state == xmsm::OPENSENT) { 
-            // Note, these are client only states
-            if (!stream_open_matched_) {
-                m = MatchRegex(tag_known_ ? stream_res_end_:stream_patt_);
-                if ((m == 0) && (tag_known_)) {
-                    stream_open_matched_ = true;
-                }
-            } else {
-                m = MatchRegex(tag_known_ ? tag_to_pattern(begin_tag_.c_str()):
-                                            stream_features_patt_);
-            }
-        } else if ((state == xmsm::OPENCONFIRM) && !(IsSslDisabled())) {
-            if (connection->IsClient()) {
-                if (oc_state == xmsm::OPENCONFIRM_FEATURE_NEGOTIATION) {
-                    m = MatchRegex(tag_known_ ? end_patt_: proceed_patt_);
-                    if ((m == 0) && (tag_known_)) {
-                        // set the flag, as we do not want OnRead function to
-                        // read any more data from basic socket.
-                        SetSslHandShakeInProgress(true);
-                    }
-                } else if (oc_state == xmsm::OPENCONFIRM_FEATURE_SUCCESS) {
-                    m = MatchRegex(tag_known_ ? stream_res_end_:stream_patt_);
-                } else {
-                    m = MatchRegex(tag_known_ ? tag_to_pattern(begin_tag_.c_str()):
-                                                stream_features_patt_);
-                }
-            } else {
-                if (oc_state == xmsm::OPENCONFIRM_FEATURE_SUCCESS) {
-                    m = MatchRegex(tag_known_ ? stream_res_end_:stream_patt_);
-                } else {
-                    m = MatchRegex(tag_known_ ? end_patt_:starttls_patt_);
-                    if ((m == 0) && (tag_known_)) {
-                        SetSslHandShakeInProgress(true);
-                    }
-                }
-            }
-        } else if (state == xmsm::OPENCONFIRM || state == xmsm::ESTABLISHED) {
-            m = MatchRegex(tag_known_ ? tag_to_pattern(begin_tag_.c_str()):patt_);
+        bool complete;
+        offset += scanner_.Scan(ExpectedStanza(), data + offset,
+                                size - offset, &complete);
+        if (!complete) {
+            // Incomplete stanza, keep the data and read more.
+            buf_.append(data + start, data + size);
+            break;
         }
 
-        if (m == 0) { // full match
-            *result = 0; 
-            tag_known_ ^= 1; 
-            if (!tag_known_) {
-                // Found well formed xml
-                return false;
-            }
-        } else if (m == -1) { // no match
-            return true;
+        StanzaComplete(scanner_.stanza());
+        std::string xml;
+        if (buf_.empty()) {
+            xml.assign(data + start, data + offset);
         } else {
-            return true; // partial. read more
+            buf_.append(data + start, data + offset);
+            xml.swap(buf_);
         }
-    } while (true);
+        start = offset;
 
-    return true;
+        if (!connection_)
+            break;
+        connection_->ReceiveMsg(this, xml);
+    }
 }
 
+//
 // Read the socket stream and send messages to the connection object.
-// The buffer is copied to local string for regex match. 
-// TODO Code need to change st Match() is done on buffer itself.
+//
 void XmppSession::OnRead(Buffer buffer) {
     if (this->Connection() == NULL || !connection_) {
         // Connection is deleted. Session is being deleted as well
@@ -258,42 +208,20 @@ void XmppSession::OnRead(Buffer buffer) {
         return;
     }
 
-    int result = 0;
-    bool more = Match(buffer, &result, true);
-    do {
-        if (more == false) {
-            if (result < 0) {
-                // TODO generate error, close connection.
-                break;
-            }
-            // We got good match. Process the message
-            std::string::const_iterator st = buf_.begin();
-            std::string xml = string(st, offset_);
-
-            //
-            // XXX Connection gone ?
-            //
-            if (!connection_) break;
-            connection_->ReceiveMsg(this, xml);
-
-        } else {
-            // Read more data. Either we have partial match
-            // or no match but in this state we need to keep
-            // reading data.
-            break;
-        }
-
-        if (LeftOver()) {
-            std::string::const_iterator st = buf_.end();
-            ReplaceBuf(string(offset_, st));
-            more = Match(buffer, &result, false);
-        } else {
-            // No more data in the Buffer
-            buf_.clear();
-            break;
-        }
-    } while (true);
+    const uint8_t *data = BufferData(buffer);
+    size_t size = BufferSize(buffer);
+    if (!buf_.empty() && scanner_.RescanRequired(ExpectedStanza())) {
+        // The connection state changed before a start tag was found in the
+        // pending data. Look for the new start tag from the beginning.
+        std::string pending;
+        pending.swap(buf_);
+        pending.append(data, data + size);
+        scanner_.Reset();
+        ScanData(reinterpret_cast<const uint8_t *>(pending.data()),
+                 pending.size());
+    } else {
+        ScanData(data, size);
+    }
 
     ReleaseBuffer(buffer);
-    return;
 }
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#include "xmpp/xmpp_stanza_scanner.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "xmpp/xmpp_str.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+enum PatternId {
+    STREAM_START,
+    STREAM_END,
+    FEATURES_START,
+    FEATURES_END,
+    STARTTLS_START,
+    PROCEED_START,
+    EMPTY_END,
+    IQ_START,
+    IQ_END,
+    MESSAGE_START,
+    MESSAGE_END,
+    PATTERN_COUNT
+};
+
+//
+// Literal string along with the Knuth-Morris-Pratt failure table for it.
+// The failure table allows the match state to be carried across buffers
+// without ever having to look at previously scanned bytes.
+//
+class Pattern {
+public:
+    explicit Pattern(const char *str) : str_(str), fail_(str_.size(), 0) {
+        size_t len = 0;
+        for (size_t idx = 1; idx < str_.size(); ++idx) {
+            while (len > 0 && str_[idx] != str_[len])
+                len = fail_[len - 1];
+            if (str_[idx] == str_[len])
+                len++;
+            fail_[idx] = len;
+        }
+    }
+
+    // Return the new match state after consuming c in the given state.
+    size_t Advance(size_t state, uint8_t c) const {
+        while (state > 0 && static_cast<uint8_t>(str_[state]) != c)
+            state = fail_[state - 1];
+        if (static_cast<uint8_t>(str_[state]) == c)
+            state++;
+        return state;
+    }
+
+    uint8_t first() const { return str_[0]; }
+    size_t size() const { return str_.size(); }
+
+private:
+    string str_;
+    vector<size_t> fail_;
+};
+
+class PatternTable {
+public:
+    PatternTable() {
+        patterns_.reserve(PATTERN_COUNT);
+        patterns_.push_back(Pattern("<stream:stream"));
+        patterns_.push_back(Pattern("http://etherx.jabber.org/streams"));
+        patterns_.push_back(Pattern("<stream:features"));
+        patterns_.push_back(Pattern("</stream:features"));
+        patterns_.push_back(Pattern("<starttls"));
+        patterns_.push_back(Pattern("<proceed"));
+        patterns_.push_back(Pattern("/>"));
+        patterns_.push_back(Pattern("<iq"));
+        patterns_.push_back(Pattern("</iq"));
+        patterns_.push_back(Pattern("<message"));
+        patterns_.push_back(Pattern("</message"));
+
+        memset(whitespace_, 0, sizeof(whitespace_));
+        for (const char *cp = sXMPP_VALIDWS; *cp; ++cp) {
+            whitespace_[static_cast<uint8_t>(*cp)] = true;
+        }
+        memset(space_, 0, sizeof(space_));
+        for (const char *cp = " \t\r\n"; *cp; ++cp) {
+            space_[static_cast<uint8_t>(*cp)] = true;
+        }
+    }
+
+    const Pattern &at(int id) const { return patterns_[id]; }
+
+    // Characters that make up a whitespace keepalive.
+    bool IsWhitespace(uint8_t c) const { return whitespace_[c]; }
+
+    // Characters allowed between the end of a tag and the closing '>'.
+    bool IsSpace(uint8_t c) const { return space_[c]; }
+
+private:
+    vector<Pattern> patterns_;
+    bool whitespace_[256];
+    bool space_[256];
+};
+
+static const PatternTable patterns;
+
+}  // namespace
+
+XmppStanzaScanner::XmppStanzaScanner() {
+    Reset();
+}
+
+void XmppStanzaScanner::Reset() {
+    expected_ = NONE;
+    stanza_ = NONE;
+    complete_ = false;
+    length_ = 0;
+    start_count_ = 0;
+    start_state_[0] = start_state_[1] = 0;
+    end_pattern_ = -1;
+    end_state_ = 0;
+    end_phase_ = END_TAG;
+}
+
+//
+// Set the start tag(s) to look for and reset any partial match of the start
+// tag(s) for the previously expected stanza.
+//
+void XmppStanzaScanner::SetExpected(Stanza expected) {
+    expected_ = expected;
+    start_count_ = 0;
+    start_state_[0] = start_state_[1] = 0;
+    switch (expected) {
+    case STREAM:
+        start_pattern_[start_count_++] = STREAM_START;
+        break;
+    case STREAM_FEATURES:
+        start_pattern_[start_count_++] = FEATURES_START;
+        break;
+    case STARTTLS:
+        start_pattern_[start_count_++] = STARTTLS_START;
+        break;
+    case PROCEED:
+        start_pattern_[start_count_++] = PROCEED_START;
+        break;
+    case MESSAGE:
+        start_pattern_[start_count_++] = IQ_START;
+        start_pattern_[start_count_++] = MESSAGE_START;
+        break;
+    default:
+        break;
+    }
+}
+
+//
+// Look for the start tag of the expected stanza. Returns the number of bytes
+// consumed, which includes the start tag if it was found.
+//
+// All the start tags begin with '<' and don't contain any other '<', so we
+// can skip to the next '<' with memchr when there's no partial match.
+//
+size_t XmppStanzaScanner::ScanStart(const uint8_t *data, size_t size) {
+    const uint8_t *cp = data;
+    const uint8_t *end = data + size;
+    while (cp < end) {
+        if (start_state_[0] == 0 && start_state_[1] == 0) {
+            cp = static_cast<const uint8_t *>(memchr(cp, '<', end - cp));
+            if (cp == NULL)
+                return size;
+        }
+        uint8_t c = *cp++;
+        for (int idx = 0; idx < start_count_; ++idx) {
+            const Pattern &pattern = patterns.at(start_pattern_[idx]);
+            start_state_[idx] = pattern.Advance(start_state_[idx], c);
+            if (start_state_[idx] < pattern.size())
+                continue;
+
+            switch (start_pattern_[idx]) {
+            case STREAM_START:
+                stanza_ = STREAM;
+                end_pattern_ = STREAM_END;
+                break;
+            case FEATURES_START:
+                stanza_ = STREAM_FEATURES;
+                end_pattern_ = FEATURES_END;
+                break;
+            case STARTTLS_START:
+                stanza_ = STARTTLS;
+                end_pattern_ = EMPTY_END;
+                break;
+            case PROCEED_START:
+                stanza_ = PROCEED;
+                end_pattern_ = EMPTY_END;
+                break;
+            case IQ_START:
+                stanza_ = MESSAGE;
+                end_pattern_ = IQ_END;
+                break;
+            case MESSAGE_START:
+                stanza_ = MESSAGE;
+                end_pattern_ = MESSAGE_END;
+                break;
+            }
+            end_state_ = 0;
+            end_phase_ = END_TAG;
+            return cp - data;
+        }
+    }
+    return size;
+}
+
+//
+// Look for the end tag corresponding to the start tag that was found. The
+// literal part of the end tag is matched in the END_TAG phase. The END_QUOTE
+// and END_SPACE phases handle the quote after the stream namespace and the
+// optional whitespace before the closing '>'.
+//
+// If the bytes following the literal don't match, the literal match is
+// abandoned and the current byte is matched against the literal afresh.
+// This is correct since none of the end tag literals has a proper suffix
+// that is also a prefix.
+//
+size_t XmppStanzaScanner::ScanEnd(const uint8_t *data, size_t size,
+                                  bool *complete) {
+    const Pattern &pattern = patterns.at(end_pattern_);
+    const uint8_t first = pattern.first();
+    const uint8_t *cp = data;
+    const uint8_t *end = data + size;
+    while (cp < end) {
+        if (end_phase_ == END_TAG && end_state_ == 0) {
+            cp = static_cast<const uint8_t *>(memchr(cp, first, end - cp));
+            if (cp == NULL)
+                return size;
+        }
+        uint8_t c = *cp++;
+        switch (end_phase_) {
+        case END_TAG:
+            end_state_ = pattern.Advance(end_state_, c);
+            if (end_state_ < pattern.size())
+                break;
+            if (end_pattern_ == EMPTY_END) {
+                *complete = true;
+                return cp - data;
+            }
+            end_phase_ = (end_pattern_ == STREAM_END) ? END_QUOTE : END_SPACE;
+            break;
+        case END_QUOTE:
+            if (c == '"' || c == '\'') {
+                end_phase_ = END_SPACE;
+            } else {
+                end_phase_ = END_TAG;
+                end_state_ = pattern.Advance(0, c);
+            }
+            break;
+        case END_SPACE:
+            if (c == '>') {
+                *complete = true;
+                return cp - data;
+            }
+            if (!patterns.IsSpace(c)) {
+                end_phase_ = END_TAG;
+                end_state_ = pattern.Advance(0, c);
+            }
+            break;
+        }
+    }
+    return size;
+}
+
+size_t XmppStanzaScanner::Scan(Stanza expected, const uint8_t *data,
+                               size_t size, bool *complete) {
+    *complete = false;
+
+    // Start afresh if the previous call completed a stanza.
+    if (complete_) {
+        complete_ = false;
+        stanza_ = NONE;
+        length_ = 0;
+        SetExpected(expected_);
+    }
+
+    size_t offset = 0;
+    if (stanza_ == NONE) {
+        // A run of whitespace at the beginning is a stanza by itself.
+        if (length_ == 0 && size > 0 && patterns.IsWhitespace(data[0])) {
+            while (offset < size && patterns.IsWhitespace(data[offset]))
+                offset++;
+            stanza_ = WHITESPACE;
+            length_ = offset;
+            complete_ = true;
+            *complete = true;
+            return offset;
+        }
+
+        if (expected != expected_)
+            SetExpected(expected);
+        offset = ScanStart(data, size);
+        if (stanza_ == NONE) {
+            length_ += offset;
+            return offset;
+        }
+    }
+
+    offset += ScanEnd(data + offset, size - offset, complete);
+    length_ += offset;
+    complete_ = *complete;
+    return offset;
+}
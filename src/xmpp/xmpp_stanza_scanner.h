@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2013 Juniper Networks, Inc. All rights reserved.
+ */
+
+#ifndef __XMPP_STANZA_SCANNER_H__
+#define __XMPP_STANZA_SCANNER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/util.h"
+
+//
+// Resumable scanner that finds the boundaries of stanzas in the byte stream
+// received on an XmppSession.
+//
+// The XmppSession calls Scan with each buffer it reads from the socket and
+// the type of stanza that it expects based on the state of the connection.
+// Scan looks at every byte exactly once and keeps enough state to continue
+// where it left off when a stanza spans multiple buffers, so the cost of
+// finding a stanza is linear in its size irrespective of how it's split up
+// across reads. The scanner does not keep any of the data itself.
+//
+// A stanza consists of any bytes preceding the start tag, the start tag and
+// everything up to and including the end tag. Which end tag is looked for
+// depends on the start tag that was found:
+//
+// o STREAM:          <stream:stream ... 'http://etherx.jabber.org/streams'>
+// o STREAM_FEATURES: <stream:features ... </stream:features>
+// o STARTTLS:        <starttls ... />
+// o PROCEED:         <proceed ... />
+// o MESSAGE:         <iq ... </iq> or <message ... </message>
+//
+// A run of whitespace characters at the beginning of a stanza is returned as
+// a separate WHITESPACE stanza since it's used as a keepalive.
+//
+class XmppStanzaScanner {
+public:
+    enum Stanza {
+        NONE,
+        STREAM,
+        STREAM_FEATURES,
+        STARTTLS,
+        PROCEED,
+        MESSAGE,
+        WHITESPACE,
+    };
+
+    XmppStanzaScanner();
+
+    // Scan up to size bytes of data, looking for the start of a stanza of
+    // the expected type if a start tag hasn't been found yet. Returns the
+    // number of bytes consumed. Sets complete to true if the bytes consumed
+    // so far make up a full stanza, in which case stanza() returns its type
+    // and the next call to Scan starts looking for a new stanza.
+    size_t Scan(Stanza expected, const uint8_t *data, size_t size,
+                bool *complete);
+
+    // Forget about any partially scanned stanza.
+    void Reset();
+
+    // Returns true if a different type of stanza is now expected and the
+    // bytes consumed so far don't contain a start tag. The caller needs to
+    // Reset and scan those bytes again in order to find the new start tag.
+    bool RescanRequired(Stanza expected) const {
+        return !complete_ && stanza_ == NONE && length_ > 0 &&
+            expected != expected_;
+    }
+
+    // Type of the stanza being scanned or the stanza that was just found.
+    Stanza stanza() const { return stanza_; }
+
+    // Number of bytes in the stanza being scanned or the one just found.
+    size_t length() const { return length_; }
+
+private:
+    enum EndPhase {
+        END_TAG,
+        END_QUOTE,
+        END_SPACE,
+    };
+
+    size_t ScanStart(const uint8_t *data, size_t size);
+    size_t ScanEnd(const uint8_t *data, size_t size, bool *complete);
+    void SetExpected(Stanza expected);
+
+    Stanza expected_;
+    Stanza stanza_;
+    bool complete_;
+    size_t length_;
+
+    // Patterns and match state when looking for a start tag.
+    int start_pattern_[2];
+    size_t start_state_[2];
+    int start_count_;
+
+    // Pattern and match state when looking for the end tag.
+    int end_pattern_;
+    size_t end_state_;
+    EndPhase end_phase_;
+
+    DISALLOW_COPY_AND_ASSIGN(XmppStanzaScanner);
+};
+
+#endif  // __XMPP_STANZA_SCANNER_H__